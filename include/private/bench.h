@@ -0,0 +1,64 @@
+/*
+ *   bench.h - Micro-benchmark helpers
+ *   Copyright (C) 2026 agent <agent@local>
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _BENCH_H_
+#define _BENCH_H_
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <inttypes.h>
+#include <time.h>
+
+/*
+ * All benchmarks print one record per line in the form
+ * "bench=NAME ops=N ns_per_op=N [key=value]...", so results of
+ * "make bench" can be compared by scripts.
+ */
+
+static inline uint64_t bench_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Fields passed by fmt are space separated "key=value" pairs */
+static inline void bench_record(const char *name, uint64_t ops,
+				uint64_t elapsed, const char *fmt, ...)
+	__attribute__((format(printf, 4, 5)));
+
+static inline void bench_record(const char *name, uint64_t ops,
+				uint64_t elapsed, const char *fmt, ...)
+{
+	va_list ap;
+
+	printf("bench=%s ops=%" PRIu64 " ns_per_op=%" PRIu64, name, ops,
+	       ops ? elapsed / ops : 0);
+	if (fmt && *fmt) {
+		putchar(' ');
+		va_start(ap, fmt);
+		vprintf(fmt, ap);
+		va_end(ap);
+	}
+	putchar('\n');
+}
+
+#endif /* _BENCH_H_ */
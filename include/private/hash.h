@@ -0,0 +1,183 @@
+/*
+ *   hash.h - Intrusive chained hash table
+ *   Copyright (C) 2026 agent <agent@local>
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _HASH_H_
+#define _HASH_H_
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <private/list.h>
+
+/*
+ * Entries embed struct hash_item and are chained into buckets. The hash
+ * value is stored in the item so the table can be resized without
+ * calling back to the user and lookups compare hashes before keys.
+ */
+
+struct hash_item {
+	struct list_item list;
+	uint32_t hash;
+};
+
+struct hash_table {
+	struct list_item *buckets;
+	unsigned int size; /* power of 2 */
+	unsigned int count;
+};
+
+#define HASH_TABLE_MIN_SIZE 16
+
+static inline uint32_t hash_mem(const void *data, size_t len, uint32_t hash)
+{
+	const unsigned char *p = data;
+
+	/* FNV-1a */
+	while (len--) {
+		hash ^= *p++;
+		hash *= 16777619;
+	}
+	return hash;
+}
+
+#define HASH_INIT 2166136261U
+
+static inline uint32_t hash_str(const char *str)
+{
+	uint32_t hash = HASH_INIT;
+
+	while (*str) {
+		hash ^= (unsigned char) *str++;
+		hash *= 16777619;
+	}
+	return hash;
+}
+
+static inline uint32_t hash_u32(uint32_t val)
+{
+	val ^= val >> 16;
+	val *= 0x7feb352d;
+	val ^= val >> 15;
+	val *= 0x846ca68b;
+	val ^= val >> 16;
+	return val;
+}
+
+static inline uint32_t hash_ptr(const void *ptr)
+{
+	uint64_t val = (uintptr_t) ptr;
+
+	return hash_u32((uint32_t) val ^ (uint32_t) (val >> 32));
+}
+
+static inline uint32_t hash_combine(uint32_t hash, uint32_t val)
+{
+	return hash ^ (val + 0x9e3779b9 + (hash << 6) + (hash >> 2));
+}
+
+static inline int __hash_table_alloc(struct hash_table *table,
+				     unsigned int size)
+{
+	unsigned int i;
+
+	table->buckets = malloc(sizeof(*table->buckets) * size);
+	if (!table->buckets)
+		return -ENOMEM;
+	for (i = 0; i < size; i++)
+		list_init(&table->buckets[i]);
+	table->size = size;
+	return 0;
+}
+
+static inline int hash_table_init(struct hash_table *table)
+{
+	table->count = 0;
+	return __hash_table_alloc(table, HASH_TABLE_MIN_SIZE);
+}
+
+static inline void hash_table_fini(struct hash_table *table)
+{
+	free(table->buckets);
+	table->buckets = NULL;
+	table->size = 0;
+	table->count = 0;
+}
+
+static inline struct list_item *hash_table_bucket(struct hash_table *table,
+						  uint32_t hash)
+{
+	return &table->buckets[hash & (table->size - 1)];
+}
+
+static inline void __hash_table_resize(struct hash_table *table,
+				       unsigned int new_size)
+{
+	struct hash_table new_table;
+	struct hash_item *item;
+	struct hash_item *tmp;
+	unsigned int i;
+
+	/* Failing to grow only makes chains longer, that is not fatal */
+	if (__hash_table_alloc(&new_table, new_size))
+		return;
+	for (i = 0; i < table->size; i++) {
+		list_for_each_node_entry_safe(item, tmp, &table->buckets[i],
+					      list)
+			list_add_tail(hash_table_bucket(&new_table, item->hash),
+				      &item->list);
+	}
+	free(table->buckets);
+	table->buckets = new_table.buckets;
+	table->size = new_table.size;
+}
+
+static inline void hash_table_add(struct hash_table *table,
+				  struct hash_item *item, uint32_t hash)
+{
+	item->hash = hash;
+	list_add_tail(hash_table_bucket(table, hash), &item->list);
+	if (++table->count > table->size)
+		__hash_table_resize(table, table->size * 2);
+}
+
+static inline void hash_table_del(struct hash_table *table,
+				  struct hash_item *item)
+{
+	list_del(&item->list);
+	table->count--;
+}
+
+#define hash_table_entry(item, struct_type, struct_member)		\
+	get_container(item, struct_type, struct_member)
+
+/*
+ * Iterates over all entries which hashed to the same value. Caller still
+ * has to compare keys.
+ */
+#define hash_table_for_each_match(entry, table, hashval, struct_member)	\
+	list_for_each_node_entry(entry, hash_table_bucket(table, hashval),	\
+				 struct_member.list)				\
+		if ((entry)->struct_member.hash != (hashval)) {} else
+
+#define hash_table_for_each_entry(entry, table, i, struct_member)	\
+	for (i = 0; i < (table)->size; i++)				\
+		list_for_each_node_entry(entry, &(table)->buckets[i],	\
+					 struct_member.list)
+
+#endif /* _HASH_H_ */
@@ -0,0 +1,128 @@
+/*
+ *   pool.h - Pool of fixed-size objects
+ *   Copyright (C) 2026 agent <agent@local>
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _POOL_H_
+#define _POOL_H_
+
+#include <stdlib.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Objects are carved from chunks which are only returned to the system
+ * by pool_fini(). Freed objects are kept on a free list and reused, so
+ * once the pool has grown to its working set no more allocations are
+ * done. Chunks double in size up to POOL_CHUNK_MAX_OBJS objects.
+ */
+
+struct pool_chunk {
+	struct pool_chunk *next;
+	/* objects follow, aligned to max_align_t */
+};
+
+struct pool_free_obj {
+	struct pool_free_obj *next;
+};
+
+struct pool {
+	size_t obj_size;
+	unsigned int chunk_objs; /* objects in next chunk */
+	struct pool_chunk *chunks;
+	struct pool_free_obj *free_list;
+	uint64_t chunk_count; /* allocations done by pool */
+};
+
+#define POOL_CHUNK_MIN_OBJS 16
+#define POOL_CHUNK_MAX_OBJS 1024
+
+#define __POOL_ALIGN(size)						\
+	(((size) + sizeof(max_align_t) - 1) & ~(sizeof(max_align_t) - 1))
+
+static inline void pool_init(struct pool *pool, size_t obj_size)
+{
+	if (obj_size < sizeof(struct pool_free_obj))
+		obj_size = sizeof(struct pool_free_obj);
+	pool->obj_size = __POOL_ALIGN(obj_size);
+	pool->chunk_objs = POOL_CHUNK_MIN_OBJS;
+	pool->chunks = NULL;
+	pool->free_list = NULL;
+	pool->chunk_count = 0;
+}
+
+static inline int __pool_grow(struct pool *pool)
+{
+	size_t hdr_size = __POOL_ALIGN(sizeof(struct pool_chunk));
+	struct pool_chunk *chunk;
+	struct pool_free_obj *obj;
+	char *objs;
+	unsigned int i;
+
+	chunk = malloc(hdr_size + pool->obj_size * pool->chunk_objs);
+	if (!chunk)
+		return -1;
+	chunk->next = pool->chunks;
+	pool->chunks = chunk;
+	pool->chunk_count++;
+	objs = (char *) chunk + hdr_size;
+	for (i = pool->chunk_objs; i > 0; i--) {
+		obj = (struct pool_free_obj *) (objs + (i - 1) * pool->obj_size);
+		obj->next = pool->free_list;
+		pool->free_list = obj;
+	}
+	if (pool->chunk_objs < POOL_CHUNK_MAX_OBJS)
+		pool->chunk_objs *= 2;
+	return 0;
+}
+
+/* Returns zeroed object */
+static inline void *pool_alloc(struct pool *pool)
+{
+	struct pool_free_obj *obj;
+
+	if (!pool->free_list && __pool_grow(pool))
+		return NULL;
+	obj = pool->free_list;
+	pool->free_list = obj->next;
+	memset(obj, 0, pool->obj_size);
+	return obj;
+}
+
+static inline void pool_free(struct pool *pool, void *ptr)
+{
+	struct pool_free_obj *obj = ptr;
+
+	obj->next = pool->free_list;
+	pool->free_list = obj;
+}
+
+/* All objects must be freed or abandoned */
+static inline void pool_fini(struct pool *pool)
+{
+	struct pool_chunk *chunk;
+
+	while (pool->chunks) {
+		chunk = pool->chunks;
+		pool->chunks = chunk->next;
+		free(chunk);
+	}
+	pool->free_list = NULL;
+}
+
+#endif /* _POOL_H_ */
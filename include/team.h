@@ -52,6 +52,41 @@ void team_set_log_priority(struct team_handle *th, int priority);
 int team_get_event_fd(struct team_handle *th);
 int team_handle_events(struct team_handle *th);
 int team_check_events(struct team_handle *th);
+uint64_t team_get_alloc_count(struct team_handle *th);
+int team_set_sock_buffer_size(struct team_handle *th, unsigned int size,
+			      unsigned int max_size);
+uint64_t team_get_overrun_count(struct team_handle *th);
+uint64_t team_get_resync_count(struct team_handle *th);
+int team_set_emul_port(struct team_handle *th, uint32_t port);
+
+/*
+ * team_req
+ *
+ * asynchronous requests, completed from team_handle_events()
+ */
+typedef void (*team_req_done_func_t)(struct team_handle *th, uint32_t req_id,
+				     int err, void *priv);
+void team_set_req_timeout(struct team_handle *th, unsigned int timeout);
+int team_req_cancel(struct team_handle *th, uint32_t req_id);
+unsigned int team_get_req_inflight_count(struct team_handle *th);
+
+/*
+ * team_evmux
+ *
+ * event sockets shared by many library user contexts
+ */
+struct team_evmux;
+
+struct team_evmux *team_evmux_alloc(void);
+int team_evmux_init(struct team_evmux *evmux);
+void team_evmux_free(struct team_evmux *evmux);
+int team_evmux_set_sock_buffer_size(struct team_evmux *evmux,
+				    unsigned int size, unsigned int max_size);
+int team_evmux_set_emul_port(struct team_evmux *evmux, uint32_t port);
+int team_evmux_get_event_fd(struct team_evmux *evmux);
+int team_evmux_handle_events(struct team_evmux *evmux);
+int team_set_evmux(struct team_handle *th, struct team_evmux *evmux);
+
 int team_get_mode_name(struct team_handle *th, char **mode_name);
 int team_set_mode_name(struct team_handle *th, const char *mode_name);
 int team_get_notify_peers_count(struct team_handle *th, uint32_t *count);
@@ -83,6 +118,29 @@ int team_set_port_priority(struct team_handle *th,
 struct team_ifinfo;
 struct team_ifinfo *team_get_ifinfo(struct team_handle *th);
 
+/*
+ * team_link_stats
+ *
+ * traffic counters of team device and ports, refreshed on request
+ */
+struct team_link_stats {
+	uint64_t	rx_packets;
+	uint64_t	tx_packets;
+	uint64_t	rx_bytes;
+	uint64_t	tx_bytes;
+	uint64_t	rx_errors;
+	uint64_t	tx_errors;
+	uint64_t	rx_dropped;
+	uint64_t	tx_dropped;
+	uint64_t	multicast;
+	uint64_t	timestamp; /* ms, CLOCK_MONOTONIC */
+};
+
+int team_refresh_stats(struct team_handle *th);
+int team_set_stats_refresh_interval(struct team_handle *th,
+				    unsigned int interval);
+const struct team_link_stats *team_get_stats(struct team_handle *th);
+
 /*
  * team_eventfd - DEPRECATED
  *
@@ -114,6 +172,11 @@ struct team_port *team_get_next_port(struct team_handle *th,
 #define team_for_each_port(port, th)				\
 	for (port = team_get_next_port(th, NULL); port;		\
 	     port = team_get_next_port(th, port))
+struct team_port *team_get_next_changed_port(struct team_handle *th,
+					     struct team_port *port);
+#define team_for_each_changed_port(port, th)				\
+	for (port = team_get_next_changed_port(th, NULL); port;		\
+	     port = team_get_next_changed_port(th, port))
 /* port getters */
 uint32_t team_get_port_ifindex(struct team_port *port);
 uint32_t team_get_port_speed(struct team_port *port);
@@ -122,6 +185,7 @@ bool team_is_port_link_up(struct team_port *port);
 bool team_is_port_changed(struct team_port *port);
 bool team_is_port_removed(struct team_port *port);
 struct team_ifinfo *team_get_port_ifinfo(struct team_port *port);
+const struct team_link_stats *team_get_port_stats(struct team_port *port);
 bool team_is_port_present(struct team_handle *th, struct team_port *port);
 
 /*
@@ -135,6 +199,14 @@ struct team_ifinfo *team_get_next_ifinfo(struct team_handle *th,
 #define team_for_each_ifinfo(ifinfo, th)			\
 	for (ifinfo = team_get_next_ifinfo(th, NULL); ifinfo;	\
 	     ifinfo = team_get_next_ifinfo(th, ifinfo))
+struct team_ifinfo *team_get_next_changed_ifinfo(struct team_handle *th,
+						 struct team_ifinfo *ifinfo);
+#define team_for_each_changed_ifinfo(ifinfo, th)			\
+	for (ifinfo = team_get_next_changed_ifinfo(th, NULL); ifinfo;	\
+	     ifinfo = team_get_next_changed_ifinfo(th, ifinfo))
+int team_ifinfo_watch(struct team_handle *th, uint32_t ifindex,
+		      struct team_ifinfo **p_ifinfo);
+void team_ifinfo_unwatch(struct team_handle *th, uint32_t ifindex);
 /* ifinfo getters */
 bool team_is_ifinfo_removed(struct team_ifinfo *ifinfo);
 uint32_t team_get_ifinfo_ifindex(struct team_ifinfo *ifinfo);
@@ -154,6 +226,10 @@ bool team_is_ifinfo_phys_port_id_changed(struct team_ifinfo *ifinfo);
 size_t team_get_ifinfo_phys_port_id_len(struct team_ifinfo *ifinfo);
 bool team_is_ifinfo_phys_port_id_len_changed(struct team_ifinfo *ifinfo);
 bool team_is_ifinfo_changed(struct team_ifinfo *ifinfo);
+const struct team_link_stats *
+team_get_ifinfo_stats(struct team_ifinfo *ifinfo);
+const struct team_link_stats *
+team_get_ifinfo_prev_stats(struct team_ifinfo *ifinfo);
 
 /*
  * team_option
@@ -179,6 +255,11 @@ struct team_option *team_get_next_option(struct team_handle *th,
 #define team_for_each_option(port, th)				\
 	for (option = team_get_next_option(th, NULL); option;	\
 	     option = team_get_next_option(th, option))
+struct team_option *team_get_next_changed_option(struct team_handle *th,
+						 struct team_option *option);
+#define team_for_each_changed_option(option, th)			\
+	for (option = team_get_next_changed_option(th, NULL); option;	\
+	     option = team_get_next_changed_option(th, option))
 bool team_is_option_initialized(struct team_option *option);
 
 /* option getters */
@@ -209,6 +290,86 @@ int team_set_option_value_bool(struct team_handle *th,
 			       struct team_option *option, bool val);
 int team_set_option_value_s32(struct team_handle *th,
 			      struct team_option *option, int32_t val);
+int team_set_option_value_u32_async(struct team_handle *th,
+				    struct team_option *option, uint32_t val,
+				    unsigned int timeout,
+				    team_req_done_func_t done, void *priv,
+				    uint32_t *req_id);
+int team_set_option_value_string_async(struct team_handle *th,
+				       struct team_option *option,
+				       const char *str, unsigned int timeout,
+				       team_req_done_func_t done, void *priv,
+				       uint32_t *req_id);
+int team_set_option_value_binary_async(struct team_handle *th,
+				       struct team_option *option,
+				       const void *data,
+				       unsigned int data_len,
+				       unsigned int timeout,
+				       team_req_done_func_t done, void *priv,
+				       uint32_t *req_id);
+int team_set_option_value_bool_async(struct team_handle *th,
+				     struct team_option *option, bool val,
+				     unsigned int timeout,
+				     team_req_done_func_t done, void *priv,
+				     uint32_t *req_id);
+int team_set_option_value_s32_async(struct team_handle *th,
+				    struct team_option *option, int32_t val,
+				    unsigned int timeout,
+				    team_req_done_func_t done, void *priv,
+				    uint32_t *req_id);
+
+/* option handles */
+struct team_option_handle;
+struct team_option_handle *team_option_handle_alloc(struct team_handle *th,
+						    const char *fmt, ...);
+void team_option_handle_free(struct team_handle *th,
+			     struct team_option_handle *handle);
+struct team_option *
+team_option_handle_get_option(struct team_option_handle *handle);
+int team_option_handle_get_value_u32(struct team_option_handle *handle,
+				     uint32_t *val);
+int team_option_handle_get_value_string(struct team_option_handle *handle,
+					char **str);
+int team_option_handle_get_value_binary(struct team_option_handle *handle,
+					void **data, unsigned int *data_len);
+int team_option_handle_get_value_bool(struct team_option_handle *handle,
+				      bool *val);
+int team_option_handle_get_value_s32(struct team_option_handle *handle,
+				     int32_t *val);
+int team_option_handle_set_value_u32(struct team_handle *th,
+				     struct team_option_handle *handle,
+				     uint32_t val);
+int team_option_handle_set_value_string(struct team_handle *th,
+					struct team_option_handle *handle,
+					const char *str);
+int team_option_handle_set_value_binary(struct team_handle *th,
+					struct team_option_handle *handle,
+					const void *data,
+					unsigned int data_len);
+int team_option_handle_set_value_bool(struct team_handle *th,
+				      struct team_option_handle *handle,
+				      bool val);
+int team_option_handle_set_value_s32(struct team_handle *th,
+				     struct team_option_handle *handle,
+				     int32_t val);
+
+/* option set transactions */
+int team_option_txn_begin(struct team_handle *th);
+void team_option_txn_abort(struct team_handle *th);
+int team_option_txn_commit(struct team_handle *th);
+int team_option_txn_get_item_err(struct team_handle *th, unsigned int index);
+int team_option_txn_set_value_u32(struct team_handle *th,
+				  struct team_option *option, uint32_t val);
+int team_option_txn_set_value_string(struct team_handle *th,
+				     struct team_option *option,
+				     const char *str);
+int team_option_txn_set_value_binary(struct team_handle *th,
+				     struct team_option *option,
+				     const void *data, unsigned int data_len);
+int team_option_txn_set_value_bool(struct team_handle *th,
+				   struct team_option *option, bool val);
+int team_option_txn_set_value_s32(struct team_handle *th,
+				  struct team_option *option, int32_t val);
 
 /*
  * team_change_handler
@@ -222,6 +383,8 @@ enum {
 	TEAM_ANY_CHANGE		= TEAM_PORT_CHANGE |
 				  TEAM_OPTION_CHANGE |
 				  TEAM_IFINFO_CHANGE,
+	/* not part of TEAM_ANY_CHANGE, counters change on every refresh */
+	TEAM_STATS_CHANGE	= 0x8,
 };
 
 typedef unsigned int team_change_type_mask_t;
@@ -275,6 +438,73 @@ int team_hwaddr_get(struct team_handle *th, uint32_t ifindex,
 		    char *addr, unsigned int addr_len);
 int team_hwaddr_len_get(struct team_handle *th, uint32_t ifindex);
 
+/*
+ * team_snapshot
+ *
+ * immutable copy of ports, options and ifinfos readable from any thread
+ */
+struct team_snapshot;
+
+int team_snapshot_enable(struct team_handle *th);
+void team_snapshot_disable(struct team_handle *th);
+struct team_snapshot *team_snapshot_get(struct team_handle *th);
+void team_snapshot_put(struct team_snapshot *snap);
+uint64_t team_snapshot_get_generation(struct team_snapshot *snap);
+struct team_port *team_snapshot_get_next_port(struct team_snapshot *snap,
+					      struct team_port *port);
+#define team_snapshot_for_each_port(port, snap)				\
+	for (port = team_snapshot_get_next_port(snap, NULL); port;	\
+	     port = team_snapshot_get_next_port(snap, port))
+struct team_option *team_snapshot_get_option(struct team_snapshot *snap,
+					     const char *fmt, ...);
+struct team_option *team_snapshot_get_next_option(struct team_snapshot *snap,
+						  struct team_option *option);
+#define team_snapshot_for_each_option(option, snap)			\
+	for (option = team_snapshot_get_next_option(snap, NULL); option;	\
+	     option = team_snapshot_get_next_option(snap, option))
+struct team_ifinfo *team_snapshot_get_next_ifinfo(struct team_snapshot *snap,
+						  struct team_ifinfo *ifinfo);
+#define team_snapshot_for_each_ifinfo(ifinfo, snap)			\
+	for (ifinfo = team_snapshot_get_next_ifinfo(snap, NULL); ifinfo;	\
+	     ifinfo = team_snapshot_get_next_ifinfo(snap, ifinfo))
+
+/*
+ * team_emul
+ *
+ * userspace stand-in of team kernel family for tests and benchmarks
+ */
+struct team_emul;
+
+struct team_emul *team_emul_alloc(void);
+int team_emul_start(struct team_emul *emul);
+void team_emul_free(struct team_emul *emul);
+uint32_t team_emul_get_port(struct team_emul *emul);
+uint64_t team_emul_get_drop_count(struct team_emul *emul);
+int team_emul_link_add(struct team_emul *emul, const char *ifname,
+		       const char *kind, uint32_t *p_ifindex);
+uint32_t team_emul_ifname2ifindex(struct team_emul *emul, const char *ifname);
+int team_emul_link_del(struct team_emul *emul, uint32_t ifindex);
+int team_emul_link_set_carrier(struct team_emul *emul, uint32_t ifindex,
+			       bool carrier_up);
+int team_emul_port_add(struct team_emul *emul, uint32_t team_ifindex,
+		       uint32_t port_ifindex);
+int team_emul_option_add(struct team_emul *emul, uint32_t team_ifindex,
+			 const char *name, unsigned int array_size);
+int team_emul_option_set_u32(struct team_emul *emul, uint32_t team_ifindex,
+			     const char *name, uint32_t value);
+int team_emul_option_get_u32(struct team_emul *emul, uint32_t team_ifindex,
+			     const char *name, uint32_t *p_value);
+uint64_t team_emul_get_option_set_count(struct team_emul *emul,
+					uint32_t team_ifindex,
+					const char *name);
+int team_emul_wait_option_set(struct team_emul *emul, uint32_t team_ifindex,
+			      const char *name, uint64_t set_count,
+			      unsigned int timeout);
+int team_emul_option_storm(struct team_emul *emul, uint32_t team_ifindex,
+			   unsigned int count);
+int team_emul_lb_stats_refresh(struct team_emul *emul, uint32_t team_ifindex,
+			       const uint64_t *tx_bytes);
+
 #ifdef __cplusplus
 } /* extern "C" */
 #endif
@@ -0,0 +1,2249 @@
+/*
+ *   emul.c - Userspace emulation of team netlink family
+ *   Copyright (C) 2026 agent <agent@local>
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <linux/if.h>
+#include <linux/if_arp.h>
+#include <netlink/netlink.h>
+#include <netlink/genl/genl.h>
+#include <linux/if_team.h>
+#include <linux/rtnetlink.h>
+#include <linux/if_link.h>
+#include <linux/netlink.h>
+#include <team.h>
+#include <private/list.h>
+#include <private/misc.h>
+#include "team_private.h"
+
+/**
+ * SECTION: emul
+ * @short_description: Userspace stand-in of team kernel family
+ *
+ * Emulator answers team generic netlink and link route netlink requests
+ * the way kernel does, so library contexts and teamd may be run without
+ * team module, privileges or real links. It listens on NETLINK_USERSOCK
+ * socket served by its own thread. Context is pointed to it by
+ * team_set_emul_port(), teamd by its --emul-port option.
+ *
+ * Links, ports and options are scripted by team_emul_* functions which
+ * may be called from any thread. Changes are announced by events like
+ * kernel does. Events which do not fit receive buffer of a subscriber are
+ * dropped and subscriber gets ENOBUFS error, same as on kernel multicast
+ * overrun. Port link state follows link carrier.
+ */
+
+#define EMUL_RECV_BUF_SIZE 65536
+#define EMUL_MSG_SIZE 8192
+#define EMUL_SOCK_BUF_SIZE (1024 * 1024)
+#define EMUL_RETRY_INTERVAL 1 /* ms */
+#define EMUL_BLOCKED_MAX 16
+#define EMUL_MODE_NAME_LEN 32
+#define EMUL_PORT_SPEED 1000
+#define EMUL_PORT_DUPLEX 1 /* full */
+#define EMUL_LB_HASH_COUNT 256
+
+struct emul_option_desc {
+	const char *		name;
+	int			type; /* NLA_* */
+	bool			per_port;
+	unsigned int		array_size;
+	bool			readonly;
+	const char *		mode; /* NULL for core options */
+	uint32_t		u32; /* default of u32, s32 and flag */
+	const char *		str; /* default of string */
+	int			data_len; /* default of binary is zeroed */
+};
+
+static const struct emul_option_desc emul_option_descs[] = {
+	{ .name = "mode", .type = NLA_STRING, .str = "" },
+	{ .name = "notify_peers_count", .type = NLA_U32 },
+	{ .name = "notify_peers_interval", .type = NLA_U32 },
+	{ .name = "mcast_rejoin_count", .type = NLA_U32 },
+	{ .name = "mcast_rejoin_interval", .type = NLA_U32 },
+	{ .name = "enabled", .type = NLA_FLAG, .per_port = true, .u32 = 1 },
+	{ .name = "user_linkup", .type = NLA_FLAG, .per_port = true },
+	{ .name = "user_linkup_enabled", .type = NLA_FLAG, .per_port = true },
+	{ .name = "priority", .type = NLA_S32, .per_port = true },
+	{ .name = "queue_id", .type = NLA_U32, .per_port = true },
+	{ .name = "activeport", .type = NLA_U32, .mode = "activebackup" },
+	{ .name = "bpf_hash_func", .type = NLA_BINARY, .mode = "loadbalance" },
+	{ .name = "lb_tx_method", .type = NLA_STRING, .mode = "loadbalance",
+	  .str = "hash" },
+	{ .name = "lb_tx_hash_to_port_mapping", .type = NLA_U32,
+	  .array_size = EMUL_LB_HASH_COUNT, .mode = "loadbalance" },
+	{ .name = "lb_hash_stats", .type = NLA_BINARY,
+	  .array_size = EMUL_LB_HASH_COUNT,
+	  .readonly = true, .mode = "loadbalance", .data_len = 8 },
+	{ .name = "lb_port_stats", .type = NLA_BINARY, .per_port = true,
+	  .readonly = true, .mode = "loadbalance", .data_len = 8 },
+	{ .name = "lb_stats_refresh_interval", .type = NLA_U32,
+	  .mode = "loadbalance", .u32 = 50 },
+	{ .name = "bpf_hash_func", .type = NLA_BINARY, .mode = "random" },
+};
+
+static const char *emul_mode_names[] = {
+	"roundrobin", "activebackup", "loadbalance", "broadcast", "random",
+};
+
+struct emul_option {
+	struct list_item	list;
+	char *			name;
+	int			type; /* NLA_* */
+	uint32_t		port_ifindex;
+	bool			per_port;
+	uint32_t		array_index;
+	bool			array;
+	bool			readonly;
+	bool			mode_owned;
+	bool			storm; /* added by team_emul_option_add() */
+	bool			changed;
+	bool			removed;
+	uint32_t		u32; /* u32, s32 and flag */
+	char *			data; /* string and binary */
+	int			data_len;
+	uint64_t		set_count;
+};
+
+struct emul_team {
+	char			mode[EMUL_MODE_NAME_LEN];
+	struct list_item	option_list;
+	unsigned int		port_count;
+	struct emul_option *	storm_option;
+};
+
+struct emul_link {
+	struct list_item	list;
+	uint32_t		ifindex;
+	char			ifname[IFNAMSIZ];
+	char			kind[IFNAMSIZ];
+	unsigned char		hwaddr[6];
+	unsigned int		flags; /* IFF_UP */
+	bool			carrier;
+	uint32_t		mtu;
+	uint32_t		master;
+	struct emul_team *	team; /* team device only */
+};
+
+/* Socket subscribed to one of TEAM_EMUL_GRP_* */
+struct emul_sub {
+	struct list_item	list;
+	uint32_t		pid;
+	uint32_t		group;
+	bool			overrun; /* ENOBUFS is to be reported */
+};
+
+struct emul_out {
+	struct list_item	list;
+	uint32_t		pid;
+	struct nl_msg *		msg;
+};
+
+struct team_emul {
+	int			sock_fd;
+	uint32_t		port;
+	int			quit_fd;
+	pthread_t		thread;
+	bool			started;
+	pthread_mutex_t		lock;
+	pthread_cond_t		set_cond; /* signalled on option set */
+	struct list_item	link_list;
+	uint32_t		last_ifindex;
+	struct list_item	sub_list;
+	struct list_item	out_list; /* replies not sent yet */
+	uint64_t		drop_count;
+	char *			recv_buf;
+};
+
+static int emul_sendto(struct team_emul *emul, uint32_t pid,
+		       const void *buf, size_t len)
+{
+	struct sockaddr_nl addr = {
+		.nl_family = AF_NETLINK,
+		.nl_pid = pid,
+	};
+	ssize_t ret;
+
+	do {
+		ret = sendto(emul->sock_fd, buf, len, MSG_DONTWAIT,
+			     (struct sockaddr *) &addr, sizeof(addr));
+	} while (ret == -1 && errno == EINTR);
+	return ret == -1 ? -errno : 0;
+}
+
+static int emul_msg_sendto(struct team_emul *emul, uint32_t pid,
+			   struct nl_msg *msg)
+{
+	struct nlmsghdr *nlh = nlmsg_hdr(msg);
+
+	return emul_sendto(emul, pid, nlh, nlh->nlmsg_len);
+}
+
+static int emul_batch_add(struct list_item *batch, struct nl_msg *msg)
+{
+	struct emul_out *out;
+
+	out = malloc(sizeof(*out));
+	if (!out) {
+		nlmsg_free(msg);
+		return -ENOMEM;
+	}
+	out->msg = msg;
+	out->pid = 0;
+	list_add_tail(batch, &out->list);
+	return 0;
+}
+
+static void emul_out_free(struct emul_out *out)
+{
+	list_del(&out->list);
+	nlmsg_free(out->msg);
+	free(out);
+}
+
+static void emul_batch_free(struct list_item *batch)
+{
+	struct emul_out *out;
+	struct emul_out *tmp;
+
+	list_for_each_node_entry_safe(out, tmp, batch, list)
+		emul_out_free(out);
+}
+
+/*
+ * Replies are not dropped. In case requester socket is full, the rest of
+ * replies to it waits for the next flush, replies to others still go.
+ */
+static void emul_flush(struct team_emul *emul)
+{
+	uint32_t blocked[EMUL_BLOCKED_MAX];
+	unsigned int blocked_count = 0;
+	struct emul_out *out;
+	struct emul_out *tmp;
+	unsigned int i;
+	int err;
+
+	list_for_each_node_entry_safe(out, tmp, &emul->out_list, list) {
+		for (i = 0; i < blocked_count; i++)
+			if (blocked[i] == out->pid)
+				break;
+		if (i < blocked_count)
+			continue;
+		err = emul_msg_sendto(emul, out->pid, out->msg);
+		if (err == -EAGAIN) {
+			if (blocked_count == EMUL_BLOCKED_MAX)
+				break;
+			blocked[blocked_count++] = out->pid;
+			continue;
+		}
+		/* Requester which went away does not get the rest */
+		emul_out_free(out);
+	}
+}
+
+static void emul_reply_batch(struct team_emul *emul, uint32_t pid,
+			     struct list_item *batch)
+{
+	struct emul_out *out;
+
+	list_for_each_node_entry(out, batch, list)
+		out->pid = pid;
+	list_move_nodes(&emul->out_list, batch);
+}
+
+static void emul_reply(struct team_emul *emul, uint32_t pid,
+		       struct nl_msg *msg)
+{
+	struct list_item batch;
+
+	list_init(&batch);
+	if (!emul_batch_add(&batch, msg))
+		emul_reply_batch(emul, pid, &batch);
+}
+
+static void emul_ack(struct team_emul *emul, uint32_t pid,
+		     struct nlmsghdr *req_nlh, int err)
+{
+	struct nlmsgerr *nlerr;
+	struct nl_msg *msg;
+
+	if (!err && !(req_nlh->nlmsg_flags & NLM_F_ACK))
+		return;
+	msg = nlmsg_alloc();
+	if (!msg)
+		return;
+	if (!nlmsg_put(msg, pid, req_nlh->nlmsg_seq, NLMSG_ERROR,
+		       sizeof(*nlerr), 0)) {
+		nlmsg_free(msg);
+		return;
+	}
+	nlerr = nlmsg_data(nlmsg_hdr(msg));
+	nlerr->error = err;
+	nlerr->msg = *req_nlh;
+	emul_reply(emul, pid, msg);
+}
+
+static void emul_sub_del(struct emul_sub *sub)
+{
+	list_del(&sub->list);
+	free(sub);
+}
+
+static int emul_sub_overrun_report(struct team_emul *emul,
+				   struct emul_sub *sub)
+{
+	struct {
+		struct nlmsghdr	nlh;
+		struct nlmsgerr	nlerr;
+	} buf;
+	int err;
+
+	memset(&buf, 0, sizeof(buf));
+	buf.nlh.nlmsg_len = sizeof(buf);
+	buf.nlh.nlmsg_type = NLMSG_ERROR;
+	buf.nlh.nlmsg_pid = sub->pid;
+	buf.nlerr.error = -ENOBUFS;
+	err = emul_sendto(emul, sub->pid, &buf, sizeof(buf));
+	if (!err)
+		sub->overrun = false;
+	return err;
+}
+
+static void emul_subs_retry(struct team_emul *emul)
+{
+	struct emul_sub *sub;
+	struct emul_sub *tmp;
+
+	list_for_each_node_entry_safe(sub, tmp, &emul->sub_list, list) {
+		if (sub->overrun &&
+		    emul_sub_overrun_report(emul, sub) == -ECONNREFUSED)
+			emul_sub_del(sub);
+	}
+}
+
+/* Events are sent right away, ones not fitting are dropped */
+static void emul_event_batch(struct team_emul *emul, uint32_t group,
+			     struct list_item *batch)
+{
+	struct emul_sub *sub;
+	struct emul_sub *tmp;
+	struct emul_out *out;
+	int err = 0;
+
+	if (list_empty(batch))
+		return;
+	list_for_each_node_entry_safe(sub, tmp, &emul->sub_list, list) {
+		if (sub->group != group)
+			continue;
+		if (sub->overrun)
+			err = emul_sub_overrun_report(emul, sub);
+		if (!err) {
+			list_for_each_node_entry(out, batch, list) {
+				err = emul_msg_sendto(emul, sub->pid,
+						      out->msg);
+				if (err)
+					break;
+			}
+		}
+		if (err == -ECONNREFUSED) {
+			emul_sub_del(sub);
+		} else if (err) {
+			sub->overrun = true;
+			emul->drop_count++;
+		}
+		err = 0;
+	}
+	emul_batch_free(batch);
+}
+
+static bool emul_pending(struct team_emul *emul)
+{
+	struct emul_sub *sub;
+
+	if (!list_empty(&emul->out_list))
+		return true;
+	list_for_each_node_entry(sub, &emul->sub_list, list)
+		if (sub->overrun)
+			return true;
+	return false;
+}
+
+/* Called by scripting functions, thread picks up what was left */
+static void emul_kick(struct team_emul *emul)
+{
+	const uint64_t one = 1;
+	int ret;
+
+	emul_flush(emul);
+	if (!emul_pending(emul))
+		return;
+	ret = write(emul->quit_fd, &one, sizeof(one));
+	(void) ret;
+}
+
+/*
+ * Links
+ */
+
+static struct emul_link *emul_link_find(struct team_emul *emul,
+					uint32_t ifindex)
+{
+	struct emul_link *link;
+
+	list_for_each_node_entry(link, &emul->link_list, list)
+		if (link->ifindex == ifindex)
+			return link;
+	return NULL;
+}
+
+static struct emul_link *emul_link_find_by_name(struct team_emul *emul,
+						const char *ifname)
+{
+	struct emul_link *link;
+
+	list_for_each_node_entry(link, &emul->link_list, list)
+		if (!strcmp(link->ifname, ifname))
+			return link;
+	return NULL;
+}
+
+static unsigned int emul_link_ifi_flags(struct emul_link *link)
+{
+	unsigned int flags = link->flags | IFF_BROADCAST | IFF_MULTICAST;
+
+	if (link->carrier)
+		flags |= IFF_LOWER_UP;
+	if (link->carrier && (link->flags & IFF_UP))
+		flags |= IFF_RUNNING;
+	return flags;
+}
+
+static struct nl_msg *emul_link_msg(struct emul_link *link, int type,
+				    uint32_t pid, uint32_t seq, int flags)
+{
+	struct rtnl_link_stats64 stats;
+	struct ifinfomsg ifi;
+	struct nlattr *linkinfo;
+	struct nl_msg *msg;
+	bool running;
+
+	msg = nlmsg_alloc();
+	if (!msg)
+		return NULL;
+	if (!nlmsg_put(msg, pid, seq, type, 0, flags))
+		goto nla_put_failure;
+	memset(&ifi, 0, sizeof(ifi));
+	ifi.ifi_family = AF_UNSPEC;
+	ifi.ifi_type = ARPHRD_ETHER;
+	ifi.ifi_index = link->ifindex;
+	ifi.ifi_flags = emul_link_ifi_flags(link);
+	if (nlmsg_append(msg, &ifi, sizeof(ifi), NLMSG_ALIGNTO))
+		goto nla_put_failure;
+	running = ifi.ifi_flags & IFF_RUNNING;
+	NLA_PUT_STRING(msg, IFLA_IFNAME, link->ifname);
+	NLA_PUT(msg, IFLA_ADDRESS, sizeof(link->hwaddr), link->hwaddr);
+	NLA_PUT_U32(msg, IFLA_MTU, link->mtu);
+	if (link->master)
+		NLA_PUT_U32(msg, IFLA_MASTER, link->master);
+	NLA_PUT_U8(msg, IFLA_CARRIER, link->carrier);
+	NLA_PUT_U8(msg, IFLA_OPERSTATE, running ? IF_OPER_UP : IF_OPER_DOWN);
+	memset(&stats, 0, sizeof(stats));
+	NLA_PUT(msg, IFLA_STATS64, sizeof(stats), &stats);
+	if (link->kind[0]) {
+		linkinfo = nla_nest_start(msg, IFLA_LINKINFO);
+		if (!linkinfo)
+			goto nla_put_failure;
+		NLA_PUT_STRING(msg, IFLA_INFO_KIND, link->kind);
+		nla_nest_end(msg, linkinfo);
+	}
+	return msg;
+
+nla_put_failure:
+	nlmsg_free(msg);
+	return NULL;
+}
+
+static void emul_link_event(struct team_emul *emul, struct emul_link *link,
+			    int type)
+{
+	struct list_item batch;
+	struct nl_msg *msg;
+
+	list_init(&batch);
+	msg = emul_link_msg(link, type, 0, 0, 0);
+	if (msg && !emul_batch_add(&batch, msg))
+		emul_event_batch(emul, TEAM_EMUL_GRP_LINK, &batch);
+}
+
+/*
+ * Options
+ */
+
+static void emul_option_free(struct emul_option *option)
+{
+	list_del(&option->list);
+	free(option->name);
+	free(option->data);
+	free(option);
+}
+
+static struct emul_option *emul_option_find(struct emul_team *team,
+					    const char *name,
+					    uint32_t port_ifindex,
+					    bool per_port,
+					    uint32_t array_index,
+					    bool array)
+{
+	struct emul_option *option;
+
+	list_for_each_node_entry(option, &team->option_list, list) {
+		if (option->removed || strcmp(option->name, name) ||
+		    option->per_port != per_port ||
+		    option->array != array)
+			continue;
+		if (per_port && option->port_ifindex != port_ifindex)
+			continue;
+		if (array && option->array_index != array_index)
+			continue;
+		return option;
+	}
+	return NULL;
+}
+
+static struct emul_option *emul_option_create(struct emul_team *team,
+					      const char *name, int type)
+{
+	struct emul_option *option;
+
+	option = myzalloc(sizeof(*option));
+	if (!option)
+		return NULL;
+	option->name = strdup(name);
+	if (!option->name) {
+		free(option);
+		return NULL;
+	}
+	option->type = type;
+	option->changed = true;
+	list_add_tail(&team->option_list, &option->list);
+	return option;
+}
+
+static int emul_option_set_data(struct emul_option *option,
+				const void *data, int data_len)
+{
+	char *new_data;
+
+	new_data = malloc(data_len + 1);
+	if (!new_data)
+		return -ENOMEM;
+	memcpy(new_data, data, data_len);
+	new_data[data_len] = '\0';
+	free(option->data);
+	option->data = new_data;
+	option->data_len = data_len;
+	return 0;
+}
+
+static int emul_option_desc_add(struct emul_team *team,
+				const struct emul_option_desc *desc,
+				uint32_t port_ifindex)
+{
+	struct emul_option *option;
+	unsigned int count = desc->array_size ? desc->array_size : 1;
+	char zero[desc->data_len + 1];
+	unsigned int i;
+	int err;
+
+	memset(zero, 0, sizeof(zero));
+	for (i = 0; i < count; i++) {
+		option = emul_option_create(team, desc->name, desc->type);
+		if (!option)
+			return -ENOMEM;
+		option->per_port = desc->per_port;
+		option->port_ifindex = port_ifindex;
+		option->array = desc->array_size;
+		option->array_index = i;
+		option->readonly = desc->readonly;
+		option->mode_owned = desc->mode != NULL;
+		option->u32 = desc->u32;
+		if (desc->type == NLA_STRING)
+			err = emul_option_set_data(option, desc->str,
+						   strlen(desc->str));
+		else if (desc->type == NLA_BINARY)
+			err = emul_option_set_data(option, zero,
+						   desc->data_len);
+		else
+			err = 0;
+		if (err)
+			return err;
+	}
+	return 0;
+}
+
+static bool emul_option_desc_wanted(struct emul_team *team,
+				    const struct emul_option_desc *desc,
+				    bool per_port, const char *mode)
+{
+	if (desc->per_port != per_port)
+		return false;
+	if (mode)
+		return desc->mode && !strcmp(desc->mode, mode);
+	return !desc->mode || !strcmp(desc->mode, team->mode);
+}
+
+/* Adds options of @mode only, or core and current mode ones for NULL */
+static int emul_options_add(struct emul_team *team, bool per_port,
+			    uint32_t port_ifindex, const char *mode)
+{
+	const struct emul_option_desc *desc;
+	unsigned int i;
+	int err;
+
+	for (i = 0; i < ARRAY_SIZE(emul_option_descs); i++) {
+		desc = &emul_option_descs[i];
+		if (!emul_option_desc_wanted(team, desc, per_port, mode))
+			continue;
+		err = emul_option_desc_add(team, desc, port_ifindex);
+		if (err)
+			return err;
+	}
+	return 0;
+}
+
+static int emul_option_item_put(struct nl_msg *msg,
+				struct emul_option *option)
+{
+	__u32 msg_len = nlmsg_hdr(msg)->nlmsg_len;
+	struct nlattr *option_item;
+
+	option_item = nla_nest_start(msg, TEAM_ATTR_ITEM_OPTION);
+	if (!option_item)
+		goto nla_put_failure;
+	NLA_PUT_STRING(msg, TEAM_ATTR_OPTION_NAME, option->name);
+	if (option->changed)
+		NLA_PUT_FLAG(msg, TEAM_ATTR_OPTION_CHANGED);
+	if (option->removed)
+		NLA_PUT_FLAG(msg, TEAM_ATTR_OPTION_REMOVED);
+	NLA_PUT_U8(msg, TEAM_ATTR_OPTION_TYPE, option->type);
+	switch (option->type) {
+	case NLA_U32:
+	case NLA_S32:
+		NLA_PUT_U32(msg, TEAM_ATTR_OPTION_DATA, option->u32);
+		break;
+	case NLA_STRING:
+		NLA_PUT_STRING(msg, TEAM_ATTR_OPTION_DATA, option->data);
+		break;
+	case NLA_BINARY:
+		NLA_PUT(msg, TEAM_ATTR_OPTION_DATA, option->data_len,
+			option->data);
+		break;
+	case NLA_FLAG:
+		if (option->u32)
+			NLA_PUT_FLAG(msg, TEAM_ATTR_OPTION_DATA);
+		break;
+	}
+	if (option->per_port)
+		NLA_PUT_U32(msg, TEAM_ATTR_OPTION_PORT_IFINDEX,
+			    option->port_ifindex);
+	if (option->array)
+		NLA_PUT_U32(msg, TEAM_ATTR_OPTION_ARRAY_INDEX,
+			    option->array_index);
+	nla_nest_end(msg, option_item);
+	return 0;
+
+nla_put_failure:
+	nlmsg_hdr(msg)->nlmsg_len = msg_len;
+	return -ENOBUFS;
+}
+
+static struct nl_msg *emul_team_msg(uint32_t team_ifindex, uint8_t cmd,
+				    uint32_t pid, uint32_t seq,
+				    int list_type, struct nlattr **p_list)
+{
+	struct nl_msg *msg;
+
+	msg = nlmsg_alloc_size(EMUL_MSG_SIZE);
+	if (!msg)
+		return NULL;
+	if (!genlmsg_put(msg, pid, seq, TEAM_EMUL_FAMILY, 0, NLM_F_MULTI,
+			 cmd, TEAM_GENL_VERSION))
+		goto nla_put_failure;
+	NLA_PUT_U32(msg, TEAM_ATTR_TEAM_IFINDEX, team_ifindex);
+	*p_list = nla_nest_start(msg, list_type);
+	if (!*p_list)
+		goto nla_put_failure;
+	return msg;
+
+nla_put_failure:
+	nlmsg_free(msg);
+	return NULL;
+}
+
+static int emul_done_add(struct list_item *batch, uint32_t pid, uint32_t seq)
+{
+	struct nl_msg *msg;
+
+	msg = nlmsg_alloc();
+	if (!msg)
+		return -ENOMEM;
+	if (!nlmsg_put(msg, pid, seq, NLMSG_DONE, 0, NLM_F_MULTI)) {
+		nlmsg_free(msg);
+		return -ENOMEM;
+	}
+	return emul_batch_add(batch, msg);
+}
+
+/*
+ * Puts all options into as few messages as fit, or only changed and
+ * removed ones in case of event. Same multipart format is used for both,
+ * like kernel does.
+ */
+static int emul_options_batch(struct emul_link *team_link, uint32_t pid,
+			      uint32_t seq, bool event,
+			      struct list_item *batch)
+{
+	struct emul_option *option;
+	struct nl_msg *msg = NULL;
+	struct nlattr *list;
+	unsigned int count = 0;
+	int err;
+
+	list_for_each_node_entry(option, &team_link->team->option_list,
+				 list) {
+		if (event ? !option->changed && !option->removed :
+			    option->removed)
+			continue;
+again:
+		if (!msg) {
+			msg = emul_team_msg(team_link->ifindex,
+					    TEAM_CMD_OPTIONS_GET, pid, seq,
+					    TEAM_ATTR_LIST_OPTION, &list);
+			if (!msg)
+				return -ENOMEM;
+			count = 0;
+		}
+		if (emul_option_item_put(msg, option)) {
+			if (!count) {
+				nlmsg_free(msg);
+				return -EMSGSIZE;
+			}
+			nla_nest_end(msg, list);
+			err = emul_batch_add(batch, msg);
+			if (err)
+				return err;
+			msg = NULL;
+			goto again;
+		}
+		count++;
+	}
+	if (msg) {
+		nla_nest_end(msg, list);
+		err = emul_batch_add(batch, msg);
+		if (err)
+			return err;
+	} else if (event) {
+		return 0;
+	}
+	return emul_done_add(batch, pid, seq);
+}
+
+/* Announces changed and removed options and forgets their flags */
+static void emul_options_event(struct team_emul *emul,
+			       struct emul_link *team_link)
+{
+	struct emul_option *option;
+	struct emul_option *tmp;
+	struct list_item batch;
+	int err;
+
+	list_init(&batch);
+	err = emul_options_batch(team_link, 0, 0, true, &batch);
+	if (err)
+		emul_batch_free(&batch);
+	else
+		emul_event_batch(emul, TEAM_EMUL_GRP_TEAM, &batch);
+	list_for_each_node_entry_safe(option, tmp,
+				      &team_link->team->option_list, list) {
+		if (option->removed)
+			emul_option_free(option);
+		else
+			option->changed = false;
+	}
+}
+
+static void emul_port_options_remove(struct emul_team *team,
+				     uint32_t port_ifindex)
+{
+	struct emul_option *option;
+
+	list_for_each_node_entry(option, &team->option_list, list)
+		if (option->per_port && option->port_ifindex == port_ifindex)
+			option->removed = true;
+}
+
+static void emul_mode_options_remove(struct emul_team *team)
+{
+	struct emul_option *option;
+
+	list_for_each_node_entry(option, &team->option_list, list)
+		if (option->mode_owned)
+			option->removed = true;
+}
+
+/*
+ * Ports
+ */
+
+static int emul_port_item_put(struct nl_msg *msg, struct emul_link *link,
+			      bool changed, bool removed)
+{
+	struct nlattr *port_item;
+
+	port_item = nla_nest_start(msg, TEAM_ATTR_ITEM_PORT);
+	if (!port_item)
+		goto nla_put_failure;
+	NLA_PUT_U32(msg, TEAM_ATTR_PORT_IFINDEX, link->ifindex);
+	if (changed)
+		NLA_PUT_FLAG(msg, TEAM_ATTR_PORT_CHANGED);
+	if (link->carrier)
+		NLA_PUT_FLAG(msg, TEAM_ATTR_PORT_LINKUP);
+	NLA_PUT_U32(msg, TEAM_ATTR_PORT_SPEED, EMUL_PORT_SPEED);
+	NLA_PUT_U8(msg, TEAM_ATTR_PORT_DUPLEX, EMUL_PORT_DUPLEX);
+	if (removed)
+		NLA_PUT_FLAG(msg, TEAM_ATTR_PORT_REMOVED);
+	nla_nest_end(msg, port_item);
+	return 0;
+
+nla_put_failure:
+	return -ENOBUFS;
+}
+
+/* Ports of team dump or single port of event (@port_link not NULL) */
+static int emul_ports_batch(struct team_emul *emul,
+			    struct emul_link *team_link,
+			    struct emul_link *port_link, bool removed,
+			    uint32_t pid, uint32_t seq,
+			    struct list_item *batch)
+{
+	struct emul_link *link;
+	struct nl_msg *msg = NULL;
+	struct nlattr *list;
+	unsigned int count = 0;
+	int err;
+
+	list_for_each_node_entry(link, &emul->link_list, list) {
+		if (port_link ? link != port_link :
+				link->master != team_link->ifindex)
+			continue;
+again:
+		if (!msg) {
+			msg = emul_team_msg(team_link->ifindex,
+					    TEAM_CMD_PORT_LIST_GET, pid, seq,
+					    TEAM_ATTR_LIST_PORT, &list);
+			if (!msg)
+				return -ENOMEM;
+			count = 0;
+		}
+		if (emul_port_item_put(msg, link, port_link != NULL,
+				       removed)) {
+			if (!count) {
+				nlmsg_free(msg);
+				return -EMSGSIZE;
+			}
+			nla_nest_end(msg, list);
+			err = emul_batch_add(batch, msg);
+			if (err)
+				return err;
+			msg = NULL;
+			goto again;
+		}
+		count++;
+	}
+	if (msg) {
+		nla_nest_end(msg, list);
+		err = emul_batch_add(batch, msg);
+		if (err)
+			return err;
+	}
+	return emul_done_add(batch, pid, seq);
+}
+
+static void emul_port_event(struct team_emul *emul,
+			    struct emul_link *team_link,
+			    struct emul_link *port_link, bool removed)
+{
+	struct list_item batch;
+
+	list_init(&batch);
+	if (emul_ports_batch(emul, team_link, port_link, removed, 0, 0,
+			     &batch))
+		emul_batch_free(&batch);
+	else
+		emul_event_batch(emul, TEAM_EMUL_GRP_TEAM, &batch);
+}
+
+static int emul_port_add(struct team_emul *emul, struct emul_link *team_link,
+			 struct emul_link *port_link)
+{
+	struct emul_team *team = team_link->team;
+	int err;
+
+	if (port_link == team_link || port_link->team)
+		return -EINVAL;
+	if (port_link->master)
+		return -EBUSY;
+	err = emul_options_add(team, true, port_link->ifindex, NULL);
+	if (err) {
+		emul_port_options_remove(team, port_link->ifindex);
+		emul_options_event(emul, team_link);
+		return err;
+	}
+	port_link->master = team_link->ifindex;
+	team->port_count++;
+	emul_options_event(emul, team_link);
+	emul_port_event(emul, team_link, port_link, false);
+	emul_link_event(emul, port_link, RTM_NEWLINK);
+	return 0;
+}
+
+static void emul_port_remove(struct team_emul *emul,
+			     struct emul_link *team_link,
+			     struct emul_link *port_link)
+{
+	struct emul_team *team = team_link->team;
+	struct emul_option *option;
+
+	emul_port_event(emul, team_link, port_link, true);
+	port_link->master = 0;
+	team->port_count--;
+	emul_port_options_remove(team, port_link->ifindex);
+	/* Like activebackup mode forgets port leaving */
+	option = emul_option_find(team, "activeport", 0, false, 0, false);
+	if (option && option->u32 == port_link->ifindex) {
+		option->u32 = 0;
+		option->changed = true;
+	}
+	emul_options_event(emul, team_link);
+	emul_link_event(emul, port_link, RTM_NEWLINK);
+}
+
+/*
+ * Team devices
+ */
+
+static int emul_team_create(struct emul_link *link)
+{
+	struct emul_option *option;
+	struct emul_team *team;
+	int err;
+
+	team = myzalloc(sizeof(*team));
+	if (!team)
+		return -ENOMEM;
+	list_init(&team->option_list);
+	link->team = team;
+	err = emul_options_add(team, false, 0, NULL);
+	if (err)
+		return err;
+	/* Nobody knows the device yet */
+	list_for_each_node_entry(option, &team->option_list, list)
+		option->changed = false;
+	return 0;
+}
+
+static void emul_team_destroy(struct emul_team *team)
+{
+	struct emul_option *option;
+	struct emul_option *tmp;
+
+	list_for_each_node_entry_safe(option, tmp, &team->option_list, list)
+		emul_option_free(option);
+	free(team);
+}
+
+static int emul_team_mode_set(struct team_emul *emul,
+			      struct emul_link *team_link, const char *mode)
+{
+	struct emul_team *team = team_link->team;
+	struct emul_link *link;
+	unsigned int i;
+	int err;
+
+	for (i = 0; i < ARRAY_SIZE(emul_mode_names); i++)
+		if (!strcmp(emul_mode_names[i], mode))
+			break;
+	if (i == ARRAY_SIZE(emul_mode_names))
+		return -EINVAL;
+	if (!strcmp(team->mode, mode))
+		return 0;
+	if (team->port_count)
+		return -EBUSY;
+	emul_mode_options_remove(team);
+	mystrlcpy(team->mode, mode, sizeof(team->mode));
+	err = emul_options_add(team, false, 0, mode);
+	if (err)
+		return err;
+	list_for_each_node_entry(link, &emul->link_list, list) {
+		if (link->master != team_link->ifindex)
+			continue;
+		err = emul_options_add(team, true, link->ifindex, mode);
+		if (err)
+			return err;
+	}
+	return 0;
+}
+
+static struct emul_link *emul_link_create(struct team_emul *emul,
+					  const char *ifname,
+					  const char *kind)
+{
+	struct emul_link *link;
+	int err;
+
+	link = myzalloc(sizeof(*link));
+	if (!link)
+		return NULL;
+	link->ifindex = ++emul->last_ifindex;
+	if (ifname && ifname[0])
+		mystrlcpy(link->ifname, ifname, sizeof(link->ifname));
+	else
+		snprintf(link->ifname, sizeof(link->ifname), "%s%u",
+			 kind && kind[0] ? kind : "eth", link->ifindex);
+	if (kind)
+		mystrlcpy(link->kind, kind, sizeof(link->kind));
+	link->hwaddr[0] = 0x02;
+	link->hwaddr[4] = link->ifindex >> 8;
+	link->hwaddr[5] = link->ifindex;
+	link->mtu = 1500;
+	if (kind && !strcmp(kind, "team")) {
+		err = emul_team_create(link);
+		if (err) {
+			if (link->team)
+				emul_team_destroy(link->team);
+			free(link);
+			return NULL;
+		}
+	} else {
+		link->carrier = true;
+	}
+	list_add_tail(&emul->link_list, &link->list);
+	return link;
+}
+
+static void emul_link_destroy(struct team_emul *emul, struct emul_link *link)
+{
+	struct emul_link *port_link;
+	struct emul_link *team_link;
+
+	if (link->team) {
+		list_for_each_node_entry(port_link, &emul->link_list, list)
+			if (port_link->master == link->ifindex)
+				emul_port_remove(emul, link, port_link);
+	} else if (link->master) {
+		team_link = emul_link_find(emul, link->master);
+		emul_port_remove(emul, team_link, link);
+	}
+	emul_link_event(emul, link, RTM_DELLINK);
+	list_del(&link->list);
+	if (link->team)
+		emul_team_destroy(link->team);
+	free(link);
+}
+
+static void emul_link_set_carrier(struct team_emul *emul,
+				  struct emul_link *link, bool carrier)
+{
+	struct emul_link *team_link;
+
+	if (link->carrier == carrier)
+		return;
+	link->carrier = carrier;
+	if (link->master) {
+		team_link = emul_link_find(emul, link->master);
+		emul_port_event(emul, team_link, link, false);
+	}
+	emul_link_event(emul, link, RTM_NEWLINK);
+}
+
+/*
+ * Route netlink requests
+ */
+
+static struct nla_policy emul_link_policy[IFLA_MAX + 1] = {
+	[IFLA_IFNAME]		= { .type = NLA_STRING, .maxlen = IFNAMSIZ },
+	[IFLA_MASTER]		= { .type = NLA_U32 },
+	[IFLA_MTU]		= { .type = NLA_U32 },
+	[IFLA_CARRIER]		= { .type = NLA_U8 },
+	[IFLA_LINKINFO]		= { .type = NLA_NESTED },
+};
+
+static struct nla_policy emul_linkinfo_policy[IFLA_INFO_MAX + 1] = {
+	[IFLA_INFO_KIND]	= { .type = NLA_STRING },
+};
+
+static int emul_link_lookup(struct team_emul *emul, struct nlmsghdr *nlh,
+			    struct nlattr **tb, struct emul_link **p_link)
+{
+	struct ifinfomsg *ifi;
+	int err;
+
+	err = nlmsg_parse(nlh, sizeof(*ifi), tb, IFLA_MAX, emul_link_policy);
+	if (err)
+		return -EINVAL;
+	ifi = nlmsg_data(nlh);
+	if (ifi->ifi_index > 0)
+		*p_link = emul_link_find(emul, ifi->ifi_index);
+	else if (tb[IFLA_IFNAME])
+		*p_link = emul_link_find_by_name(emul,
+						 nla_get_string(tb[IFLA_IFNAME]));
+	else
+		*p_link = NULL;
+	return 0;
+}
+
+static int emul_rtnl_getlink(struct team_emul *emul, uint32_t pid,
+			     struct nlmsghdr *nlh)
+{
+	struct nlattr *tb[IFLA_MAX + 1];
+	struct emul_link *link;
+	struct list_item batch;
+	struct nl_msg *msg;
+	uint32_t master = 0;
+	int err;
+
+	err = emul_link_lookup(emul, nlh, tb, &link);
+	if (err)
+		return err;
+	if (!(nlh->nlmsg_flags & NLM_F_DUMP)) {
+		if (!link)
+			return -ENODEV;
+		msg = emul_link_msg(link, RTM_NEWLINK, pid,
+				    nlh->nlmsg_seq, 0);
+		if (!msg)
+			return -ENOMEM;
+		emul_reply(emul, pid, msg);
+		return 0;
+	}
+
+	if (tb[IFLA_MASTER])
+		master = nla_get_u32(tb[IFLA_MASTER]);
+	list_init(&batch);
+	list_for_each_node_entry(link, &emul->link_list, list) {
+		if (master && link->master != master)
+			continue;
+		msg = emul_link_msg(link, RTM_NEWLINK, pid, nlh->nlmsg_seq,
+				    NLM_F_MULTI);
+		if (!msg || emul_batch_add(&batch, msg)) {
+			emul_batch_free(&batch);
+			return -ENOMEM;
+		}
+	}
+	err = emul_done_add(&batch, pid, nlh->nlmsg_seq);
+	if (err) {
+		emul_batch_free(&batch);
+		return err;
+	}
+	emul_reply_batch(emul, pid, &batch);
+	/* Dump is not acked */
+	return 1;
+}
+
+static int emul_link_change(struct team_emul *emul, struct emul_link *link,
+			    struct nlmsghdr *nlh, struct nlattr **tb)
+{
+	struct ifinfomsg *ifi = nlmsg_data(nlh);
+	struct emul_link *team_link;
+	unsigned int change;
+	unsigned int flags;
+	bool changed = false;
+	uint32_t master;
+
+	/* Zero change mask means all flags, only IFF_UP is kept though */
+	if (ifi->ifi_flags || ifi->ifi_change) {
+		change = ifi->ifi_change ? ifi->ifi_change : ~0U;
+		flags = ((link->flags & ~change) |
+			 (ifi->ifi_flags & change)) & IFF_UP;
+		if (flags != link->flags) {
+			link->flags = flags;
+			changed = true;
+		}
+	}
+	if (tb[IFLA_ADDRESS] &&
+	    nla_len(tb[IFLA_ADDRESS]) == sizeof(link->hwaddr) &&
+	    memcmp(link->hwaddr, nla_data(tb[IFLA_ADDRESS]),
+		   sizeof(link->hwaddr))) {
+		memcpy(link->hwaddr, nla_data(tb[IFLA_ADDRESS]),
+		       sizeof(link->hwaddr));
+		changed = true;
+	}
+	if (tb[IFLA_MTU] && nla_get_u32(tb[IFLA_MTU]) != link->mtu) {
+		link->mtu = nla_get_u32(tb[IFLA_MTU]);
+		changed = true;
+	}
+	if (changed)
+		emul_link_event(emul, link, RTM_NEWLINK);
+	if (tb[IFLA_CARRIER])
+		emul_link_set_carrier(emul, link,
+				      nla_get_u8(tb[IFLA_CARRIER]));
+	if (!tb[IFLA_MASTER])
+		return 0;
+	master = nla_get_u32(tb[IFLA_MASTER]);
+	if (master == link->master)
+		return 0;
+	if (link->master) {
+		team_link = emul_link_find(emul, link->master);
+		emul_port_remove(emul, team_link, link);
+	}
+	if (!master)
+		return 0;
+	team_link = emul_link_find(emul, master);
+	if (!team_link)
+		return -ENODEV;
+	if (!team_link->team)
+		return -EOPNOTSUPP;
+	return emul_port_add(emul, team_link, link);
+}
+
+static int emul_rtnl_newlink(struct team_emul *emul, uint32_t pid,
+			     struct nlmsghdr *nlh)
+{
+	struct nlattr *linkinfo[IFLA_INFO_MAX + 1];
+	struct nlattr *tb[IFLA_MAX + 1];
+	struct emul_link *link;
+	const char *ifname = NULL;
+	const char *kind = NULL;
+	int err;
+
+	err = emul_link_lookup(emul, nlh, tb, &link);
+	if (err)
+		return err;
+	if (link) {
+		if ((nlh->nlmsg_flags & NLM_F_CREATE) &&
+		    (nlh->nlmsg_flags & NLM_F_EXCL))
+			return -EEXIST;
+		return emul_link_change(emul, link, nlh, tb);
+	}
+	if (nlh->nlmsg_type != RTM_NEWLINK ||
+	    !(nlh->nlmsg_flags & NLM_F_CREATE))
+		return -ENODEV;
+	if (tb[IFLA_LINKINFO]) {
+		err = nla_parse_nested(linkinfo, IFLA_INFO_MAX,
+				       tb[IFLA_LINKINFO],
+				       emul_linkinfo_policy);
+		if (err)
+			return -EINVAL;
+		if (linkinfo[IFLA_INFO_KIND])
+			kind = nla_get_string(linkinfo[IFLA_INFO_KIND]);
+	}
+	if (!kind)
+		return -EOPNOTSUPP;
+	if (tb[IFLA_IFNAME])
+		ifname = nla_get_string(tb[IFLA_IFNAME]);
+	link = emul_link_create(emul, ifname, kind);
+	if (!link)
+		return -ENOMEM;
+	emul_link_event(emul, link, RTM_NEWLINK);
+	return 0;
+}
+
+static int emul_rtnl_dellink(struct team_emul *emul, uint32_t pid,
+			     struct nlmsghdr *nlh)
+{
+	struct nlattr *tb[IFLA_MAX + 1];
+	struct emul_link *link;
+	int err;
+
+	err = emul_link_lookup(emul, nlh, tb, &link);
+	if (err)
+		return err;
+	if (!link)
+		return -ENODEV;
+	emul_link_destroy(emul, link);
+	return 0;
+}
+
+/*
+ * Team generic netlink requests
+ */
+
+static struct nla_policy emul_team_policy[TEAM_ATTR_MAX + 1] = {
+	[TEAM_ATTR_TEAM_IFINDEX]	= { .type = NLA_U32 },
+	[TEAM_ATTR_LIST_OPTION]		= { .type = NLA_NESTED },
+};
+
+static struct nla_policy emul_option_policy[TEAM_ATTR_OPTION_MAX + 1] = {
+	[TEAM_ATTR_OPTION_NAME]		= { .type = NLA_STRING },
+	[TEAM_ATTR_OPTION_TYPE]		= { .type = NLA_U8 },
+	[TEAM_ATTR_OPTION_PORT_IFINDEX]	= { .type = NLA_U32 },
+	[TEAM_ATTR_OPTION_ARRAY_INDEX]	= { .type = NLA_U32 },
+};
+
+static int emul_option_set_one(struct team_emul *emul,
+			       struct emul_link *team_link,
+			       struct nlattr *nl_option)
+{
+	struct nlattr *option_attrs[TEAM_ATTR_OPTION_MAX + 1];
+	struct emul_team *team = team_link->team;
+	struct emul_option *option;
+	struct nlattr *data_attr;
+	struct emul_link *link;
+	uint32_t port_ifindex = 0;
+	uint32_t array_index = 0;
+	uint32_t u32 = 0;
+	int type;
+	int err;
+
+	if (nla_parse_nested(option_attrs, TEAM_ATTR_OPTION_MAX, nl_option,
+			     emul_option_policy))
+		return -EINVAL;
+	if (!option_attrs[TEAM_ATTR_OPTION_NAME] ||
+	    !option_attrs[TEAM_ATTR_OPTION_TYPE])
+		return -EINVAL;
+	type = nla_get_u8(option_attrs[TEAM_ATTR_OPTION_TYPE]);
+	data_attr = option_attrs[TEAM_ATTR_OPTION_DATA];
+	if (type != NLA_FLAG && !data_attr)
+		return -EINVAL;
+	if (option_attrs[TEAM_ATTR_OPTION_PORT_IFINDEX])
+		port_ifindex = nla_get_u32(option_attrs[TEAM_ATTR_OPTION_PORT_IFINDEX]);
+	if (option_attrs[TEAM_ATTR_OPTION_ARRAY_INDEX])
+		array_index = nla_get_u32(option_attrs[TEAM_ATTR_OPTION_ARRAY_INDEX]);
+	option = emul_option_find(team,
+				  nla_get_string(option_attrs[TEAM_ATTR_OPTION_NAME]),
+				  port_ifindex,
+				  option_attrs[TEAM_ATTR_OPTION_PORT_IFINDEX],
+				  array_index,
+				  option_attrs[TEAM_ATTR_OPTION_ARRAY_INDEX]);
+	if (!option)
+		return -ENOENT;
+	if (option->type != type)
+		return -EINVAL;
+	if (option->readonly)
+		return -EOPNOTSUPP;
+
+	switch (type) {
+	case NLA_U32:
+	case NLA_S32:
+		if (nla_len(data_attr) < sizeof(u32))
+			return -EINVAL;
+		u32 = nla_get_u32(data_attr);
+		break;
+	case NLA_FLAG:
+		u32 = data_attr ? 1 : 0;
+		break;
+	case NLA_STRING:
+		if (!memchr(nla_data(data_attr), '\0', nla_len(data_attr)))
+			return -EINVAL;
+		break;
+	}
+
+	if (!strcmp(option->name, "activeport") && u32) {
+		link = emul_link_find(emul, u32);
+		if (!link || link->master != team_link->ifindex)
+			return -ENOENT;
+	}
+	if (!strcmp(option->name, "mode")) {
+		err = emul_team_mode_set(emul, team_link, nla_data(data_attr));
+		if (err)
+			return err;
+	}
+
+	option->set_count++;
+	if (type == NLA_STRING) {
+		if (!strcmp(option->data, nla_data(data_attr)))
+			return 0;
+		err = emul_option_set_data(option, nla_data(data_attr),
+					   strlen(nla_data(data_attr)));
+		if (err)
+			return err;
+	} else if (type == NLA_BINARY) {
+		if (option->data_len == nla_len(data_attr) &&
+		    !memcmp(option->data, nla_data(data_attr),
+			    option->data_len))
+			return 0;
+		err = emul_option_set_data(option, nla_data(data_attr),
+					   nla_len(data_attr));
+		if (err)
+			return err;
+	} else {
+		if (option->u32 == u32)
+			return 0;
+		option->u32 = u32;
+	}
+	option->changed = true;
+	return 0;
+}
+
+static int emul_team_link_get(struct team_emul *emul, struct nlattr **attrs,
+			      struct emul_link **p_team_link)
+{
+	struct emul_link *team_link;
+
+	if (!attrs[TEAM_ATTR_TEAM_IFINDEX])
+		return -EINVAL;
+	team_link = emul_link_find(emul,
+				   nla_get_u32(attrs[TEAM_ATTR_TEAM_IFINDEX]));
+	if (!team_link || !team_link->team)
+		return -ENODEV;
+	*p_team_link = team_link;
+	return 0;
+}
+
+static int emul_genl_options_set(struct team_emul *emul,
+				 struct emul_link *team_link,
+				 struct nlattr **attrs)
+{
+	struct nlattr *nl_option;
+	int err = 0;
+	int i;
+
+	if (!attrs[TEAM_ATTR_LIST_OPTION])
+		return -EINVAL;
+	nla_for_each_nested(nl_option, attrs[TEAM_ATTR_LIST_OPTION], i) {
+		if (nla_type(nl_option) != TEAM_ATTR_ITEM_OPTION) {
+			err = -EINVAL;
+			break;
+		}
+		err = emul_option_set_one(emul, team_link, nl_option);
+		if (err)
+			break;
+	}
+	/* Options set before the failing one stay set */
+	emul_options_event(emul, team_link);
+	pthread_cond_broadcast(&emul->set_cond);
+	return err;
+}
+
+static int emul_genl(struct team_emul *emul, uint32_t pid,
+		     struct nlmsghdr *nlh)
+{
+	struct nlattr *attrs[TEAM_ATTR_MAX + 1];
+	struct emul_link *team_link;
+	struct genlmsghdr *gnlh;
+	struct list_item batch;
+	int err;
+
+	err = genlmsg_parse(nlh, 0, attrs, TEAM_ATTR_MAX, emul_team_policy);
+	if (err)
+		return -EINVAL;
+	gnlh = nlmsg_data(nlh);
+	if (gnlh->cmd == TEAM_CMD_NOOP)
+		return 0;
+	err = emul_team_link_get(emul, attrs, &team_link);
+	if (err)
+		return err;
+
+	switch (gnlh->cmd) {
+	case TEAM_CMD_OPTIONS_SET:
+		return emul_genl_options_set(emul, team_link, attrs);
+	case TEAM_CMD_OPTIONS_GET:
+		list_init(&batch);
+		err = emul_options_batch(team_link, pid, nlh->nlmsg_seq,
+					 false, &batch);
+		break;
+	case TEAM_CMD_PORT_LIST_GET:
+		list_init(&batch);
+		err = emul_ports_batch(emul, team_link, NULL, false, pid,
+				       nlh->nlmsg_seq, &batch);
+		break;
+	default:
+		return -EOPNOTSUPP;
+	}
+	if (err) {
+		emul_batch_free(&batch);
+		return err;
+	}
+	emul_reply_batch(emul, pid, &batch);
+	return 0;
+}
+
+static int emul_subscribe(struct team_emul *emul, uint32_t pid,
+			  struct nlmsghdr *nlh)
+{
+	struct emul_sub *sub;
+	uint32_t group;
+
+	if (!nlmsg_valid_hdr(nlh, sizeof(group)))
+		return -EINVAL;
+	group = *(uint32_t *) nlmsg_data(nlh);
+	if (group != TEAM_EMUL_GRP_TEAM && group != TEAM_EMUL_GRP_LINK)
+		return -EINVAL;
+	list_for_each_node_entry(sub, &emul->sub_list, list)
+		if (sub->pid == pid && sub->group == group)
+			return 0;
+	sub = myzalloc(sizeof(*sub));
+	if (!sub)
+		return -ENOMEM;
+	sub->pid = pid;
+	sub->group = group;
+	list_add_tail(&emul->sub_list, &sub->list);
+	return 0;
+}
+
+static void emul_process_msg(struct team_emul *emul, uint32_t pid,
+			     struct nlmsghdr *nlh)
+{
+	int err;
+
+	if (!(nlh->nlmsg_flags & NLM_F_REQUEST))
+		return;
+	switch (nlh->nlmsg_type) {
+	case TEAM_EMUL_FAMILY:
+		err = emul_genl(emul, pid, nlh);
+		break;
+	case TEAM_EMUL_SUBSCRIBE:
+		err = emul_subscribe(emul, pid, nlh);
+		break;
+	case RTM_GETLINK:
+		err = emul_rtnl_getlink(emul, pid, nlh);
+		break;
+	case RTM_NEWLINK:
+	case RTM_SETLINK:
+		err = emul_rtnl_newlink(emul, pid, nlh);
+		break;
+	case RTM_DELLINK:
+		err = emul_rtnl_dellink(emul, pid, nlh);
+		break;
+	default:
+		err = -EOPNOTSUPP;
+	}
+	if (err <= 0)
+		emul_ack(emul, pid, nlh, err);
+}
+
+static void emul_recv(struct team_emul *emul)
+{
+	struct sockaddr_nl addr;
+	socklen_t addr_len;
+	struct nlmsghdr *nlh;
+	ssize_t ret;
+	int len;
+
+	while (1) {
+		addr_len = sizeof(addr);
+		ret = recvfrom(emul->sock_fd, emul->recv_buf,
+			       EMUL_RECV_BUF_SIZE, MSG_DONTWAIT,
+			       (struct sockaddr *) &addr, &addr_len);
+		if (ret == -1 && errno == EINTR)
+			continue;
+		if (ret <= 0)
+			return;
+		len = ret;
+		pthread_mutex_lock(&emul->lock);
+		for (nlh = (struct nlmsghdr *) emul->recv_buf;
+		     nlmsg_ok(nlh, len); nlh = nlmsg_next(nlh, &len))
+			emul_process_msg(emul, addr.nl_pid, nlh);
+		emul_flush(emul);
+		pthread_mutex_unlock(&emul->lock);
+	}
+}
+
+static void *emul_thread(void *arg)
+{
+	struct team_emul *emul = arg;
+	struct pollfd pfds[2];
+	uint64_t count;
+	bool quit = false;
+	int timeout;
+	int ret;
+
+	pfds[0].fd = emul->sock_fd;
+	pfds[0].events = POLLIN;
+	pfds[1].fd = emul->quit_fd;
+	pfds[1].events = POLLIN;
+	while (!quit) {
+		pthread_mutex_lock(&emul->lock);
+		emul_flush(emul);
+		emul_subs_retry(emul);
+		timeout = emul_pending(emul) ? EMUL_RETRY_INTERVAL : -1;
+		quit = !emul->started;
+		pthread_mutex_unlock(&emul->lock);
+		if (quit)
+			break;
+		ret = poll(pfds, 2, timeout);
+		if (ret == -1 && errno != EINTR)
+			break;
+		if (pfds[1].revents & POLLIN) {
+			ret = read(emul->quit_fd, &count, sizeof(count));
+			(void) ret;
+		}
+		if (pfds[0].revents & POLLIN)
+			emul_recv(emul);
+	}
+	return NULL;
+}
+
+/**
+ * team_emul_alloc:
+ *
+ * Allocates team emulator and its socket. Its port is known right away,
+ * requests are served once team_emul_start() is called.
+ *
+ * Returns: new team emulator or NULL in case of an error.
+ **/
+TEAM_EXPORT
+struct team_emul *team_emul_alloc(void)
+{
+	struct sockaddr_nl addr = {
+		.nl_family = AF_NETLINK,
+	};
+	socklen_t addr_len = sizeof(addr);
+	int size = EMUL_SOCK_BUF_SIZE;
+	struct team_emul *emul;
+	pthread_condattr_t attr;
+
+	emul = myzalloc(sizeof(*emul));
+	if (!emul)
+		return NULL;
+	list_init(&emul->link_list);
+	list_init(&emul->sub_list);
+	list_init(&emul->out_list);
+	emul->recv_buf = malloc(EMUL_RECV_BUF_SIZE);
+	if (!emul->recv_buf)
+		goto err_recv_buf_alloc;
+
+	emul->sock_fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC,
+			       NETLINK_USERSOCK);
+	if (emul->sock_fd == -1)
+		goto err_socket;
+	setsockopt(emul->sock_fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+	setsockopt(emul->sock_fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+	if (bind(emul->sock_fd, (struct sockaddr *) &addr, sizeof(addr)) ||
+	    getsockname(emul->sock_fd, (struct sockaddr *) &addr, &addr_len))
+		goto err_bind;
+	emul->port = addr.nl_pid;
+
+	emul->quit_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (emul->quit_fd == -1)
+		goto err_bind;
+
+	pthread_mutex_init(&emul->lock, NULL);
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&emul->set_cond, &attr);
+	pthread_condattr_destroy(&attr);
+	return emul;
+
+err_bind:
+	close(emul->sock_fd);
+err_socket:
+	free(emul->recv_buf);
+err_recv_buf_alloc:
+	free(emul);
+	return NULL;
+}
+
+/**
+ * team_emul_start:
+ * @emul: team emulator
+ *
+ * Starts thread serving requests.
+ *
+ * Returns: zero on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_emul_start(struct team_emul *emul)
+{
+	int err;
+
+	if (emul->started)
+		return -EBUSY;
+	emul->started = true;
+	err = pthread_create(&emul->thread, NULL, emul_thread, emul);
+	if (err) {
+		emul->started = false;
+		return -err;
+	}
+	return 0;
+}
+
+/**
+ * team_emul_free:
+ * @emul: team emulator
+ *
+ * Stops serving thread and frees emulator with all its links.
+ **/
+TEAM_EXPORT
+void team_emul_free(struct team_emul *emul)
+{
+	const uint64_t one = 1;
+	struct emul_link *link;
+	struct emul_link *tmp;
+	struct emul_sub *sub;
+	struct emul_sub *sub_tmp;
+	int ret;
+
+	if (emul->started) {
+		pthread_mutex_lock(&emul->lock);
+		emul->started = false;
+		pthread_mutex_unlock(&emul->lock);
+		ret = write(emul->quit_fd, &one, sizeof(one));
+		(void) ret;
+		pthread_join(emul->thread, NULL);
+	}
+	list_for_each_node_entry_safe(link, tmp, &emul->link_list, list) {
+		list_del(&link->list);
+		if (link->team)
+			emul_team_destroy(link->team);
+		free(link);
+	}
+	list_for_each_node_entry_safe(sub, sub_tmp, &emul->sub_list, list)
+		emul_sub_del(sub);
+	emul_batch_free(&emul->out_list);
+	pthread_cond_destroy(&emul->set_cond);
+	pthread_mutex_destroy(&emul->lock);
+	close(emul->quit_fd);
+	close(emul->sock_fd);
+	free(emul->recv_buf);
+	free(emul);
+}
+
+/**
+ * team_emul_get_port:
+ * @emul: team emulator
+ *
+ * Get netlink port of emulator, to be passed to team_set_emul_port()
+ * or to --emul-port option of teamd.
+ *
+ * Returns: netlink port.
+ **/
+TEAM_EXPORT
+uint32_t team_emul_get_port(struct team_emul *emul)
+{
+	return emul->port;
+}
+
+/**
+ * team_emul_get_drop_count:
+ * @emul: team emulator
+ *
+ * Get number of events dropped because subscriber receive buffer was
+ * full.
+ *
+ * Returns: number of dropped events.
+ **/
+TEAM_EXPORT
+uint64_t team_emul_get_drop_count(struct team_emul *emul)
+{
+	uint64_t count;
+
+	pthread_mutex_lock(&emul->lock);
+	count = emul->drop_count;
+	pthread_mutex_unlock(&emul->lock);
+	return count;
+}
+
+/**
+ * team_emul_link_add:
+ * @emul: team emulator
+ * @ifname: link name, NULL to generate one
+ * @kind: link kind, "team" for team device
+ * @p_ifindex: where interface index of new link is stored
+ *
+ * Add emulated link. Links other than team devices start with carrier on.
+ *
+ * Returns: zero on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_emul_link_add(struct team_emul *emul, const char *ifname,
+		       const char *kind, uint32_t *p_ifindex)
+{
+	struct emul_link *link;
+	int err = 0;
+
+	pthread_mutex_lock(&emul->lock);
+	if (ifname && emul_link_find_by_name(emul, ifname)) {
+		err = -EEXIST;
+		goto unlock;
+	}
+	link = emul_link_create(emul, ifname, kind);
+	if (!link) {
+		err = -ENOMEM;
+		goto unlock;
+	}
+	emul_link_event(emul, link, RTM_NEWLINK);
+	emul_kick(emul);
+	if (p_ifindex)
+		*p_ifindex = link->ifindex;
+unlock:
+	pthread_mutex_unlock(&emul->lock);
+	return err;
+}
+
+/**
+ * team_emul_ifname2ifindex:
+ * @emul: team emulator
+ * @ifname: link name
+ *
+ * Looks up emulated link, like one created by program under test.
+ *
+ * Returns: interface index or zero in case link does not exist.
+ **/
+TEAM_EXPORT
+uint32_t team_emul_ifname2ifindex(struct team_emul *emul, const char *ifname)
+{
+	struct emul_link *link;
+	uint32_t ifindex;
+
+	pthread_mutex_lock(&emul->lock);
+	link = emul_link_find_by_name(emul, ifname);
+	ifindex = link ? link->ifindex : 0;
+	pthread_mutex_unlock(&emul->lock);
+	return ifindex;
+}
+
+/**
+ * team_emul_link_del:
+ * @emul: team emulator
+ * @ifindex: interface index
+ *
+ * Delete emulated link. Ports of deleted team device are released.
+ *
+ * Returns: zero on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_emul_link_del(struct team_emul *emul, uint32_t ifindex)
+{
+	struct emul_link *link;
+	int err = 0;
+
+	pthread_mutex_lock(&emul->lock);
+	link = emul_link_find(emul, ifindex);
+	if (link) {
+		emul_link_destroy(emul, link);
+		emul_kick(emul);
+	} else {
+		err = -ENODEV;
+	}
+	pthread_mutex_unlock(&emul->lock);
+	return err;
+}
+
+/**
+ * team_emul_link_set_carrier:
+ * @emul: team emulator
+ * @ifindex: interface index
+ * @carrier_up: carrier state
+ *
+ * Set carrier of emulated link. Link event is sent and in case the link
+ * is a port, port event too.
+ *
+ * Returns: zero on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_emul_link_set_carrier(struct team_emul *emul, uint32_t ifindex,
+			       bool carrier_up)
+{
+	struct emul_link *link;
+	int err = 0;
+
+	pthread_mutex_lock(&emul->lock);
+	link = emul_link_find(emul, ifindex);
+	if (link) {
+		emul_link_set_carrier(emul, link, carrier_up);
+		emul_kick(emul);
+	} else {
+		err = -ENODEV;
+	}
+	pthread_mutex_unlock(&emul->lock);
+	return err;
+}
+
+/**
+ * team_emul_port_add:
+ * @emul: team emulator
+ * @team_ifindex: team device interface index
+ * @port_ifindex: port interface index
+ *
+ * Make emulated link port of emulated team device.
+ *
+ * Returns: zero on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_emul_port_add(struct team_emul *emul, uint32_t team_ifindex,
+		       uint32_t port_ifindex)
+{
+	struct emul_link *team_link;
+	struct emul_link *port_link;
+	int err;
+
+	pthread_mutex_lock(&emul->lock);
+	team_link = emul_link_find(emul, team_ifindex);
+	port_link = emul_link_find(emul, port_ifindex);
+	if (!team_link || !port_link)
+		err = -ENODEV;
+	else if (!team_link->team)
+		err = -EOPNOTSUPP;
+	else
+		err = emul_port_add(emul, team_link, port_link);
+	emul_kick(emul);
+	pthread_mutex_unlock(&emul->lock);
+	return err;
+}
+
+/**
+ * team_emul_option_add:
+ * @emul: team emulator
+ * @team_ifindex: team device interface index
+ * @name: option name
+ * @array_size: number of array items, zero for scalar option
+ *
+ * Add u32 option to emulated team device, on top of the ones kernel has.
+ * These options are the ones team_emul_option_storm() changes.
+ *
+ * Returns: zero on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_emul_option_add(struct team_emul *emul, uint32_t team_ifindex,
+			 const char *name, unsigned int array_size)
+{
+	struct emul_option_desc desc = {
+		.name = name,
+		.type = NLA_U32,
+		.array_size = array_size,
+	};
+	struct emul_option *option;
+	struct emul_link *team_link;
+	int err;
+
+	pthread_mutex_lock(&emul->lock);
+	team_link = emul_link_find(emul, team_ifindex);
+	if (!team_link || !team_link->team) {
+		err = -ENODEV;
+		goto unlock;
+	}
+	list_for_each_node_entry(option, &team_link->team->option_list, list) {
+		if (!option->removed && !strcmp(option->name, name)) {
+			err = -EEXIST;
+			goto unlock;
+		}
+	}
+	err = emul_option_desc_add(team_link->team, &desc, 0);
+	list_for_each_node_entry(option, &team_link->team->option_list, list) {
+		if (!option->changed || strcmp(option->name, name))
+			continue;
+		option->storm = true;
+		/* Partially added one is gone before anyone sees it */
+		if (err)
+			option->removed = true;
+	}
+	emul_options_event(emul, team_link);
+	emul_kick(emul);
+unlock:
+	pthread_mutex_unlock(&emul->lock);
+	return err;
+}
+
+static struct emul_option *emul_scalar_option_find(struct team_emul *emul,
+						   uint32_t team_ifindex,
+						   const char *name,
+						   struct emul_link **p_team_link)
+{
+	struct emul_link *team_link;
+
+	team_link = emul_link_find(emul, team_ifindex);
+	if (!team_link || !team_link->team)
+		return NULL;
+	if (p_team_link)
+		*p_team_link = team_link;
+	return emul_option_find(team_link->team, name, 0, false, 0, false);
+}
+
+/**
+ * team_emul_option_set_u32:
+ * @emul: team emulator
+ * @team_ifindex: team device interface index
+ * @name: option name
+ * @value: new value
+ *
+ * Set value of scalar u32 option of emulated team device like kernel
+ * would on its own and send event.
+ *
+ * Returns: zero on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_emul_option_set_u32(struct team_emul *emul, uint32_t team_ifindex,
+			     const char *name, uint32_t value)
+{
+	struct emul_link *team_link;
+	struct emul_option *option;
+	int err = 0;
+
+	pthread_mutex_lock(&emul->lock);
+	option = emul_scalar_option_find(emul, team_ifindex, name, &team_link);
+	if (!option || option->type != NLA_U32) {
+		err = -ENOENT;
+	} else if (option->u32 != value) {
+		option->u32 = value;
+		option->changed = true;
+		emul_options_event(emul, team_link);
+		emul_kick(emul);
+	}
+	pthread_mutex_unlock(&emul->lock);
+	return err;
+}
+
+/**
+ * team_emul_option_get_u32:
+ * @emul: team emulator
+ * @team_ifindex: team device interface index
+ * @name: option name
+ * @p_value: where the value is stored
+ *
+ * Get value of scalar u32 option of emulated team device.
+ *
+ * Returns: zero on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_emul_option_get_u32(struct team_emul *emul, uint32_t team_ifindex,
+			     const char *name, uint32_t *p_value)
+{
+	struct emul_option *option;
+	int err = 0;
+
+	pthread_mutex_lock(&emul->lock);
+	option = emul_scalar_option_find(emul, team_ifindex, name, NULL);
+	if (!option || option->type != NLA_U32)
+		err = -ENOENT;
+	else
+		*p_value = option->u32;
+	pthread_mutex_unlock(&emul->lock);
+	return err;
+}
+
+/**
+ * team_emul_get_option_set_count:
+ * @emul: team emulator
+ * @team_ifindex: team device interface index
+ * @name: option name
+ *
+ * Get number of times scalar option was set by TEAM_CMD_OPTIONS_SET,
+ * including sets to the same value.
+ *
+ * Returns: number of sets.
+ **/
+TEAM_EXPORT
+uint64_t team_emul_get_option_set_count(struct team_emul *emul,
+					uint32_t team_ifindex,
+					const char *name)
+{
+	struct emul_option *option;
+	uint64_t count = 0;
+
+	pthread_mutex_lock(&emul->lock);
+	option = emul_scalar_option_find(emul, team_ifindex, name, NULL);
+	if (option)
+		count = option->set_count;
+	pthread_mutex_unlock(&emul->lock);
+	return count;
+}
+
+/**
+ * team_emul_wait_option_set:
+ * @emul: team emulator
+ * @team_ifindex: team device interface index
+ * @name: option name
+ * @set_count: set count to wait to be exceeded
+ * @timeout: timeout in milliseconds
+ *
+ * Wait until scalar option is set by TEAM_CMD_OPTIONS_SET more than
+ * @set_count times, see team_emul_get_option_set_count(). Used to measure
+ * how fast library user reacts to events.
+ *
+ * Returns: zero on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_emul_wait_option_set(struct team_emul *emul, uint32_t team_ifindex,
+			      const char *name, uint64_t set_count,
+			      unsigned int timeout)
+{
+	struct emul_option *option;
+	struct timespec ts;
+	int err = 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	ts.tv_sec += timeout / 1000;
+	ts.tv_nsec += (timeout % 1000) * 1000000;
+	if (ts.tv_nsec >= 1000000000) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000;
+	}
+	pthread_mutex_lock(&emul->lock);
+	while (1) {
+		/* Option may come and go with mode */
+		option = emul_scalar_option_find(emul, team_ifindex, name,
+						 NULL);
+		if (option && option->set_count > set_count)
+			break;
+		err = pthread_cond_timedwait(&emul->set_cond, &emul->lock, &ts);
+		if (err) {
+			err = -err;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&emul->lock);
+	return err;
+}
+
+static struct emul_option *emul_storm_option_next(struct emul_team *team)
+{
+	struct emul_option *option = team->storm_option;
+	unsigned int pass;
+
+	/* Second pass starts over from the list head */
+	for (pass = 0; pass < 2; pass++) {
+		while ((option = list_get_next_node_entry(&team->option_list,
+							  option, list))) {
+			if (option->storm && !option->removed) {
+				team->storm_option = option;
+				return option;
+			}
+		}
+	}
+	return NULL;
+}
+
+/**
+ * team_emul_option_storm:
+ * @emul: team emulator
+ * @team_ifindex: team device interface index
+ * @count: number of events
+ *
+ * Send @count option events as fast as possible. Each one increments
+ * value of next option added by team_emul_option_add(), round robin.
+ * Events not fitting receive buffers are dropped like kernel does.
+ *
+ * Returns: zero on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_emul_option_storm(struct team_emul *emul, uint32_t team_ifindex,
+			   unsigned int count)
+{
+	struct emul_link *team_link;
+	struct emul_option *option;
+	unsigned int i;
+	int err = 0;
+
+	/* Requests, like resync dumps, are served in between events */
+	for (i = 0; i < count && !err; i++) {
+		pthread_mutex_lock(&emul->lock);
+		team_link = emul_link_find(emul, team_ifindex);
+		if (!team_link || !team_link->team) {
+			err = -ENODEV;
+		} else {
+			option = emul_storm_option_next(team_link->team);
+			if (option) {
+				option->u32++;
+				option->changed = true;
+				emul_options_event(emul, team_link);
+			} else {
+				err = -ENOENT;
+			}
+		}
+		pthread_mutex_unlock(&emul->lock);
+	}
+	pthread_mutex_lock(&emul->lock);
+	emul_kick(emul);
+	pthread_mutex_unlock(&emul->lock);
+	return err;
+}
+
+static void emul_lb_stats_add(struct emul_option *option, uint64_t bytes)
+{
+	uint64_t tx_bytes;
+
+	if (!bytes || option->data_len != sizeof(tx_bytes))
+		return;
+	memcpy(&tx_bytes, option->data, sizeof(tx_bytes));
+	tx_bytes += bytes;
+	memcpy(option->data, &tx_bytes, sizeof(tx_bytes));
+	option->changed = true;
+}
+
+/**
+ * team_emul_lb_stats_refresh:
+ * @emul: team emulator
+ * @team_ifindex: team device interface index
+ * @tx_bytes: bytes sent by each of 256 hashes since previous refresh
+ *
+ * Account sent bytes to lb_hash_stats and, by lb_tx_hash_to_port_mapping,
+ * to lb_port_stats of loadbalance team device. Changed stats are sent in
+ * one event, like kernel does every lb_stats_refresh_interval.
+ *
+ * Returns: zero on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_emul_lb_stats_refresh(struct team_emul *emul, uint32_t team_ifindex,
+			       const uint64_t *tx_bytes)
+{
+	uint32_t mapping[EMUL_LB_HASH_COUNT] = {};
+	struct emul_link *team_link;
+	struct emul_option *option;
+	uint64_t port_bytes;
+	unsigned int i;
+	int err = 0;
+
+	pthread_mutex_lock(&emul->lock);
+	team_link = emul_link_find(emul, team_ifindex);
+	if (!team_link || !team_link->team) {
+		err = -ENODEV;
+		goto unlock;
+	}
+	if (strcmp(team_link->team->mode, "loadbalance")) {
+		err = -EOPNOTSUPP;
+		goto unlock;
+	}
+	list_for_each_node_entry(option, &team_link->team->option_list, list) {
+		if (!option->removed && option->array &&
+		    option->array_index < EMUL_LB_HASH_COUNT &&
+		    !strcmp(option->name, "lb_tx_hash_to_port_mapping"))
+			mapping[option->array_index] = option->u32;
+	}
+	list_for_each_node_entry(option, &team_link->team->option_list, list) {
+		if (option->removed)
+			continue;
+		if (option->array && option->array_index < EMUL_LB_HASH_COUNT &&
+		    !strcmp(option->name, "lb_hash_stats")) {
+			emul_lb_stats_add(option,
+					  tx_bytes[option->array_index]);
+		} else if (option->per_port &&
+			   !strcmp(option->name, "lb_port_stats")) {
+			port_bytes = 0;
+			for (i = 0; i < EMUL_LB_HASH_COUNT; i++)
+				if (mapping[i] == option->port_ifindex)
+					port_bytes += tx_bytes[i];
+			emul_lb_stats_add(option, port_bytes);
+		}
+	}
+	emul_options_event(emul, team_link);
+	emul_kick(emul);
+unlock:
+	pthread_mutex_unlock(&emul->lock);
+	return err;
+}
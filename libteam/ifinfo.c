@@ -25,14 +25,22 @@
 #include <netlink/data.h>
 #include <linux/netdevice.h>
 #include <linux/types.h>
+#include <linux/if_link.h>
 #include <team.h>
 #include <private/list.h>
+#include <private/hash.h>
 #include <private/misc.h>
 #include "team_private.h"
 
 struct team_ifinfo {
 	struct list_item	list;
+	struct hash_item	hitem; /* keyed by ifindex */
+	struct hash_item	name_hitem; /* keyed by ifname, if known */
+	struct list_item	changed_list;
+	bool			in_changed_list;
 	bool			linked;
+	bool			resynced;
+	unsigned int		watch_count;
 	uint32_t		ifindex;
 	struct team_port *	port; /* NULL if device is not team port */
 	char			hwaddr[MAX_ADDR_LEN];
@@ -45,6 +53,8 @@ struct team_ifinfo {
 	char			phys_port_id[MAX_PHYS_PORT_ID_LEN];
 	size_t			phys_port_id_len;
 	int			changed;
+	struct team_link_stats	stats;
+	struct team_link_stats	prev_stats;
 };
 
 #define CHANGED_REMOVED			(1 << 0)
@@ -74,24 +84,24 @@ static void clear_changed(struct team_ifinfo *ifinfo)
 	ifinfo->changed = 0;
 }
 
-static void update_hwaddr(struct team_ifinfo *ifinfo, struct rtnl_link *link)
+static void update_hwaddr(struct team_ifinfo *ifinfo, struct nlattr *attr)
 {
-	struct nl_addr *nl_addr;
 	char *hwaddr;
 	size_t hwaddr_len;
 
-	nl_addr = rtnl_link_get_addr(link);
-	if (!nl_addr)
+	if (!attr)
 		return;
 
-	hwaddr_len = nl_addr_get_len(nl_addr);
+	hwaddr_len = nla_len(attr);
+	if (hwaddr_len > MAX_ADDR_LEN)
+		hwaddr_len = MAX_ADDR_LEN;
 	if (ifinfo->hwaddr_len != hwaddr_len) {
 		ifinfo->hwaddr_len = hwaddr_len;
 		if (!ifinfo->master_ifindex)
 			ifinfo->orig_hwaddr_len = hwaddr_len;
 		set_changed(ifinfo, CHANGED_HWADDR_LEN);
 	}
-	hwaddr = nl_addr_get_binary_addr(nl_addr);
+	hwaddr = nla_data(attr);
 	if (memcmp(ifinfo->hwaddr, hwaddr, hwaddr_len)) {
 		memcpy(ifinfo->hwaddr, hwaddr, hwaddr_len);
 		if (!ifinfo->master_ifindex)
@@ -100,22 +110,33 @@ static void update_hwaddr(struct team_ifinfo *ifinfo, struct rtnl_link *link)
 	}
 }
 
-static void update_ifname(struct team_ifinfo *ifinfo, struct rtnl_link *link)
+static void update_ifname(struct team_handle *th, struct team_ifinfo *ifinfo,
+			  struct nlattr *attr)
 {
-	char *ifname;
+	char ifname[IFNAMSIZ];
 
-	ifname = rtnl_link_get_name(link);
-	if (ifname && strcmp(ifinfo->ifname, ifname)) {
+	if (!attr)
+		return;
+
+	nla_strlcpy(ifname, attr, sizeof(ifname));
+	if (strcmp(ifinfo->ifname, ifname)) {
+		if (ifinfo->ifname[0])
+			hash_table_del(&th->ifinfo_name_table,
+				       &ifinfo->name_hitem);
 		mystrlcpy(ifinfo->ifname, ifname, sizeof(ifinfo->ifname));
+		if (ifinfo->ifname[0])
+			hash_table_add(&th->ifinfo_name_table,
+				       &ifinfo->name_hitem,
+				       hash_str(ifinfo->ifname));
 		set_changed(ifinfo, CHANGED_IFNAME);
 	}
 }
 
-static void update_master(struct team_ifinfo *ifinfo, struct rtnl_link *link)
+static void update_master(struct team_ifinfo *ifinfo, struct nlattr *attr)
 {
 	uint32_t master_ifindex;
 
-	master_ifindex = rtnl_link_get_master(link);
+	master_ifindex = attr ? nla_get_u32(attr) : 0;
 	if (ifinfo->master_ifindex != master_ifindex) {
 		ifinfo->master_ifindex = master_ifindex;
 		set_changed(ifinfo, CHANGED_MASTER_IFINDEX);
@@ -123,65 +144,116 @@ static void update_master(struct team_ifinfo *ifinfo, struct rtnl_link *link)
 }
 
 static void update_phys_port_id(struct team_ifinfo *ifinfo,
-				struct rtnl_link *link)
+				struct nlattr *attr)
 {
-#ifdef HAVE_RTNL_LINK_GET_PHYS_ID
-	struct nl_data *nl_data;
 	char *phys_port_id = NULL;
 	size_t phys_port_id_len = 0;
 
-	nl_data = rtnl_link_get_phys_port_id(link);
-	if (nl_data) {
-		phys_port_id_len = nl_data_get_size(nl_data);
-		phys_port_id = nl_data_get(nl_data);
+	if (attr) {
+		phys_port_id_len = nla_len(attr);
+		if (phys_port_id_len > MAX_PHYS_PORT_ID_LEN)
+			phys_port_id_len = MAX_PHYS_PORT_ID_LEN;
+		phys_port_id = nla_data(attr);
 	}
 
 	if (ifinfo->phys_port_id_len != phys_port_id_len) {
 		ifinfo->phys_port_id_len = phys_port_id_len;
 		set_changed(ifinfo, CHANGED_PHYS_PORT_ID_LEN);
 	}
-	if (memcmp(ifinfo->phys_port_id, phys_port_id, phys_port_id_len)) {
+	if (phys_port_id_len &&
+	    memcmp(ifinfo->phys_port_id, phys_port_id, phys_port_id_len)) {
 		memcpy(ifinfo->phys_port_id, phys_port_id, phys_port_id_len);
 		set_changed(ifinfo, CHANGED_PHYS_PORT_ID);
 	}
-#endif
 }
 
-static void ifinfo_update(struct team_ifinfo *ifinfo, struct rtnl_link *link)
+static void ifinfo_update(struct team_handle *th, struct team_ifinfo *ifinfo,
+			  struct nlattr **tb)
 {
-	update_ifname(ifinfo, link);
-	update_master(ifinfo, link);
-	update_hwaddr(ifinfo, link);
-	update_phys_port_id(ifinfo, link);
+	update_ifname(th, ifinfo, tb[IFLA_IFNAME]);
+	update_master(ifinfo, tb[IFLA_MASTER]);
+	update_hwaddr(ifinfo, tb[IFLA_ADDRESS]);
+	update_phys_port_id(ifinfo, tb[IFLA_PHYS_PORT_ID]);
 }
 
-static struct team_ifinfo *ifinfo_find(struct team_handle *th, uint32_t ifindex)
+struct team_ifinfo *ifinfo_find(struct team_handle *th, uint32_t ifindex)
 {
 	struct team_ifinfo *ifinfo;
+	uint32_t hash = hash_u32(ifindex);
 
-	list_for_each_node_entry(ifinfo, &th->ifinfo_list, list) {
+	hash_table_for_each_match(ifinfo, &th->ifinfo_table, hash, hitem) {
 		if (ifinfo->ifindex == ifindex)
 			return ifinfo;
 	}
 	return NULL;
 }
 
-static void clear_last_changed(struct team_handle *th)
+/*
+ * Tells if ifinfo is kept up to date by link events and so it can be
+ * used to answer name and index lookups. Handles attached to event
+ * multiplexer only get events of the team device and its ports.
+ */
+static bool ifinfo_is_current(struct team_handle *th,
+			      struct team_ifinfo *ifinfo)
 {
-	struct team_ifinfo *ifinfo;
-
-	list_for_each_node_entry(ifinfo, &th->ifinfo_list, list)
-		clear_changed(ifinfo);
+	if (is_changed(ifinfo, CHANGED_REMOVED))
+		return false;
+	return !th->evmux || ifinfo->linked ||
+	       ifinfo->ifindex == th->ifindex ||
+	       ifinfo->master_ifindex == th->ifindex;
 }
 
-static struct team_ifinfo *ifinfo_find_create(struct team_handle *th,
-					      uint32_t ifindex)
+static struct team_ifinfo *ifinfo_find_current(struct team_handle *th,
+					       uint32_t ifindex)
 {
 	struct team_ifinfo *ifinfo;
 
 	ifinfo = ifinfo_find(th, ifindex);
-	if (ifinfo)
+	if (ifinfo && ifinfo_is_current(th, ifinfo))
 		return ifinfo;
+	return NULL;
+}
+
+static struct team_ifinfo *ifinfo_find_current_by_name(struct team_handle *th,
+						       const char *ifname)
+{
+	struct team_ifinfo *ifinfo;
+	uint32_t hash = hash_str(ifname);
+
+	hash_table_for_each_match(ifinfo, &th->ifinfo_name_table, hash,
+				  name_hitem) {
+		if (!strcmp(ifinfo->ifname, ifname) &&
+		    ifinfo_is_current(th, ifinfo))
+			return ifinfo;
+	}
+	return NULL;
+}
+
+static void changed_list_add(struct team_handle *th,
+			     struct team_ifinfo *ifinfo)
+{
+	if (ifinfo->in_changed_list)
+		return;
+	list_add_tail(&th->ifinfo_changed_list, &ifinfo->changed_list);
+	ifinfo->in_changed_list = true;
+}
+
+static void clear_last_changed(struct team_handle *th)
+{
+	struct team_ifinfo *ifinfo, *tmp;
+
+	list_for_each_node_entry_safe(ifinfo, tmp, &th->ifinfo_changed_list,
+				      changed_list) {
+		list_del(&ifinfo->changed_list);
+		ifinfo->in_changed_list = false;
+		clear_changed(ifinfo);
+	}
+}
+
+static struct team_ifinfo *ifinfo_create(struct team_handle *th,
+					 uint32_t ifindex)
+{
+	struct team_ifinfo *ifinfo;
 
 	ifinfo = myzalloc(sizeof(*ifinfo));
 	if (!ifinfo)
@@ -189,95 +261,140 @@ static struct team_ifinfo *ifinfo_find_create(struct team_handle *th,
 
 	ifinfo->ifindex = ifindex;
 	list_add(&th->ifinfo_list, &ifinfo->list);
+	hash_table_add(&th->ifinfo_table, &ifinfo->hitem, hash_u32(ifindex));
 	return ifinfo;
 }
 
-static void ifinfo_destroy(struct team_ifinfo *ifinfo)
+static void ifinfo_destroy(struct team_handle *th, struct team_ifinfo *ifinfo)
 {
+	if (ifinfo->in_changed_list)
+		list_del(&ifinfo->changed_list);
+	if (ifinfo->ifname[0])
+		hash_table_del(&th->ifinfo_name_table, &ifinfo->name_hitem);
+	hash_table_del(&th->ifinfo_table, &ifinfo->hitem);
 	list_del(&ifinfo->list);
 	free(ifinfo);
 }
 
+/*
+ * Only the team device, its ports (including ones not yet linked) and
+ * links user asked for by team_ifinfo_watch() are tracked.
+ */
+static bool ifinfo_is_wanted(struct team_handle *th,
+			     struct team_ifinfo *ifinfo)
+{
+	return ifinfo->linked || ifinfo->watch_count ||
+	       ifinfo->ifindex == th->ifindex ||
+	       ifinfo->master_ifindex == th->ifindex;
+}
+
 static void ifinfo_destroy_removed(struct team_handle *th)
 {
 	struct team_ifinfo *ifinfo, *tmp;
 
 	list_for_each_node_entry_safe(ifinfo, tmp, &th->ifinfo_list, list) {
-		if (is_changed(ifinfo, CHANGED_REMOVED))
-			ifinfo_destroy(ifinfo);
+		if (is_changed(ifinfo, CHANGED_REMOVED) ||
+		    !ifinfo_is_wanted(th, ifinfo))
+			ifinfo_destroy(th, ifinfo);
 	}
 }
 
-static void obj_input_newlink(struct nl_object *obj, void *arg, bool event)
+static struct nla_policy ifinfo_link_policy[IFLA_MAX + 1] = {
+	[IFLA_IFNAME]		= { .type = NLA_STRING, .maxlen = IFNAMSIZ },
+	[IFLA_MASTER]		= { .type = NLA_U32 },
+	[IFLA_STATS64]		= { .minlen = sizeof(struct rtnl_link_stats64) },
+};
+
+static int ifinfo_parse(struct team_handle *th, struct nlmsghdr *nlh,
+			struct nlattr **tb, uint32_t *p_ifindex)
 {
-	struct team_handle *th = arg;
-	struct rtnl_link *link;
-	struct team_ifinfo *ifinfo;
-	uint32_t ifindex;
+	struct ifinfomsg *ifi;
 	int err;
 
-	ifinfo_destroy_removed(th);
+	err = nlmsg_parse(nlh, sizeof(*ifi), tb, IFLA_MAX, ifinfo_link_policy);
+	if (err) {
+		err(th, "Failed to parse link message.");
+		return -nl2syserr(err);
+	}
+	ifi = nlmsg_data(nlh);
+	*p_ifindex = ifi->ifi_index;
+	return 0;
+}
 
-	link = (struct rtnl_link *) obj;
+/*
+ * Link messages are parsed in place and the ones of links which are not
+ * tracked are dropped before anything gets allocated. @force makes the
+ * link tracked regardless, that is used for links fetched on demand.
+ */
+static void ifinfo_input_newlink(struct team_handle *th, struct nlmsghdr *nlh,
+				 bool event, bool force)
+{
+	struct nlattr *tb[IFLA_MAX + 1];
+	struct team_ifinfo *ifinfo;
+	uint32_t master_ifindex;
+	uint32_t ifindex;
 
-	ifindex = rtnl_link_get_ifindex(link);
-	ifinfo = ifinfo_find_create(th, ifindex);
-	if (!ifinfo)
+	/* Resync collects changes of all links, nothing is dropped */
+	if (!th->resyncing)
+		ifinfo_destroy_removed(th);
+
+	if (ifinfo_parse(th, nlh, tb, &ifindex))
 		return;
 
-	if (event) {
-		err = rtnl_link_get_kernel(th->nl_cli.sock, ifindex, NULL, &link);
-		if (err)
+	ifinfo = ifinfo_find(th, ifindex);
+	if (!ifinfo) {
+		master_ifindex = tb[IFLA_MASTER] ?
+				 nla_get_u32(tb[IFLA_MASTER]) : 0;
+		if (!force && ifindex != th->ifindex &&
+		    master_ifindex != th->ifindex)
+			return;
+		ifinfo = ifinfo_create(th, ifindex);
+		if (!ifinfo)
 			return;
 	}
 
-	clear_last_changed(th);
-	ifinfo_update(ifinfo, link);
-
-	if (event)
-		rtnl_link_put(link);
+	if (!th->resyncing)
+		clear_last_changed(th);
+	ifinfo_update(th, ifinfo, tb);
+	if (ifinfo->changed)
+		changed_list_add(th, ifinfo);
+	ifinfo->resynced = true;
 
 	if (ifinfo->changed || !event)
 		set_call_change_handlers(th, TEAM_IFINFO_CHANGE);
 }
 
-static void event_handler_obj_input_newlink(struct nl_object *obj, void *arg)
-{
-	return obj_input_newlink(obj, arg, true);
-}
-
-static void event_handler_obj_input_dellink(struct nl_object *obj, void *arg)
+static void ifinfo_input_dellink(struct team_handle *th, struct nlmsghdr *nlh)
 {
-	struct team_handle *th = arg;
-	struct rtnl_link *link;
 	struct team_ifinfo *ifinfo;
-	uint32_t ifindex;
+	struct ifinfomsg *ifi;
 
 	ifinfo_destroy_removed(th);
 
-	link = (struct rtnl_link *) obj;
+	if (!nlmsg_valid_hdr(nlh, sizeof(*ifi)))
+		return;
+	ifi = nlmsg_data(nlh);
 
-	ifindex = rtnl_link_get_ifindex(link);
-	ifinfo = ifinfo_find_create(th, ifindex);
+	ifinfo = ifinfo_find(th, ifi->ifi_index);
 	if (!ifinfo)
 		return;
 	clear_last_changed(th);
 	set_changed(ifinfo, CHANGED_REMOVED);
+	changed_list_add(th, ifinfo);
 	set_call_change_handlers(th, TEAM_IFINFO_CHANGE);
 }
 
 int ifinfo_event_handler(struct nl_msg *msg, void *arg)
 {
 	struct team_handle *th = arg;
+	struct nlmsghdr *nlh = nlmsg_hdr(msg);
 
-	switch (nlmsg_hdr(msg)->nlmsg_type) {
+	switch (nlh->nlmsg_type) {
 	case RTM_NEWLINK:
-		if (nl_msg_parse(msg, &event_handler_obj_input_newlink, th) < 0)
-			err(th, "Unknown message type.");
+		ifinfo_input_newlink(th, nlh, true, false);
 		break;
 	case RTM_DELLINK:
-		if (nl_msg_parse(msg, &event_handler_obj_input_dellink, th) < 0)
-			err(th, "Unknown message type.");
+		ifinfo_input_dellink(th, nlh);
 		break;
 	default:
 		return NL_OK;
@@ -287,55 +404,271 @@ int ifinfo_event_handler(struct nl_msg *msg, void *arg)
 
 int ifinfo_list_alloc(struct team_handle *th)
 {
+	int err;
+
 	list_init(&th->ifinfo_list);
+	list_init(&th->ifinfo_changed_list);
+	err = hash_table_init(&th->ifinfo_table);
+	if (err)
+		return err;
+	err = hash_table_init(&th->ifinfo_name_table);
+	if (err) {
+		hash_table_fini(&th->ifinfo_table);
+		return err;
+	}
 	return 0;
 }
 
-static void valid_handler_obj_input_newlink(struct nl_object *obj, void *arg)
+static int valid_handler(struct nl_msg *msg, void *arg)
 {
-	return obj_input_newlink(obj, arg, false);
+	struct team_handle *th = arg;
+	struct nlmsghdr *nlh = nlmsg_hdr(msg);
+
+	if (nlh->nlmsg_type != RTM_NEWLINK)
+		return NL_OK;
+
+	ifinfo_input_newlink(th, nlh, false, false);
+	return NL_OK;
 }
 
-static int valid_handler(struct nl_msg *msg, void *arg)
+static int fetch_valid_handler(struct nl_msg *msg, void *arg)
 {
 	struct team_handle *th = arg;
+	struct nlmsghdr *nlh = nlmsg_hdr(msg);
 
-	if (nlmsg_hdr(msg)->nlmsg_type != RTM_NEWLINK)
+	if (nlh->nlmsg_type != RTM_NEWLINK)
 		return NL_OK;
 
-	if (nl_msg_parse(msg, &valid_handler_obj_input_newlink, th) < 0)
-		err(th, "Unknown message type.");
+	ifinfo_input_newlink(th, nlh, false, true);
 	return NL_OK;
 }
 
-int get_ifinfo_list(struct team_handle *th)
+static void update_stats(struct team_ifinfo *ifinfo, struct nlattr *attr,
+			 uint64_t now)
+{
+	struct rtnl_link_stats64 st;
+
+	/* Attribute payload is not guaranteed to be 8-byte aligned */
+	memcpy(&st, nla_data(attr), sizeof(st));
+	ifinfo->prev_stats = ifinfo->stats;
+	ifinfo->stats.rx_packets = st.rx_packets;
+	ifinfo->stats.tx_packets = st.tx_packets;
+	ifinfo->stats.rx_bytes = st.rx_bytes;
+	ifinfo->stats.tx_bytes = st.tx_bytes;
+	ifinfo->stats.rx_errors = st.rx_errors;
+	ifinfo->stats.tx_errors = st.tx_errors;
+	ifinfo->stats.rx_dropped = st.rx_dropped;
+	ifinfo->stats.tx_dropped = st.tx_dropped;
+	ifinfo->stats.multicast = st.multicast;
+	ifinfo->stats.timestamp = now;
+}
+
+/* Only counters are taken, the rest of link is left to link events */
+static int stats_valid_handler(struct nl_msg *msg, void *arg)
+{
+	struct team_handle *th = arg;
+	struct nlmsghdr *nlh = nlmsg_hdr(msg);
+	struct nlattr *tb[IFLA_MAX + 1];
+	struct team_ifinfo *ifinfo;
+	uint32_t ifindex;
+
+	if (nlh->nlmsg_type != RTM_NEWLINK)
+		return NL_OK;
+	if (ifinfo_parse(th, nlh, tb, &ifindex) || !tb[IFLA_STATS64])
+		return NL_OK;
+	ifinfo = ifinfo_find_current(th, ifindex);
+	if (!ifinfo || (ifindex != th->ifindex && !ifinfo->port))
+		return NL_OK;
+	update_stats(ifinfo, tb[IFLA_STATS64], team_now_ms());
+	return NL_OK;
+}
+
+static int ifinfo_recv(struct team_handle *th, nl_recvmsg_msg_cb_t func)
 {
 	struct nl_cb *cb;
 	struct nl_cb *orig_cb;
-	struct rtgenmsg rt_hdr = {
-		.rtgen_family = AF_UNSPEC,
-	};
 	int ret;
 
-	ret = nl_send_simple(th->nl_cli.sock, RTM_GETLINK, NLM_F_DUMP,
-			     &rt_hdr, sizeof(rt_hdr));
-	if (ret < 0)
-		return -nl2syserr(ret);
 	orig_cb = nl_socket_get_cb(th->nl_cli.sock);
 	cb = nl_cb_clone(orig_cb);
 	nl_cb_put(orig_cb);
 	if (!cb)
 		return -ENOMEM;
 
-	nl_cb_set(cb, NL_CB_VALID, NL_CB_CUSTOM, valid_handler, th);
+	nl_cb_set(cb, NL_CB_VALID, NL_CB_CUSTOM, func, th);
 
 	ret = nl_recvmsgs(th->nl_cli.sock, cb);
 	nl_cb_put(cb);
 	if (ret < 0)
 		return -nl2syserr(ret);
+	return 0;
+}
+
+/*
+ * Get single link from kernel and start tracking it. Used for links
+ * which are wanted but whose link events were not seen.
+ */
+static int send_link_get(struct team_handle *th, uint32_t ifindex)
+{
+	struct nl_msg *msg;
+	struct ifinfomsg ifi = {
+		.ifi_family = AF_UNSPEC,
+		.ifi_index = ifindex,
+	};
+	int ret;
+
+	msg = nlmsg_alloc_simple(RTM_GETLINK, 0);
+	if (!msg)
+		return -ENOMEM;
+	ret = nlmsg_append(msg, &ifi, sizeof(ifi), NLMSG_ALIGNTO);
+	if (ret < 0) {
+		nlmsg_free(msg);
+		return -nl2syserr(ret);
+	}
+	ret = nl_send_auto(th->nl_cli.sock, msg);
+	nlmsg_free(msg);
+	if (ret < 0)
+		return -nl2syserr(ret);
+	return 0;
+}
+
+/* Reply to single link get is followed by ack, see nl_send_auto() */
+static int ifinfo_link_get(struct team_handle *th, uint32_t ifindex,
+			   nl_recvmsg_msg_cb_t func)
+{
+	int ret;
+
+	ret = send_link_get(th, ifindex);
+	if (ret)
+		return ret;
+	ret = ifinfo_recv(th, func);
+	if (ret)
+		return ret;
+	ret = nl_wait_for_ack(th->nl_cli.sock);
+	if (ret < 0)
+		return -nl2syserr(ret);
+	return 0;
+}
+
+static int ifinfo_fetch(struct team_handle *th, uint32_t ifindex)
+{
+	int ret;
+
+	ret = ifinfo_link_get(th, ifindex, fetch_valid_handler);
+	if (ret)
+		return ret;
+	return ifinfo_find(th, ifindex) ? 0 : -ENOENT;
+}
+
+/*
+ * Ask kernel to dump only ports of the team device. Kernels not knowing
+ * the master filter dump all links, those are filtered out by
+ * ifinfo_input_newlink().
+ */
+static int send_port_link_dump(struct team_handle *th)
+{
+	struct nl_msg *msg;
+	struct ifinfomsg ifi = {
+		.ifi_family = AF_UNSPEC,
+	};
+	int ret;
+
+	msg = nlmsg_alloc_simple(RTM_GETLINK, NLM_F_DUMP);
+	if (!msg)
+		return -ENOMEM;
+	ret = nlmsg_append(msg, &ifi, sizeof(ifi), NLMSG_ALIGNTO);
+	if (ret < 0)
+		goto nla_put_failure;
+	NLA_PUT_U32(msg, IFLA_MASTER, th->ifindex);
+	ret = nl_send_auto(th->nl_cli.sock, msg);
+	nlmsg_free(msg);
+	if (ret < 0)
+		return -nl2syserr(ret);
+	return 0;
+
+nla_put_failure:
+	nlmsg_free(msg);
+	return -ENOBUFS;
+}
+
+/*
+ * Only the team device and its ports are fetched. Everything else is
+ * fetched on demand once it is needed, see ifinfo_fetch().
+ */
+int get_ifinfo_list(struct team_handle *th)
+{
+	int ret;
+
+	ret = ifinfo_fetch(th, th->ifindex);
+	if (ret)
+		return ret;
+	ret = send_port_link_dump(th);
+	if (ret)
+		return ret;
+	ret = ifinfo_recv(th, valid_handler);
+	if (ret)
+		return ret;
 	return check_call_change_handlers(th, TEAM_IFINFO_CHANGE);
 }
 
+/*
+ * Counters of all ports are taken from single dump, the same one which
+ * is used to get the ports on init.
+ */
+int ifinfo_list_stats_refresh(struct team_handle *th)
+{
+	int ret;
+
+	ret = ifinfo_link_get(th, th->ifindex, stats_valid_handler);
+	if (ret)
+		return ret;
+	ret = send_port_link_dump(th);
+	if (ret)
+		return ret;
+	return ifinfo_recv(th, stats_valid_handler);
+}
+
+/*
+ * Used once link events may have been lost. Team device and its ports
+ * are fetched again, other tracked links one by one. Links which are
+ * gone are reported as removed. Change handlers are left for caller to
+ * call.
+ */
+int ifinfo_list_resync(struct team_handle *th)
+{
+	struct team_ifinfo *ifinfo, *tmp;
+	int err;
+
+	list_for_each_node_entry(ifinfo, &th->ifinfo_list, list)
+		ifinfo->resynced = false;
+
+	err = send_port_link_dump(th);
+	if (!err)
+		err = ifinfo_recv(th, valid_handler);
+	list_for_each_node_entry_safe(ifinfo, tmp, &th->ifinfo_list, list) {
+		if (err)
+			break;
+		if (ifinfo->resynced)
+			continue;
+		err = ifinfo_fetch(th, ifinfo->ifindex);
+		if (err == -ENODEV) {
+			set_changed(ifinfo, CHANGED_REMOVED);
+			changed_list_add(th, ifinfo);
+			err = 0;
+		}
+	}
+	if (err)
+		return err;
+	set_call_change_handlers(th, TEAM_IFINFO_CHANGE);
+	return 0;
+}
+
+void ifinfo_list_cleanup_last_state(struct team_handle *th)
+{
+	ifinfo_destroy_removed(th);
+	clear_last_changed(th);
+}
+
 int ifinfo_list_init(struct team_handle *th)
 {
 	int err;
@@ -353,22 +686,95 @@ static void flush_port_list(struct team_handle *th)
 	struct team_ifinfo *ifinfo, *tmp;
 
 	list_for_each_node_entry_safe(ifinfo, tmp, &th->ifinfo_list, list)
-		ifinfo_destroy(ifinfo);
+		ifinfo_destroy(th, ifinfo);
 }
 
 void ifinfo_list_free(struct team_handle *th)
 {
 	flush_port_list(th);
+	hash_table_fini(&th->ifinfo_name_table);
+	hash_table_fini(&th->ifinfo_table);
+}
+
+/* Copies are not hashed nor tracked, only getters may be used on them */
+int ifinfo_list_snapshot(struct team_handle *th, struct team_snapshot *snap)
+{
+	struct team_ifinfo *ifinfo;
+	struct team_ifinfo *copy;
+
+	list_for_each_node_entry(ifinfo, &th->ifinfo_list, list) {
+		if (!ifinfo->linked)
+			continue;
+		copy = malloc(sizeof(*copy));
+		if (!copy)
+			return -ENOMEM;
+		memcpy(copy, ifinfo, sizeof(*copy));
+		copy->port = NULL;
+		copy->in_changed_list = false;
+		list_add_tail(&snap->ifinfo_list, &copy->list);
+	}
+	return 0;
+}
+
+struct team_ifinfo *ifinfo_snapshot_link_port(struct team_snapshot *snap,
+					      uint32_t ifindex,
+					      struct team_port *port)
+{
+	struct team_ifinfo *copy;
+
+	list_for_each_node_entry(copy, &snap->ifinfo_list, list) {
+		if (copy->ifindex == ifindex) {
+			copy->port = port;
+			return copy;
+		}
+	}
+	return NULL;
+}
+
+void ifinfo_snapshot_free(struct team_snapshot *snap)
+{
+	struct team_ifinfo *copy, *tmp;
+
+	list_for_each_node_entry_safe(copy, tmp, &snap->ifinfo_list, list)
+		free(copy);
+}
+
+/*
+ * Name and index lookups are answered from tracked links. Links which
+ * are not tracked are not cached as nothing would keep them up to date.
+ */
+uint32_t ifinfo_ifname2ifindex(struct team_handle *th, const char *ifname)
+{
+	struct team_ifinfo *ifinfo;
+
+	ifinfo = ifinfo_find_current_by_name(th, ifname);
+	return ifinfo ? ifinfo->ifindex : 0;
+}
+
+char *ifinfo_ifindex2ifname(struct team_handle *th, uint32_t ifindex)
+{
+	struct team_ifinfo *ifinfo;
+
+	ifinfo = ifinfo_find_current(th, ifindex);
+	if (!ifinfo || !ifinfo->ifname[0])
+		return NULL;
+	return ifinfo->ifname;
 }
 
 int ifinfo_link_with_port(struct team_handle *th, uint32_t ifindex,
 			  struct team_port *port, struct team_ifinfo **p_ifinfo)
 {
 	struct team_ifinfo *ifinfo;
+	int err;
 
 	ifinfo = ifinfo_find(th, ifindex);
-	if (!ifinfo)
-		return -ENOENT;
+	if (!ifinfo) {
+		/* Port may be reported before its link event arrives */
+		err = ifinfo_fetch(th, ifindex);
+		if (err)
+			return err;
+		ifinfo = ifinfo_find(th, ifindex);
+	}
 	if (ifinfo->linked)
 		return -EBUSY;
 	ifinfo->port = port;
@@ -390,6 +796,59 @@ void ifinfo_unlink(struct team_ifinfo *ifinfo)
 	ifinfo->linked = false;
 }
 
+/**
+ * team_ifinfo_watch:
+ * @th: libteam library context
+ * @ifindex: interface index
+ * @p_ifinfo: pointer where ifinfo of @ifindex will be stored (may be NULL)
+ *
+ * Only the team device and its ports are tracked, link events of other
+ * interfaces are dropped. This makes interface @ifindex tracked
+ * as well until team_ifinfo_unwatch() is called. Its changes are reported
+ * as TEAM_IFINFO_CHANGE. Handles attached to event multiplexer only get
+ * the initial state of watched interfaces which are not ports.
+ *
+ * Returns: zero on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_ifinfo_watch(struct team_handle *th, uint32_t ifindex,
+		      struct team_ifinfo **p_ifinfo)
+{
+	struct team_ifinfo *ifinfo;
+	int err;
+
+	ifinfo = ifinfo_find(th, ifindex);
+	if (!ifinfo) {
+		err = ifinfo_fetch(th, ifindex);
+		if (err)
+			return err;
+		ifinfo = ifinfo_find(th, ifindex);
+	}
+	ifinfo->watch_count++;
+	if (p_ifinfo)
+		*p_ifinfo = ifinfo;
+	return 0;
+}
+
+/**
+ * team_ifinfo_unwatch:
+ * @th: libteam library context
+ * @ifindex: interface index
+ *
+ * Drop interest in interface @ifindex taken by team_ifinfo_watch().
+ * Once it is not wanted for other reason, its ifinfo gets freed while
+ * processing next link event.
+ **/
+TEAM_EXPORT
+void team_ifinfo_unwatch(struct team_handle *th, uint32_t ifindex)
+{
+	struct team_ifinfo *ifinfo;
+
+	ifinfo = ifinfo_find(th, ifindex);
+	if (ifinfo && ifinfo->watch_count)
+		ifinfo->watch_count--;
+}
+
 /**
  * team_get_next_ifinfo:
  * @th: libteam library context
@@ -411,6 +870,46 @@ struct team_ifinfo *team_get_next_ifinfo(struct team_handle *th,
 	return NULL;
 }
 
+/**
+ * team_snapshot_get_next_ifinfo:
+ * @snap: libteam snapshot
+ * @ifinfo: ifinfo structure
+ *
+ * Get next ifinfo in snapshot.
+ *
+ * Returns: ifinfo next to @ifinfo passed.
+ **/
+TEAM_EXPORT
+struct team_ifinfo *team_snapshot_get_next_ifinfo(struct team_snapshot *snap,
+						  struct team_ifinfo *ifinfo)
+{
+	return list_get_next_node_entry(&snap->ifinfo_list, ifinfo, list);
+}
+
+/**
+ * team_get_next_changed_ifinfo:
+ * @th: libteam library context
+ * @ifinfo: ifinfo structure
+ *
+ * Get next ifinfo which got changed or removed by last processed event.
+ * Watched interfaces are included. Unlike team_get_next_ifinfo() this
+ * does not walk ifinfos which stayed the same.
+ *
+ * Returns: changed ifinfo next to @ifinfo passed.
+ **/
+TEAM_EXPORT
+struct team_ifinfo *team_get_next_changed_ifinfo(struct team_handle *th,
+						 struct team_ifinfo *ifinfo)
+{
+	do {
+		ifinfo = list_get_next_node_entry(&th->ifinfo_changed_list,
+						  ifinfo, changed_list);
+		if (ifinfo && (ifinfo->linked || ifinfo->watch_count))
+			return ifinfo;
+	} while (ifinfo);
+	return NULL;
+}
+
 /**
  * team_is_ifinfo_removed:
  * @ifinfo: ifinfo structure
@@ -650,6 +1149,52 @@ bool team_is_ifinfo_phys_port_id_len_changed(struct team_ifinfo *ifinfo)
 	return is_changed(ifinfo, CHANGED_PHYS_PORT_ID_LEN);
 }
 
+/**
+ * team_get_ifinfo_stats:
+ * @ifinfo: ifinfo structure
+ *
+ * Get traffic counters of the interface as of last team_refresh_stats().
+ * Only team device and its ports are refreshed.
+ *
+ * Returns: pointer to counters, all zero if never refreshed.
+ **/
+TEAM_EXPORT
+const struct team_link_stats *
+team_get_ifinfo_stats(struct team_ifinfo *ifinfo)
+{
+	return &ifinfo->stats;
+}
+
+/**
+ * team_get_ifinfo_prev_stats:
+ * @ifinfo: ifinfo structure
+ *
+ * Get traffic counters of the interface as of the refresh before the
+ * last one. Together with team_get_ifinfo_stats() it gives rates.
+ *
+ * Returns: pointer to counters, all zero if not refreshed twice yet.
+ **/
+TEAM_EXPORT
+const struct team_link_stats *
+team_get_ifinfo_prev_stats(struct team_ifinfo *ifinfo)
+{
+	return &ifinfo->prev_stats;
+}
+
+/**
+ * team_get_stats:
+ * @th: libteam library context
+ *
+ * Get traffic counters of team device as of last team_refresh_stats().
+ *
+ * Returns: pointer to counters or NULL in case team device is not known.
+ **/
+TEAM_EXPORT
+const struct team_link_stats *team_get_stats(struct team_handle *th)
+{
+	return th->ifinfo ? &th->ifinfo->stats : NULL;
+}
+
 /**
  * team_is_ifinfo_changed:
  * @ifinfo: ifinfo structure
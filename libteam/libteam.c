@@ -23,8 +23,10 @@
 #include <stdarg.h>
 #include <unistd.h>
 #include <syslog.h>
+#include <poll.h>
 #include <sys/select.h>
 #include <sys/epoll.h>
+#include <sys/timerfd.h>
 #include <time.h>
 #include <netlink/netlink.h>
 #include <netlink/genl/genl.h>
@@ -32,6 +34,8 @@
 #include <netlink/cli/utils.h>
 #include <netlink/cli/link.h>
 #include <linux/if_team.h>
+#include <linux/rtnetlink.h>
+#include <linux/if_link.h>
 #include <linux/types.h>
 #include <linux/filter.h>
 #include <team.h>
@@ -132,33 +136,95 @@ static int seq_check_handler(struct nl_msg *msg, void *arg)
 	return NL_OK;
 }
 
+/*
+ * Requests reuse one message and one callback set allocated together with
+ * the handle, so setting options (port enabling, active port) does not
+ * allocate memory.
+ */
+static int req_alloc(struct team_handle *th)
+{
+	struct nl_cb *orig_cb;
+
+	th->req.msg = nlmsg_alloc();
+	if (!th->req.msg)
+		return -ENOMEM;
+	orig_cb = nl_socket_get_cb(th->nl_sock);
+	th->req.cb = nl_cb_clone(orig_cb);
+	nl_cb_put(orig_cb);
+	if (!th->req.cb) {
+		nlmsg_free(th->req.msg);
+		return -ENOMEM;
+	}
+	nl_cb_set(th->req.cb, NL_CB_ACK, NL_CB_CUSTOM,
+		  ack_handler, &th->req.acked);
+	nl_cb_set(th->req.cb, NL_CB_SEQ_CHECK, NL_CB_CUSTOM,
+		  seq_check_handler, &th->req.seq);
+	return 0;
+}
+
+static void req_free(struct team_handle *th)
+{
+	nl_cb_put(th->req.cb);
+	nlmsg_free(th->req.msg);
+}
+
+/* Returned message is released by send_and_recv() or by nlmsg_free() */
+struct nl_msg *team_req_msg_get(struct team_handle *th)
+{
+	nlmsg_get(th->req.msg);
+	nlmsg_hdr(th->req.msg)->nlmsg_len = NLMSG_HDRLEN;
+	return th->req.msg;
+}
+
+uint64_t team_now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int req_wait(struct team_handle *th, uint64_t deadline)
+{
+	struct pollfd pfd;
+	uint64_t now;
+	int ret;
+
+	pfd.fd = nl_socket_get_fd(th->nl_sock);
+	pfd.events = POLLIN;
+	do {
+		now = team_now_ms();
+		if (now >= deadline)
+			return -ETIMEDOUT;
+		ret = poll(&pfd, 1, deadline - now);
+	} while (ret == -1 && errno == EINTR);
+	if (ret == -1)
+		return -errno;
+	if (!ret)
+		return -ETIMEDOUT;
+	return 0;
+}
+
 int send_and_recv(struct team_handle *th, struct nl_msg *msg,
 		  int (*valid_handler)(struct nl_msg *, void *),
 		  void *valid_data)
 {
 	int ret;
-	struct nl_cb *cb;
-	struct nl_cb *orig_cb;
-	bool acked;
+	struct nl_cb *cb = th->req.cb;
 	unsigned int seq = th->nl_sock_seq++;
-	int err;
+	uint64_t deadline = 0;
 
 	ret = nl_send_auto(th->nl_sock, msg);
 	nlmsg_free(msg);
 	if (ret < 0)
 		return -nl2syserr(ret);
 
-	orig_cb = nl_socket_get_cb(th->nl_sock);
-	cb = nl_cb_clone(orig_cb);
-	nl_cb_put(orig_cb);
-	if (!cb)
-		return -ENOMEM;
-
-	nl_cb_set(cb, NL_CB_ACK, NL_CB_CUSTOM, ack_handler, &acked);
-	nl_cb_set(cb, NL_CB_SEQ_CHECK, NL_CB_CUSTOM, seq_check_handler, &seq);
+	th->req.seq = seq;
 	if (valid_handler)
 		nl_cb_set(cb, NL_CB_VALID, NL_CB_CUSTOM,
 			  valid_handler, valid_data);
+	else
+		nl_cb_set(cb, NL_CB_VALID, NL_CB_DEFAULT, NULL, NULL);
 
 	/* There is a bug in libnl. When implicit sequence number checking is in
 	 * use the expected next number is increased when NLMSG_DONE is
@@ -169,21 +235,332 @@ int send_and_recv(struct team_handle *th, struct nl_msg *msg,
 	 * sequence number checking is used here.
 	 */
 
-	acked = false;
-	while (!acked) {
+	if (th->req.timeout)
+		deadline = team_now_ms() + th->req.timeout;
+	th->req.acked = false;
+	while (!th->req.acked) {
+		/* Late reply is skipped by sequence number check */
+		if (deadline) {
+			ret = req_wait(th, deadline);
+			if (ret)
+				return ret;
+		}
 		ret = nl_recvmsgs(th->nl_sock, cb);
-		if (ret) {
-			err = -nl2syserr(ret);
-			goto put_cb;
+		if (ret)
+			return -nl2syserr(ret);
+	}
+	return 0;
+}
+
+/**
+ * SECTION: Asynchronous requests
+ * @short_description: requests which do not wait for kernel reply
+ *
+ * Asynchronous requests are sent over separate socket created on first
+ * use. That socket and the request timeout timer are added to the event
+ * filedescriptor, so done funcs get called from team_handle_events() (or
+ * team_evmux_handle_events()). Any number of requests may be in flight.
+ */
+
+struct team_req *team_req_get(struct team_handle *th)
+{
+	struct team_req *req;
+
+	if (!list_empty(&th->async.free_list)) {
+		req = list_get_node_entry(th->async.free_list.next,
+					  struct team_req, list);
+		list_del(&req->list);
+	} else {
+		req = malloc(sizeof(*req));
+		if (!req)
+			return NULL;
+		th->alloc_count++;
+	}
+	memset(req, 0, sizeof(*req));
+	return req;
+}
+
+void team_req_put(struct team_handle *th, struct team_req *req)
+{
+	if (req->release)
+		req->release(th, req);
+	list_add(&th->async.free_list, &req->list);
+}
+
+static void team_req_timer_arm(struct team_handle *th)
+{
+	struct itimerspec its;
+	struct team_req *req;
+
+	memset(&its, 0, sizeof(its));
+	if (!list_empty(&th->async.inflight_list)) {
+		req = list_get_node_entry(th->async.inflight_list.next,
+					  struct team_req, list);
+		if (req->deadline) {
+			its.it_value.tv_sec = req->deadline / 1000;
+			its.it_value.tv_nsec = (req->deadline % 1000) * 1000000;
 		}
 	}
+	timerfd_settime(th->async.timer_fd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+static void team_req_done(struct team_handle *th, uint32_t id, int err)
+{
+	struct team_req *req;
+
+	list_for_each_node_entry(req, &th->async.inflight_list, list) {
+		if (req->id != id)
+			continue;
+		list_del(&req->list);
+		th->async.inflight_count--;
+		req->err = err;
+		list_add_tail(&th->async.done_list, &req->list);
+		return;
+	}
+}
+
+static int async_ack_handler(struct nl_msg *msg, void *arg)
+{
+	team_req_done(arg, nlmsg_hdr(msg)->nlmsg_seq, 0);
+	return NL_OK;
+}
+
+static int async_err_handler(struct sockaddr_nl *nla, struct nlmsgerr *nlerr,
+			     void *arg)
+{
+	team_req_done(arg, nlerr->msg.nlmsg_seq, nlerr->error);
+	return NL_SKIP;
+}
+
+static int team_req_async_event_handler(struct team_handle *th)
+{
+	struct team_req *req;
+	struct team_req *tmp;
+	uint64_t expirations;
+	uint64_t now;
+	int err = 0;
+	int ret;
+
+	do {
+		ret = nl_recvmsgs_report(th->async.sock, th->async.cb);
+	} while (ret > 0);
+	if (ret < 0 && ret != -NLE_AGAIN)
+		err = -nl2syserr(ret);
+
+	if (read(th->async.timer_fd, &expirations, sizeof(expirations)) < 0 &&
+	    errno != EAGAIN && !err)
+		err = -errno;
+	now = team_now_ms();
+	list_for_each_node_entry_safe(req, tmp, &th->async.inflight_list,
+				      list) {
+		if (!req->deadline || req->deadline > now)
+			break;
+		list_del(&req->list);
+		th->async.inflight_count--;
+		req->err = -ETIMEDOUT;
+		list_add_tail(&th->async.done_list, &req->list);
+	}
+	team_req_timer_arm(th);
+
+	/* Done funcs may send new requests */
+	while (!list_empty(&th->async.done_list)) {
+		req = list_get_node_entry(th->async.done_list.next,
+					  struct team_req, list);
+		list_del(&req->list);
+		if (req->complete)
+			req->complete(th, req);
+		if (req->done)
+			req->done(th, req->id, req->err, req->done_priv);
+		team_req_put(th, req);
+	}
+	return err;
+}
+
+static int team_req_async_init(struct team_handle *th)
+{
+	struct epoll_event event;
+	int efd = team_get_event_fd(th);
+	int err;
+
+	if (!th->ifindex)
+		return -EINVAL;
+	th->async.cb = nl_cb_alloc(NL_CB_DEFAULT);
+	if (!th->async.cb)
+		return -ENOMEM;
+	nl_cb_set(th->async.cb, NL_CB_ACK, NL_CB_CUSTOM, async_ack_handler, th);
+	nl_cb_err(th->async.cb, NL_CB_CUSTOM, async_err_handler, th);
+	team_transport_setup_cb(&th->transport, th->async.cb);
+
+	th->async.sock = nl_socket_alloc();
+	if (!th->async.sock) {
+		err = -ENOMEM;
+		goto err_sock_alloc;
+	}
+	err = team_transport_connect(&th->transport, th->async.sock,
+				     NETLINK_GENERIC);
+	if (err) {
+		err = -nl2syserr(err);
+		goto err_sock_connect;
+	}
+	nl_socket_disable_seq_check(th->async.sock);
+	err = nl_socket_set_nonblocking(th->async.sock);
+	if (err) {
+		err = -nl2syserr(err);
+		goto err_sock_connect;
+	}
 
-	err = 0;
-put_cb:
-	nl_cb_put(cb);
+	th->async.timer_fd = timerfd_create(CLOCK_MONOTONIC,
+					    TFD_NONBLOCK | TFD_CLOEXEC);
+	if (th->async.timer_fd == -1) {
+		err = -errno;
+		goto err_sock_connect;
+	}
+
+	/* Multiplexer tells contexts apart by pointer, see there */
+	event.events = EPOLLIN;
+	if (th->evmux)
+		event.data.ptr = th;
+	else
+		event.data.fd = nl_socket_get_fd(th->async.sock);
+	if (epoll_ctl(efd, EPOLL_CTL_ADD, nl_socket_get_fd(th->async.sock),
+		      &event) == -1)
+		goto err_epoll_ctl;
+	if (!th->evmux)
+		event.data.fd = th->async.timer_fd;
+	if (epoll_ctl(efd, EPOLL_CTL_ADD, th->async.timer_fd, &event) == -1)
+		goto err_epoll_ctl;
+	return 0;
+
+err_epoll_ctl:
+	err = -errno;
+	epoll_ctl(efd, EPOLL_CTL_DEL, nl_socket_get_fd(th->async.sock), NULL);
+	close(th->async.timer_fd);
+	th->async.timer_fd = -1;
+err_sock_connect:
+	nl_socket_free(th->async.sock);
+	th->async.sock = NULL;
+err_sock_alloc:
+	nl_cb_put(th->async.cb);
+	th->async.cb = NULL;
+	return err;
+}
+
+static void team_req_async_fini(struct team_handle *th)
+{
+	struct team_req *req;
+	struct team_req *tmp;
+
+	list_move_nodes(&th->async.done_list, &th->async.inflight_list);
+	list_for_each_node_entry_safe(req, tmp, &th->async.done_list, list) {
+		list_del(&req->list);
+		team_req_put(th, req);
+	}
+	list_for_each_node_entry_safe(req, tmp, &th->async.free_list, list)
+		free(req);
+	if (!th->async.sock)
+		return;
+	close(th->async.timer_fd);
+	nl_socket_free(th->async.sock);
+	nl_cb_put(th->async.cb);
+}
+
+/* Takes over both message and request, even in case of an error */
+int team_req_send(struct team_handle *th, struct team_req *req,
+		  struct nl_msg *msg, unsigned int timeout)
+{
+	struct team_req *pos;
+	int err;
+
+	if (!th->async.sock) {
+		err = team_req_async_init(th);
+		if (err)
+			goto err_out;
+	}
+	if (!th->async.seq)
+		th->async.seq++;
+	req->id = th->async.seq++;
+	nlmsg_hdr(msg)->nlmsg_seq = req->id;
+	err = nl_send_auto(th->async.sock, msg);
+	nlmsg_free(msg);
+	if (err < 0) {
+		team_req_put(th, req);
+		return -nl2syserr(err);
+	}
+
+	req->deadline = timeout ? team_now_ms() + timeout : 0;
+	list_for_each_node_entry(pos, &th->async.inflight_list, list) {
+		if (req->deadline &&
+		    (!pos->deadline || pos->deadline > req->deadline))
+			break;
+	}
+	/* Inserting before head entry (or to empty list) means new head */
+	list_add_tail(&pos->list, &req->list);
+	th->async.inflight_count++;
+	if (th->async.inflight_list.next == &req->list)
+		team_req_timer_arm(th);
+	return 0;
+
+err_out:
+	nlmsg_free(msg);
+	team_req_put(th, req);
 	return err;
 }
 
+/**
+ * team_set_req_timeout:
+ * @th: libteam library context
+ * @timeout: timeout in milliseconds, zero means no timeout
+ *
+ * Set how long synchronous requests wait for kernel reply before
+ * failing with -ETIMEDOUT. There is no timeout by default.
+ **/
+TEAM_EXPORT
+void team_set_req_timeout(struct team_handle *th, unsigned int timeout)
+{
+	th->req.timeout = timeout;
+}
+
+/**
+ * team_req_cancel:
+ * @th: libteam library context
+ * @req_id: asynchronous request id
+ *
+ * Cancel asynchronous request. Its done func is not called. Note that
+ * kernel may still process the request, local state then gets updated
+ * by the change event.
+ *
+ * Returns: zero on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_req_cancel(struct team_handle *th, uint32_t req_id)
+{
+	struct team_req *req;
+
+	list_for_each_node_entry(req, &th->async.inflight_list, list) {
+		if (req->id != req_id)
+			continue;
+		list_del(&req->list);
+		th->async.inflight_count--;
+		team_req_put(th, req);
+		return 0;
+	}
+	return -ENOENT;
+}
+
+/**
+ * team_get_req_inflight_count:
+ * @th: libteam library context
+ *
+ * Get number of asynchronous requests waiting for kernel reply.
+ *
+ * Returns: number of requests.
+ **/
+TEAM_EXPORT
+unsigned int team_get_req_inflight_count(struct team_handle *th)
+{
+	return th->async.inflight_count;
+}
+
 /**
  * SECTION: Change handlers
  * @short_description: event change handlers handling
@@ -209,6 +586,9 @@ int check_call_change_handlers(struct team_handle *th,
 	team_change_type_mask_t to_call_type_mask =
 			th->change_handler.pending_type_mask & call_type_mask;
 
+	if (to_call_type_mask)
+		snapshot_update(th);
+
 	list_for_each_node_entry(handler_item, &th->change_handler.list, list) {
 		const struct team_change_handler *handler =
 				handler_item->handler;
@@ -348,7 +728,101 @@ static int cli_event_handler(struct nl_msg *msg, void *arg)
 	return ifinfo_event_handler(msg, arg);
 }
 
+/*
+ * Event sockets start with TEAM_SOCK_BUF_SIZE receive buffer. Once events
+ * overrun it, the buffer is doubled up to the max size.
+ */
+#define TEAM_SOCK_BUF_SIZE 98304
+#define TEAM_SOCK_BUF_MAX_SIZE (4 * 1024 * 1024)
+
+/* Bounds draining of socket which keeps being filled */
+#define TEAM_SOCK_DRAIN_MAX 1024
+
+static int team_sock_buf_grow(struct nl_sock *sock, unsigned int max_size)
+{
+	int fd = nl_socket_get_fd(sock);
+	socklen_t len = sizeof(int);
+	int size;
+
+	if (getsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, &len))
+		return -errno;
+	/* Kernel reports double of what was set */
+	size /= 2;
+	if (size >= max_size)
+		return 0;
+	size = size > max_size / 2 ? max_size : size * 2;
+	/* Forcing over rmem_max needs CAP_NET_ADMIN */
+	if (setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof(size)) &&
+	    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)))
+		return -errno;
+	return size;
+}
+
+static void team_sock_drain(struct nl_sock *sock)
+{
+	struct pollfd pfd = {
+		.fd = nl_socket_get_fd(sock),
+		.events = POLLIN,
+	};
+	int i;
+
+	for (i = 0; i < TEAM_SOCK_DRAIN_MAX; i++) {
+		if (poll(&pfd, 1, 0) != 1 || !(pfd.revents & POLLIN))
+			break;
+		nl_recvmsgs_default(sock);
+	}
+}
+
+/*
+ * Events still queued after overrun are processed while resyncing so
+ * their changes are reported together with the ones resync finds.
+ */
+static void team_resync_begin(struct team_handle *th,
+			      team_change_type_mask_t type_mask)
+{
+	if (type_mask & TEAM_IFINFO_CHANGE)
+		ifinfo_list_cleanup_last_state(th);
+	if (type_mask & (TEAM_PORT_CHANGE | TEAM_OPTION_CHANGE)) {
+		port_list_cleanup_last_state(th);
+		option_list_cleanup_last_state(th);
+		th->msg_recv_started = true;
+	}
+	th->resyncing = true;
+}
+
+static int team_resync_end(struct team_handle *th,
+			   team_change_type_mask_t type_mask)
+{
+	int err = 0;
+
+	if (type_mask & TEAM_IFINFO_CHANGE)
+		err = ifinfo_list_resync(th);
+	if (!err && type_mask & TEAM_PORT_CHANGE)
+		err = port_list_resync(th);
+	if (!err && type_mask & TEAM_OPTION_CHANGE)
+		err = option_list_resync(th);
+	th->resyncing = false;
+	if (err) {
+		err(th, "Failed to resync after netlink event sock overrun.");
+		return err;
+	}
+	th->resync_count++;
+	return 0;
+}
+
+static void team_sock_overrun(struct team_handle *th, int size)
+{
+	th->overrun_count++;
+	if (size > 0)
+		warn(th, "Netlink event sock overrun, buffer size grown to %d.",
+		     size);
+	else
+		warn(th, "Netlink event sock overrun.");
+}
+
 static int team_init_event_fd(struct team_handle *th);
+static int team_evmux_attach(struct team_evmux *evmux, struct team_handle *th);
+static void team_evmux_detach(struct team_evmux *evmux, struct team_handle *th);
 
 /**
  * team_alloc:
@@ -379,6 +853,16 @@ struct team_handle *team_alloc(void)
 	dbg(th, "log_priority=%d", th->log_priority);
 
 	list_init(&th->change_handler.list);
+	list_init(&th->async.inflight_list);
+	list_init(&th->async.done_list);
+	list_init(&th->async.free_list);
+	th->async.timer_fd = -1;
+	th->async.seq = time(NULL);
+	th->stats.timer_fd = -1;
+	th->sock_buf.size = TEAM_SOCK_BUF_SIZE;
+	th->sock_buf.max_size = TEAM_SOCK_BUF_MAX_SIZE;
+	pthread_mutex_init(&th->snapshot.lock, NULL);
+	team_transport_init(&th->transport);
 
 	err = ifinfo_list_alloc(th);
 	if (err)
@@ -394,6 +878,10 @@ struct team_handle *team_alloc(void)
 	if (!th->nl_sock)
 		goto err_sk_alloc;
 
+	err = req_alloc(th);
+	if (err)
+		goto err_req_alloc;
+
 	th->nl_sock_event = nl_socket_alloc();
 	if (!th->nl_sock_event)
 		goto err_sk_event_alloc;
@@ -405,7 +893,8 @@ struct team_handle *team_alloc(void)
 	th->nl_cli.sock = nl_cli_alloc_socket();
 	if (!th->nl_cli.sock)
 		goto err_cli_sk_alloc;
-	err = nl_cli_connect(th->nl_cli.sock, NETLINK_ROUTE);
+	err = team_transport_connect(&th->transport, th->nl_cli.sock,
+				     NETLINK_ROUTE);
 	if (err)
 		goto err_cli_connect;
 
@@ -421,6 +910,9 @@ err_cli_sk_event_alloc:
 	nl_socket_free(th->nl_sock_event);
 
 err_sk_event_alloc:
+	req_free(th);
+
+err_req_alloc:
 	nl_socket_free(th->nl_sock);
 
 err_sk_alloc:
@@ -433,6 +925,7 @@ err_port_list_alloc:
 	ifinfo_list_free(th);
 
 err_ifinfo_list_alloc:
+	pthread_mutex_destroy(&th->snapshot.lock);
 	free(th);
 
 	return NULL;
@@ -534,36 +1027,13 @@ int team_destroy(struct team_handle *th)
 #define NETLINK_BROADCAST_SEND_ERROR    0x4
 #endif
 
-/**
- * team_init:
- * @th: libteam library context
- * @ifindex: team device interface index
- *
- * Do library context initialization. Sets up team generic netlink connection.
- *
- * Returns: zero on success or negative number in case of an error.
- **/
-TEAM_EXPORT
-int team_init(struct team_handle *th, uint32_t ifindex)
+static int team_init_event_socks(struct team_handle *th)
 {
-	int err;
-	int grp_id;
 	int val;
+	int err;
 
-	if (!ifindex) {
-		err(th, "Passed interface index %d is not valid.", ifindex);
-		return -EINVAL;
-	}
-	th->ifindex = ifindex;
-
-	th->nl_sock_seq = time(NULL);
-	err = genl_connect(th->nl_sock);
-	if (err) {
-		err(th, "Failed to connect to netlink sock.");
-		return -nl2syserr(err);
-	}
-
-	err = genl_connect(th->nl_sock_event);
+	err = team_transport_connect(&th->transport, th->nl_sock_event,
+				     NETLINK_GENERIC);
 	if (err) {
 		err(th, "Failed to connect to netlink event sock.");
 		return -nl2syserr(err);
@@ -577,31 +1047,14 @@ int team_init(struct team_handle *th, uint32_t ifindex)
 		return -errno;
 	}
 
-	err = nl_socket_set_buffer_size(th->nl_sock, 98304, 0);
-	if (err) {
-		err(th, "Failed to set buffer size of netlink sock.");
-		return -nl2syserr(err);
-	}
-	err = nl_socket_set_buffer_size(th->nl_sock_event, 98304, 0);
+	err = nl_socket_set_buffer_size(th->nl_sock_event, th->sock_buf.size, 0);
 	if (err) {
 		err(th, "Failed to set buffer size of netlink event sock.");
 		return -nl2syserr(err);
 	}
 
-	th->family = genl_ctrl_resolve(th->nl_sock, TEAM_GENL_NAME);
-	if (th->family < 0) {
-		err(th, "Failed to resolve netlink family.");
-		return -nl2syserr(th->family);
-	}
-
-	grp_id = genl_ctrl_resolve_grp(th->nl_sock, TEAM_GENL_NAME,
-				       TEAM_GENL_CHANGE_EVENT_MC_GRP_NAME);
-	if (grp_id < 0) {
-		err(th, "Failed to resolve netlink multicast groups.");
-		return -nl2syserr(grp_id);
-	}
-
-	err = nl_socket_add_membership(th->nl_sock_event, grp_id);
+	err = team_transport_join_events(&th->transport, th->nl_sock_event,
+					 NETLINK_GENERIC);
 	if (err < 0) {
 		err(th, "Failed to add netlink membership.");
 		return -nl2syserr(err);
@@ -614,17 +1067,73 @@ int team_init(struct team_handle *th, uint32_t ifindex)
 	nl_socket_disable_seq_check(th->nl_cli.sock_event);
 	nl_socket_modify_cb(th->nl_cli.sock_event, NL_CB_VALID,
 			    NL_CB_CUSTOM, cli_event_handler, th);
-	nl_cli_connect(th->nl_cli.sock_event, NETLINK_ROUTE);
-	err = nl_socket_add_membership(th->nl_cli.sock_event, RTNLGRP_LINK);
+	err = team_transport_connect(&th->transport, th->nl_cli.sock_event,
+				     NETLINK_ROUTE);
+	if (err) {
+		err(th, "Failed to connect to netlink event sock.");
+		return -nl2syserr(err);
+	}
+	err = team_transport_join_events(&th->transport, th->nl_cli.sock_event,
+					 NETLINK_ROUTE);
 	if (err < 0) {
 		err(th, "Failed to add netlink membership.");
 		return -nl2syserr(err);
 	}
+	return 0;
+}
 
-	err = ifinfo_list_init(th);
-	if (err) {
-		err(th, "Failed to init interface information list.");
-		return err;
+/**
+ * team_init:
+ * @th: libteam library context
+ * @ifindex: team device interface index
+ *
+ * Do library context initialization. Sets up team generic netlink connection.
+ *
+ * Returns: zero on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_init(struct team_handle *th, uint32_t ifindex)
+{
+	int err;
+
+	if (!ifindex) {
+		err(th, "Passed interface index %d is not valid.", ifindex);
+		return -EINVAL;
+	}
+	th->ifindex = ifindex;
+
+	th->nl_sock_seq = time(NULL);
+	err = team_transport_connect(&th->transport, th->nl_sock,
+				     NETLINK_GENERIC);
+	if (err) {
+		err(th, "Failed to connect to netlink sock.");
+		return -nl2syserr(err);
+	}
+	/* Request callbacks were cloned before transport was final */
+	team_transport_setup_cb(&th->transport, th->req.cb);
+
+	err = nl_socket_set_buffer_size(th->nl_sock, th->sock_buf.size, 0);
+	if (err) {
+		err(th, "Failed to set buffer size of netlink sock.");
+		return -nl2syserr(err);
+	}
+
+	th->family = team_transport_resolve_family(&th->transport, th->nl_sock);
+	if (th->family < 0) {
+		err(th, "Failed to resolve netlink family.");
+		return -nl2syserr(th->family);
+	}
+
+	if (!th->evmux) {
+		err = team_init_event_socks(th);
+		if (err)
+			return err;
+	}
+
+	err = ifinfo_list_init(th);
+	if (err) {
+		err(th, "Failed to init interface information list.");
+		return err;
 	}
 
 	err = port_list_init(th);
@@ -645,6 +1154,9 @@ int team_init(struct team_handle *th, uint32_t ifindex)
 		return err;
 	}
 
+	if (th->evmux)
+		return team_evmux_attach(th->evmux, th);
+
 	err = team_init_event_fd(th);
 	if (err) {
 		err(th, "Failed to init event fd.");
@@ -664,13 +1176,22 @@ int team_init(struct team_handle *th, uint32_t ifindex)
 TEAM_EXPORT
 void team_free(struct team_handle *th)
 {
-	close(th->event_fd);
-	ifinfo_list_free(th);
+	team_req_async_fini(th);
+	if (th->evmux)
+		team_evmux_detach(th->evmux, th);
+	else
+		close(th->event_fd);
+	if (th->stats.timer_fd != -1)
+		close(th->stats.timer_fd);
+	snapshot_fini(th);
+	/* Ports unlink their ifinfos */
 	port_list_free(th);
+	ifinfo_list_free(th);
 	option_list_free(th);
 	nl_socket_free(th->nl_cli.sock);
 	nl_socket_free(th->nl_cli.sock_event);
 	nl_socket_free(th->nl_sock_event);
+	req_free(th);
 	nl_socket_free(th->nl_sock);
 	free(th);
 }
@@ -700,278 +1221,1096 @@ int team_refresh(struct team_handle *th)
 		return err;
 	}
 
-	err = option_list_init(th);
-	if (err) {
-		err(th, "Failed to refresh option list.");
-		return err;
+	err = option_list_init(th);
+	if (err) {
+		err(th, "Failed to refresh option list.");
+		return err;
+	}
+	return 0;
+}
+
+/**
+ * team_set_log_fn:
+ * @th: libteam library context
+ * @log_fn: function to be called for logging messages
+ *
+ * The built-in logging writes to stderr. It can be
+ * overridden by a custom function, to plug log messages
+ * into the user's logging functionality.
+ *
+ **/
+TEAM_EXPORT
+void team_set_log_fn(struct team_handle *th,
+		     void (*log_fn)(struct team_handle *th, int priority,
+				    const char *file, int line, const char *fn,
+				    const char *format, va_list args))
+{
+	th->log_fn = log_fn;
+	dbg(th, "Custom logging function %p registered.", log_fn);
+}
+
+/**
+ * team_get_log_priority:
+ * @th: libteam library context
+ *
+ * Returns: the current logging priority
+ **/
+TEAM_EXPORT
+int team_get_log_priority(struct team_handle *th)
+{
+	return th->log_priority;
+}
+
+/**
+ * team_set_log_priority:
+ * @th: libteam library context
+ * @priority: the new logging priority
+ *
+ * Set the current logging priority. The value controls which messages
+ * are logged.
+ **/
+TEAM_EXPORT
+void team_set_log_priority(struct team_handle *th, int priority)
+{
+	th->log_priority = priority;
+}
+
+static int get_cli_sock_event_fd(struct team_handle *th)
+{
+	return nl_socket_get_fd(th->nl_cli.sock_event);
+}
+
+static int team_sock_event_resync(struct team_handle *th,
+				  struct nl_sock *sock,
+				  team_change_type_mask_t type_mask)
+{
+	team_sock_overrun(th, team_sock_buf_grow(sock, th->sock_buf.max_size));
+	team_resync_begin(th, type_mask);
+	team_sock_drain(sock);
+	return team_resync_end(th, type_mask);
+}
+
+static int cli_sock_event_handler(struct team_handle *th)
+{
+	int ret;
+
+	ret = nl_recvmsgs_default(th->nl_cli.sock_event);
+	if (ret == -NLE_NOMEM) {
+		ret = team_sock_event_resync(th, th->nl_cli.sock_event,
+					     TEAM_IFINFO_CHANGE);
+		if (ret)
+			return ret;
+	}
+	return check_call_change_handlers(th, TEAM_IFINFO_CHANGE);
+}
+
+static int get_sock_event_fd(struct team_handle *th)
+{
+	return nl_socket_get_fd(th->nl_sock_event);
+}
+
+static int sock_event_handler(struct team_handle *th)
+{
+	int ret;
+
+	ret = nl_recvmsgs_default(th->nl_sock_event);
+	if (ret == -NLE_NOMEM)
+		ret = team_sock_event_resync(th, th->nl_sock_event,
+					     TEAM_PORT_CHANGE |
+					     TEAM_OPTION_CHANGE);
+	else if (ret)
+		ret = -nl2syserr(ret);
+	th->msg_recv_started = false;
+	if (ret)
+		return ret;
+
+	return check_call_change_handlers(th, TEAM_PORT_CHANGE |
+					      TEAM_OPTION_CHANGE |
+					      TEAM_IFINFO_CHANGE);
+}
+
+struct team_eventfd {
+	int (*get_fd)(struct team_handle *th);
+	int (*event_handler)(struct team_handle *th);
+};
+
+static const struct team_eventfd team_eventfds[] = {
+	/* Always handle cli socket first. The reason is that cli socket
+	 * message may include information, like master unset, which may be
+	 * handy to have before proceeding others.
+	 */
+	{
+		.get_fd = get_cli_sock_event_fd,
+		.event_handler = cli_sock_event_handler,
+	},
+	{
+		.get_fd = get_sock_event_fd,
+		.event_handler = sock_event_handler,
+	},
+};
+#define TEAM_EVENT_FDS_COUNT ARRAY_SIZE(team_eventfds)
+
+static const struct team_eventfd __dummy_eventfd;
+
+/**
+ * team_get_next_eventfd:
+ * @th: libteam library context
+ * @eventfd: eventfd structure
+ *
+ * Get next eventfd in list.
+ *
+ * Returns: eventfd next to @eventfd passed.
+ *
+ * @deprecated Use of this function is deprecated.
+ **/
+TEAM_EXPORT
+const struct team_eventfd *team_get_next_eventfd(struct team_handle *th,
+						 const struct team_eventfd *eventfd)
+{
+	if (!eventfd)
+		return &__dummy_eventfd;
+	return NULL;
+}
+
+/**
+ * team_get_eventfd_fd:
+ * @th: libteam library context
+ * @eventfd: eventfd structure
+ *
+ * Get eventfd filedesctiptor.
+ *
+ * Returns: fd.
+ *
+ * @deprecated Use of this function is deprecated. User should use
+ *	       team_get_event_fd() funstion instead.
+ **/
+TEAM_EXPORT
+int team_get_eventfd_fd(struct team_handle *th,
+			const struct team_eventfd *eventfd)
+{
+	return team_get_event_fd(th);
+}
+
+/**
+ * team_call_eventfd_handler:
+ * @th: libteam library context
+ * @eventfd: eventfd structure
+ *
+ * Call eventfd handler.
+ *
+ * Returns: zero on success or negative number in case of an error.
+ *
+ * @deprecated Use of this function is deprecated. User should use
+ *	       team_handle_events() funstion instead.
+ **/
+TEAM_EXPORT
+int team_call_eventfd_handler(struct team_handle *th,
+			      const struct team_eventfd *eventfd)
+{
+	return team_handle_events(th);
+}
+
+static int team_init_event_fd(struct team_handle *th)
+{
+	int efd;
+	int i;
+	struct epoll_event event;
+	int err;
+
+	efd = epoll_create1(0);
+	if (efd == -1)
+		return -errno;
+	for (i = 0; i < TEAM_EVENT_FDS_COUNT; i++) {
+		int fd = team_eventfds[i].get_fd(th);
+
+		event.data.fd = fd;
+		event.events = EPOLLIN;
+		err = epoll_ctl(efd, EPOLL_CTL_ADD, fd, &event);
+		if (err == -1) {
+			err = -errno;
+			goto close_efd;
+		}
+	}
+	th->event_fd = efd;
+	return 0;
+
+close_efd:
+	close(efd);
+	return err;
+}
+
+/**
+ * team_get_alloc_count:
+ * @th: libteam library context
+ *
+ * Get number of heap allocations done for options and ports. Option and
+ * port objects come from pools, so it grows only once more of them exist
+ * at the same time than ever before. It does not grow while only values
+ * of existing options change, so growth during port enabling, active port
+ * changes or stats refreshes indicates a regression.
+ *
+ * Returns: number of allocations.
+ **/
+TEAM_EXPORT
+uint64_t team_get_alloc_count(struct team_handle *th)
+{
+	return th->alloc_count + th->option_pool.chunk_count +
+	       th->port_pool.chunk_count;
+}
+
+/**
+ * team_set_sock_buffer_size:
+ * @th: libteam library context
+ * @size: initial receive buffer size in bytes
+ * @max_size: size the buffer may grow to once events overrun it
+ *
+ * Set netlink socket receive buffer sizes. Has to be called before
+ * team_init(). Zero keeps the current value.
+ *
+ * Returns: zero on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_set_sock_buffer_size(struct team_handle *th, unsigned int size,
+			      unsigned int max_size)
+{
+	if (th->ifindex)
+		return -EBUSY;
+	if (size)
+		th->sock_buf.size = size;
+	if (max_size)
+		th->sock_buf.max_size = max_size;
+	if (th->sock_buf.max_size < th->sock_buf.size)
+		th->sock_buf.max_size = th->sock_buf.size;
+	return 0;
+}
+
+/**
+ * team_set_emul_port:
+ * @th: libteam library context
+ * @port: netlink port of team emulator, zero for kernel
+ *
+ * Make library context talk to team emulator (see team_emul_alloc())
+ * instead of kernel. Has to be called before team_init(). Messages which
+ * do not come from @port are dropped. Contexts using event multiplexer
+ * have to use the same transport as the multiplexer.
+ *
+ * Returns: zero on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_set_emul_port(struct team_handle *th, uint32_t port)
+{
+	int err;
+
+	if (th->ifindex)
+		return -EBUSY;
+	team_transport_set_emul(&th->transport, port);
+	/* Route socket got connected on alloc already */
+	nl_close(th->nl_cli.sock);
+	err = team_transport_connect(&th->transport, th->nl_cli.sock,
+				     NETLINK_ROUTE);
+	return -nl2syserr(err);
+}
+
+/**
+ * team_get_overrun_count:
+ * @th: libteam library context
+ *
+ * Get number of times event socket receive buffer overran and events
+ * were lost.
+ *
+ * Returns: number of overruns.
+ **/
+TEAM_EXPORT
+uint64_t team_get_overrun_count(struct team_handle *th)
+{
+	return th->overrun_count;
+}
+
+/**
+ * team_get_resync_count:
+ * @th: libteam library context
+ *
+ * Get number of times ports, options and links were successfully
+ * resynced with kernel after an overrun.
+ *
+ * Returns: number of resyncs.
+ **/
+TEAM_EXPORT
+uint64_t team_get_resync_count(struct team_handle *th)
+{
+	return th->resync_count;
+}
+
+/**
+ * team_refresh_stats:
+ * @th: libteam library context
+ *
+ * Fetch traffic counters of team device and all its ports, the ports by
+ * single link dump, and call change handlers registered for
+ * TEAM_STATS_CHANGE.
+ *
+ * Returns: zero on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_refresh_stats(struct team_handle *th)
+{
+	int err;
+
+	err = ifinfo_list_stats_refresh(th);
+	if (err) {
+		err(th, "Failed to refresh traffic counters.");
+		return err;
+	}
+	set_call_change_handlers(th, TEAM_STATS_CHANGE);
+	return check_call_change_handlers(th, TEAM_STATS_CHANGE);
+}
+
+static int team_stats_timer_handler(struct team_handle *th)
+{
+	uint64_t expirations;
+
+	if (read(th->stats.timer_fd, &expirations, sizeof(expirations)) < 0)
+		return errno == EAGAIN ? 0 : -errno;
+	return team_refresh_stats(th);
+}
+
+/* Multiplexer does not know which of context's own fds is ready */
+static int team_ctx_event_handler(struct team_handle *th)
+{
+	int err;
+
+	if (th->stats.timer_fd != -1) {
+		err = team_stats_timer_handler(th);
+		if (err)
+			return err;
+	}
+	if (th->async.sock)
+		return team_req_async_event_handler(th);
+	return 0;
+}
+
+/**
+ * team_set_stats_refresh_interval:
+ * @th: libteam library context
+ * @interval: refresh interval in milliseconds, zero stops refreshing
+ *
+ * Make event handling refresh traffic counters periodically, the same
+ * way team_refresh_stats() does. Has to be called after team_init().
+ *
+ * Returns: zero on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_set_stats_refresh_interval(struct team_handle *th,
+				    unsigned int interval)
+{
+	struct itimerspec its = {};
+	struct epoll_event event;
+	int err;
+
+	if (!th->ifindex)
+		return -EINVAL;
+	if (th->stats.timer_fd == -1) {
+		if (!interval)
+			return 0;
+		th->stats.timer_fd = timerfd_create(CLOCK_MONOTONIC,
+						    TFD_NONBLOCK | TFD_CLOEXEC);
+		if (th->stats.timer_fd == -1)
+			return -errno;
+		/* Multiplexer tells contexts apart by pointer */
+		event.events = EPOLLIN;
+		if (th->evmux)
+			event.data.ptr = th;
+		else
+			event.data.fd = th->stats.timer_fd;
+		if (epoll_ctl(team_get_event_fd(th), EPOLL_CTL_ADD,
+			      th->stats.timer_fd, &event) == -1) {
+			err = -errno;
+			close(th->stats.timer_fd);
+			th->stats.timer_fd = -1;
+			return err;
+		}
+	}
+	its.it_value.tv_sec = interval / 1000;
+	its.it_value.tv_nsec = (interval % 1000) * 1000000;
+	its.it_interval = its.it_value;
+	if (timerfd_settime(th->stats.timer_fd, 0, &its, NULL))
+		return -errno;
+	return 0;
+}
+
+/**
+ * team_get_event_fd:
+ * @th: libteam library context
+ *
+ * Get event filedesctiptor. For context attached to event multiplexer
+ * this is the multiplexer event filedescriptor.
+ *
+ * Returns: fd.
+ **/
+TEAM_EXPORT
+int team_get_event_fd(struct team_handle *th)
+{
+	if (th->evmux)
+		return team_evmux_get_event_fd(th->evmux);
+	return th->event_fd;
+}
+
+/**
+ * team_handle_events:
+ * @th: libteam library context
+ * @eventfd: eventfd structure
+ *
+ * Handler events which happened on event filedescriptor. For context
+ * attached to event multiplexer events of all attached contexts are handled.
+ *
+ * Returns: zero on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_handle_events(struct team_handle *th)
+{
+	struct epoll_event events[TEAM_EVENT_FDS_COUNT + 3];
+	bool async_ready = false;
+	bool stats_ready = false;
+	int nfds;
+	int n;
+	int i;
+	int err;
+
+	if (th->evmux)
+		return team_evmux_handle_events(th->evmux);
+
+	nfds = epoll_wait(th->event_fd, events, ARRAY_SIZE(events), -1);
+	if (nfds == -1)
+		return -errno;
+
+	if (th->async.sock) {
+		for (n = 0; n < nfds; n++) {
+			if (events[n].data.fd ==
+			    nl_socket_get_fd(th->async.sock) ||
+			    events[n].data.fd == th->async.timer_fd)
+				async_ready = true;
+		}
+	}
+	for (n = 0; n < nfds; n++) {
+		if (events[n].data.fd == th->stats.timer_fd)
+			stats_ready = true;
+	}
+
+	/* Go over list of event fds and handle them sequentially */
+	for (i = 0; i < TEAM_EVENT_FDS_COUNT; i++) {
+		const struct team_eventfd *eventfd = &team_eventfds[i];
+
+		for (n = 0; n < nfds; n++) {
+			if (events[n].data.fd == eventfd->get_fd(th)) {
+				err = eventfd->event_handler(th);
+				if (err)
+					return err;
+			}
+		}
+	}
+	if (stats_ready) {
+		err = team_stats_timer_handler(th);
+		if (err)
+			return err;
+	}
+	if (async_ready)
+		return team_req_async_event_handler(th);
+	return 0;
+}
+
+/**
+ * team_check_events:
+ * @th: libteam library context
+ *
+ * Check for events pending to be processed on event socket and process
+ * them one by one. This is safe to be called even if no data present
+ * on event socket file descriptor.
+ *
+ * Returns: zero on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_check_events(struct team_handle *th)
+{
+	fd_set rfds;
+	int fdmax;
+	struct timeval tv;
+	int fd = team_get_event_fd(th);
+	int ret;
+
+	memset(&tv, 0, sizeof(tv));
+	FD_ZERO(&rfds);
+	FD_SET(fd, &rfds);
+	fdmax = fd + 1;
+	ret = select(fdmax, &rfds, NULL, NULL, &tv);
+	if (ret == -1)
+		return -errno;
+	return team_handle_events(th);
+}
+
+/**
+ * SECTION: Event multiplexer
+ * @short_description: Event sockets shared by many library contexts
+ *
+ * Process hosting many team devices does not have to have event sockets
+ * per each team. Contexts attached to one multiplexer share a single
+ * generic netlink event socket and a single rtnetlink link event socket.
+ * Generic netlink events are delivered only to context the team interface
+ * index of which matches TEAM_ATTR_TEAM_IFINDEX. Link events are delivered
+ * only to context of the team device itself and to context the link is
+ * (or was) port of.
+ */
+
+struct team_evmux_link {
+	struct hash_item	hitem;
+	uint32_t		ifindex;
+	struct team_handle *	th;
+};
+
+/* Events not fetched at once are left for the next call */
+#define TEAM_EVMUX_EVENTS_MAX 16
+
+struct team_evmux {
+	int			event_fd;
+	struct team_transport	transport;
+	struct nl_sock *	nl_sock_event;
+	struct nl_sock *	nl_cli_sock_event;
+	struct hash_table	th_table; /* by team ifindex */
+	struct hash_table	link_table; /* by port ifindex */
+	struct list_item	pending_list;
+	struct {
+		unsigned int	size;
+		unsigned int	max_size;
+	} sock_buf;
+};
+
+static struct team_handle *team_evmux_th_find(struct team_evmux *evmux,
+					      uint32_t ifindex)
+{
+	struct team_handle *th;
+	uint32_t hash = hash_u32(ifindex);
+
+	hash_table_for_each_match(th, &evmux->th_table, hash, evmux_hitem) {
+		if (th->ifindex == ifindex)
+			return th;
+	}
+	return NULL;
+}
+
+static struct team_evmux_link *team_evmux_link_find(struct team_evmux *evmux,
+						    uint32_t ifindex)
+{
+	struct team_evmux_link *link;
+	uint32_t hash = hash_u32(ifindex);
+
+	hash_table_for_each_match(link, &evmux->link_table, hash, hitem) {
+		if (link->ifindex == ifindex)
+			return link;
+	}
+	return NULL;
+}
+
+static void team_evmux_link_set(struct team_evmux *evmux, uint32_t ifindex,
+				struct team_handle *th)
+{
+	struct team_evmux_link *link;
+
+	link = team_evmux_link_find(evmux, ifindex);
+	if (link && !th) {
+		hash_table_del(&evmux->link_table, &link->hitem);
+		free(link);
+		return;
+	}
+	if (!th)
+		return;
+	if (!link) {
+		link = myzalloc(sizeof(*link));
+		if (!link)
+			return;
+		link->ifindex = ifindex;
+		hash_table_add(&evmux->link_table, &link->hitem,
+			       hash_u32(ifindex));
+	}
+	link->th = th;
+}
+
+static void team_evmux_pending_add(struct team_evmux *evmux,
+				   struct team_handle *th)
+{
+	if (th->evmux_pending)
+		return;
+	th->evmux_pending = true;
+	list_add_tail(&evmux->pending_list, &th->evmux_pending_list);
+}
+
+static int team_evmux_event_handler(struct nl_msg *msg, void *arg)
+{
+	struct team_evmux *evmux = arg;
+	struct nlattr *attrs[TEAM_ATTR_MAX + 1];
+	struct team_handle *th;
+
+	if (genlmsg_parse(nlmsg_hdr(msg), 0, attrs, TEAM_ATTR_MAX, NULL))
+		return NL_SKIP;
+	if (!attrs[TEAM_ATTR_TEAM_IFINDEX])
+		return NL_SKIP;
+	th = team_evmux_th_find(evmux,
+				nla_get_u32(attrs[TEAM_ATTR_TEAM_IFINDEX]));
+	if (!th)
+		return NL_SKIP;
+	team_evmux_pending_add(evmux, th);
+	return event_handler(msg, th);
+}
+
+static void team_evmux_cli_dispatch(struct team_evmux *evmux,
+				    struct team_handle *th,
+				    struct nl_msg *msg)
+{
+	team_evmux_pending_add(evmux, th);
+	ifinfo_event_handler(msg, th);
+}
+
+static int team_evmux_cli_event_handler(struct nl_msg *msg, void *arg)
+{
+	struct team_evmux *evmux = arg;
+	struct nlmsghdr *nlh = nlmsg_hdr(msg);
+	struct team_evmux_link *link;
+	struct team_handle *master_th = NULL;
+	struct team_handle *th;
+	struct ifinfomsg *ifi;
+	struct nlattr *attr;
+	uint32_t ifindex;
+
+	if (nlh->nlmsg_type != RTM_NEWLINK && nlh->nlmsg_type != RTM_DELLINK)
+		return NL_OK;
+	if (!nlmsg_valid_hdr(nlh, sizeof(*ifi)))
+		return NL_OK;
+	ifi = nlmsg_data(nlh);
+	ifindex = ifi->ifi_index;
+
+	th = team_evmux_th_find(evmux, ifindex);
+	if (th)
+		team_evmux_cli_dispatch(evmux, th, msg);
+
+	if (nlh->nlmsg_type == RTM_NEWLINK) {
+		attr = nlmsg_find_attr(nlh, sizeof(*ifi), IFLA_MASTER);
+		if (attr)
+			master_th = team_evmux_th_find(evmux,
+						       nla_get_u32(attr));
 	}
-	return 0;
+
+	/* Former owner has to see the link got released or removed */
+	link = team_evmux_link_find(evmux, ifindex);
+	if (link && link->th != master_th && link->th != th)
+		team_evmux_cli_dispatch(evmux, link->th, msg);
+	if (master_th && master_th != th)
+		team_evmux_cli_dispatch(evmux, master_th, msg);
+	team_evmux_link_set(evmux, ifindex, master_th);
+	return NL_OK;
 }
 
-/**
- * team_set_log_fn:
- * @th: libteam library context
- * @log_fn: function to be called for logging messages
- *
- * The built-in logging writes to stderr. It can be
- * overridden by a custom function, to plug log messages
- * into the user's logging functionality.
- *
- **/
-TEAM_EXPORT
-void team_set_log_fn(struct team_handle *th,
-		     void (*log_fn)(struct team_handle *th, int priority,
-				    const char *file, int line, const char *fn,
-				    const char *format, va_list args))
+static int team_evmux_pending_flush(struct team_evmux *evmux,
+				    team_change_type_mask_t type_mask)
 {
-	th->log_fn = log_fn;
-	dbg(th, "Custom logging function %p registered.", log_fn);
+	struct team_handle *th;
+	int ret = 0;
+	int err;
+
+	while (!list_empty(&evmux->pending_list)) {
+		th = list_get_node_entry(evmux->pending_list.next,
+					 struct team_handle,
+					 evmux_pending_list);
+		list_del(&th->evmux_pending_list);
+		th->evmux_pending = false;
+		th->msg_recv_started = false;
+		err = check_call_change_handlers(th, type_mask);
+		if (err && !ret)
+			ret = err;
+	}
+	return ret;
 }
 
 /**
- * team_get_log_priority:
- * @th: libteam library context
+ * team_evmux_alloc:
  *
- * Returns: the current logging priority
+ * Allocates event multiplexer and its sockets.
+ *
+ * Returns: new event multiplexer
  **/
 TEAM_EXPORT
-int team_get_log_priority(struct team_handle *th)
+struct team_evmux *team_evmux_alloc(void)
 {
-	return th->log_priority;
+	struct team_evmux *evmux;
+
+	evmux = myzalloc(sizeof(*evmux));
+	if (!evmux)
+		return NULL;
+	evmux->event_fd = -1;
+	list_init(&evmux->pending_list);
+	evmux->sock_buf.size = TEAM_SOCK_BUF_SIZE;
+	evmux->sock_buf.max_size = TEAM_SOCK_BUF_MAX_SIZE;
+	team_transport_init(&evmux->transport);
+	if (hash_table_init(&evmux->th_table))
+		goto err_th_table_init;
+	if (hash_table_init(&evmux->link_table))
+		goto err_link_table_init;
+
+	evmux->nl_sock_event = nl_socket_alloc();
+	if (!evmux->nl_sock_event)
+		goto err_sk_event_alloc;
+
+	evmux->nl_cli_sock_event = nl_cli_alloc_socket();
+	if (!evmux->nl_cli_sock_event)
+		goto err_cli_sk_event_alloc;
+
+	return evmux;
+
+err_cli_sk_event_alloc:
+	nl_socket_free(evmux->nl_sock_event);
+
+err_sk_event_alloc:
+	hash_table_fini(&evmux->link_table);
+
+err_link_table_init:
+	hash_table_fini(&evmux->th_table);
+
+err_th_table_init:
+	free(evmux);
+
+	return NULL;
 }
 
 /**
- * team_set_log_priority:
- * @th: libteam library context
- * @priority: the new logging priority
+ * team_evmux_init:
+ * @evmux: event multiplexer
  *
- * Set the current logging priority. The value controls which messages
- * are logged.
+ * Connects event sockets and subscribes to team and link events.
+ *
+ * Returns: zero on success or negative number in case of an error.
  **/
 TEAM_EXPORT
-void team_set_log_priority(struct team_handle *th, int priority)
-{
-	th->log_priority = priority;
-}
-
-static int get_cli_sock_event_fd(struct team_handle *th)
+int team_evmux_init(struct team_evmux *evmux)
 {
-	return nl_socket_get_fd(th->nl_cli.sock_event);
-}
+	struct epoll_event event;
+	int val;
+	int efd;
+	int fd;
+	int err;
 
-static int cli_sock_event_handler(struct team_handle *th)
-{
-	nl_recvmsgs_default(th->nl_cli.sock_event);
-	return check_call_change_handlers(th, TEAM_IFINFO_CHANGE);
-}
+	err = team_transport_connect(&evmux->transport, evmux->nl_sock_event,
+				     NETLINK_GENERIC);
+	if (err)
+		return -nl2syserr(err);
 
-static int get_sock_event_fd(struct team_handle *th)
-{
-	return nl_socket_get_fd(th->nl_sock_event);
-}
+	val = NETLINK_BROADCAST_SEND_ERROR;
+	err = setsockopt(nl_socket_get_fd(evmux->nl_sock_event), SOL_NETLINK,
+			 NETLINK_BROADCAST_ERROR, &val, sizeof(val));
+	if (err)
+		return -errno;
 
-static int sock_event_handler(struct team_handle *th)
-{
-	int ret;
+	err = nl_socket_set_buffer_size(evmux->nl_sock_event,
+					evmux->sock_buf.size, 0);
+	if (err)
+		return -nl2syserr(err);
 
-	ret = nl_recvmsgs_default(th->nl_sock_event);
-	if (ret)
-		return -nl2syserr(ret);
+	/* Join before sequence checking is disabled for events */
+	err = team_transport_join_events(&evmux->transport,
+					 evmux->nl_sock_event, NETLINK_GENERIC);
+	if (err < 0)
+		return -nl2syserr(err);
 
-	th->msg_recv_started = false;
-	return check_call_change_handlers(th, TEAM_PORT_CHANGE |
-					      TEAM_OPTION_CHANGE |
-					      TEAM_IFINFO_CHANGE);
-}
+	nl_socket_disable_seq_check(evmux->nl_sock_event);
+	nl_socket_modify_cb(evmux->nl_sock_event, NL_CB_VALID, NL_CB_CUSTOM,
+			    team_evmux_event_handler, evmux);
 
-struct team_eventfd {
-	int (*get_fd)(struct team_handle *th);
-	int (*event_handler)(struct team_handle *th);
-};
+	nl_socket_disable_seq_check(evmux->nl_cli_sock_event);
+	nl_socket_modify_cb(evmux->nl_cli_sock_event, NL_CB_VALID,
+			    NL_CB_CUSTOM, team_evmux_cli_event_handler, evmux);
+	err = team_transport_connect(&evmux->transport,
+				     evmux->nl_cli_sock_event, NETLINK_ROUTE);
+	if (err)
+		return -nl2syserr(err);
+	err = team_transport_join_events(&evmux->transport,
+					 evmux->nl_cli_sock_event,
+					 NETLINK_ROUTE);
+	if (err < 0)
+		return -nl2syserr(err);
 
-static const struct team_eventfd team_eventfds[] = {
-	/* Always handle cli socket first. The reason is that cli socket
-	 * message may include information, like master unset, which may be
-	 * handy to have before proceeding others.
+	efd = epoll_create1(0);
+	if (efd == -1)
+		return -errno;
+	/*
+	 * Events carry pointer to what is ready. That is either one of
+	 * shared sockets or context the asynchronous request socket or
+	 * timer of which is ready.
 	 */
-	{
-		.get_fd = get_cli_sock_event_fd,
-		.event_handler = cli_sock_event_handler,
-	},
-	{
-		.get_fd = get_sock_event_fd,
-		.event_handler = sock_event_handler,
-	},
-};
-#define TEAM_EVENT_FDS_COUNT ARRAY_SIZE(team_eventfds)
+	event.events = EPOLLIN;
+	fd = nl_socket_get_fd(evmux->nl_cli_sock_event);
+	event.data.ptr = evmux->nl_cli_sock_event;
+	if (epoll_ctl(efd, EPOLL_CTL_ADD, fd, &event) == -1)
+		goto close_efd;
+	fd = nl_socket_get_fd(evmux->nl_sock_event);
+	event.data.ptr = evmux->nl_sock_event;
+	if (epoll_ctl(efd, EPOLL_CTL_ADD, fd, &event) == -1)
+		goto close_efd;
+	evmux->event_fd = efd;
+	return 0;
 
-static const struct team_eventfd __dummy_eventfd;
+close_efd:
+	err = -errno;
+	close(efd);
+	return err;
+}
 
 /**
- * team_get_next_eventfd:
- * @th: libteam library context
- * @eventfd: eventfd structure
+ * team_evmux_free:
+ * @evmux: event multiplexer
  *
- * Get next eventfd in list.
- *
- * Returns: eventfd next to @eventfd passed.
+ * Do event multiplexer cleanup. All contexts have to be freed before.
  *
- * @deprecated Use of this function is deprecated.
  **/
 TEAM_EXPORT
-const struct team_eventfd *team_get_next_eventfd(struct team_handle *th,
-						 const struct team_eventfd *eventfd)
-{
-	if (!eventfd)
-		return &__dummy_eventfd;
-	return NULL;
+void team_evmux_free(struct team_evmux *evmux)
+{
+	struct team_evmux_link *link;
+	struct team_evmux_link *tmp;
+	unsigned int i;
+
+	if (evmux->event_fd != -1)
+		close(evmux->event_fd);
+	for (i = 0; i < evmux->link_table.size; i++) {
+		list_for_each_node_entry_safe(link, tmp,
+					      &evmux->link_table.buckets[i],
+					      hitem.list)
+			free(link);
+	}
+	hash_table_fini(&evmux->link_table);
+	hash_table_fini(&evmux->th_table);
+	nl_socket_free(evmux->nl_cli_sock_event);
+	nl_socket_free(evmux->nl_sock_event);
+	free(evmux);
 }
 
 /**
- * team_get_eventfd_fd:
- * @th: libteam library context
- * @eventfd: eventfd structure
- *
- * Get eventfd filedesctiptor.
+ * team_evmux_set_emul_port:
+ * @evmux: event multiplexer
+ * @port: netlink port of team emulator, zero for kernel
  *
- * Returns: fd.
+ * Make event multiplexer get events from team emulator instead of kernel.
+ * Has to be called before team_evmux_init().
  *
- * @deprecated Use of this function is deprecated. User should use
- *	       team_get_event_fd() funstion instead.
+ * Returns: zero on success or negative number in case of an error.
  **/
 TEAM_EXPORT
-int team_get_eventfd_fd(struct team_handle *th,
-			const struct team_eventfd *eventfd)
+int team_evmux_set_emul_port(struct team_evmux *evmux, uint32_t port)
 {
-	return team_get_event_fd(th);
+	if (evmux->event_fd != -1)
+		return -EBUSY;
+	team_transport_set_emul(&evmux->transport, port);
+	return 0;
 }
 
 /**
- * team_call_eventfd_handler:
- * @th: libteam library context
- * @eventfd: eventfd structure
+ * team_evmux_set_sock_buffer_size:
+ * @evmux: event multiplexer
+ * @size: initial receive buffer size in bytes
+ * @max_size: size the buffer may grow to once events overrun it
  *
- * Call eventfd handler.
+ * Set receive buffer sizes of shared event sockets. Has to be called
+ * before team_evmux_init(). Zero keeps the current value.
  *
  * Returns: zero on success or negative number in case of an error.
- *
- * @deprecated Use of this function is deprecated. User should use
- *	       team_handle_events() funstion instead.
  **/
 TEAM_EXPORT
-int team_call_eventfd_handler(struct team_handle *th,
-			      const struct team_eventfd *eventfd)
-{
-	return team_handle_events(th);
+int team_evmux_set_sock_buffer_size(struct team_evmux *evmux,
+				    unsigned int size, unsigned int max_size)
+{
+	if (evmux->event_fd != -1)
+		return -EBUSY;
+	if (size)
+		evmux->sock_buf.size = size;
+	if (max_size)
+		evmux->sock_buf.max_size = max_size;
+	if (evmux->sock_buf.max_size < evmux->sock_buf.size)
+		evmux->sock_buf.max_size = evmux->sock_buf.size;
+	return 0;
 }
 
-static int team_init_event_fd(struct team_handle *th)
+/*
+ * Overrun of shared socket may have lost events of any attached context,
+ * so all of them are resynced.
+ */
+static int team_evmux_resync(struct team_evmux *evmux, struct nl_sock *sock,
+			     team_change_type_mask_t type_mask)
 {
-	int efd;
-	int i;
-	struct epoll_event event;
+	struct team_handle *th;
+	unsigned int i;
+	int ret = 0;
+	int size;
 	int err;
 
-	efd = epoll_create1(0);
-	if (efd == -1)
-		return -errno;
-	for (i = 0; i < TEAM_EVENT_FDS_COUNT; i++) {
-		int fd = team_eventfds[i].get_fd(th);
-
-		event.data.fd = fd;
-		event.events = EPOLLIN;
-		err = epoll_ctl(efd, EPOLL_CTL_ADD, fd, &event);
-		if (err == -1) {
-			err = -errno;
-			goto close_efd;
+	size = team_sock_buf_grow(sock, evmux->sock_buf.max_size);
+	for (i = 0; i < evmux->th_table.size; i++) {
+		list_for_each_node_entry(th, &evmux->th_table.buckets[i],
+					 evmux_hitem.list) {
+			team_sock_overrun(th, size);
+			team_resync_begin(th, type_mask);
 		}
 	}
-	th->event_fd = efd;
-	return 0;
-
-close_efd:
-	close(efd);
-	return err;
+	team_sock_drain(sock);
+	for (i = 0; i < evmux->th_table.size; i++) {
+		list_for_each_node_entry(th, &evmux->th_table.buckets[i],
+					 evmux_hitem.list) {
+			team_evmux_pending_add(evmux, th);
+			err = team_resync_end(th, type_mask);
+			if (err && !ret)
+				ret = err;
+		}
+	}
+	return ret;
 }
 
 /**
- * team_get_event_fd:
- * @th: libteam library context
+ * team_evmux_get_event_fd:
+ * @evmux: event multiplexer
  *
  * Get event filedesctiptor.
  *
  * Returns: fd.
  **/
 TEAM_EXPORT
-int team_get_event_fd(struct team_handle *th)
+int team_evmux_get_event_fd(struct team_evmux *evmux)
 {
-	return th->event_fd;
+	return evmux->event_fd;
 }
 
 /**
- * team_handle_events:
- * @th: libteam library context
- * @eventfd: eventfd structure
+ * team_evmux_handle_events:
+ * @evmux: event multiplexer
  *
- * Handler events which happened on event filedescriptor.
+ * Handle events which happened on event filedescriptor and call change
+ * handlers of contexts the events were delivered to.
  *
  * Returns: zero on success or negative number in case of an error.
  **/
 TEAM_EXPORT
-int team_handle_events(struct team_handle *th)
+int team_evmux_handle_events(struct team_evmux *evmux)
 {
-	struct epoll_event events[TEAM_EVENT_FDS_COUNT];
+	struct epoll_event events[TEAM_EVMUX_EVENTS_MAX];
+	bool cli_ready = false;
+	bool ready = false;
 	int nfds;
-	int n;
-	int i;
 	int err;
+	int n;
 
-	nfds = epoll_wait(th->event_fd, events, TEAM_EVENT_FDS_COUNT, -1);
+	nfds = epoll_wait(evmux->event_fd, events, TEAM_EVMUX_EVENTS_MAX, -1);
 	if (nfds == -1)
 		return -errno;
+	for (n = 0; n < nfds; n++) {
+		if (events[n].data.ptr == evmux->nl_cli_sock_event) {
+			cli_ready = true;
+		} else if (events[n].data.ptr == evmux->nl_sock_event) {
+			ready = true;
+		} else {
+			err = team_ctx_event_handler(events[n].data.ptr);
+			if (err)
+				return err;
+		}
+	}
 
-	/* Go over list of event fds and handle them sequentially */
-	for (i = 0; i < TEAM_EVENT_FDS_COUNT; i++) {
-		const struct team_eventfd *eventfd = &team_eventfds[i];
-
-		for (n = 0; n < nfds; n++) {
-			if (events[n].data.fd == eventfd->get_fd(th)) {
-				err = eventfd->event_handler(th);
-				if (err)
-					return err;
+	/* Same as for single context, cli socket goes first */
+	if (cli_ready) {
+		err = nl_recvmsgs_default(evmux->nl_cli_sock_event);
+		if (err == -NLE_NOMEM) {
+			err = team_evmux_resync(evmux,
+						evmux->nl_cli_sock_event,
+						TEAM_IFINFO_CHANGE);
+			if (err) {
+				team_evmux_pending_flush(evmux, 0);
+				return err;
 			}
 		}
+		err = team_evmux_pending_flush(evmux, TEAM_IFINFO_CHANGE);
+		if (err)
+			return err;
+	}
+	if (ready) {
+		err = nl_recvmsgs_default(evmux->nl_sock_event);
+		if (err == -NLE_NOMEM)
+			err = team_evmux_resync(evmux, evmux->nl_sock_event,
+						TEAM_PORT_CHANGE |
+						TEAM_OPTION_CHANGE);
+		else if (err)
+			err = -nl2syserr(err);
+		if (err) {
+			team_evmux_pending_flush(evmux, 0);
+			return err;
+		}
+		return team_evmux_pending_flush(evmux, TEAM_PORT_CHANGE |
+							TEAM_OPTION_CHANGE |
+							TEAM_IFINFO_CHANGE);
 	}
 	return 0;
 }
 
 /**
- * team_check_events:
+ * team_set_evmux:
  * @th: libteam library context
+ * @evmux: event multiplexer
  *
- * Check for events pending to be processed on event socket and process
- * them one by one. This is safe to be called even if no data present
- * on event socket file descriptor.
+ * Make library context use event sockets of @evmux instead of creating
+ * its own. Has to be called before team_init().
  *
  * Returns: zero on success or negative number in case of an error.
  **/
 TEAM_EXPORT
-int team_check_events(struct team_handle *th)
+int team_set_evmux(struct team_handle *th, struct team_evmux *evmux)
 {
-	fd_set rfds;
-	int fdmax;
-	struct timeval tv;
-	int fd = team_get_event_fd(th);
-	int ret;
+	if (th->ifindex)
+		return -EBUSY;
+	nl_socket_free(th->nl_cli.sock_event);
+	th->nl_cli.sock_event = NULL;
+	nl_socket_free(th->nl_sock_event);
+	th->nl_sock_event = NULL;
+	th->evmux = evmux;
+	return 0;
+}
 
-	memset(&tv, 0, sizeof(tv));
-	FD_ZERO(&rfds);
-	FD_SET(fd, &rfds);
-	fdmax = fd + 1;
-	ret = select(fdmax, &rfds, NULL, NULL, &tv);
-	if (ret == -1)
-		return -errno;
-	return team_handle_events(th);
+static int team_evmux_attach(struct team_evmux *evmux, struct team_handle *th)
+{
+	struct team_port *port;
+
+	if (team_evmux_th_find(evmux, th->ifindex)) {
+		err(th, "Team ifindex %u is already attached to multiplexer.",
+		    th->ifindex);
+		return -EEXIST;
+	}
+	hash_table_add(&evmux->th_table, &th->evmux_hitem,
+		       hash_u32(th->ifindex));
+	team_for_each_port(port, th)
+		team_evmux_link_set(evmux, team_get_port_ifindex(port), th);
+	return 0;
+}
+
+static void team_evmux_detach(struct team_evmux *evmux, struct team_handle *th)
+{
+	struct team_evmux_link *link;
+	struct team_evmux_link *tmp;
+	unsigned int i;
+
+	if (team_evmux_th_find(evmux, th->ifindex) != th)
+		return;
+	hash_table_del(&evmux->th_table, &th->evmux_hitem);
+	if (th->evmux_pending)
+		list_del(&th->evmux_pending_list);
+	for (i = 0; i < evmux->link_table.size; i++) {
+		list_for_each_node_entry_safe(link, tmp,
+					      &evmux->link_table.buckets[i],
+					      hitem.list) {
+			if (link->th != th)
+				continue;
+			hash_table_del(&evmux->link_table, &link->hitem);
+			free(link);
+		}
+	}
 }
 
 /**
@@ -1451,7 +2790,9 @@ int team_set_port_priority(struct team_handle *th,
  * @th: libteam library context
  * @ifname: interface name
  *
- * Looks up for interface of given name and gets its index.
+ * Looks up for interface of given name and gets its index. Team device,
+ * its ports and watched interfaces are answered from ifinfo, kernel is
+ * asked only for others.
  *
  * Returns: zero if interface is not found,
  *	    interface index as reffered by in kernel otherwise.
@@ -1463,6 +2804,9 @@ uint32_t team_ifname2ifindex(struct team_handle *th, const char *ifname)
 	uint32_t ifindex;
 	int err;
 
+	ifindex = ifinfo_ifname2ifindex(th, ifname);
+	if (ifindex)
+		return ifindex;
 	err = rtnl_link_get_kernel(th->nl_cli.sock, 0, ifname, &link);
 	if (err)
 		return 0;
@@ -1478,7 +2822,9 @@ uint32_t team_ifname2ifindex(struct team_handle *th, const char *ifname)
  * @ifname: where the interface name will be stored
  * @maxlen: length of ifname buffer
  *
- * Looks up for interface of given index and gets its name.
+ * Looks up for interface of given index and gets its name. Team device,
+ * its ports and watched interfaces are answered from ifinfo, kernel is
+ * asked only for others.
  *
  * Returns: NULL if interface is not found,
  *	    @ifname otherwise.
@@ -1488,8 +2834,14 @@ char *team_ifindex2ifname(struct team_handle *th, uint32_t ifindex,
 			  char *ifname, unsigned int maxlen)
 {
 	struct rtnl_link *link;
+	char *cached_ifname;
 	int err;
 
+	cached_ifname = ifinfo_ifindex2ifname(th, ifindex);
+	if (cached_ifname) {
+		mystrlcpy(ifname, cached_ifname, maxlen);
+		return ifname;
+	}
 	err = rtnl_link_get_kernel(th->nl_cli.sock, ifindex, NULL, &link);
 	if (err)
 		return NULL;
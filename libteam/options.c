@@ -30,36 +30,136 @@
 #include <linux/types.h>
 #include <team.h>
 #include <private/list.h>
+#include <private/hash.h>
+#include <private/pool.h>
 #include <private/misc.h>
 #include "team_private.h"
 #include "nl_updates.h"
 
-struct team_option_id {
-	char *			name;
-	uint32_t		port_ifindex;
-	bool			port_ifindex_used;
-	uint32_t		array_index;
-	bool			array_index_used;
+/* Option names are shared by all ports and array items of an option */
+struct option_name {
+	struct hash_item	hitem;
+	unsigned int		refcount;
+	char			name[];
 };
 
+/* Values up to this size, like lb_hash_stats, are stored in option itself */
+#define OPTION_INLINE_DATA_SIZE 16
+
 struct team_option {
 	struct list_item	list;
+	struct list_item	changed_list;
+	bool			in_changed_list;
+	struct hash_item	hitem; /* keyed by id */
+	struct option_name *	name;
+	struct list_item	handle_list; /* bound handles */
 	bool			initialized;
 	enum team_option_type	type;
 	struct team_option_id	id;
-	void *			data;
+	void *			data; /* inline_data or heap */
 	int			data_len;
 	bool			changed;
 	bool			changed_locally;
 	bool			temporary;
+	bool			resynced;
+	union {
+		uint64_t	align;
+		char		buf[OPTION_INLINE_DATA_SIZE];
+	} inline_data;
+};
+
+static void option_data_free(struct team_option *option)
+{
+	if (option->data != option->inline_data.buf)
+		free(option->data);
+}
+
+static struct option_name *option_name_get(struct team_handle *th,
+					   const char *name_str,
+					   uint32_t name_hash)
+{
+	struct option_name *name;
+	size_t len;
+
+	hash_table_for_each_match(name, &th->option_name_table, name_hash,
+				  hitem) {
+		if (!strcmp(name->name, name_str)) {
+			name->refcount++;
+			return name;
+		}
+	}
+	len = strlen(name_str) + 1;
+	name = malloc(sizeof(*name) + len);
+	if (!name)
+		return NULL;
+	th->alloc_count++;
+	memcpy(name->name, name_str, len);
+	name->refcount = 1;
+	hash_table_add(&th->option_name_table, &name->hitem, name_hash);
+	return name;
+}
+
+static void option_name_put(struct team_handle *th, struct option_name *name)
+{
+	if (--name->refcount)
+		return;
+	hash_table_del(&th->option_name_table, &name->hitem);
+	free(name);
+}
+
+static uint32_t option_id_hash(struct team_option_id *opt_id,
+			       uint32_t name_hash)
+{
+	uint32_t hash = name_hash;
+
+	if (opt_id->port_ifindex_used)
+		hash = hash_combine(hash, hash_u32(opt_id->port_ifindex));
+	if (opt_id->array_index_used)
+		hash = hash_combine(hash, hash_u32(~opt_id->array_index));
+	return hash;
+}
+
+/*
+ * Handle refers to option by id. It is bound to the option while that
+ * exists and gets bound again once option with the same id reappears.
+ */
+struct team_option_handle {
+	struct hash_item	hitem; /* keyed by id */
+	struct list_item	list; /* in bound option handle_list */
+	struct team_option_id	id;
+	struct option_name *	name;
+	struct team_option *	option; /* NULL in case option does not exist */
 };
 
-static void destroy_option(struct team_option *option)
+static void option_handle_bind(struct team_option_handle *handle,
+			       struct team_option *option)
+{
+	handle->option = option;
+	list_add_tail(&option->handle_list, &handle->list);
+}
+
+static void option_handle_unbind(struct team_option_handle *handle)
+{
+	list_del(&handle->list);
+	list_init(&handle->list);
+	handle->option = NULL;
+}
+
+static void destroy_option(struct team_handle *th, struct team_option *option)
 {
+	struct team_option_handle *handle, *tmp;
+
+	list_for_each_node_entry_safe(handle, tmp, &option->handle_list, list)
+		option_handle_unbind(handle);
+	if (option->in_changed_list)
+		list_del(&option->changed_list);
+	if (option->temporary)
+		th->option_temporary_count--;
 	list_del(&option->list);
-	free(option->id.name);
-	free(option->data);
-	free(option);
+	hash_table_del(&th->option_table, &option->hitem);
+	option_name_put(th, option->name);
+	option_data_free(option);
+	pool_free(&th->option_pool, option);
 }
 
 static void flush_option_list(struct team_handle *th)
@@ -67,39 +167,60 @@ static void flush_option_list(struct team_handle *th)
 	struct team_option *option, *tmp;
 
 	list_for_each_node_entry_safe(option, tmp, &th->option_list, list)
-		destroy_option(option);
+		destroy_option(th, option);
+}
+
+static void option_changed_list_add(struct team_handle *th,
+				    struct team_option *option)
+{
+	if (option->in_changed_list)
+		return;
+	list_add_tail(&th->option_changed_list, &option->changed_list);
+	option->in_changed_list = true;
 }
 
-static void option_list_cleanup_last_state(struct team_handle *th)
+void option_list_cleanup_last_state(struct team_handle *th)
 {
 	struct team_option *option, *tmp;
 
-	list_for_each_node_entry_safe(option, tmp, &th->option_list, list) {
+	list_for_each_node_entry_safe(option, tmp, &th->option_changed_list,
+				      changed_list) {
+		list_del(&option->changed_list);
+		option->in_changed_list = false;
 		option->changed = false;
+	}
+	if (!th->option_temporary_count)
+		return;
+	list_for_each_node_entry_safe(option, tmp, &th->option_list, list) {
 		if (option->temporary)
-			destroy_option(option);
+			destroy_option(th, option);
 	}
 }
 
+static bool option_id_equal(struct team_option_id *id1,
+			    struct team_option_id *id2)
+{
+	if (id1->port_ifindex_used != id2->port_ifindex_used)
+		return false;
+	if (id1->port_ifindex_used && id1->port_ifindex != id2->port_ifindex)
+		return false;
+	if (id1->array_index_used != id2->array_index_used)
+		return false;
+	if (id1->array_index_used && id1->array_index != id2->array_index)
+		return false;
+	return !strcmp(id1->name, id2->name);
+}
+
 static struct team_option *do_find_option(struct team_handle *th,
 					  struct team_option_id *opt_id)
 {
 	struct team_option *option;
+	uint32_t hash;
 
-	list_for_each_node_entry(option, &th->option_list, list) {
-		if (strcmp(option->id.name, opt_id->name))
-			continue;
-		if (option->id.port_ifindex_used != opt_id->port_ifindex_used)
-			continue;
-		if (option->id.port_ifindex_used &&
-		    option->id.port_ifindex != opt_id->port_ifindex)
-			continue;
-		if (option->id.array_index_used != opt_id->array_index_used)
-			continue;
-		if (option->id.array_index_used &&
-		    option->id.array_index != opt_id->array_index)
-			continue;
-		return option;
+	hash = option_id_hash(opt_id, hash_str(opt_id->name));
+	hash_table_for_each_match(option, &th->option_table, hash, hitem) {
+		if (option_id_equal(&option->id, opt_id))
+			return option;
 	}
 	return NULL;
 }
@@ -123,33 +244,58 @@ static int get_option_data_size_by_type(int opt_type, const void *data,
 	}
 }
 
+static bool option_value_differs(struct team_option *option, int opt_type,
+				 const void *data, int data_len)
+{
+	int data_size;
+
+	data_size = get_option_data_size_by_type(opt_type, data, data_len);
+	if (!option->initialized || option->type != opt_type ||
+	    option->data_len != data_size)
+		return true;
+	return memcmp(option->data, data, data_size) ? true : false;
+}
+
 static int create_option(struct team_handle *th, struct team_option **poption,
 			 struct team_option_id *opt_id)
 {
+	struct team_option_handle *handle;
 	struct team_option *option;
+	uint32_t name_hash;
+	uint32_t hash;
 	int err;
 
-	option = myzalloc(sizeof(struct team_option));
+	option = pool_alloc(&th->option_pool);
 	if (!option)
 		return -ENOMEM;
+	list_init(&option->handle_list);
 
-	option->id.name = strdup(opt_id->name);
-	if (!option->id.name) {
+	name_hash = hash_str(opt_id->name);
+	option->name = option_name_get(th, opt_id->name, name_hash);
+	if (!option->name) {
 		err = -ENOMEM;
 		goto err_alloc_name;
 	}
+	option->id.name = option->name->name;
 	option->id.port_ifindex = opt_id->port_ifindex;
 	option->id.port_ifindex_used = opt_id->port_ifindex_used;
 	option->id.array_index = opt_id->array_index;
 	option->id.array_index_used = opt_id->array_index_used;
 
 	list_add(&th->option_list, &option->list);
+	hash = option_id_hash(&option->id, name_hash);
+	hash_table_add(&th->option_table, &option->hitem, hash);
+	hash_table_for_each_match(handle, &th->option_handle_table, hash,
+				  hitem) {
+		if (option_id_equal(&handle->id, &option->id))
+			option_handle_bind(handle, option);
+	}
 
 	*poption = option;
 	return 0;
 
 err_alloc_name:
-	free(option);
+	pool_free(&th->option_pool, option);
 
 	return err;
 }
@@ -169,18 +315,30 @@ static int do_update_option(struct team_handle *th, struct team_option *option,
 		dbg(th, "Updating option \"%s\" with different option type.",
 		    option->id.name);
 
-	tmp_data = malloc(data_size);
-	if (!tmp_data)
-		return -ENOMEM;
-
-	memcpy(tmp_data, data, data_size);
-	free(option->data);
-	option->data = tmp_data;
-	option->data_len = data_size;
+	if (option->data && option->data_len == data_size) {
+		/* Value changes of existing options do not allocate */
+		memmove(option->data, data, data_size);
+	} else if (data_size <= OPTION_INLINE_DATA_SIZE) {
+		memmove(option->inline_data.buf, data, data_size);
+		option_data_free(option);
+		option->data = option->inline_data.buf;
+		option->data_len = data_size;
+	} else {
+		tmp_data = malloc(data_size);
+		if (!tmp_data)
+			return -ENOMEM;
+		th->alloc_count++;
+		memcpy(tmp_data, data, data_size);
+		option_data_free(option);
+		option->data = tmp_data;
+		option->data_len = data_size;
+	}
 	option->type = opt_type;
 	option->changed = changed;
 	option->changed_locally = changed_locally;
 	option->initialized = true;
+	if (changed)
+		option_changed_list_add(th, option);
 
 	return 0;
 }
@@ -205,9 +363,11 @@ static int update_option(struct team_handle *th, struct team_option **poption,
 			       changed, changed_locally);
 	if (err) {
 		if (option_created)
-			destroy_option(option);
+			destroy_option(th, option);
 		return err;
 	}
+	if (option_created)
+		option_changed_list_add(th, option);
 	*poption = option;
 	return 0;
 }
@@ -315,50 +475,109 @@ int get_options_handler(struct nl_msg *msg, void *arg)
 			continue;
 		}
 
+		/*
+		 * Dump does not flag anything, compare with last state and
+		 * keep changes of events processed during resync.
+		 */
+		if (th->resyncing && !changed) {
+			option = do_find_option(th, &opt_id);
+			changed = !option || option->changed ||
+				  option_value_differs(option, opt_type,
+						       data, data_len);
+		}
+
 		err = update_option(th, &option, &opt_id, opt_type,
 				    data, data_len, changed, false);
 		if (err) {
 			err(th, "Failed to update option: %s", strerror(-err));
 			continue;
 		}
+		option->resynced = true;
 		if (option_attrs[TEAM_ATTR_OPTION_REMOVED])
-			destroy_option(option);
+			destroy_option(th, option);
 	}
 
 	set_call_change_handlers(th, TEAM_OPTION_CHANGE);
 	return NL_SKIP;
 }
 
-static int get_options(struct team_handle *th)
+static int option_list_dump(struct team_handle *th)
 {
 	struct nl_msg *msg;
-	int err;
 
-	msg = nlmsg_alloc();
-	if (!msg)
-		return -ENOMEM;
+	msg = team_req_msg_get(th);
 
 	genlmsg_put(msg, NL_AUTO_PID, th->nl_sock_seq, th->family, 0, 0,
 			 TEAM_CMD_OPTIONS_GET, 0);
 	NLA_PUT_U32(msg, TEAM_ATTR_TEAM_IFINDEX, th->ifindex);
 
+	return send_and_recv(th, msg, get_options_handler, th);
+
+nla_put_failure:
+	nlmsg_free(msg);
+	return -ENOBUFS;
+}
+
+static int get_options(struct team_handle *th)
+{
+	int err;
+
 	th->msg_recv_started = false;
-	err = send_and_recv(th, msg, get_options_handler, th);
+	err = option_list_dump(th);
 	if (err)
 		return err;
 
 	return check_call_change_handlers(th, TEAM_OPTION_CHANGE);
+}
 
-nla_put_failure:
-	nlmsg_free(msg);
-	return -ENOBUFS;
+/*
+ * Used once option events may have been lost. Options are dumped again
+ * and the ones which are gone are removed. Change handlers are left for
+ * caller to call.
+ */
+int option_list_resync(struct team_handle *th)
+{
+	struct team_option *option, *tmp;
+	int err;
+
+	list_for_each_node_entry(option, &th->option_list, list)
+		option->resynced = false;
+
+	err = option_list_dump(th);
+	if (err)
+		return err;
+
+	list_for_each_node_entry_safe(option, tmp, &th->option_list, list) {
+		if (!option->resynced && option->initialized)
+			destroy_option(th, option);
+	}
+	set_call_change_handlers(th, TEAM_OPTION_CHANGE);
+	return 0;
 }
 
 int option_list_alloc(struct team_handle *th)
 {
-	list_init(&th->option_list);
+	int err;
 
+	list_init(&th->option_list);
+	list_init(&th->option_changed_list);
+	pool_init(&th->option_pool, sizeof(struct team_option));
+	err = hash_table_init(&th->option_table);
+	if (err)
+		return err;
+	err = hash_table_init(&th->option_name_table);
+	if (err)
+		goto err_name_table_init;
+	err = hash_table_init(&th->option_handle_table);
+	if (err)
+		goto err_handle_table_init;
 	return 0;
+
+err_handle_table_init:
+	hash_table_fini(&th->option_name_table);
+err_name_table_init:
+	hash_table_fini(&th->option_table);
+	return err;
 }
 
 int option_list_init(struct team_handle *th)
@@ -373,9 +592,68 @@ int option_list_init(struct team_handle *th)
 	return 0;
 }
 
+static void flush_option_handles(struct team_handle *th)
+{
+	struct team_option_handle *handle, *tmp;
+	unsigned int i;
+
+	for (i = 0; i < th->option_handle_table.size; i++)
+		list_for_each_node_entry_safe(handle, tmp,
+					      &th->option_handle_table.buckets[i],
+					      hitem.list)
+			team_option_handle_free(th, handle);
+}
+
 void option_list_free(struct team_handle *th)
 {
 	flush_option_list(th);
+	flush_option_handles(th);
+	hash_table_fini(&th->option_handle_table);
+	hash_table_fini(&th->option_name_table);
+	hash_table_fini(&th->option_table);
+	pool_fini(&th->option_pool);
+	free(th->txn.items);
+	free(th->txn.buf);
+}
+
+/*
+ * Copy carries its value and name in the same allocation. It is not
+ * hashed nor bound to handles, only getters may be used on it.
+ */
+int option_list_snapshot(struct team_handle *th, struct team_snapshot *snap)
+{
+	struct team_option *option;
+	struct team_option *copy;
+	size_t name_size;
+	char *buf;
+
+	list_for_each_node_entry(option, &th->option_list, list) {
+		if (!option->initialized)
+			continue;
+		name_size = strlen(option->id.name) + 1;
+		copy = malloc(sizeof(*copy) + option->data_len + name_size);
+		if (!copy)
+			return -ENOMEM;
+		memcpy(copy, option, sizeof(*copy));
+		buf = (char *) (copy + 1);
+		memcpy(buf, option->data, option->data_len);
+		copy->data = buf;
+		copy->id.name = buf + option->data_len;
+		memcpy(copy->id.name, option->id.name, name_size);
+		copy->name = NULL;
+		copy->in_changed_list = false;
+		list_init(&copy->handle_list);
+		list_add_tail(&snap->option_list, &copy->list);
+	}
+	return 0;
+}
+
+void option_snapshot_free(struct team_snapshot *snap)
+{
+	struct team_option *copy, *tmp;
+
+	list_for_each_node_entry_safe(copy, tmp, &snap->option_list, list)
+		free(copy);
 }
 
 static struct team_option *find_option(struct team_handle *th,
@@ -398,9 +676,37 @@ static struct team_option *find_option(struct team_handle *th,
 	if (err)
 		return NULL;
 	option->temporary = true;
+	th->option_temporary_count++;
 	return option;
 }
 
+/* Returns false in case option does not have to exist */
+static bool option_id_vparse(struct team_option_id *opt_id,
+			     const char *fmt, va_list ap)
+{
+	bool must_exist = true;
+
+	while (*fmt) {
+		switch (*fmt++) {
+		case 'n': /* name */
+			opt_id->name = va_arg(ap, char *);
+			break;
+		case 'p': /* port_ifindex */
+			opt_id->port_ifindex = va_arg(ap, uint32_t);
+			opt_id->port_ifindex_used = true;
+			break;
+		case 'a': /* array index */
+			opt_id->array_index = va_arg(ap, uint32_t);
+			opt_id->array_index_used = true;
+			break;
+		case '!': /* option does not have to exist */
+			must_exist = false;
+			break;
+		}
+	}
+	return must_exist;
+}
+
 /**
  * team_get_option:
  * @th: libteam library context
@@ -416,27 +722,10 @@ struct team_option *team_get_option(struct team_handle *th,
 {
 	struct team_option_id opt_id = {};
 	va_list ap;
-	bool must_exist = true;
+	bool must_exist;
 
 	va_start(ap, fmt);
-	while (*fmt) {
-		switch (*fmt++) {
-		case 'n': /* name */
-			opt_id.name = va_arg(ap, char *);
-			break;
-		case 'p': /* port_ifindex */
-			opt_id.port_ifindex = va_arg(ap, uint32_t);
-			opt_id.port_ifindex_used = true;
-			break;
-		case 'a': /* array index */
-			opt_id.array_index = va_arg(ap, uint32_t);
-			opt_id.array_index_used = true;
-			break;
-		case '!': /* option does not have to exist */
-			must_exist = false;
-			break;
-		}
-	}
+	must_exist = option_id_vparse(&opt_id, fmt, ap);
 	va_end(ap);
 
 	if (!opt_id.name)
@@ -465,6 +754,72 @@ struct team_option *team_get_next_option(struct team_handle *th,
 	return next_option;
 }
 
+/**
+ * team_snapshot_get_option:
+ * @snap: libteam snapshot
+ * @fmt: format string
+ *
+ * Get option structure referred by format sttring from snapshot. Unlike
+ * team_get_option(), "!" does not create missing option.
+ *
+ * Returns: pointer to option structure or NULL in case it does not exist.
+ **/
+TEAM_EXPORT
+struct team_option *team_snapshot_get_option(struct team_snapshot *snap,
+					     const char *fmt, ...)
+{
+	struct team_option_id opt_id = {};
+	struct team_option *option;
+	va_list ap;
+
+	va_start(ap, fmt);
+	option_id_vparse(&opt_id, fmt, ap);
+	va_end(ap);
+
+	if (!opt_id.name)
+		return NULL;
+	list_for_each_node_entry(option, &snap->option_list, list) {
+		if (option_id_equal(&option->id, &opt_id))
+			return option;
+	}
+	return NULL;
+}
+
+/**
+ * team_snapshot_get_next_option:
+ * @snap: libteam snapshot
+ * @option: option structure
+ *
+ * Get next option in snapshot.
+ *
+ * Returns: option next to @option passed.
+ **/
+TEAM_EXPORT
+struct team_option *team_snapshot_get_next_option(struct team_snapshot *snap,
+						  struct team_option *option)
+{
+	return list_get_next_node_entry(&snap->option_list, option, list);
+}
+
+/**
+ * team_get_next_changed_option:
+ * @th: libteam library context
+ * @option: option structure
+ *
+ * Get next option which got changed or created by last processed event
+ * or changed locally since then. Unlike team_get_next_option() this
+ * does not walk options which stayed the same.
+ *
+ * Returns: changed option next to @option passed.
+ **/
+TEAM_EXPORT
+struct team_option *team_get_next_changed_option(struct team_handle *th,
+						 struct team_option *option)
+{
+	return list_get_next_node_entry(&th->option_changed_list, option,
+					changed_list);
+}
+
 /**
  * team_is_option_initialized:
  * @option: option structure
@@ -685,54 +1040,51 @@ static int local_set_option_value(struct team_handle *th,
 	err = update_option(th, &option, opt_id, opt_type,
 			    data, data_len, true, true);
 	if (option->temporary)
-		destroy_option(option);
+		destroy_option(th, option);
 	if (err)
 		return err;
 	return 0;
 }
 
-static int set_option_value(struct team_handle *th, struct team_option *option,
-			    const void *data, int data_len, int opt_type)
+static int option_nla_type(int opt_type)
 {
-	struct nl_msg *msg;
-	struct nlattr *option_list;
-	struct nlattr *option_item;
-	int nla_type;
-	int err;
-
-	if (option->initialized && option->type != opt_type)
-		return -EINVAL;
-
 	switch (opt_type) {
 	case TEAM_OPTION_TYPE_U32:
-		nla_type = NLA_U32;
-		break;
+		return NLA_U32;
 	case TEAM_OPTION_TYPE_STRING:
-		nla_type = NLA_STRING;
-		break;
+		return NLA_STRING;
 	case TEAM_OPTION_TYPE_BINARY:
-		nla_type = NLA_BINARY;
-		break;
+		return NLA_BINARY;
 	case TEAM_OPTION_TYPE_BOOL:
-		nla_type = NLA_FLAG;
-		break;
+		return NLA_FLAG;
 	case TEAM_OPTION_TYPE_S32:
-		nla_type = NLA_S32;
-		break;
+		return NLA_S32;
 	default:
 		return -EINVAL;
 	}
+}
 
-	msg = nlmsg_alloc();
-	if (!msg)
-		return -ENOMEM;
-
+static struct nlattr *options_set_msg_start(struct team_handle *th,
+					    struct nl_msg *msg)
+{
 	genlmsg_put(msg, NL_AUTO_PID, th->nl_sock_seq, th->family, 0, 0,
 		    TEAM_CMD_OPTIONS_SET, 0);
 	NLA_PUT_U32(msg, TEAM_ATTR_TEAM_IFINDEX, th->ifindex);
-	option_list = nla_nest_start(msg, TEAM_ATTR_LIST_OPTION);
-	if (!option_list)
-		goto nla_put_failure;
+	return nla_nest_start(msg, TEAM_ATTR_LIST_OPTION);
+
+nla_put_failure:
+	return NULL;
+}
+
+/* In case item does not fit, message is left as it was before the call */
+static int options_set_msg_put_item(struct nl_msg *msg,
+				    struct team_option *option,
+				    const void *data, int data_len,
+				    int nla_type)
+{
+	__u32 msg_len = nlmsg_hdr(msg)->nlmsg_len;
+	struct nlattr *option_item;
+
 	option_item = nla_nest_start(msg, TEAM_ATTR_ITEM_OPTION);
 	if (!option_item)
 		goto nla_put_failure;
@@ -765,6 +1117,35 @@ static int set_option_value(struct team_handle *th, struct team_option *option,
 			goto nla_put_failure;
 	}
 	nla_nest_end(msg, option_item);
+	return 0;
+
+nla_put_failure:
+	nlmsg_hdr(msg)->nlmsg_len = msg_len;
+	return -ENOBUFS;
+}
+
+static int set_option_value(struct team_handle *th, struct team_option *option,
+			    const void *data, int data_len, int opt_type)
+{
+	struct nl_msg *msg;
+	struct nlattr *option_list;
+	int nla_type;
+	int err;
+
+	if (option->initialized && option->type != opt_type)
+		return -EINVAL;
+
+	nla_type = option_nla_type(opt_type);
+	if (nla_type < 0)
+		return nla_type;
+
+	msg = team_req_msg_get(th);
+
+	option_list = options_set_msg_start(th, msg);
+	if (!option_list)
+		goto nla_put_failure;
+	if (options_set_msg_put_item(msg, option, data, data_len, nla_type))
+		goto nla_put_failure;
 	nla_nest_end(msg, option_list);
 
 	err = send_and_recv(th, msg, NULL, NULL);
@@ -870,3 +1251,944 @@ int team_set_option_value_s32(struct team_handle *th,
 	return set_option_value(th, option, &val, 0,
 				TEAM_OPTION_TYPE_S32);
 }
+
+static void option_req_complete(struct team_handle *th, struct team_req *req)
+{
+	const void *data;
+
+	if (req->err)
+		return;
+	switch (req->opt.type) {
+	case TEAM_OPTION_TYPE_STRING:
+	case TEAM_OPTION_TYPE_BINARY:
+		data = req->opt.data;
+		break;
+	default:
+		data = &req->opt.val;
+	}
+	local_set_option_value(th, &req->opt.id, req->opt.type,
+			       data, req->opt.data_len);
+}
+
+static void option_req_release(struct team_handle *th, struct team_req *req)
+{
+	option_name_put(th, req->opt.name);
+	free(req->opt.data);
+}
+
+static int set_option_value_async(struct team_handle *th,
+				  struct team_option *option,
+				  const void *data, int data_len, int opt_type,
+				  unsigned int timeout,
+				  team_req_done_func_t done, void *priv,
+				  uint32_t *req_id)
+{
+	struct team_req *req;
+	struct nl_msg *msg;
+	struct nlattr *option_list;
+	size_t size = 0;
+	int nla_type;
+	int err;
+
+	if (option->initialized && option->type != opt_type)
+		return -EINVAL;
+
+	nla_type = option_nla_type(opt_type);
+	if (nla_type < 0)
+		return nla_type;
+
+	req = team_req_get(th);
+	if (!req)
+		return -ENOMEM;
+	switch (opt_type) {
+	case TEAM_OPTION_TYPE_U32:
+		req->opt.val.u32 = *((__u32 *) data);
+		break;
+	case TEAM_OPTION_TYPE_STRING:
+		size = strlen(data) + 1;
+		break;
+	case TEAM_OPTION_TYPE_BINARY:
+		size = data_len;
+		break;
+	case TEAM_OPTION_TYPE_BOOL:
+		req->opt.val.bool_val = *((bool *) data);
+		break;
+	case TEAM_OPTION_TYPE_S32:
+		req->opt.val.s32 = *((__s32 *) data);
+		break;
+	}
+	if (size) {
+		req->opt.data = malloc(size);
+		if (!req->opt.data) {
+			team_req_put(th, req);
+			return -ENOMEM;
+		}
+		memcpy(req->opt.data, data, size);
+	}
+	/* Option itself may be gone by the time reply comes, keep its id */
+	req->opt.id = option->id;
+	req->opt.name = option->name;
+	option->name->refcount++;
+	req->opt.type = opt_type;
+	req->opt.data_len = data_len;
+	req->complete = option_req_complete;
+	req->release = option_req_release;
+	req->done = done;
+	req->done_priv = priv;
+
+	msg = team_req_msg_get(th);
+	option_list = options_set_msg_start(th, msg);
+	if (!option_list)
+		goto nla_put_failure;
+	if (options_set_msg_put_item(msg, option, data, data_len, nla_type))
+		goto nla_put_failure;
+	nla_nest_end(msg, option_list);
+
+	err = team_req_send(th, req, msg, timeout);
+	if (err)
+		return err;
+	if (req_id)
+		*req_id = req->id;
+	return 0;
+
+nla_put_failure:
+	nlmsg_free(msg);
+	team_req_put(th, req);
+	return -ENOBUFS;
+}
+
+/**
+ * team_set_option_value_u32_async:
+ * @th: libteam library context
+ * @option: option structure
+ * @val: value to be set
+ * @timeout: timeout in milliseconds, zero means no timeout
+ * @done: function to be called once request is finished, may be NULL
+ * @priv: private data passed to @done
+ * @req_id: where the request id will be stored, may be NULL
+ *
+ * Set 32-bit number type option without waiting for kernel reply. Local
+ * option value is updated once kernel acked the request, before @done
+ * is called.
+ *
+ * Returns: zero on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_set_option_value_u32_async(struct team_handle *th,
+				    struct team_option *option, uint32_t val,
+				    unsigned int timeout,
+				    team_req_done_func_t done, void *priv,
+				    uint32_t *req_id)
+{
+	return set_option_value_async(th, option, &val, 0,
+				      TEAM_OPTION_TYPE_U32,
+				      timeout, done, priv, req_id);
+}
+
+/**
+ * team_set_option_value_string_async:
+ * @th: libteam library context
+ * @option: option structure
+ * @str: string to be set
+ * @timeout: timeout in milliseconds, zero means no timeout
+ * @done: function to be called once request is finished, may be NULL
+ * @priv: private data passed to @done
+ * @req_id: where the request id will be stored, may be NULL
+ *
+ * Set string type option without waiting for kernel reply.
+ *
+ * Returns: zero on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_set_option_value_string_async(struct team_handle *th,
+				       struct team_option *option,
+				       const char *str, unsigned int timeout,
+				       team_req_done_func_t done, void *priv,
+				       uint32_t *req_id)
+{
+	return set_option_value_async(th, option, str, 0,
+				      TEAM_OPTION_TYPE_STRING,
+				      timeout, done, priv, req_id);
+}
+
+/**
+ * team_set_option_value_binary_async:
+ * @th: libteam library context
+ * @option: option structure
+ * @data: binary data to be set
+ * @data_len: binary data length
+ * @timeout: timeout in milliseconds, zero means no timeout
+ * @done: function to be called once request is finished, may be NULL
+ * @priv: private data passed to @done
+ * @req_id: where the request id will be stored, may be NULL
+ *
+ * Set binary type option without waiting for kernel reply.
+ *
+ * Returns: zero on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_set_option_value_binary_async(struct team_handle *th,
+				       struct team_option *option,
+				       const void *data,
+				       unsigned int data_len,
+				       unsigned int timeout,
+				       team_req_done_func_t done, void *priv,
+				       uint32_t *req_id)
+{
+	return set_option_value_async(th, option, data, data_len,
+				      TEAM_OPTION_TYPE_BINARY,
+				      timeout, done, priv, req_id);
+}
+
+/**
+ * team_set_option_value_bool_async:
+ * @th: libteam library context
+ * @option: option structure
+ * @val: value to be set
+ * @timeout: timeout in milliseconds, zero means no timeout
+ * @done: function to be called once request is finished, may be NULL
+ * @priv: private data passed to @done
+ * @req_id: where the request id will be stored, may be NULL
+ *
+ * Set bool type option without waiting for kernel reply.
+ *
+ * Returns: zero on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_set_option_value_bool_async(struct team_handle *th,
+				     struct team_option *option, bool val,
+				     unsigned int timeout,
+				     team_req_done_func_t done, void *priv,
+				     uint32_t *req_id)
+{
+	return set_option_value_async(th, option, &val, 0,
+				      TEAM_OPTION_TYPE_BOOL,
+				      timeout, done, priv, req_id);
+}
+
+/**
+ * team_set_option_value_s32_async:
+ * @th: libteam library context
+ * @option: option structure
+ * @val: value to be set
+ * @timeout: timeout in milliseconds, zero means no timeout
+ * @done: function to be called once request is finished, may be NULL
+ * @priv: private data passed to @done
+ * @req_id: where the request id will be stored, may be NULL
+ *
+ * Set 32-bit signed number type option without waiting for kernel reply.
+ *
+ * Returns: zero on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_set_option_value_s32_async(struct team_handle *th,
+				    struct team_option *option, int32_t val,
+				    unsigned int timeout,
+				    team_req_done_func_t done, void *priv,
+				    uint32_t *req_id)
+{
+	return set_option_value_async(th, option, &val, 0,
+				      TEAM_OPTION_TYPE_S32,
+				      timeout, done, priv, req_id);
+}
+
+/**
+ * SECTION: Option set transactions
+ * @short_description: setting many options in a few messages
+ *
+ * Values staged between team_option_txn_begin() and team_option_txn_commit()
+ * are packed into as few TEAM_CMD_OPTIONS_SET messages as fit. Local option
+ * values are updated only once kernel acked the message carrying them.
+ * There is at most one transaction per handle and its buffers are kept for
+ * the next one.
+ */
+
+struct team_option_txn_item {
+	struct team_option *	option;
+	int			opt_type;
+	int			nla_type;
+	union {
+		__u32		u32;
+		__s32		s32;
+		bool		bool_val;
+	} val;
+	size_t			buf_offset; /* string and binary */
+	int			data_len;
+	int			err;
+};
+
+static const void *txn_item_data(struct team_handle *th,
+				 struct team_option_txn_item *item)
+{
+	switch (item->opt_type) {
+	case TEAM_OPTION_TYPE_STRING:
+	case TEAM_OPTION_TYPE_BINARY:
+		return th->txn.buf + item->buf_offset;
+	default:
+		return &item->val;
+	}
+}
+
+static int txn_buf_put(struct team_handle *th, const void *data, size_t len,
+		       size_t *p_offset)
+{
+	if (th->txn.buf_len + len > th->txn.buf_size) {
+		size_t new_size = th->txn.buf_size ? th->txn.buf_size : 256;
+		char *new_buf;
+
+		while (new_size < th->txn.buf_len + len)
+			new_size *= 2;
+		new_buf = realloc(th->txn.buf, new_size);
+		if (!new_buf)
+			return -ENOMEM;
+		th->alloc_count++;
+		th->txn.buf = new_buf;
+		th->txn.buf_size = new_size;
+	}
+	memcpy(th->txn.buf + th->txn.buf_len, data, len);
+	*p_offset = th->txn.buf_len;
+	th->txn.buf_len += len;
+	return 0;
+}
+
+static int txn_stage(struct team_handle *th, struct team_option *option,
+		     const void *data, int data_len, int opt_type)
+{
+	struct team_option_txn_item *item;
+	int nla_type;
+	int err = 0;
+
+	if (!th->txn.active)
+		return -EINVAL;
+	if (option->initialized && option->type != opt_type)
+		return -EINVAL;
+	nla_type = option_nla_type(opt_type);
+	if (nla_type < 0)
+		return nla_type;
+
+	if (th->txn.count == th->txn.size) {
+		unsigned int new_size = th->txn.size ? th->txn.size * 2 : 16;
+		struct team_option_txn_item *new_items;
+
+		new_items = realloc(th->txn.items,
+				    new_size * sizeof(*new_items));
+		if (!new_items)
+			return -ENOMEM;
+		th->alloc_count++;
+		th->txn.items = new_items;
+		th->txn.size = new_size;
+	}
+	item = &th->txn.items[th->txn.count];
+	memset(item, 0, sizeof(*item));
+	item->option = option;
+	item->opt_type = opt_type;
+	item->nla_type = nla_type;
+	item->data_len = data_len;
+	switch (opt_type) {
+	case TEAM_OPTION_TYPE_U32:
+		item->val.u32 = *((__u32 *) data);
+		break;
+	case TEAM_OPTION_TYPE_STRING:
+		err = txn_buf_put(th, data, strlen(data) + 1,
+				  &item->buf_offset);
+		break;
+	case TEAM_OPTION_TYPE_BINARY:
+		err = txn_buf_put(th, data, data_len, &item->buf_offset);
+		break;
+	case TEAM_OPTION_TYPE_BOOL:
+		item->val.bool_val = *((bool *) data);
+		break;
+	case TEAM_OPTION_TYPE_S32:
+		item->val.s32 = *((__s32 *) data);
+		break;
+	}
+	if (err)
+		return err;
+	return th->txn.count++;
+}
+
+/* Sends as many items starting with first as fit into one message */
+static int txn_send_items(struct team_handle *th, unsigned int first,
+			  unsigned int limit, unsigned int *p_next)
+{
+	struct team_option_txn_item *item;
+	struct nlattr *option_list;
+	struct nl_msg *msg;
+	unsigned int i;
+
+	*p_next = first;
+	msg = team_req_msg_get(th);
+	option_list = options_set_msg_start(th, msg);
+	if (!option_list)
+		goto nla_put_failure;
+	for (i = first; i < limit; i++) {
+		item = &th->txn.items[i];
+		if (options_set_msg_put_item(msg, item->option,
+					     txn_item_data(th, item),
+					     item->data_len, item->nla_type))
+			break;
+	}
+	if (i == first)
+		goto nla_put_failure;
+	*p_next = i;
+	nla_nest_end(msg, option_list);
+	return send_and_recv(th, msg, NULL, NULL);
+
+nla_put_failure:
+	nlmsg_free(msg);
+	return -ENOBUFS;
+}
+
+static void txn_apply_item(struct team_handle *th,
+			   struct team_option_txn_item *item)
+{
+	struct team_option *option;
+
+	item->err = update_option(th, &option, &item->option->id,
+				  item->opt_type, txn_item_data(th, item),
+				  item->data_len, true, true);
+}
+
+static void txn_destroy_temporary_options(struct team_handle *th)
+{
+	struct team_option *option;
+	unsigned int i, j;
+
+	for (i = 0; i < th->txn.count; i++) {
+		option = th->txn.items[i].option;
+		if (!option || !option->temporary)
+			continue;
+		for (j = i; j < th->txn.count; j++)
+			if (th->txn.items[j].option == option)
+				th->txn.items[j].option = NULL;
+		destroy_option(th, option);
+	}
+}
+
+/**
+ * team_option_txn_begin:
+ * @th: libteam library context
+ *
+ * Start option set transaction.
+ *
+ * Returns: zero on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_option_txn_begin(struct team_handle *th)
+{
+	if (th->txn.active)
+		return -EBUSY;
+	th->txn.count = 0;
+	th->txn.buf_len = 0;
+	th->txn.active = true;
+	return 0;
+}
+
+/**
+ * team_option_txn_abort:
+ * @th: libteam library context
+ *
+ * Drop all values staged in transaction without sending them.
+ **/
+TEAM_EXPORT
+void team_option_txn_abort(struct team_handle *th)
+{
+	th->txn.count = 0;
+	th->txn.active = false;
+}
+
+/**
+ * team_option_txn_commit:
+ * @th: libteam library context
+ *
+ * Send all staged values and finish transaction. Result of each item can
+ * be obtained by team_option_txn_get_item_err() afterwards. Temporary
+ * options (those got with "!" in format) staged in transaction are freed.
+ *
+ * Returns: zero if all items were set, otherwise error of the first
+ *	    failed item.
+ **/
+TEAM_EXPORT
+int team_option_txn_commit(struct team_handle *th)
+{
+	unsigned int i = 0;
+	unsigned int next;
+	int err;
+
+	if (!th->txn.active)
+		return -EINVAL;
+	th->txn.active = false;
+
+	while (i < th->txn.count) {
+		err = txn_send_items(th, i, th->txn.count, &next);
+		if (!err) {
+			for (; i < next; i++)
+				txn_apply_item(th, &th->txn.items[i]);
+			continue;
+		}
+		if (next <= i + 1) {
+			/* Single item, either sent or too big for a message */
+			th->txn.items[i++].err = err;
+			continue;
+		}
+		/*
+		 * Kernel stops on the first failing item without saying
+		 * which one it was, items before it are already set. Resend
+		 * the items one by one to get per-item result, setting
+		 * the same value again does no harm.
+		 */
+		for (; i < next; i++) {
+			unsigned int tmp;
+
+			err = txn_send_items(th, i, i + 1, &tmp);
+			if (err)
+				th->txn.items[i].err = err;
+			else
+				txn_apply_item(th, &th->txn.items[i]);
+		}
+	}
+	txn_destroy_temporary_options(th);
+
+	for (i = 0; i < th->txn.count; i++)
+		if (th->txn.items[i].err)
+			return th->txn.items[i].err;
+	return 0;
+}
+
+/**
+ * team_option_txn_get_item_err:
+ * @th: libteam library context
+ * @index: item index as returned by team_option_txn_set_value_*()
+ *
+ * Get result of item of last committed transaction.
+ *
+ * Returns: zero if item was set, negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_option_txn_get_item_err(struct team_handle *th, unsigned int index)
+{
+	if (th->txn.active || index >= th->txn.count)
+		return -EINVAL;
+	return th->txn.items[index].err;
+}
+
+/**
+ * team_option_txn_set_value_u32:
+ * @th: libteam library context
+ * @option: option structure
+ * @val: value to be set
+ *
+ * Stage 32-bit number type option value in transaction.
+ *
+ * Returns: item index on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_option_txn_set_value_u32(struct team_handle *th,
+				  struct team_option *option, uint32_t val)
+{
+	return txn_stage(th, option, &val, 0, TEAM_OPTION_TYPE_U32);
+}
+
+/**
+ * team_option_txn_set_value_string:
+ * @th: libteam library context
+ * @option: option structure
+ * @str: string to be set
+ *
+ * Stage string type option value in transaction.
+ *
+ * Returns: item index on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_option_txn_set_value_string(struct team_handle *th,
+				     struct team_option *option,
+				     const char *str)
+{
+	return txn_stage(th, option, str, 0, TEAM_OPTION_TYPE_STRING);
+}
+
+/**
+ * team_option_txn_set_value_binary:
+ * @th: libteam library context
+ * @option: option structure
+ * @data: binary data to be set
+ * @data_len: binary data length
+ *
+ * Stage binary type option value in transaction.
+ *
+ * Returns: item index on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_option_txn_set_value_binary(struct team_handle *th,
+				     struct team_option *option,
+				     const void *data, unsigned int data_len)
+{
+	return txn_stage(th, option, data, data_len,
+			 TEAM_OPTION_TYPE_BINARY);
+}
+
+/**
+ * team_option_txn_set_value_bool:
+ * @th: libteam library context
+ * @option: option structure
+ * @val: value to be set
+ *
+ * Stage bool type option value in transaction.
+ *
+ * Returns: item index on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_option_txn_set_value_bool(struct team_handle *th,
+				   struct team_option *option, bool val)
+{
+	return txn_stage(th, option, &val, 0, TEAM_OPTION_TYPE_BOOL);
+}
+
+/**
+ * team_option_txn_set_value_s32:
+ * @th: libteam library context
+ * @option: option structure
+ * @val: value to be set
+ *
+ * Stage 32-bit signed number type option value in transaction.
+ *
+ * Returns: item index on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_option_txn_set_value_s32(struct team_handle *th,
+				  struct team_option *option, int32_t val)
+{
+	return txn_stage(th, option, &val, 0, TEAM_OPTION_TYPE_S32);
+}
+
+/**
+ * SECTION: Option handles
+ * @short_description: stable references to options
+ *
+ * Option handle is resolved once and then used instead of looking option
+ * up by team_get_option() over and over. It stays valid when options are
+ * refreshed. In case the option is removed, the handle is unbound until
+ * option with the same id appears again.
+ */
+
+/**
+ * team_option_handle_alloc:
+ * @th: libteam library context
+ * @fmt: format string, same as for team_get_option()
+ *
+ * Allocate handle for option referred by format string. Option does not
+ * have to exist at that time.
+ *
+ * Returns: pointer to option handle or NULL in case of an error.
+ **/
+TEAM_EXPORT
+struct team_option_handle *team_option_handle_alloc(struct team_handle *th,
+						    const char *fmt, ...)
+{
+	struct team_option_handle *handle;
+	struct team_option *option;
+	uint32_t name_hash;
+	va_list ap;
+
+	handle = myzalloc(sizeof(*handle));
+	if (!handle)
+		return NULL;
+	va_start(ap, fmt);
+	option_id_vparse(&handle->id, fmt, ap);
+	va_end(ap);
+	if (!handle->id.name)
+		goto err_out;
+
+	name_hash = hash_str(handle->id.name);
+	handle->name = option_name_get(th, handle->id.name, name_hash);
+	if (!handle->name)
+		goto err_out;
+	handle->id.name = handle->name->name;
+	list_init(&handle->list);
+	hash_table_add(&th->option_handle_table, &handle->hitem,
+		       option_id_hash(&handle->id, name_hash));
+
+	option = do_find_option(th, &handle->id);
+	if (option)
+		option_handle_bind(handle, option);
+	return handle;
+
+err_out:
+	free(handle);
+	return NULL;
+}
+
+/**
+ * team_option_handle_free:
+ * @th: libteam library context
+ * @handle: option handle
+ *
+ * Free option handle. Handles which are not freed explicitly are freed
+ * by team_free().
+ **/
+TEAM_EXPORT
+void team_option_handle_free(struct team_handle *th,
+			     struct team_option_handle *handle)
+{
+	list_del(&handle->list);
+	hash_table_del(&th->option_handle_table, &handle->hitem);
+	option_name_put(th, handle->name);
+	free(handle);
+}
+
+/**
+ * team_option_handle_get_option:
+ * @handle: option handle
+ *
+ * Get option the handle is bound to.
+ *
+ * Returns: pointer to option structure or NULL in case option does
+ *	    not exist.
+ **/
+TEAM_EXPORT
+struct team_option *
+team_option_handle_get_option(struct team_option_handle *handle)
+{
+	if (!handle->option || !handle->option->initialized)
+		return NULL;
+	return handle->option;
+}
+
+static struct team_option *option_handle_get_typed(
+					struct team_option_handle *handle,
+					enum team_option_type type, int *perr)
+{
+	struct team_option *option = team_option_handle_get_option(handle);
+
+	if (!option) {
+		*perr = -ENOENT;
+		return NULL;
+	}
+	if (option->type != type) {
+		*perr = -EINVAL;
+		return NULL;
+	}
+	return option;
+}
+
+/**
+ * team_option_handle_get_value_u32:
+ * @handle: option handle
+ * @val: where the value will be stored
+ *
+ * Get 32-bit number type option value.
+ *
+ * Returns: zero on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_option_handle_get_value_u32(struct team_option_handle *handle,
+				     uint32_t *val)
+{
+	struct team_option *option;
+	int err;
+
+	option = option_handle_get_typed(handle, TEAM_OPTION_TYPE_U32, &err);
+	if (!option)
+		return err;
+	*val = team_get_option_value_u32(option);
+	return 0;
+}
+
+/**
+ * team_option_handle_get_value_string:
+ * @handle: option handle
+ * @str: where the string pointer will be stored
+ *
+ * Get string type option value.
+ *
+ * Returns: zero on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_option_handle_get_value_string(struct team_option_handle *handle,
+					char **str)
+{
+	struct team_option *option;
+	int err;
+
+	option = option_handle_get_typed(handle, TEAM_OPTION_TYPE_STRING,
+					 &err);
+	if (!option)
+		return err;
+	*str = team_get_option_value_string(option);
+	return 0;
+}
+
+/**
+ * team_option_handle_get_value_binary:
+ * @handle: option handle
+ * @data: where the data pointer will be stored
+ * @data_len: where the data length will be stored
+ *
+ * Get binary type option value.
+ *
+ * Returns: zero on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_option_handle_get_value_binary(struct team_option_handle *handle,
+					void **data, unsigned int *data_len)
+{
+	struct team_option *option;
+	int err;
+
+	option = option_handle_get_typed(handle, TEAM_OPTION_TYPE_BINARY,
+					 &err);
+	if (!option)
+		return err;
+	*data = team_get_option_value_binary(option);
+	*data_len = team_get_option_value_len(option);
+	return 0;
+}
+
+/**
+ * team_option_handle_get_value_bool:
+ * @handle: option handle
+ * @val: where the value will be stored
+ *
+ * Get bool type option value.
+ *
+ * Returns: zero on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_option_handle_get_value_bool(struct team_option_handle *handle,
+				      bool *val)
+{
+	struct team_option *option;
+	int err;
+
+	option = option_handle_get_typed(handle, TEAM_OPTION_TYPE_BOOL, &err);
+	if (!option)
+		return err;
+	*val = team_get_option_value_bool(option);
+	return 0;
+}
+
+/**
+ * team_option_handle_get_value_s32:
+ * @handle: option handle
+ * @val: where the value will be stored
+ *
+ * Get 32-bit signed number type option value.
+ *
+ * Returns: zero on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_option_handle_get_value_s32(struct team_option_handle *handle,
+				     int32_t *val)
+{
+	struct team_option *option;
+	int err;
+
+	option = option_handle_get_typed(handle, TEAM_OPTION_TYPE_S32, &err);
+	if (!option)
+		return err;
+	*val = team_get_option_value_s32(option);
+	return 0;
+}
+
+/**
+ * team_option_handle_set_value_u32:
+ * @th: libteam library context
+ * @handle: option handle
+ * @val: value to be set
+ *
+ * Set 32-bit number type option.
+ *
+ * Returns: zero on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_option_handle_set_value_u32(struct team_handle *th,
+				     struct team_option_handle *handle,
+				     uint32_t val)
+{
+	if (!handle->option)
+		return -ENOENT;
+	return team_set_option_value_u32(th, handle->option, val);
+}
+
+/**
+ * team_option_handle_set_value_string:
+ * @th: libteam library context
+ * @handle: option handle
+ * @str: string to be set
+ *
+ * Set string type option.
+ *
+ * Returns: zero on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_option_handle_set_value_string(struct team_handle *th,
+					struct team_option_handle *handle,
+					const char *str)
+{
+	if (!handle->option)
+		return -ENOENT;
+	return team_set_option_value_string(th, handle->option, str);
+}
+
+/**
+ * team_option_handle_set_value_binary:
+ * @th: libteam library context
+ * @handle: option handle
+ * @data: binary data to be set
+ * @data_len: binary data length
+ *
+ * Set binary type option.
+ *
+ * Returns: zero on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_option_handle_set_value_binary(struct team_handle *th,
+					struct team_option_handle *handle,
+					const void *data,
+					unsigned int data_len)
+{
+	if (!handle->option)
+		return -ENOENT;
+	return team_set_option_value_binary(th, handle->option,
+					    data, data_len);
+}
+
+/**
+ * team_option_handle_set_value_bool:
+ * @th: libteam library context
+ * @handle: option handle
+ * @val: value to be set
+ *
+ * Set bool type option.
+ *
+ * Returns: zero on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_option_handle_set_value_bool(struct team_handle *th,
+				      struct team_option_handle *handle,
+				      bool val)
+{
+	if (!handle->option)
+		return -ENOENT;
+	return team_set_option_value_bool(th, handle->option, val);
+}
+
+/**
+ * team_option_handle_set_value_s32:
+ * @th: libteam library context
+ * @handle: option handle
+ * @val: value to be set
+ *
+ * Set 32-bit signed number type option.
+ *
+ * Returns: zero on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_option_handle_set_value_s32(struct team_handle *th,
+				     struct team_option_handle *handle,
+				     int32_t val)
+{
+	if (!handle->option)
+		return -ENOENT;
+	return team_set_option_value_s32(th, handle->option, val);
+}
@@ -34,12 +34,15 @@
 
 struct team_port {
 	struct list_item	list;
+	struct list_item	changed_list;
+	bool			in_changed_list;
 	uint32_t		ifindex;
 	uint32_t		speed;
 	uint8_t			duplex;
 	bool			linkup;
 	bool			changed;
 	bool			removed;
+	bool			resynced;
 	struct team_ifinfo *	ifinfo;
 };
 
@@ -49,7 +52,7 @@ static struct team_port *port_create(struct team_handle *th,
 	struct team_port *port;
 	int err;
 
-	port = myzalloc(sizeof(struct team_port));
+	port = pool_alloc(&th->port_pool);
 	if (!port) {
 		err(th, "Malloc failed.");
 		return NULL;
@@ -57,7 +60,7 @@ static struct team_port *port_create(struct team_handle *th,
 	err = ifinfo_link_with_port(th, ifindex, port, &port->ifinfo);
 	if (err) {
 		err(th, "Failed to link port with ifinfo.");
-		free(port);
+		pool_free(&th->port_pool, port);
 		return NULL;
 	}
 	port->ifindex = ifindex;
@@ -68,9 +71,11 @@ static struct team_port *port_create(struct team_handle *th,
 static void port_destroy(struct team_handle *th,
 			 struct team_port *port)
 {
+	if (port->in_changed_list)
+		list_del(&port->changed_list);
 	ifinfo_unlink(port->ifinfo);
 	list_del(&port->list);
-	free(port);
+	pool_free(&th->port_pool, port);
 }
 
 static void flush_port_list(struct team_handle *th)
@@ -81,12 +86,16 @@ static void flush_port_list(struct team_handle *th)
 		port_destroy(th, port);
 }
 
-static void port_list_cleanup_last_state(struct team_handle *th)
+/* Only ports reported by last event may be changed or removed */
+void port_list_cleanup_last_state(struct team_handle *th)
 {
 	struct team_port *port;
 	struct team_port *tmp;
 
-	list_for_each_node_entry_safe(port, tmp, &th->port_list, list) {
+	list_for_each_node_entry_safe(port, tmp, &th->port_changed_list,
+				      changed_list) {
+		list_del(&port->changed_list);
+		port->in_changed_list = false;
 		port->changed = false;
 		if (port->removed)
 			port_destroy(th, port);
@@ -130,6 +139,11 @@ int get_port_list_handler(struct nl_msg *msg, void *arg)
 	nla_for_each_nested(nl_port, attrs[TEAM_ATTR_LIST_PORT], i) {
 		struct team_port *port;
 		uint32_t ifindex;
+		bool created = false;
+		bool changed;
+		bool linkup;
+		uint32_t speed;
+		uint8_t duplex;
 
 		if (nla_parse_nested(port_attrs, TEAM_ATTR_PORT_MAX,
 				     nl_port, NULL)) {
@@ -148,48 +162,107 @@ int get_port_list_handler(struct nl_msg *msg, void *arg)
 			port = port_create(th, ifindex);
 			if (!port)
 				return NL_SKIP;
+			created = true;
 		}
-		port->changed = port_attrs[TEAM_ATTR_PORT_CHANGED] ? true : false;
-		port->linkup = port_attrs[TEAM_ATTR_PORT_LINKUP] ? true : false;
+		linkup = port_attrs[TEAM_ATTR_PORT_LINKUP] ? true : false;
+		speed = port_attrs[TEAM_ATTR_PORT_SPEED] ?
+			nla_get_u32(port_attrs[TEAM_ATTR_PORT_SPEED]) :
+			port->speed;
+		duplex = port_attrs[TEAM_ATTR_PORT_DUPLEX] ?
+			 nla_get_u8(port_attrs[TEAM_ATTR_PORT_DUPLEX]) :
+			 port->duplex;
+		/*
+		 * Dump does not flag anything, compare with last state and
+		 * keep changes of events processed during resync.
+		 */
+		changed = port_attrs[TEAM_ATTR_PORT_CHANGED] ? true : false;
+		if (th->resyncing)
+			changed |= created || port->changed ||
+				   port->linkup != linkup ||
+				   port->speed != speed || port->duplex != duplex;
+		port->changed = changed;
+		port->linkup = linkup;
+		port->speed = speed;
+		port->duplex = duplex;
 		port->removed = port_attrs[TEAM_ATTR_PORT_REMOVED] ? true : false;
-		if (port_attrs[TEAM_ATTR_PORT_SPEED])
-			port->speed = nla_get_u32(port_attrs[TEAM_ATTR_PORT_SPEED]);
-		if (port_attrs[TEAM_ATTR_PORT_DUPLEX])
-			port->duplex = nla_get_u8(port_attrs[TEAM_ATTR_PORT_DUPLEX]);
+		port->resynced = true;
+		if (!port->in_changed_list) {
+			list_add_tail(&th->port_changed_list,
+				      &port->changed_list);
+			port->in_changed_list = true;
+		}
 	}
 
 	set_call_change_handlers(th, TEAM_PORT_CHANGE);
 	return NL_SKIP;
 }
 
-static int get_port_list(struct team_handle *th)
+static int port_list_dump(struct team_handle *th)
 {
 	struct nl_msg *msg;
-	int err;
 
-	msg = nlmsg_alloc();
-	if (!msg)
-		return -ENOMEM;
+	msg = team_req_msg_get(th);
 
 	genlmsg_put(msg, NL_AUTO_PID, th->nl_sock_seq, th->family, 0, 0,
 			 TEAM_CMD_PORT_LIST_GET, 0);
 	NLA_PUT_U32(msg, TEAM_ATTR_TEAM_IFINDEX, th->ifindex);
 
+	return send_and_recv(th, msg, get_port_list_handler, th);
+
+nla_put_failure:
+	nlmsg_free(msg);
+	return -ENOBUFS;
+}
+
+static int get_port_list(struct team_handle *th)
+{
+	int err;
+
 	th->msg_recv_started = false;
-	err = send_and_recv(th, msg, get_port_list_handler, th);
+	err = port_list_dump(th);
 	if (err)
 		return err;
 
 	return check_call_change_handlers(th, TEAM_PORT_CHANGE);
+}
 
-nla_put_failure:
-	nlmsg_free(msg);
-	return -ENOBUFS;
+/*
+ * Used once port events may have been lost. Ports are dumped again and
+ * the ones which are gone are reported as removed. Change handlers are
+ * left for caller to call.
+ */
+int port_list_resync(struct team_handle *th)
+{
+	struct team_port *port;
+	int err;
+
+	list_for_each_node_entry(port, &th->port_list, list)
+		port->resynced = false;
+
+	err = port_list_dump(th);
+	if (err)
+		return err;
+
+	list_for_each_node_entry(port, &th->port_list, list) {
+		if (port->resynced)
+			continue;
+		port->changed = true;
+		port->removed = true;
+		if (!port->in_changed_list) {
+			list_add_tail(&th->port_changed_list,
+				      &port->changed_list);
+			port->in_changed_list = true;
+		}
+	}
+	set_call_change_handlers(th, TEAM_PORT_CHANGE);
+	return 0;
 }
 
 int port_list_alloc(struct team_handle *th)
 {
 	list_init(&th->port_list);
+	list_init(&th->port_changed_list);
+	pool_init(&th->port_pool, sizeof(struct team_port));
 
 	return 0;
 }
@@ -209,6 +282,36 @@ int port_list_init(struct team_handle *th)
 void port_list_free(struct team_handle *th)
 {
 	flush_port_list(th);
+	pool_fini(&th->port_pool);
+}
+
+/* Has to be called after ifinfo_list_snapshot() so ports get their ifinfo */
+int port_list_snapshot(struct team_handle *th, struct team_snapshot *snap)
+{
+	struct team_port *port;
+	struct team_port *copy;
+
+	list_for_each_node_entry(port, &th->port_list, list) {
+		if (port->removed)
+			continue;
+		copy = malloc(sizeof(*copy));
+		if (!copy)
+			return -ENOMEM;
+		memcpy(copy, port, sizeof(*copy));
+		copy->in_changed_list = false;
+		copy->ifinfo = ifinfo_snapshot_link_port(snap, port->ifindex,
+							 copy);
+		list_add_tail(&snap->port_list, &copy->list);
+	}
+	return 0;
+}
+
+void port_snapshot_free(struct team_snapshot *snap)
+{
+	struct team_port *copy, *tmp;
+
+	list_for_each_node_entry_safe(copy, tmp, &snap->port_list, list)
+		free(copy);
 }
 
 /**
@@ -227,6 +330,41 @@ struct team_port *team_get_next_port(struct team_handle *th,
 	return list_get_next_node_entry(&th->port_list, port, list);
 }
 
+/**
+ * team_snapshot_get_next_port:
+ * @snap: libteam snapshot
+ * @port: port structure
+ *
+ * Get next port in snapshot.
+ *
+ * Returns: port next to @port passed.
+ **/
+TEAM_EXPORT
+struct team_port *team_snapshot_get_next_port(struct team_snapshot *snap,
+					      struct team_port *port)
+{
+	return list_get_next_node_entry(&snap->port_list, port, list);
+}
+
+/**
+ * team_get_next_changed_port:
+ * @th: libteam library context
+ * @port: port structure
+ *
+ * Get next port reported by last processed event. Those are new ports
+ * and ports which got changed or removed. Unlike team_get_next_port()
+ * this does not walk ports which stayed the same.
+ *
+ * Returns: changed port next to @port passed.
+ **/
+TEAM_EXPORT
+struct team_port *team_get_next_changed_port(struct team_handle *th,
+					     struct team_port *port)
+{
+	return list_get_next_node_entry(&th->port_changed_list, port,
+					changed_list);
+}
+
 /**
  * team_get_port_ifindex:
  * @port: port structure
@@ -325,6 +463,20 @@ struct team_ifinfo *team_get_port_ifinfo(struct team_port *port)
 	return port->ifinfo;
 }
 
+/**
+ * team_get_port_stats:
+ * @port: port structure
+ *
+ * Get port traffic counters as of last team_refresh_stats().
+ *
+ * Returns: pointer to counters.
+ **/
+TEAM_EXPORT
+const struct team_link_stats *team_get_port_stats(struct team_port *port)
+{
+	return team_get_ifinfo_stats(port->ifinfo);
+}
+
 /**
  * team_is_port_present:
  * @th: libteam library context
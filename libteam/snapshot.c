@@ -0,0 +1,207 @@
+/*
+ *   snapshot.c - Immutable state snapshots for other threads
+ *   Copyright (C) 2026 agent <agent@local>
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <pthread.h>
+#include <team.h>
+#include <private/list.h>
+#include <private/misc.h>
+#include "team_private.h"
+
+/**
+ * SECTION: snapshot
+ * @short_description: Snapshots readable from other threads
+ *
+ * Library context itself is not thread safe, it has to be used by the
+ * thread processing its events only. Other threads may read its state
+ * through snapshots. Snapshot is rebuilt by the event processing thread
+ * after each batch of changes, right before change handlers are called,
+ * and published by swapping a pointer. Readers take a reference to the
+ * current snapshot and never wait for event processing, the snapshot
+ * they hold does not change until they put it.
+ *
+ * Ports, options and ifinfos of snapshot are read by the usual getters,
+ * like team_get_port_ifindex() or team_get_option_value_u32(). They must
+ * not be passed to functions taking library context.
+ */
+
+static void snapshot_free(struct team_snapshot *snap)
+{
+	port_snapshot_free(snap);
+	option_snapshot_free(snap);
+	ifinfo_snapshot_free(snap);
+	free(snap);
+}
+
+static struct team_snapshot *snapshot_build(struct team_handle *th)
+{
+	struct team_snapshot *snap;
+	int err;
+
+	snap = myzalloc(sizeof(*snap));
+	if (!snap)
+		return NULL;
+	snap->refcount = 1;
+	snap->generation = ++th->snapshot.generation;
+	list_init(&snap->port_list);
+	list_init(&snap->option_list);
+	list_init(&snap->ifinfo_list);
+
+	/* Ports link to already copied ifinfos */
+	err = ifinfo_list_snapshot(th, snap);
+	if (!err)
+		err = port_list_snapshot(th, snap);
+	if (!err)
+		err = option_list_snapshot(th, snap);
+	if (err) {
+		snapshot_free(snap);
+		return NULL;
+	}
+	return snap;
+}
+
+static void snapshot_publish(struct team_handle *th,
+			     struct team_snapshot *snap)
+{
+	struct team_snapshot *old;
+
+	pthread_mutex_lock(&th->snapshot.lock);
+	old = th->snapshot.cur;
+	th->snapshot.cur = snap;
+	pthread_mutex_unlock(&th->snapshot.lock);
+	if (old)
+		team_snapshot_put(old);
+}
+
+void snapshot_update(struct team_handle *th)
+{
+	struct team_snapshot *snap;
+
+	if (!th->snapshot.enabled)
+		return;
+	snap = snapshot_build(th);
+	if (!snap) {
+		/* Readers keep getting the previous one */
+		err(th, "Failed to build snapshot.");
+		return;
+	}
+	snapshot_publish(th, snap);
+}
+
+void snapshot_fini(struct team_handle *th)
+{
+	snapshot_publish(th, NULL);
+	pthread_mutex_destroy(&th->snapshot.lock);
+}
+
+/**
+ * team_snapshot_enable:
+ * @th: libteam library context
+ *
+ * Start building snapshots. Has to be called from thread processing
+ * events. In case context is initialized already, the first snapshot
+ * is built right away.
+ *
+ * Returns: zero on success or negative number in case of an error.
+ **/
+TEAM_EXPORT
+int team_snapshot_enable(struct team_handle *th)
+{
+	struct team_snapshot *snap;
+
+	if (th->snapshot.enabled)
+		return 0;
+	th->snapshot.enabled = true;
+	if (!th->ifindex)
+		return 0;
+	snap = snapshot_build(th);
+	if (!snap) {
+		th->snapshot.enabled = false;
+		return -ENOMEM;
+	}
+	snapshot_publish(th, snap);
+	return 0;
+}
+
+/**
+ * team_snapshot_disable:
+ * @th: libteam library context
+ *
+ * Stop building snapshots. Has to be called from thread processing
+ * events. Snapshots held by readers stay valid until they are put.
+ **/
+TEAM_EXPORT
+void team_snapshot_disable(struct team_handle *th)
+{
+	th->snapshot.enabled = false;
+	snapshot_publish(th, NULL);
+}
+
+/**
+ * team_snapshot_get:
+ * @th: libteam library context
+ *
+ * Get reference to current snapshot. May be called from any thread.
+ *
+ * Returns: snapshot which has to be put by team_snapshot_put() or NULL
+ *	    in case none was built yet.
+ **/
+TEAM_EXPORT
+struct team_snapshot *team_snapshot_get(struct team_handle *th)
+{
+	struct team_snapshot *snap;
+
+	pthread_mutex_lock(&th->snapshot.lock);
+	snap = th->snapshot.cur;
+	if (snap)
+		__atomic_add_fetch(&snap->refcount, 1, __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&th->snapshot.lock);
+	return snap;
+}
+
+/**
+ * team_snapshot_put:
+ * @snap: libteam snapshot
+ *
+ * Put reference to snapshot. May be called from any thread.
+ **/
+TEAM_EXPORT
+void team_snapshot_put(struct team_snapshot *snap)
+{
+	if (!__atomic_sub_fetch(&snap->refcount, 1, __ATOMIC_ACQ_REL))
+		snapshot_free(snap);
+}
+
+/**
+ * team_snapshot_get_generation:
+ * @snap: libteam snapshot
+ *
+ * Get snapshot generation. Snapshots built later have higher generation,
+ * so reader can easily see nothing changed since last time.
+ *
+ * Returns: snapshot generation.
+ **/
+TEAM_EXPORT
+uint64_t team_snapshot_get_generation(struct team_snapshot *snap)
+{
+	return snap->generation;
+}
@@ -30,15 +30,11 @@
 
 static char *__get_port_ifname(struct team_handle *th, uint32_t port_ifindex)
 {
-	struct team_port *port;
+	struct team_ifinfo *ifinfo = ifinfo_find(th, port_ifindex);
 
-	team_for_each_port(port, th) {
-		struct team_ifinfo *ifinfo = team_get_port_ifinfo(port);
-
-		if (port_ifindex == team_get_port_ifindex(port))
-			return team_get_ifinfo_ifname(ifinfo);
-	}
-	return NULL;
+	if (!ifinfo || !team_get_ifinfo_port(ifinfo))
+		return NULL;
+	return team_get_ifinfo_ifname(ifinfo);
 }
 
 static bool __buf_append(char **pbuf, size_t *pbufsiz, const char *fmt, ...)
@@ -0,0 +1,282 @@
+/*
+ *   team_event_bench.c - Event throughput benchmark against team emulator
+ *   Copyright (C) 2026 agent <agent@local>
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Runs team emulator in-process and measures how fast library context
+ * initializes and processes option and port event storms. Storm is sent
+ * by separate thread, so events which do not fit receive buffer get
+ * dropped and resynced like with kernel. Output is one "key=value" record
+ * per line. Needs no privileges nor team kernel module.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <team.h>
+#include <private/bench.h>
+
+#define BENCH_DEFAULT_PORTS 4
+#define BENCH_DEFAULT_OPTIONS 512
+#define BENCH_DEFAULT_EVENTS 100000
+#define BENCH_ROUNDS 20
+#define BENCH_TIMEOUT 10000 /* ms */
+#define BENCH_TEAM_NAME "bench_team0"
+/* Core option set at the end of storm so its last event is recognized */
+#define BENCH_MARK_OPTION "notify_peers_count"
+
+struct bench {
+	struct team_emul *	emul;
+	uint32_t		ifindex;
+	uint32_t *		port_ifindexes;
+	unsigned int		port_count;
+	unsigned int		option_count;
+	unsigned int		event_count;
+	uint32_t		mark;
+	bool			port_storm;
+	int			err;
+};
+
+/* Allocs are the ones libteam did for options and ports during the run */
+static void bench_report(const char *name, struct bench *bench,
+			 uint64_t ops, uint64_t elapsed,
+			 struct team_handle *th, uint64_t drop_count,
+			 uint64_t alloc_count)
+{
+	bench_record(name, ops, elapsed, "ports=%u options=%u drops=%" PRIu64
+		     " overruns=%" PRIu64 " resyncs=%" PRIu64
+		     " allocs=%" PRIu64, bench->port_count,
+		     bench->option_count, drop_count,
+		     th ? team_get_overrun_count(th) : 0,
+		     th ? team_get_resync_count(th) : 0, alloc_count);
+}
+
+static int bench_setup(struct bench *bench)
+{
+	char ifname[16];
+	unsigned int i;
+	int err;
+
+	bench->emul = team_emul_alloc();
+	if (!bench->emul)
+		return -ENOMEM;
+	err = team_emul_link_add(bench->emul, BENCH_TEAM_NAME, "team",
+				 &bench->ifindex);
+	if (err)
+		return err;
+	bench->port_ifindexes = calloc(bench->port_count, sizeof(uint32_t));
+	if (!bench->port_ifindexes)
+		return -ENOMEM;
+	for (i = 0; i < bench->port_count; i++) {
+		snprintf(ifname, sizeof(ifname), "bench%u", i);
+		err = team_emul_link_add(bench->emul, ifname, "dummy",
+					 &bench->port_ifindexes[i]);
+		if (!err)
+			err = team_emul_port_add(bench->emul, bench->ifindex,
+						 bench->port_ifindexes[i]);
+		if (err)
+			return err;
+	}
+	err = team_emul_option_add(bench->emul, bench->ifindex,
+				   "bench_option", bench->option_count);
+	if (err)
+		return err;
+	return team_emul_start(bench->emul);
+}
+
+static struct team_handle *bench_team_init(struct bench *bench, int *p_err)
+{
+	struct team_handle *th;
+	int err;
+
+	th = team_alloc();
+	if (!th) {
+		*p_err = -ENOMEM;
+		return NULL;
+	}
+	err = team_set_emul_port(th, team_emul_get_port(bench->emul));
+	if (!err)
+		err = team_init(th, bench->ifindex);
+	if (err) {
+		team_free(th);
+		*p_err = err;
+		return NULL;
+	}
+	return th;
+}
+
+static int bench_init(struct bench *bench)
+{
+	struct team_handle *th;
+	uint64_t alloc_count = 0;
+	uint64_t elapsed = 0;
+	uint64_t start;
+	unsigned int i;
+	int err;
+
+	for (i = 0; i < BENCH_ROUNDS; i++) {
+		start = bench_now();
+		th = bench_team_init(bench, &err);
+		elapsed += bench_now() - start;
+		if (!th)
+			return err;
+		alloc_count += team_get_alloc_count(th);
+		team_free(th);
+	}
+	bench_report("team_init", bench, BENCH_ROUNDS, elapsed, NULL, 0,
+		     alloc_count / BENCH_ROUNDS);
+	return 0;
+}
+
+static void *bench_storm_thread(void *arg)
+{
+	struct bench *bench = arg;
+	uint32_t port_ifindex;
+	unsigned int i;
+	int err = 0;
+
+	if (bench->port_storm) {
+		for (i = 0; i < bench->event_count && !err; i++) {
+			port_ifindex = bench->port_ifindexes[(i / 2) %
+							     bench->port_count];
+			err = team_emul_link_set_carrier(bench->emul,
+							 port_ifindex, i % 2);
+		}
+	} else {
+		err = team_emul_option_storm(bench->emul, bench->ifindex,
+					     bench->event_count);
+	}
+	if (!err)
+		err = team_emul_option_set_u32(bench->emul, bench->ifindex,
+					       BENCH_MARK_OPTION, bench->mark);
+	bench->err = err;
+	return NULL;
+}
+
+static int bench_mark_get(struct team_handle *th, uint32_t *mark)
+{
+	struct team_option *option;
+
+	option = team_get_option(th, "n", BENCH_MARK_OPTION);
+	if (!option)
+		return -ENOENT;
+	*mark = team_get_option_value_u32(option);
+	return 0;
+}
+
+/* Events are processed until the mark set after storm shows up */
+static int bench_storm(struct bench *bench, const char *name, bool port_storm)
+{
+	struct team_handle *th;
+	struct pollfd pfd;
+	pthread_t thread;
+	uint64_t alloc_count;
+	uint64_t drop_count;
+	uint64_t elapsed;
+	uint64_t start;
+	uint32_t mark = 0;
+	int err;
+	int ret;
+
+	th = bench_team_init(bench, &err);
+	if (!th)
+		return err;
+	bench->mark++;
+	bench->port_storm = port_storm;
+	bench->err = 0;
+	drop_count = team_emul_get_drop_count(bench->emul);
+	alloc_count = team_get_alloc_count(th);
+	pfd.fd = team_get_event_fd(th);
+	pfd.events = POLLIN;
+
+	start = bench_now();
+	err = pthread_create(&thread, NULL, bench_storm_thread, bench);
+	if (err) {
+		team_free(th);
+		return -err;
+	}
+	while (!err && mark != bench->mark) {
+		ret = poll(&pfd, 1, BENCH_TIMEOUT);
+		if (ret == -1 && errno == EINTR)
+			continue;
+		if (ret <= 0) {
+			err = ret ? -errno : -ETIMEDOUT;
+			break;
+		}
+		err = team_handle_events(th);
+		if (!err)
+			err = bench_mark_get(th, &mark);
+	}
+	elapsed = bench_now() - start;
+	pthread_join(thread, NULL);
+	if (!err)
+		err = bench->err;
+	if (!err)
+		bench_report(name, bench, bench->event_count, elapsed, th,
+			     team_emul_get_drop_count(bench->emul) -
+			     drop_count,
+			     team_get_alloc_count(th) - alloc_count);
+	team_free(th);
+	return err;
+}
+
+int main(int argc, char **argv)
+{
+	struct bench bench = {
+		.port_count = BENCH_DEFAULT_PORTS,
+		.option_count = BENCH_DEFAULT_OPTIONS,
+		.event_count = BENCH_DEFAULT_EVENTS,
+	};
+	int err;
+
+	if (argc > 1)
+		bench.port_count = strtoul(argv[1], NULL, 10);
+	if (argc > 2)
+		bench.option_count = strtoul(argv[2], NULL, 10);
+	if (argc > 3)
+		bench.event_count = strtoul(argv[3], NULL, 10);
+	if (!bench.port_count || !bench.option_count || !bench.event_count) {
+		fprintf(stderr, "Usage: %s [PORT_COUNT [OPTION_COUNT [EVENT_COUNT]]]\n",
+			argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	err = bench_setup(&bench);
+	if (err) {
+		fprintf(stderr, "Failed to set up emulator (%d)\n", err);
+		return EXIT_FAILURE;
+	}
+	err = bench_init(&bench);
+	if (!err)
+		err = bench_storm(&bench, "option_events", false);
+	if (!err)
+		err = bench_storm(&bench, "port_events", true);
+	if (err) {
+		fprintf(stderr, "Benchmark failed (%d)\n", err);
+		return EXIT_FAILURE;
+	}
+
+	team_emul_free(bench.emul);
+	free(bench.port_ifindexes);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,240 @@
+/*
+ *   team_init_bench.c - Startup benchmark on host with many links
+ *   Copyright (C) 2026 agent <agent@local>
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Creates a team device with few ports among many dummy links in a new
+ * network namespace and measures team_init() there. The full link dump
+ * team_init() used to do is measured alongside the port dump it does now.
+ * Output is one "key=value" record per line. Needs CAP_SYS_ADMIN and
+ * team and dummy kernel modules.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <sched.h>
+#include <netlink/netlink.h>
+#include <netlink/route/link.h>
+#include <linux/rtnetlink.h>
+#include <linux/if.h>
+#include <team.h>
+#include <private/bench.h>
+
+#define BENCH_DEFAULT_LINKS 4000
+#define BENCH_DEFAULT_PORTS 4
+#define BENCH_ROUNDS 20
+#define BENCH_TEAM_NAME "bench_team0"
+
+static void bench_report(const char *name, unsigned int link_count,
+			 unsigned int port_count, uint64_t ops,
+			 uint64_t elapsed, unsigned int msg_count)
+{
+	bench_record(name, ops, elapsed, "links=%u ports=%u msgs_per_op=%u",
+		     link_count, port_count, msg_count);
+}
+
+static int bench_links_create(struct nl_sock *sock, unsigned int count)
+{
+	struct rtnl_link *link;
+	char ifname[IFNAMSIZ];
+	unsigned int i;
+	int err = 0;
+
+	link = rtnl_link_alloc();
+	if (!link)
+		return -NLE_NOMEM;
+	err = rtnl_link_set_type(link, "dummy");
+	if (err)
+		goto out;
+	for (i = 0; i < count; i++) {
+		snprintf(ifname, sizeof(ifname), "bench%u", i);
+		rtnl_link_set_name(link, ifname);
+		err = rtnl_link_add(sock, link, NLM_F_CREATE | NLM_F_EXCL);
+		if (err)
+			break;
+	}
+out:
+	rtnl_link_put(link);
+	return err;
+}
+
+static int bench_dump_valid(struct nl_msg *msg, void *arg)
+{
+	unsigned int *msg_count = arg;
+
+	(*msg_count)++;
+	return NL_OK;
+}
+
+static int bench_dump(struct nl_sock *sock, uint32_t master_ifindex,
+		      unsigned int *msg_count)
+{
+	struct nl_msg *msg;
+	struct ifinfomsg ifi = {
+		.ifi_family = AF_UNSPEC,
+	};
+	int err;
+
+	msg = nlmsg_alloc_simple(RTM_GETLINK, NLM_F_DUMP);
+	if (!msg)
+		return -NLE_NOMEM;
+	err = nlmsg_append(msg, &ifi, sizeof(ifi), NLMSG_ALIGNTO);
+	if (!err && master_ifindex)
+		err = nla_put_u32(msg, IFLA_MASTER, master_ifindex);
+	if (!err)
+		err = nl_send_auto(sock, msg);
+	nlmsg_free(msg);
+	if (err < 0)
+		return err;
+	*msg_count = 0;
+	nl_socket_modify_cb(sock, NL_CB_VALID, NL_CB_CUSTOM,
+			    bench_dump_valid, msg_count);
+	return nl_recvmsgs_default(sock);
+}
+
+static int bench_link_dump(struct nl_sock *sock, const char *name,
+			   uint32_t master_ifindex, unsigned int link_count,
+			   unsigned int port_count)
+{
+	unsigned int msg_count = 0;
+	uint64_t start;
+	unsigned int i;
+	int err;
+
+	start = bench_now();
+	for (i = 0; i < BENCH_ROUNDS; i++) {
+		err = bench_dump(sock, master_ifindex, &msg_count);
+		if (err < 0)
+			return err;
+	}
+	bench_report(name, link_count, port_count, BENCH_ROUNDS,
+		     bench_now() - start, msg_count);
+	return 0;
+}
+
+static int bench_team_init(uint32_t ifindex, unsigned int link_count,
+			   unsigned int port_count)
+{
+	struct team_handle *th;
+	uint64_t elapsed = 0;
+	uint64_t start;
+	unsigned int i;
+	int err;
+
+	for (i = 0; i < BENCH_ROUNDS; i++) {
+		th = team_alloc();
+		if (!th)
+			return -ENOMEM;
+		start = bench_now();
+		err = team_init(th, ifindex);
+		elapsed += bench_now() - start;
+		team_free(th);
+		if (err)
+			return err;
+	}
+	bench_report("team_init", link_count, port_count, BENCH_ROUNDS,
+		     elapsed, 0);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int link_count = BENCH_DEFAULT_LINKS;
+	unsigned int port_count = BENCH_DEFAULT_PORTS;
+	struct team_handle *th;
+	struct nl_sock *sock;
+	uint32_t port_ifindex;
+	uint32_t ifindex;
+	char ifname[IFNAMSIZ];
+	unsigned int i;
+	int err;
+
+	if (argc > 1)
+		link_count = strtoul(argv[1], NULL, 10);
+	if (argc > 2)
+		port_count = strtoul(argv[2], NULL, 10);
+	if (!link_count || port_count > link_count) {
+		fprintf(stderr, "Usage: %s [LINK_COUNT [PORT_COUNT]]\n",
+			argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	if (unshare(CLONE_NEWNET)) {
+		perror("Failed to create network namespace");
+		return EXIT_FAILURE;
+	}
+
+	sock = nl_socket_alloc();
+	if (!sock)
+		return EXIT_FAILURE;
+	err = nl_connect(sock, NETLINK_ROUTE);
+	if (!err)
+		err = bench_links_create(sock, link_count);
+	if (err) {
+		fprintf(stderr, "Failed to create links (%s)\n",
+			nl_geterror(err));
+		return EXIT_FAILURE;
+	}
+
+	th = team_alloc();
+	if (!th)
+		return EXIT_FAILURE;
+	err = team_create(th, BENCH_TEAM_NAME);
+	if (err) {
+		fprintf(stderr, "Failed to create team device (%d)\n", err);
+		return EXIT_FAILURE;
+	}
+	ifindex = team_ifname2ifindex(th, BENCH_TEAM_NAME);
+	err = team_init(th, ifindex);
+	if (err) {
+		fprintf(stderr, "Failed to init team device (%d)\n", err);
+		return EXIT_FAILURE;
+	}
+	for (i = 0; i < port_count; i++) {
+		snprintf(ifname, sizeof(ifname), "bench%u", i);
+		port_ifindex = team_ifname2ifindex(th, ifname);
+		err = team_port_add(th, port_ifindex);
+		if (err) {
+			fprintf(stderr, "Failed to add port (%d)\n", err);
+			return EXIT_FAILURE;
+		}
+	}
+
+	err = bench_link_dump(sock, "link_dump_full", 0,
+			      link_count, port_count);
+	if (!err)
+		err = bench_link_dump(sock, "link_dump_ports", ifindex,
+				      link_count, port_count);
+	if (err) {
+		fprintf(stderr, "Failed to dump links (%s)\n",
+			nl_geterror(err));
+		return EXIT_FAILURE;
+	}
+	err = bench_team_init(ifindex, link_count, port_count);
+	if (err) {
+		fprintf(stderr, "Benchmark failed (%d)\n", err);
+		return EXIT_FAILURE;
+	}
+
+	team_free(th);
+	nl_socket_free(sock);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,404 @@
+/*
+ *   team_option_bench.c - Option list micro-benchmarks
+ *   Copyright (C) 2026 agent <agent@local>
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Built together with library sources so option dump messages can be fed
+ * straight to get_options_handler() without any socket in between. Dump
+ * resembles loadbalance team: core options, per-port options, 256 item
+ * hash mapping and stats arrays, filled up to requested option count.
+ * Output is one "key=value" record per line.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <netlink/netlink.h>
+#include <netlink/genl/genl.h>
+#include <linux/if_team.h>
+#include <team.h>
+#include <private/misc.h>
+#include <private/bench.h>
+#include "team_private.h"
+
+#define BENCH_DEFAULT_PORTS 4
+#define BENCH_DEFAULT_OPTIONS 600
+#define BENCH_DEFAULT_ROUNDS 2000
+#define BENCH_TEAM_IFINDEX 100
+#define BENCH_PORT_IFINDEX_BASE 101
+#define BENCH_HASH_COUNT 256
+#define BENCH_BPF_SIZE 400
+#define BENCH_MSG_SIZE (256 * 1024)
+#define BENCH_HANDLERS_MAX 64
+
+struct bench {
+	struct team_handle *	th;
+	unsigned int		port_count;
+	unsigned int		option_count;
+	unsigned int		rounds;
+	struct nl_msg *		dump_msgs[2];
+	struct nl_msg *		stats_msgs[2];
+};
+
+static void bench_report(const char *name, struct bench *bench,
+			 unsigned int handler_count, uint64_t ops,
+			 uint64_t elapsed, uint64_t alloc_count)
+{
+	bench_record(name, ops, elapsed,
+		     "ports=%u options=%u handlers=%u allocs=%" PRIu64,
+		     bench->port_count, bench->option_count, handler_count,
+		     alloc_count);
+}
+
+struct bench_option {
+	const char *	name;
+	int		type;
+	uint32_t	u32;
+	const void *	data;
+	int		data_len;
+	bool		changed;
+	bool		per_port;
+	uint32_t	port_ifindex;
+	bool		array;
+	uint32_t	array_index;
+};
+
+static int bench_option_put(struct nl_msg *msg, struct bench_option *option,
+			    unsigned int *p_count)
+{
+	struct nlattr *option_item;
+
+	option_item = nla_nest_start(msg, TEAM_ATTR_ITEM_OPTION);
+	if (!option_item)
+		goto nla_put_failure;
+	NLA_PUT_STRING(msg, TEAM_ATTR_OPTION_NAME, option->name);
+	if (option->changed)
+		NLA_PUT_FLAG(msg, TEAM_ATTR_OPTION_CHANGED);
+	NLA_PUT_U8(msg, TEAM_ATTR_OPTION_TYPE, option->type);
+	switch (option->type) {
+	case NLA_U32:
+	case NLA_S32:
+		NLA_PUT_U32(msg, TEAM_ATTR_OPTION_DATA, option->u32);
+		break;
+	case NLA_STRING:
+		NLA_PUT_STRING(msg, TEAM_ATTR_OPTION_DATA, option->data);
+		break;
+	case NLA_BINARY:
+		NLA_PUT(msg, TEAM_ATTR_OPTION_DATA, option->data_len,
+			option->data);
+		break;
+	case NLA_FLAG:
+		if (option->u32)
+			NLA_PUT_FLAG(msg, TEAM_ATTR_OPTION_DATA);
+		break;
+	}
+	if (option->per_port)
+		NLA_PUT_U32(msg, TEAM_ATTR_OPTION_PORT_IFINDEX,
+			    option->port_ifindex);
+	if (option->array)
+		NLA_PUT_U32(msg, TEAM_ATTR_OPTION_ARRAY_INDEX,
+			    option->array_index);
+	nla_nest_end(msg, option_item);
+	(*p_count)++;
+	return 0;
+
+nla_put_failure:
+	return -ENOBUFS;
+}
+
+static const char *bench_core_u32_options[] = {
+	"notify_peers_count", "notify_peers_interval",
+	"mcast_rejoin_count", "mcast_rejoin_interval",
+	"lb_stats_refresh_interval",
+};
+
+static const char *bench_port_flag_options[] = {
+	"enabled", "user_linkup", "user_linkup_enabled",
+};
+
+/*
+ * Full dump when stats_only is false, otherwise event as sent by stats
+ * refresh with only stats options flagged changed. Seed varies values.
+ */
+static struct nl_msg *bench_msg_build(struct bench *bench, bool stats_only,
+				      uint32_t seed)
+{
+	static const char bpf_hash_func[BENCH_BPF_SIZE];
+	struct bench_option option;
+	struct nlattr *list;
+	struct nl_msg *msg;
+	uint64_t stats;
+	unsigned int count = 0;
+	unsigned int i;
+	unsigned int j;
+
+	msg = nlmsg_alloc_size(BENCH_MSG_SIZE);
+	if (!msg)
+		return NULL;
+	genlmsg_put(msg, NL_AUTO_PORT, NL_AUTO_SEQ, 0, 0, 0,
+		    TEAM_CMD_OPTIONS_GET, TEAM_GENL_VERSION);
+	NLA_PUT_U32(msg, TEAM_ATTR_TEAM_IFINDEX, BENCH_TEAM_IFINDEX);
+	list = nla_nest_start(msg, TEAM_ATTR_LIST_OPTION);
+	if (!list)
+		goto nla_put_failure;
+
+#define BENCH_OPTION_PUT(...)						\
+	do {								\
+		option = (struct bench_option) { __VA_ARGS__ };	\
+		if (bench_option_put(msg, &option, &count))		\
+			goto nla_put_failure;				\
+	} while (0)
+
+	for (i = 0; i < bench->port_count; i++) {
+		stats = seed + i;
+		BENCH_OPTION_PUT(.name = "lb_port_stats", .type = NLA_BINARY,
+				 .data = &stats, .data_len = sizeof(stats),
+				 .changed = stats_only, .per_port = true,
+				 .port_ifindex = BENCH_PORT_IFINDEX_BASE + i);
+	}
+	for (i = 0; i < BENCH_HASH_COUNT; i++) {
+		stats = seed + i;
+		BENCH_OPTION_PUT(.name = "lb_hash_stats", .type = NLA_BINARY,
+				 .data = &stats, .data_len = sizeof(stats),
+				 .changed = stats_only, .array = true,
+				 .array_index = i);
+	}
+	if (stats_only)
+		goto out;
+
+	BENCH_OPTION_PUT(.name = "mode", .type = NLA_STRING,
+			 .data = "loadbalance");
+	BENCH_OPTION_PUT(.name = "lb_tx_method", .type = NLA_STRING,
+			 .data = "hash_to_port_mapping");
+	BENCH_OPTION_PUT(.name = "bpf_hash_func", .type = NLA_BINARY,
+			 .data = bpf_hash_func, .data_len = BENCH_BPF_SIZE);
+	for (i = 0; i < ARRAY_SIZE(bench_core_u32_options); i++)
+		BENCH_OPTION_PUT(.name = bench_core_u32_options[i],
+				 .type = NLA_U32, .u32 = seed);
+	for (i = 0; i < bench->port_count; i++) {
+		for (j = 0; j < ARRAY_SIZE(bench_port_flag_options); j++)
+			BENCH_OPTION_PUT(.name = bench_port_flag_options[j],
+					 .type = NLA_FLAG, .u32 = seed % 2,
+					 .per_port = true,
+					 .port_ifindex = BENCH_PORT_IFINDEX_BASE + i);
+		BENCH_OPTION_PUT(.name = "priority", .type = NLA_S32,
+				 .u32 = seed, .per_port = true,
+				 .port_ifindex = BENCH_PORT_IFINDEX_BASE + i);
+		BENCH_OPTION_PUT(.name = "queue_id", .type = NLA_U32,
+				 .u32 = seed, .per_port = true,
+				 .port_ifindex = BENCH_PORT_IFINDEX_BASE + i);
+	}
+	for (i = 0; i < BENCH_HASH_COUNT; i++)
+		BENCH_OPTION_PUT(.name = "lb_tx_hash_to_port_mapping",
+				 .type = NLA_U32,
+				 .u32 = BENCH_PORT_IFINDEX_BASE +
+					(i + seed) % bench->port_count,
+				 .array = true, .array_index = i);
+	for (i = 0; count < bench->option_count; i++)
+		BENCH_OPTION_PUT(.name = "bench_option", .type = NLA_U32,
+				 .u32 = seed + i, .array = true,
+				 .array_index = i);
+#undef BENCH_OPTION_PUT
+
+out:
+	nla_nest_end(msg, list);
+	if (!stats_only)
+		bench->option_count = count;
+	return msg;
+
+nla_put_failure:
+	nlmsg_free(msg);
+	return NULL;
+}
+
+static int bench_msg_process(struct bench *bench, struct nl_msg *msg)
+{
+	struct team_handle *th = bench->th;
+
+	th->msg_recv_started = false;
+	get_options_handler(msg, th);
+	return check_call_change_handlers(th, TEAM_OPTION_CHANGE);
+}
+
+static int bench_setup(struct bench *bench)
+{
+	unsigned int i;
+	int err;
+
+	bench->th = team_alloc();
+	if (!bench->th)
+		return -ENOMEM;
+	bench->th->ifindex = BENCH_TEAM_IFINDEX;
+	for (i = 0; i < 2; i++) {
+		bench->dump_msgs[i] = bench_msg_build(bench, false, i);
+		bench->stats_msgs[i] = bench_msg_build(bench, true, i + 1);
+		if (!bench->dump_msgs[i] || !bench->stats_msgs[i])
+			return -ENOMEM;
+	}
+	/* Warm up so option list and pools reach their working set */
+	for (i = 0; i < 2; i++) {
+		err = bench_msg_process(bench, bench->dump_msgs[i]);
+		if (err)
+			return err;
+	}
+	return 0;
+}
+
+static int bench_dump(struct bench *bench)
+{
+	uint64_t alloc_count;
+	uint64_t elapsed;
+	uint64_t start;
+	unsigned int i;
+	int err;
+
+	alloc_count = team_get_alloc_count(bench->th);
+	start = bench_now();
+	for (i = 0; i < bench->rounds; i++) {
+		err = bench_msg_process(bench, bench->dump_msgs[i % 2]);
+		if (err)
+			return err;
+	}
+	elapsed = bench_now() - start;
+	bench_report("option_dump", bench, 0, bench->rounds, elapsed,
+		     team_get_alloc_count(bench->th) - alloc_count);
+	return 0;
+}
+
+/* Looks up what teamd looks up most, stats and port options */
+static int bench_lookup(struct bench *bench)
+{
+	struct team_handle *th = bench->th;
+	uint64_t ops = 0;
+	uint64_t elapsed;
+	uint64_t start;
+	unsigned int i;
+	unsigned int j;
+
+	start = bench_now();
+	for (i = 0; i < bench->rounds; i++) {
+		for (j = 0; j < BENCH_HASH_COUNT; j++, ops++)
+			if (!team_get_option(th, "na", "lb_hash_stats", j))
+				return -ENOENT;
+		for (j = 0; j < bench->port_count; j++, ops++)
+			if (!team_get_option(th, "np", "enabled",
+					     BENCH_PORT_IFINDEX_BASE + j))
+				return -ENOENT;
+	}
+	elapsed = bench_now() - start;
+	bench_report("option_lookup", bench, 0, ops, elapsed, 0);
+	return 0;
+}
+
+static int bench_change_handler_func(struct team_handle *th, void *priv,
+				     team_change_type_mask_t type_mask)
+{
+	struct team_option *option;
+	uint64_t *p_sum = priv;
+
+	team_for_each_changed_option(option, th)
+		*p_sum += team_get_option_value_len(option);
+	return 0;
+}
+
+static const struct team_change_handler bench_change_handler = {
+	.func = bench_change_handler_func,
+	.type_mask = TEAM_OPTION_CHANGE,
+};
+
+/* Each stats refresh event is delivered to every registered handler */
+static int bench_fanout(struct bench *bench, unsigned int handler_count)
+{
+	uint64_t sums[BENCH_HANDLERS_MAX];
+	uint64_t alloc_count;
+	uint64_t elapsed;
+	uint64_t start;
+	unsigned int i;
+	int err = 0;
+
+	for (i = 0; i < handler_count; i++) {
+		err = team_change_handler_register(bench->th,
+						   &bench_change_handler,
+						   &sums[i]);
+		if (err)
+			goto unregister;
+	}
+	alloc_count = team_get_alloc_count(bench->th);
+	start = bench_now();
+	for (i = 0; i < bench->rounds; i++) {
+		err = bench_msg_process(bench, bench->stats_msgs[i % 2]);
+		if (err)
+			goto unregister;
+	}
+	elapsed = bench_now() - start;
+	bench_report("change_handler_fanout", bench, handler_count,
+		     bench->rounds, elapsed,
+		     team_get_alloc_count(bench->th) - alloc_count);
+
+unregister:
+	while (i--)
+		team_change_handler_unregister(bench->th, &bench_change_handler,
+					       &sums[i]);
+	return err;
+}
+
+int main(int argc, char **argv)
+{
+	static const unsigned int handler_counts[] = { 1, 8, BENCH_HANDLERS_MAX };
+	struct bench bench = {
+		.port_count = BENCH_DEFAULT_PORTS,
+		.option_count = BENCH_DEFAULT_OPTIONS,
+		.rounds = BENCH_DEFAULT_ROUNDS,
+	};
+	unsigned int i;
+	int err;
+
+	if (argc > 1)
+		bench.port_count = strtoul(argv[1], NULL, 10);
+	if (argc > 2)
+		bench.option_count = strtoul(argv[2], NULL, 10);
+	if (argc > 3)
+		bench.rounds = strtoul(argv[3], NULL, 10);
+	if (!bench.port_count || !bench.option_count || !bench.rounds) {
+		fprintf(stderr, "Usage: %s [PORT_COUNT [OPTION_COUNT [ROUNDS]]]\n",
+			argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	err = bench_setup(&bench);
+	if (!err)
+		err = bench_dump(&bench);
+	if (!err)
+		err = bench_lookup(&bench);
+	for (i = 0; !err && i < ARRAY_SIZE(handler_counts); i++)
+		err = bench_fanout(&bench, handler_counts[i]);
+	if (err) {
+		fprintf(stderr, "Benchmark failed (%d)\n", err);
+		return EXIT_FAILURE;
+	}
+
+	for (i = 0; i < 2; i++) {
+		nlmsg_free(bench.dump_msgs[i]);
+		nlmsg_free(bench.stats_msgs[i]);
+	}
+	team_free(bench.th);
+	return EXIT_SUCCESS;
+}
@@ -22,9 +22,12 @@
 
 #include <stdarg.h>
 #include <syslog.h>
+#include <pthread.h>
 #include <netlink/netlink.h>
 #include <team.h>
 #include <private/list.h>
+#include <private/hash.h>
+#include <private/pool.h>
 
 #include "config.h"
 
@@ -35,8 +38,85 @@
  * @short_description: libteam context
  */
 
+struct team_option_txn_item;
+struct option_name;
+
+struct team_option_id {
+	char *			name;
+	uint32_t		port_ifindex;
+	bool			port_ifindex_used;
+	uint32_t		array_index;
+	bool			array_index_used;
+};
+
+/*
+ * Immutable copy of ports, options and linked ifinfos. Built by thread
+ * processing events, read by any thread holding a reference.
+ */
+struct team_snapshot {
+	unsigned int		refcount; /* atomic */
+	uint64_t		generation;
+	struct list_item	port_list;
+	struct list_item	option_list;
+	struct list_item	ifinfo_list;
+};
+
+/*
+ * Emulated team family, see emul.c. Family id is out of range of route
+ * message types, so both families are told apart by message type.
+ * Subscribe message payload is the uint32_t group.
+ */
+#define TEAM_EMUL_FAMILY	0x1000
+#define TEAM_EMUL_SUBSCRIBE	0x1001
+#define TEAM_EMUL_GRP_TEAM	1
+#define TEAM_EMUL_GRP_LINK	2
+
+struct team_transport;
+
+struct team_transport_ops {
+	int (*connect)(struct team_transport *tp, struct nl_sock *sock,
+		       int protocol);
+	int (*resolve_family)(struct team_transport *tp, struct nl_sock *sock);
+	int (*join_events)(struct team_transport *tp, struct nl_sock *sock,
+			   int protocol);
+};
+
+struct team_transport {
+	const struct team_transport_ops *	ops;
+	uint32_t				emul_port;
+};
+
+/*
+ * Asynchronous request. Complete func is called when the request got
+ * acked, failed or timed out, right before user done func. Release func
+ * frees whatever the request holds before it is put back for reuse.
+ */
+struct team_req {
+	struct list_item	list;
+	uint32_t		id; /* netlink sequence number */
+	uint64_t		deadline; /* ms, zero means no timeout */
+	int			err;
+	team_req_done_func_t	done;
+	void *			done_priv;
+	void (*complete)(struct team_handle *th, struct team_req *req);
+	void (*release)(struct team_handle *th, struct team_req *req);
+	struct {
+		struct team_option_id	id;
+		struct option_name *	name;
+		int			type;
+		union {
+			uint32_t	u32;
+			int32_t		s32;
+			bool		bool_val;
+		} val;
+		void *			data; /* string and binary */
+		int			data_len;
+	} opt;
+};
+
 struct team_handle {
 	int			event_fd;
+	struct team_transport	transport;
 	struct nl_sock *	nl_sock;
 	unsigned int		nl_sock_seq;
 	struct nl_sock *	nl_sock_event;
@@ -45,8 +125,19 @@ struct team_handle {
 	uint32_t		ifindex;
 	struct team_ifinfo *	ifinfo;
 	struct list_item	port_list;
+	struct list_item	port_changed_list;
+	struct pool		port_pool;
 	struct list_item	ifinfo_list;
+	struct list_item	ifinfo_changed_list;
+	struct hash_table	ifinfo_table;
+	struct hash_table	ifinfo_name_table;
 	struct list_item	option_list;
+	struct list_item	option_changed_list;
+	unsigned int		option_temporary_count;
+	struct hash_table	option_table;
+	struct hash_table	option_name_table;
+	struct hash_table	option_handle_table;
+	struct pool		option_pool;
 	struct {
 		struct list_item		list;
 		team_change_type_mask_t		pending_type_mask;
@@ -59,6 +150,53 @@ struct team_handle {
 		       const char *file, int line, const char *fn,
 		       const char *format, va_list args);
 	int log_priority;
+	struct team_evmux *	evmux;
+	struct hash_item	evmux_hitem;
+	struct list_item	evmux_pending_list;
+	bool			evmux_pending;
+	struct {
+		struct nl_msg *		msg; /* reused by all requests */
+		struct nl_cb *		cb;
+		bool			acked;
+		unsigned int		seq;
+		unsigned int		timeout; /* ms, zero means none */
+	} req;
+	struct {
+		struct nl_sock *	sock; /* created on first use */
+		struct nl_cb *		cb;
+		int			timer_fd;
+		uint32_t		seq;
+		struct list_item	inflight_list; /* sorted by deadline */
+		struct list_item	done_list;
+		struct list_item	free_list;
+		unsigned int		inflight_count;
+	} async;
+	struct {
+		struct team_option_txn_item *	items;
+		unsigned int			count;
+		unsigned int			size;
+		char *				buf; /* string and binary values */
+		size_t				buf_len;
+		size_t				buf_size;
+		bool				active;
+	} txn;
+	uint64_t		alloc_count; /* options and ports, pools excluded */
+	bool			resyncing; /* dumps compared with last state */
+	struct {
+		unsigned int	size;
+		unsigned int	max_size;
+	} sock_buf;
+	uint64_t		overrun_count;
+	uint64_t		resync_count;
+	struct {
+		int			timer_fd; /* periodic refresh */
+	} stats;
+	struct {
+		bool			enabled;
+		pthread_mutex_t		lock; /* protects cur swap */
+		struct team_snapshot *	cur;
+		uint64_t		generation;
+	} snapshot;
 };
 
 /**
@@ -104,24 +242,60 @@ team_log_null(struct team_handle *th, const char *format, ...) {}
 int get_port_list_handler(struct nl_msg *msg, void *arg);
 int port_list_alloc(struct team_handle *th);
 int port_list_init(struct team_handle *th);
+void port_list_cleanup_last_state(struct team_handle *th);
+int port_list_resync(struct team_handle *th);
 void port_list_free(struct team_handle *th);
+int port_list_snapshot(struct team_handle *th, struct team_snapshot *snap);
+void port_snapshot_free(struct team_snapshot *snap);
 int ifinfo_event_handler(struct nl_msg *msg, void *arg);
 int ifinfo_list_alloc(struct team_handle *th);
 int ifinfo_list_init(struct team_handle *th);
+void ifinfo_list_cleanup_last_state(struct team_handle *th);
+int ifinfo_list_resync(struct team_handle *th);
 void ifinfo_list_free(struct team_handle *th);
+int ifinfo_list_snapshot(struct team_handle *th, struct team_snapshot *snap);
+struct team_ifinfo *ifinfo_snapshot_link_port(struct team_snapshot *snap,
+					      uint32_t ifindex,
+					      struct team_port *port);
+void ifinfo_snapshot_free(struct team_snapshot *snap);
+int ifinfo_list_stats_refresh(struct team_handle *th);
 int ifinfo_link_with_port(struct team_handle *th, uint32_t ifindex,
 			  struct team_port *port, struct team_ifinfo **p_ifinfo);
 int ifinfo_link(struct team_handle *th, uint32_t ifindex,
 		struct team_ifinfo **p_ifinfo);
 void ifinfo_unlink(struct team_ifinfo *ifinfo);
+struct team_ifinfo *ifinfo_find(struct team_handle *th, uint32_t ifindex);
+uint32_t ifinfo_ifname2ifindex(struct team_handle *th, const char *ifname);
+char *ifinfo_ifindex2ifname(struct team_handle *th, uint32_t ifindex);
 int get_options_handler(struct nl_msg *msg, void *arg);
 int option_list_alloc(struct team_handle *th);
 int option_list_init(struct team_handle *th);
+void option_list_cleanup_last_state(struct team_handle *th);
+int option_list_resync(struct team_handle *th);
 void option_list_free(struct team_handle *th);
+int option_list_snapshot(struct team_handle *th, struct team_snapshot *snap);
+void option_snapshot_free(struct team_snapshot *snap);
+void snapshot_update(struct team_handle *th);
+void snapshot_fini(struct team_handle *th);
 int nl2syserr(int nl_error);
+void team_transport_init(struct team_transport *tp);
+void team_transport_set_emul(struct team_transport *tp, uint32_t port);
+void team_transport_setup_cb(struct team_transport *tp, struct nl_cb *cb);
+int team_transport_connect(struct team_transport *tp, struct nl_sock *sock,
+			   int protocol);
+int team_transport_resolve_family(struct team_transport *tp,
+				  struct nl_sock *sock);
+int team_transport_join_events(struct team_transport *tp,
+			       struct nl_sock *sock, int protocol);
+uint64_t team_now_ms(void);
+struct nl_msg *team_req_msg_get(struct team_handle *th);
 int send_and_recv(struct team_handle *th, struct nl_msg *msg,
 		  int (*valid_handler)(struct nl_msg *, void *),
 		  void *valid_data);
+struct team_req *team_req_get(struct team_handle *th);
+void team_req_put(struct team_handle *th, struct team_req *req);
+int team_req_send(struct team_handle *th, struct team_req *req,
+		  struct nl_msg *msg, unsigned int timeout);
 void set_call_change_handlers(struct team_handle *th,
 			      team_change_type_mask_t set_type_mask);
 int check_call_change_handlers(struct team_handle *th,
@@ -0,0 +1,179 @@
+/*
+ *   transport.c - Netlink transports of libteam
+ *   Copyright (C) 2026 agent <agent@local>
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <stdint.h>
+#include <errno.h>
+#include <netlink/netlink.h>
+#include <netlink/genl/genl.h>
+#include <netlink/genl/ctrl.h>
+#include <linux/if_team.h>
+#include <linux/rtnetlink.h>
+#include <linux/netlink.h>
+#include <team.h>
+#include "team_private.h"
+
+/*
+ * Transport decides where sockets of library context get connected to
+ * and how team family and multicast groups are resolved. Messages
+ * themselves are the same for all transports. Functions return libnl
+ * error codes.
+ */
+
+static int kernel_connect(struct team_transport *tp, struct nl_sock *sock,
+			  int protocol)
+{
+	return nl_connect(sock, protocol);
+}
+
+static int kernel_resolve_family(struct team_transport *tp,
+				 struct nl_sock *sock)
+{
+	return genl_ctrl_resolve(sock, TEAM_GENL_NAME);
+}
+
+static int kernel_join_events(struct team_transport *tp,
+			      struct nl_sock *sock, int protocol)
+{
+	int grp_id;
+
+	if (protocol == NETLINK_ROUTE)
+		return nl_socket_add_membership(sock, RTNLGRP_LINK);
+	grp_id = genl_ctrl_resolve_grp(sock, TEAM_GENL_NAME,
+				       TEAM_GENL_CHANGE_EVENT_MC_GRP_NAME);
+	if (grp_id < 0)
+		return grp_id;
+	return nl_socket_add_membership(sock, grp_id);
+}
+
+static const struct team_transport_ops kernel_ops = {
+	.connect	= kernel_connect,
+	.resolve_family	= kernel_resolve_family,
+	.join_events	= kernel_join_events,
+};
+
+/*
+ * Emulator is a userspace socket of the same protocol, see emul.c. All
+ * messages are sent to its port, events are unicast back to sockets
+ * which subscribed. Any local process may send to NETLINK_USERSOCK
+ * socket, so whatever does not come from emulator port is dropped.
+ */
+
+static int emul_msg_in_handler(struct nl_msg *msg, void *arg)
+{
+	struct team_transport *tp = arg;
+	struct sockaddr_nl *src = nlmsg_get_src(msg);
+
+	if (!src || src->nl_pid != tp->emul_port)
+		return NL_SKIP;
+	return NL_OK;
+}
+
+static int emul_connect(struct team_transport *tp, struct nl_sock *sock,
+			int protocol)
+{
+	int err;
+
+	err = nl_connect(sock, NETLINK_USERSOCK);
+	if (err)
+		return err;
+	nl_socket_set_peer_port(sock, tp->emul_port);
+	return 0;
+}
+
+static int emul_resolve_family(struct team_transport *tp,
+			       struct nl_sock *sock)
+{
+	return TEAM_EMUL_FAMILY;
+}
+
+static int emul_join_events(struct team_transport *tp, struct nl_sock *sock,
+			    int protocol)
+{
+	struct nl_msg *msg;
+	uint32_t group;
+	int err;
+
+	group = protocol == NETLINK_ROUTE ? TEAM_EMUL_GRP_LINK :
+					    TEAM_EMUL_GRP_TEAM;
+	msg = nlmsg_alloc_simple(TEAM_EMUL_SUBSCRIBE, 0);
+	if (!msg)
+		return -NLE_NOMEM;
+	err = nlmsg_append(msg, &group, sizeof(group), NLMSG_ALIGNTO);
+	if (!err)
+		err = nl_send_auto(sock, msg);
+	nlmsg_free(msg);
+	if (err < 0)
+		return err;
+	return nl_wait_for_ack(sock);
+}
+
+static const struct team_transport_ops emul_ops = {
+	.connect	= emul_connect,
+	.resolve_family	= emul_resolve_family,
+	.join_events	= emul_join_events,
+};
+
+void team_transport_init(struct team_transport *tp)
+{
+	tp->ops = &kernel_ops;
+	tp->emul_port = 0;
+}
+
+void team_transport_set_emul(struct team_transport *tp, uint32_t port)
+{
+	tp->ops = port ? &emul_ops : &kernel_ops;
+	tp->emul_port = port;
+}
+
+/* Has to be applied to every callback set messages are received with */
+void team_transport_setup_cb(struct team_transport *tp, struct nl_cb *cb)
+{
+	if (tp->emul_port)
+		nl_cb_set(cb, NL_CB_MSG_IN, NL_CB_CUSTOM,
+			  emul_msg_in_handler, tp);
+	else
+		nl_cb_set(cb, NL_CB_MSG_IN, NL_CB_DEFAULT, NULL, NULL);
+}
+
+int team_transport_connect(struct team_transport *tp, struct nl_sock *sock,
+			   int protocol)
+{
+	struct nl_cb *cb;
+	int err;
+
+	err = tp->ops->connect(tp, sock, protocol);
+	if (err)
+		return err;
+	cb = nl_socket_get_cb(sock);
+	team_transport_setup_cb(tp, cb);
+	nl_cb_put(cb);
+	return 0;
+}
+
+int team_transport_resolve_family(struct team_transport *tp,
+				  struct nl_sock *sock)
+{
+	return tp->ops->resolve_family(tp, sock);
+}
+
+int team_transport_join_events(struct team_transport *tp,
+			       struct nl_sock *sock, int protocol)
+{
+	return tp->ops->join_events(tp, sock, protocol);
+}
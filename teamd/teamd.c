@@ -30,10 +30,8 @@
 #include <inttypes.h>
 #include <sys/socket.h>
 #include <sys/time.h>
-#include <sys/select.h>
 #include <linux/netdevice.h>
 #include <sys/syslog.h>
-#include <sys/timerfd.h>
 #include <libdaemon/dfork.h>
 #include <libdaemon/dsignal.h>
 #include <libdaemon/dlog.h>
@@ -58,37 +56,7 @@ enum teamd_exit_code {
 	TEAMD_EXIT_RUNTIME_FAILURE,
 };
 
-static const struct teamd_runner *teamd_runner_list[] = {
-	&teamd_runner_broadcast,
-	&teamd_runner_roundrobin,
-	&teamd_runner_random,
-	&teamd_runner_activebackup,
-	&teamd_runner_loadbalance,
-	&teamd_runner_lacp,
-};
-
-#define TEAMD_RUNNER_LIST_SIZE ARRAY_SIZE(teamd_runner_list)
-
-static const struct teamd_runner *teamd_find_runner(const char *runner_name)
-{
-	int i;
-
-	for (i = 0; i < TEAMD_RUNNER_LIST_SIZE; i++) {
-		if (strcmp(teamd_runner_list[i]->name, runner_name) == 0)
-			return teamd_runner_list[i];
-	}
-	return NULL;
-}
-
-#define TEAMD_DEFAULT_RUNNER_NAME "roundrobin"
-#define TEAMD_DEFAULT_DEVNAME_PREFIX "team"
-
-static void libteam_log_daemon(struct team_handle *th, int priority,
-			       const char *file, int line, const char *fn,
-			       const char *format, va_list args)
-{
-	daemon_logv(priority, format, args);
-}
+#define TEAMD_MULTI_DEFAULT_NAME "multi"
 
 static char **__g_pid_file;
 
@@ -116,10 +84,16 @@ static void print_help(const struct teamd_context *ctx) {
             "    -D --dbus-enable         Enable D-Bus interface\n"
             "    -Z --zmq-enable=ADDRESS  Enable ZeroMQ interface\n"
             "    -U --usock-enable        Enable UNIX domain socket interface\n"
-            "    -u --usock-disable       Disable UNIX domain socket interface\n",
+            "    -u --usock-disable       Disable UNIX domain socket interface\n"
+            "    -m --multi               Host many team devices in one process, teams\n"
+            "                             are added and removed over UNIX domain socket\n"
+            "    -R --realtime            Lock memory and keep failover paths free of\n"
+            "                             allocations, see \"realtime\" config keys\n"
+            "    -E --emul-port=PORT      Talk to team emulator listening on given\n"
+            "                             netlink port instead of kernel\n",
             ctx->argv0);
 	printf("Available runners: ");
-	for (i = 0; i < TEAMD_RUNNER_LIST_SIZE; i++) {
+	for (i = 0; i < teamd_runner_list_size; i++) {
 		if (i != 0)
 			printf(", ");
 		printf("%s", teamd_runner_list[i]->name);
@@ -149,10 +123,13 @@ static int parse_command_line(struct teamd_context *ctx,
 		{ "zmq-enable",		required_argument,	NULL, 'Z' },
 		{ "usock-enable",	no_argument,		NULL, 'U' },
 		{ "usock-disable",	no_argument,		NULL, 'u' },
+		{ "multi",		no_argument,		NULL, 'm' },
+		{ "realtime",		no_argument,		NULL, 'R' },
+		{ "emul-port",		required_argument,	NULL, 'E' },
 		{ NULL, 0, NULL, 0 }
 	};
 
-	while ((opt = getopt_long(argc, argv, "hdkevf:c:p:groNt:nDZ:Uu",
+	while ((opt = getopt_long(argc, argv, "hdkevf:c:p:groNt:nDZ:UumRE:",
 				  long_options, NULL)) >= 0) {
 
 		switch(opt) {
@@ -230,6 +207,20 @@ static int parse_command_line(struct teamd_context *ctx,
 		case 'u':
 			ctx->usock.enabled = false;
 			break;
+		case 'm':
+			ctx->multi.enabled = true;
+			break;
+		case 'R':
+			ctx->realtime.enabled = true;
+			break;
+		case 'E':
+			ctx->emul_port = strtoul(optarg, NULL, 10);
+			if (!ctx->emul_port) {
+				fprintf(stderr, "Invalid emulator port \"%s\"\n",
+					optarg);
+				return -1;
+			}
+			break;
 		default:
 			return -1;
 		}
@@ -247,1196 +238,6 @@ static const char *teamd_pid_file_proc(void) {
 	return *__g_pid_file;
 }
 
-static int handle_period_fd(int fd)
-{
-	ssize_t ret;
-	uint64_t exp;
-
-	ret = read(fd, &exp, sizeof(uint64_t));
-	if (ret == -1) {
-		if (errno == EINTR || errno == EAGAIN)
-			return 0;
-		teamd_log_err("read() failed.");
-		return -errno;
-	}
-	if (ret != sizeof(uint64_t)) {
-		teamd_log_err("read() returned unexpected number of bytes.");
-		return -EINVAL;
-	}
-	if (exp > 1)
-		teamd_log_warn("some periodic function calls missed (%" PRIu64 ")",
-			       exp - 1);
-	return 0;
-}
-
-struct teamd_loop_callback {
-	struct list_item list;
-	char *name;
-	void *priv;
-	teamd_loop_callback_func_t func;
-	int fd;
-	int fd_event;
-	bool is_period;
-	bool enabled;
-};
-
-static void teamd_run_loop_set_fds(struct list_item *lcb_list,
-				   fd_set *fds, int *fdmax)
-{
-	struct teamd_loop_callback *lcb;
-	int i;
-
-	list_for_each_node_entry(lcb, lcb_list, list) {
-		if (!lcb->enabled)
-			continue;
-		for (i = 0; i < 3; i++) {
-			if (lcb->fd_event & (1 << i)) {
-				FD_SET(lcb->fd, &fds[i]);
-				if (lcb->fd >= *fdmax)
-					*fdmax = lcb->fd + 1;
-			}
-		}
-	}
-}
-
-static int teamd_run_loop_do_callbacks(struct list_item *lcb_list, fd_set *fds,
-				       struct teamd_context *ctx)
-{
-	struct teamd_loop_callback *lcb;
-	struct teamd_loop_callback *tmp;
-	int i;
-	int events;
-	int err;
-
-	list_for_each_node_entry_safe(lcb, tmp, lcb_list, list) {
-		for (i = 0; i < 3; i++) {
-			if (!(lcb->fd_event & (1 << i)))
-				continue;
-			events = 0;
-			if (FD_ISSET(lcb->fd, &fds[i]))
-				events |= (1 << i);
-			if (!events)
-				continue;
-			if (lcb->is_period) {
-				err = handle_period_fd(lcb->fd);
-				if (err)
-					return err;
-			}
-			err = lcb->func(ctx, events, lcb->priv);
-			if (err) {
-				teamd_log_warn("Loop callback failed with: %s",
-					       strerror(-err));
-				teamd_log_dbg("Failed loop callback: %s, %p",
-					      lcb->name, lcb->priv);
-			}
-		}
-	}
-	return 0;
-}
-
-static int teamd_flush_ports(struct teamd_context *ctx)
-{
-	if (!ctx->no_quit_destroy)
-		return teamd_port_remove_all(ctx);
-	else
-		teamd_port_obj_remove_all(ctx);
-	return 0;
-}
-
-static int teamd_run_loop_run(struct teamd_context *ctx)
-{
-	int err;
-	int ctrl_fd = ctx->run_loop.ctrl_pipe_r;
-	fd_set fds[3];
-	int fdmax;
-	char ctrl_byte;
-	int i;
-	bool quit_in_progress = false;
-
-	/*
-	 * To process all things correctly during cleanup, on quit command
-	 * received via control pipe ('q') do flush all existing ports.
-	 * After that wait until all ports are gone and return.
-	 */
-
-	while (true) {
-		if (quit_in_progress && !teamd_has_ports(ctx))
-			return ctx->run_loop.err;
-
-		for (i = 0; i < 3; i++)
-			FD_ZERO(&fds[i]);
-		FD_SET(ctrl_fd, &fds[0]);
-		fdmax = ctrl_fd + 1;
-
-		teamd_run_loop_set_fds(&ctx->run_loop.callback_list,
-				       fds, &fdmax);
-
-		while (select(fdmax, &fds[0], &fds[1], &fds[2], NULL) < 0) {
-			if (errno == EINTR)
-				continue;
-
-			teamd_log_err("select() failed.");
-			return -errno;
-		}
-
-		if (FD_ISSET(ctrl_fd, &fds[0])) {
-			err = read(ctrl_fd, &ctrl_byte, 1);
-			if (err != -1) {
-				switch(ctrl_byte) {
-				case 'q':
-					if (quit_in_progress)
-						return -EBUSY;
-					err = teamd_flush_ports(ctx);
-					if (err)
-						return err;
-					quit_in_progress = true;
-					continue;
-				case 'r':
-					continue;
-				}
-			} else if (errno == EINTR || errno == EAGAIN) {
-				continue;
-			} else {
-				teamd_log_err("read() failed.");
-				return -errno;
-			}
-		}
-
-		err = teamd_run_loop_do_callbacks(&ctx->run_loop.callback_list,
-						  fds, ctx);
-		if (err)
-			return err;
-	}
-	return 0;
-}
-
-static void teamd_run_loop_sent_ctrl_byte(struct teamd_context *ctx,
-					  const char ctrl_byte)
-{
-	int err;
-
-retry:
-	err = write(ctx->run_loop.ctrl_pipe_w, &ctrl_byte, 1);
-	if (err == -1 && errno == EINTR)
-		goto retry;
-}
-
-void teamd_run_loop_quit(struct teamd_context *ctx, int err)
-{
-	ctx->run_loop.err = err;
-	teamd_run_loop_sent_ctrl_byte(ctx, 'q');
-}
-
-void teamd_run_loop_restart(struct teamd_context *ctx)
-{
-	teamd_run_loop_sent_ctrl_byte(ctx, 'r');
-}
-
-static struct teamd_loop_callback *__get_lcb(struct teamd_context *ctx,
-					     const char *cb_name, void *priv,
-					     struct teamd_loop_callback *last)
-{
-	struct teamd_loop_callback *lcb;
-	bool last_found;
-
-	last_found = last == NULL ? true: false;
-	list_for_each_node_entry(lcb, &ctx->run_loop.callback_list, list) {
-		if (!last_found) {
-			if (lcb == last)
-				last_found = true;
-			continue;
-		}
-		if (cb_name && strcmp(lcb->name, cb_name))
-			continue;
-		if (priv && lcb->priv != priv)
-			continue;
-		return lcb;
-	}
-	return NULL;
-}
-
-static struct teamd_loop_callback *get_lcb(struct teamd_context *ctx,
-					   const char *cb_name, void *priv)
-{
-	return __get_lcb(ctx, cb_name, priv, NULL);
-}
-
-static struct teamd_loop_callback *get_lcb_multi(struct teamd_context *ctx,
-						 const char *cb_name,
-						 void *priv,
-						 struct teamd_loop_callback *last)
-{
-	return __get_lcb(ctx, cb_name, priv, last);
-}
-
-#define for_each_lcb_multi_match(lcb, ctx, cb_name, priv)		\
-	for (lcb = get_lcb_multi(ctx, cb_name, priv, NULL); lcb;	\
-	     lcb = get_lcb_multi(ctx, cb_name, priv, lcb))
-
-#define for_each_lcb_multi_match_safe(lcb, tmp, ctx, cb_name, priv)	\
-	for (lcb = get_lcb_multi(ctx, cb_name, priv, NULL),		\
-	     tmp = get_lcb_multi(ctx, cb_name, priv, lcb);		\
-	     lcb;							\
-	     lcb = tmp,							\
-	     tmp = get_lcb_multi(ctx, cb_name, priv, lcb))
-
-static int __teamd_loop_callback_fd_add(struct teamd_context *ctx,
-					const char *cb_name, void *priv,
-					teamd_loop_callback_func_t func,
-					int fd, int fd_event, bool tail)
-{
-	int err;
-	struct teamd_loop_callback *lcb;
-
-	if (!cb_name || !priv)
-		return -EINVAL;
-	if (get_lcb(ctx, cb_name, priv)) {
-		teamd_log_err("Callback named \"%s\" is already registered.",
-			      cb_name);
-		return -EEXIST;
-	}
-	lcb = myzalloc(sizeof(*lcb));
-	if (!lcb) {
-		teamd_log_err("Failed alloc memory for callback.");
-		return -ENOMEM;
-	}
-	lcb->name = strdup(cb_name);
-	if (!lcb->name) {
-		err = -ENOMEM;
-		goto lcb_free;
-	}
-	lcb->priv = priv;
-	lcb->func = func;
-	lcb->fd = fd;
-	lcb->fd_event = fd_event & TEAMD_LOOP_FD_EVENT_MASK;
-	if (tail)
-		list_add_tail(&ctx->run_loop.callback_list, &lcb->list);
-	else
-		list_add(&ctx->run_loop.callback_list, &lcb->list);
-	teamd_log_dbg("Added loop callback: %s, %p", lcb->name, lcb->priv);
-	return 0;
-
-lcb_free:
-	free(lcb);
-	return err;
-}
-
-int teamd_loop_callback_fd_add(struct teamd_context *ctx,
-			       const char *cb_name, void *priv,
-			       teamd_loop_callback_func_t func,
-			       int fd, int fd_event)
-{
-	return __teamd_loop_callback_fd_add(ctx, cb_name, priv, func,
-					    fd, fd_event, false);
-}
-
-int teamd_loop_callback_fd_add_tail(struct teamd_context *ctx,
-				    const char *cb_name, void *priv,
-				    teamd_loop_callback_func_t func,
-				    int fd, int fd_event)
-{
-	return __teamd_loop_callback_fd_add(ctx, cb_name, priv, func,
-					    fd, fd_event, true);
-}
-
-static int __timerfd_reset(int fd, struct timespec *interval,
-			   struct timespec *initial)
-{
-	struct itimerspec its;
-
-	memset(&its, 0, sizeof(its));
-	if (interval)
-		its.it_interval = *interval;
-	if (initial)
-		its.it_value = *initial;
-	else
-		its.it_value.tv_nsec = 1; /* to enable that */
-	if (timerfd_settime(fd, 0, &its, NULL) < 0) {
-		teamd_log_err("Failed to set timerfd.");
-		return -errno;
-	}
-	return 0;
-}
-
-int teamd_loop_callback_timer_add_set(struct teamd_context *ctx,
-				      const char *cb_name, void *priv,
-				      teamd_loop_callback_func_t func,
-				      struct timespec *interval,
-				      struct timespec *initial)
-{
-	int err;
-	int fd = fd;
-
-	fd = timerfd_create(CLOCK_MONOTONIC, 0);
-	if (fd < 0) {
-		teamd_log_err("Failed to create timerfd.");
-		return -errno;
-	}
-	if (interval || initial) {
-		err = __timerfd_reset(fd, interval, initial);
-		if (err) {
-			close(fd);
-			return err;
-		}
-	}
-	err = teamd_loop_callback_fd_add(ctx, cb_name, priv, func, fd,
-					 TEAMD_LOOP_FD_EVENT_READ);
-	if (err) {
-		close(fd);
-		return err;
-	}
-	get_lcb(ctx, cb_name, priv)->is_period = true;
-	return 0;
-}
-
-int teamd_loop_callback_timer_add(struct teamd_context *ctx,
-				  const char *cb_name, void *priv,
-				  teamd_loop_callback_func_t func)
-{
-	return teamd_loop_callback_timer_add_set(ctx, cb_name, priv, func,
-						 NULL, NULL);
-}
-
-int teamd_loop_callback_timer_set(struct teamd_context *ctx,
-				  const char *cb_name,
-				  void *priv,
-				  struct timespec *interval,
-				  struct timespec *initial)
-{
-	struct teamd_loop_callback *lcb;
-
-	if (!cb_name || !priv)
-		return -EINVAL;
-	lcb = get_lcb(ctx, cb_name, priv);
-	if (!lcb) {
-		teamd_log_err("Callback named \"%s\" not found.", cb_name);
-		return -ENOENT;
-	}
-	if (!lcb->is_period) {
-		teamd_log_err("Can't reset non-periodic callback.");
-		return -EINVAL;
-	}
-	return __timerfd_reset(lcb->fd, interval, initial);
-}
-
-void teamd_loop_callback_del(struct teamd_context *ctx, const char *cb_name,
-			     void *priv)
-{
-	struct teamd_loop_callback *lcb;
-	struct teamd_loop_callback *tmp;
-	bool found = false;
-
-	for_each_lcb_multi_match_safe(lcb, tmp, ctx, cb_name, priv) {
-		list_del(&lcb->list);
-		if (lcb->is_period)
-			close(lcb->fd);
-		teamd_log_dbg("Removed loop callback: %s, %p",
-			      lcb->name, lcb->priv);
-		free(lcb->name);
-		free(lcb);
-		found = true;
-	}
-	if (found)
-		teamd_run_loop_restart(ctx);
-	else
-		teamd_log_dbg("Callback named \"%s\" not found.", cb_name);
-}
-
-int teamd_loop_callback_enable(struct teamd_context *ctx, const char *cb_name,
-			       void *priv)
-{
-	struct teamd_loop_callback *lcb;
-	bool found = false;
-
-	for_each_lcb_multi_match(lcb, ctx, cb_name, priv) {
-		lcb->enabled = true;
-		found = true;
-	}
-	if (!found)
-		return -ENOENT;
-	teamd_run_loop_restart(ctx);
-	return 0;
-}
-
-int teamd_loop_callback_disable(struct teamd_context *ctx, const char *cb_name,
-				void *priv)
-{
-	struct teamd_loop_callback *lcb;
-	bool found = false;
-
-	for_each_lcb_multi_match(lcb, ctx, cb_name, priv) {
-		lcb->enabled = false;
-		found = true;
-	}
-	if (!found)
-		return -ENOENT;
-	teamd_run_loop_restart(ctx);
-	return 0;
-}
-
-static int callback_daemon_signal(struct teamd_context *ctx, int events,
-				  void *priv)
-{
-	int sig;
-
-	/* Get signal */
-	if ((sig = daemon_signal_next()) <= 0) {
-		teamd_log_err("daemon_signal_next() failed.");
-		return -EINVAL;
-	}
-
-	/* Dispatch signal */
-	switch (sig) {
-	case SIGINT:
-	case SIGQUIT:
-	case SIGTERM:
-		teamd_log_warn("Got SIGINT, SIGQUIT or SIGTERM.");
-		teamd_run_loop_quit(ctx, 0);
-		break;
-	}
-	return 0;
-}
-
-static int callback_libteam_event(struct teamd_context *ctx, int events,
-				  void *priv)
-{
-	return team_handle_events(ctx->th);
-}
-
-#define DAEMON_CB_NAME "daemon"
-#define LIBTEAM_EVENTS_CB_NAME "libteam_events"
-
-static int teamd_run_loop_init(struct teamd_context *ctx)
-{
-	int fds[2];
-	int err;
-
-	list_init(&ctx->run_loop.callback_list);
-	err = pipe(fds);
-	if (err)
-		return -errno;
-	ctx->run_loop.ctrl_pipe_r = fds[0];
-	ctx->run_loop.ctrl_pipe_w = fds[1];
-
-	err = teamd_loop_callback_fd_add(ctx, DAEMON_CB_NAME, ctx,
-					 callback_daemon_signal,
-					 daemon_signal_fd(),
-					 TEAMD_LOOP_FD_EVENT_READ);
-	if (err) {
-		teamd_log_err("Failed to add daemon loop callback");
-		goto close_pipe;
-	}
-
-	err = teamd_loop_callback_fd_add(ctx, LIBTEAM_EVENTS_CB_NAME, ctx,
-					 callback_libteam_event,
-					 team_get_event_fd(ctx->th),
-					 TEAMD_LOOP_FD_EVENT_READ);
-	if (err) {
-		teamd_log_err("Failed to add libteam event loop callback");
-		goto del_daemon_callback;
-	}
-
-	teamd_loop_callback_enable(ctx, DAEMON_CB_NAME, ctx);
-	teamd_loop_callback_enable(ctx, LIBTEAM_EVENTS_CB_NAME, ctx);
-
-	return 0;
-
-del_daemon_callback:
-	teamd_loop_callback_del(ctx, DAEMON_CB_NAME, ctx);
-
-close_pipe:
-	close(ctx->run_loop.ctrl_pipe_r);
-	close(ctx->run_loop.ctrl_pipe_w);
-	return err;
-}
-
-static void teamd_run_loop_fini(struct teamd_context *ctx)
-{
-	teamd_loop_callback_del(ctx, LIBTEAM_EVENTS_CB_NAME, NULL);
-	teamd_loop_callback_del(ctx, DAEMON_CB_NAME, ctx);
-	close(ctx->run_loop.ctrl_pipe_r);
-	close(ctx->run_loop.ctrl_pipe_w);
-}
-
-static int parse_hwaddr(const char *hwaddr_str, char **phwaddr,
-			unsigned int *plen)
-{
-	const char *pos = hwaddr_str;
-	unsigned int byte_count = 0;
-	unsigned int tmp;
-	int err;
-	char *hwaddr = NULL;
-	char *new_hwaddr;
-	char *endptr;
-
-	while (true) {
-		errno = 0;
-		tmp = strtoul(pos, &endptr, 16);
-		if (errno != 0 || tmp > 0xFF) {
-			err = -EINVAL;
-			goto err_out;
-		}
-		byte_count++;
-		new_hwaddr = realloc(hwaddr, sizeof(char) * byte_count);
-		if (!new_hwaddr) {
-			err = -ENOMEM;
-			goto err_out;
-		}
-		hwaddr = new_hwaddr;
-		hwaddr[byte_count - 1] = (char) tmp;
-		while (isspace(endptr[0]) && endptr[0] != '\0')
-			endptr++;
-		if (endptr[0] == ':') {
-			pos = endptr + 1;
-		} else if (endptr[0] == '\0') {
-			break;
-		} else {
-			err = -EINVAL;
-			goto err_out;
-		}
-	}
-	*phwaddr = hwaddr;
-	*plen = byte_count;
-	return 0;
-err_out:
-	free(hwaddr);
-	return err;
-}
-
-static int teamd_set_hwaddr(struct teamd_context *ctx)
-{
-	int err;
-	const char *hwaddr_str;
-	char *hwaddr;
-	unsigned int hwaddr_len;
-
-	err = teamd_config_string_get(ctx, &hwaddr_str, "$.hwaddr");
-	if (err)
-		return 0; /* addr is not defined in config, no change needed */
-
-	teamd_log_dbg("Hwaddr string: \"%s\".", hwaddr_str);
-	err = parse_hwaddr(hwaddr_str, &hwaddr, &hwaddr_len);
-	if (err) {
-		teamd_log_err("Failed to parse hardware address.");
-		return err;
-	}
-
-	if (hwaddr_len != ctx->hwaddr_len) {
-		teamd_log_err("Passed hardware address has different length (%d) than team device has (%d).",
-			      hwaddr_len, ctx->hwaddr_len);
-		err = -EINVAL;
-		goto free_hwaddr;
-	}
-	err = team_hwaddr_set(ctx->th, ctx->ifindex, hwaddr, hwaddr_len);
-	if (!err)
-		ctx->hwaddr_explicit = true;
-free_hwaddr:
-	free(hwaddr);
-	return err;
-}
-
-static int teamd_add_ports(struct teamd_context *ctx)
-{
-	int err;
-	const char *key;
-
-	ctx->pre_add_ports = false;
-	if (ctx->init_no_ports)
-		return 0;
-
-	teamd_config_for_each_key(key, ctx, "$.ports") {
-		err = teamd_port_add_ifname(ctx, key);
-		if (err)
-			return err;
-	}
-	return 0;
-}
-
-static int teamd_hwaddr_check_change(struct teamd_context *ctx,
-				     struct teamd_port *tdport)
-{
-	char *hwaddr;
-	unsigned char hwaddr_len;
-	int err;
-
-	if (ctx->port_obj_list_count != 1 || ctx->hwaddr_explicit)
-		return 0;
-	hwaddr = team_get_ifinfo_orig_hwaddr(tdport->team_ifinfo);
-	hwaddr_len = team_get_ifinfo_orig_hwaddr_len(tdport->team_ifinfo);
-	if (hwaddr_len != ctx->hwaddr_len) {
-		teamd_log_err("%s: Port original hardware address has different length (%d) than team device has (%d).",
-			      tdport->ifname, hwaddr_len, ctx->hwaddr_len);
-		return -EINVAL;
-	}
-	err = team_hwaddr_set(ctx->th, ctx->ifindex, hwaddr, hwaddr_len);
-	if (err) {
-		teamd_log_err("Failed to set team device hardware address.");
-		return err;
-	}
-	ctx->hwaddr = hwaddr;
-	return 0;
-}
-
-static int teamd_event_watch_port_added(struct teamd_context *ctx,
-					struct teamd_port *tdport, void *priv)
-{
-	int err;
-	int tmp;
-
-	if (!ctx->pre_add_ports) {
-		err = teamd_hwaddr_check_change(ctx, tdport);
-		if (err)
-			return err;
-	}
-
-	err = teamd_config_int_get(ctx, &tmp, "$.ports.%s.queue_id",
-				   tdport->ifname);
-	if (!err) {
-		uint32_t queue_id;
-
-		if (tmp < 0) {
-			teamd_log_err("%s: \"queue_id\" must not be negative number.",
-				      tdport->ifname);
-			return -EINVAL;
-		}
-		queue_id = tmp;
-		err = team_set_port_queue_id(ctx->th, tdport->ifindex,
-					     queue_id);
-		if (err) {
-			teamd_log_err("%s: Failed to set \"queue_id\".",
-				      tdport->ifname);
-			return err;
-		}
-	}
-	err = teamd_config_int_get(ctx, &tmp, "$.ports.%s.prio",
-				   tdport->ifname);
-	if (err)
-		tmp = 0;
-	err = team_set_port_priority(ctx->th, tdport->ifindex, tmp);
-	if (err) {
-		teamd_log_err("%s: Failed to set \"priority\".",
-			      tdport->ifname);
-		return err;
-	}
-	return 0;
-}
-
-static const struct teamd_event_watch_ops teamd_port_watch_ops = {
-	.port_added = teamd_event_watch_port_added,
-};
-
-static int teamd_port_watch_init(struct teamd_context *ctx)
-{
-	return teamd_event_watch_register(ctx, &teamd_port_watch_ops, NULL);
-}
-
-static void teamd_port_watch_fini(struct teamd_context *ctx)
-{
-	teamd_event_watch_unregister(ctx, &teamd_port_watch_ops, NULL);
-}
-
-static int teamd_runner_init(struct teamd_context *ctx)
-{
-	int err;
-	const char *runner_name;
-
-	err = teamd_config_string_get(ctx, &runner_name, "$.runner.name");
-	if (err) {
-		teamd_log_dbg("Failed to get team runner name from config.");
-		runner_name = TEAMD_DEFAULT_RUNNER_NAME;
-		err = teamd_config_string_set(ctx, runner_name, "$.runner.name");
-		if (err) {
-			teamd_log_err("Failed to set default team runner name in config.");
-			return err;
-		}
-		teamd_log_dbg("Using default team runner \"%s\".", runner_name);
-	} else {
-		teamd_log_dbg("Using team runner \"%s\".", runner_name);
-	}
-	ctx->runner = teamd_find_runner(runner_name);
-	if (!ctx->runner) {
-		teamd_log_err("No runner named \"%s\" available.", runner_name);
-		return -EINVAL;
-	}
-
-	if (ctx->runner->team_mode_name) {
-		char *cur_mode;
-		const char *new_mode = ctx->runner->team_mode_name;
-
-		err = team_get_mode_name(ctx->th, &cur_mode);
-		if (err) {
-			teamd_log_err("Failed to det team mode.");
-			return err;
-		}
-		if (strcmp(cur_mode, new_mode)) {
-			err = team_set_mode_name(ctx->th, new_mode);
-			if (err) {
-				teamd_log_err("Failed to set team mode \"%s\".",
-					      new_mode);
-				return err;
-			}
-		}
-	} else {
-		teamd_log_warn("Note \"%s\" runner does not select team mode resulting in no functionality!",
-			       runner_name);
-	}
-
-	if (ctx->runner->priv_size) {
-		ctx->runner_priv = myzalloc(ctx->runner->priv_size);
-		if (!ctx->runner_priv)
-			return -ENOMEM;
-	}
-
-	if (ctx->runner->init) {
-		err = ctx->runner->init(ctx, ctx->runner_priv);
-		if (err)
-			goto free_runner_priv;
-	}
-	return 0;
-
-free_runner_priv:
-	free(ctx->runner_priv);
-	return err;
-}
-
-static void teamd_runner_fini(struct teamd_context *ctx)
-{
-	if (ctx->runner->fini)
-		ctx->runner->fini(ctx, ctx->runner_priv);
-	free(ctx->runner_priv);
-	ctx->runner = NULL;
-}
-
-static int teamd_post_runner_init(struct teamd_context *ctx)
-{
-	int err;
-	int tmp;
-
-	err = teamd_config_int_get(ctx, &tmp, "$.notify_peers.count");
-	if (!err) {
-		uint32_t count;
-
-		if (tmp < 0) {
-			teamd_log_err("\"count\" must not be negative number.");
-			return -EINVAL;
-		}
-		count = tmp;
-		err = team_set_notify_peers_count(ctx->th, count);
-		if (err) {
-			if (err == -ENOENT) {
-				teamd_log_warn("Failed to set \"notify_peers_count\". Kernel probably does not support this option yet.");
-			} else {
-				teamd_log_err("Failed to set \"notify_peers_count\".");
-				return err;
-			}
-		}
-	}
-	err = teamd_config_int_get(ctx, &tmp, "$.notify_peers.interval");
-	if (!err) {
-		uint32_t interval;
-
-		if (tmp < 0) {
-			teamd_log_err("\"interval\" must not be negative number.");
-			return -EINVAL;
-		}
-		interval = tmp;
-		err = team_set_notify_peers_interval(ctx->th, interval);
-		if (err) {
-			if (err == -ENOENT) {
-				teamd_log_warn("Failed to set \"notify_peers_interval\". Kernel probably does not support this option yet.");
-			} else {
-				teamd_log_err("Failed to set \"notify_peers_interval\".");
-				return err;
-			}
-		}
-	}
-	err = teamd_config_int_get(ctx, &tmp, "$.mcast_rejoin.count");
-	if (!err) {
-		uint32_t count;
-
-		if (tmp < 0) {
-			teamd_log_err("\"count\" must not be negative number.");
-			return -EINVAL;
-		}
-		count = tmp;
-		err = team_set_mcast_rejoin_count(ctx->th, count);
-		if (err) {
-			if (err == -ENOENT) {
-				teamd_log_warn("Failed to set \"mcast_rejoin_count\". Kernel probably does not support this option yet.");
-			} else {
-				teamd_log_err("Failed to set \"mcast_rejoin_count\".");
-				return err;
-			}
-		}
-	}
-	err = teamd_config_int_get(ctx, &tmp, "$.mcast_rejoin.interval");
-	if (!err) {
-		uint32_t interval;
-
-		if (tmp < 0) {
-			teamd_log_err("\"interval\" must not be negative number.");
-			return -EINVAL;
-		}
-		interval = tmp;
-		err = team_set_mcast_rejoin_interval(ctx->th, interval);
-		if (err) {
-			if (err == -ENOENT) {
-				teamd_log_warn("Failed to set \"mcast_rejoin_interval\". Kernel probably does not support this option yet.");
-			} else {
-				teamd_log_err("Failed to set \"mcast_rejoin_interval\".");
-				return err;
-			}
-		}
-	}
-	return 0;
-}
-
-static void debug_log_port_list(struct teamd_context *ctx)
-{
-	struct team_port *port;
-	char buf[120];
-	bool trunc;
-
-	teamd_log_dbg("<port_list>");
-	team_for_each_port(port, ctx->th) {
-		trunc = team_port_str(port, buf, sizeof(buf));
-		teamd_log_dbg("%s %s", buf, trunc ? "<trunc>" : "");
-	}
-	teamd_log_dbg("</port_list>");
-}
-
-static void debug_log_option_list(struct teamd_context *ctx)
-{
-	struct team_option *option;
-	char buf[120];
-	bool trunc;
-
-	teamd_log_dbgx(ctx, 2, "<changed_option_list>");
-	team_for_each_option(option, ctx->th) {
-		if (!team_is_option_changed(option) ||
-		    team_is_option_changed_locally(option))
-			continue;
-		trunc = team_option_str(ctx->th, option, buf, sizeof(buf));
-		teamd_log_dbgx(ctx, 2, "%s %s", buf, trunc ? "<trunc>" : "");
-	}
-	teamd_log_dbgx(ctx, 2, "</changed_option_list>");
-}
-
-static void debug_log_ifinfo_list(struct teamd_context *ctx)
-{
-	struct team_ifinfo *ifinfo;
-	char buf[120];
-	bool trunc;
-
-	teamd_log_dbg("<ifinfo_list>");
-	team_for_each_ifinfo(ifinfo, ctx->th) {
-		trunc = team_ifinfo_str(ifinfo, buf, sizeof(buf));
-		teamd_log_dbg("%s %s", buf, trunc ? "<trunc>" : "");
-	}
-	teamd_log_dbg("</ifinfo_list>");
-}
-
-static int debug_change_handler_func(struct team_handle *th, void *priv,
-				     team_change_type_mask_t type_mask)
-{
-	struct teamd_context *ctx = priv;
-
-	if (type_mask & TEAM_PORT_CHANGE)
-		debug_log_port_list(ctx);
-	if (type_mask & TEAM_OPTION_CHANGE)
-		debug_log_option_list(ctx);
-	if (type_mask & TEAM_IFINFO_CHANGE)
-		debug_log_ifinfo_list(ctx);
-	return 0;
-}
-
-static const struct team_change_handler debug_change_handler = {
-	.func = debug_change_handler_func,
-	.type_mask = TEAM_PORT_CHANGE | TEAM_OPTION_CHANGE | TEAM_IFINFO_CHANGE,
-};
-
-static int teamd_register_debug_handler(struct teamd_context *ctx)
-{
-	return team_change_handler_register_head(ctx->th,
-						 &debug_change_handler, ctx);
-}
-
-static int teamd_register_default_handlers(struct teamd_context *ctx)
-{
-	if (!ctx->debug)
-		return 0;
-	return teamd_register_debug_handler(ctx);
-}
-
-static void teamd_unregister_debug_handler(struct teamd_context *ctx)
-{
-	team_change_handler_unregister(ctx->th, &debug_change_handler, ctx);
-}
-
-static void teamd_unregister_default_handlers(struct teamd_context *ctx)
-{
-	if (!ctx->debug)
-		return;
-	teamd_unregister_debug_handler(ctx);
-}
-
-int teamd_change_debug_level(struct teamd_context *ctx, unsigned int new_debug)
-{
-	int err = 0;
-
-	if (!ctx->debug && new_debug) {
-		daemon_set_verbosity(LOG_DEBUG);
-		err = teamd_register_debug_handler(ctx);
-	}
-	if (ctx->debug && !new_debug) {
-		daemon_set_verbosity(LOG_WARNING);
-		teamd_unregister_debug_handler(ctx);
-	}
-	if (err)
-		return err;
-	ctx->debug = new_debug;
-	return 0;
-}
-
-static int teamd_init(struct teamd_context *ctx)
-{
-	int err;
-
-	ctx->th = team_alloc();
-	if (!ctx->th) {
-		teamd_log_err("Team alloc failed.");
-		return -ENOMEM;
-	}
-	if (ctx->debug)
-		team_set_log_priority(ctx->th, LOG_DEBUG);
-
-	team_set_log_fn(ctx->th, libteam_log_daemon);
-
-	ctx->ifindex = team_ifname2ifindex(ctx->th, ctx->team_devname);
-	if (ctx->ifindex && ctx->take_over)
-		goto skip_create;
-
-	if (ctx->force_recreate)
-		err = team_recreate(ctx->th, ctx->team_devname);
-	else
-		err = team_create(ctx->th, ctx->team_devname);
-	if (err) {
-		teamd_log_err("Failed to create team device.");
-		goto team_free;
-	}
-
-	ctx->ifindex = team_ifname2ifindex(ctx->th, ctx->team_devname);
-	if (!ctx->ifindex) {
-		teamd_log_err("Netdevice \"%s\" not found.", ctx->team_devname);
-		err = -ENODEV;
-		goto team_destroy;
-	}
-skip_create:
-
-	err = team_init(ctx->th, ctx->ifindex);
-	if (err) {
-		teamd_log_err("Team init failed.");
-		goto team_destroy;
-	}
-
-	ctx->ifinfo = team_get_ifinfo(ctx->th);
-	ctx->hwaddr = team_get_ifinfo_hwaddr(ctx->ifinfo);
-	ctx->hwaddr_len = team_get_ifinfo_hwaddr_len(ctx->ifinfo);
-
-	err = teamd_set_hwaddr(ctx);
-	if (err) {
-		teamd_log_err("Hardware address set failed.");
-		goto team_destroy;
-	}
-
-	err = teamd_run_loop_init(ctx);
-	if (err) {
-		teamd_log_err("Failed to init run loop.");
-		goto team_destroy;
-	}
-
-	err = teamd_workq_init(ctx);
-	if (err) {
-		teamd_log_err("Failed to init workq.");
-		goto run_loop_fini;
-	}
-
-	err = teamd_register_default_handlers(ctx);
-	if (err) {
-		teamd_log_err("Failed to register debug event handlers.");
-		goto workq_fini;
-	}
-
-	err = teamd_events_init(ctx);
-	if (err) {
-		teamd_log_err("Failed to init events infrastructure.");
-		goto team_unreg_debug_handlers;
-	}
-
-	err = teamd_option_watch_init(ctx);
-	if (err) {
-		teamd_log_err("Failed to init option watches.");
-		goto events_fini;
-	}
-
-	err = teamd_ifinfo_watch_init(ctx);
-	if (err) {
-		teamd_log_err("Failed to init ifinfo watches.");
-		goto option_watch_fini;
-	}
-
-	err = teamd_port_watch_init(ctx);
-	if (err) {
-		teamd_log_err("Failed to init port watch.");
-		goto ifinfo_watch_fini;
-	}
-
-	err = teamd_state_init(ctx);
-	if (err) {
-		teamd_log_err("Failed to init state json infrastructure.");
-		goto port_watch_fini;
-	}
-
-	err = teamd_per_port_init(ctx);
-	if (err) {
-		teamd_log_err("Failed to init per-port.");
-		goto state_fini;
-	}
-
-	err = teamd_link_watch_init(ctx);
-	if (err) {
-		teamd_log_err("Failed to init link watch.");
-		goto per_port_fini;
-	}
-
-	err = teamd_runner_init(ctx);
-	if (err) {
-		teamd_log_err("Failed to init runner.");
-		goto link_watch_fini;
-	}
-
-	err = teamd_post_runner_init(ctx);
-	if (err) {
-		teamd_log_err("Failed to do post-runner initializations.");
-		goto runner_fini;
-	}
-
-	err = teamd_state_basics_init(ctx);
-	if (err) {
-		teamd_log_err("Failed to init state json basics.");
-		goto runner_fini;
-	}
-
-	err = teamd_phys_port_check_init(ctx);
-	if (err) {
-		teamd_log_err("Failed to init SR-IOV support.");
-		goto state_basics_fini;
-	}
-
-	err = teamd_usock_init(ctx);
-	if (err) {
-		teamd_log_err("Failed to init unix domain socket.");
-		goto phys_port_check_fini;
-	}
-
-	err = teamd_dbus_init(ctx);
-	if (err) {
-		teamd_log_err("Failed to init dbus.");
-		goto usock_fini;
-	}
-
-	err = teamd_zmq_init(ctx);
-	if (err) {
-		teamd_log_err("Failed to init zmq.");
-		goto dbus_fini;
-	}
-
-	ctx->pre_add_ports = true;
-	err = team_refresh(ctx->th);
-	if (err) {
-		teamd_log_err("Team refresh failed.");
-		goto zmq_fini;
-	}
-
-	err = teamd_add_ports(ctx);
-	if (err) {
-		teamd_log_err("Failed to add ports.");
-		goto zmq_fini;
-	}
-
-	/*
-	 * Expose name as the last thing so watchers like systemd
-	 * knows we are here and all ready.
-	 */
-	err = teamd_dbus_expose_name(ctx);
-	if (err) {
-		teamd_log_err("Failed to expose dbus name.");
-		goto zmq_fini;
-	}
-
-	return 0;
-zmq_fini:
-	teamd_zmq_fini(ctx);
-dbus_fini:
-	teamd_dbus_fini(ctx);
-usock_fini:
-	teamd_usock_fini(ctx);
-phys_port_check_fini:
-	teamd_phys_port_check_fini(ctx);
-state_basics_fini:
-	teamd_state_basics_fini(ctx);
-runner_fini:
-	teamd_runner_fini(ctx);
-link_watch_fini:
-	teamd_link_watch_fini(ctx);
-per_port_fini:
-	teamd_per_port_fini(ctx);
-state_fini:
-	teamd_state_fini(ctx);
-port_watch_fini:
-	teamd_port_watch_fini(ctx);
-ifinfo_watch_fini:
-	teamd_ifinfo_watch_fini(ctx);
-option_watch_fini:
-	teamd_option_watch_fini(ctx);
-events_fini:
-	teamd_events_fini(ctx);
-team_unreg_debug_handlers:
-	teamd_unregister_default_handlers(ctx);
-workq_fini:
-	teamd_workq_fini(ctx);
-run_loop_fini:
-	teamd_run_loop_fini(ctx);
-team_destroy:
-	if (!ctx->take_over)
-		team_destroy(ctx->th);
-team_free:
-	team_free(ctx->th);
-	return err;
-}
-
-static void teamd_fini(struct teamd_context *ctx)
-{
-	teamd_zmq_fini(ctx);
-	teamd_dbus_fini(ctx);
-	teamd_usock_fini(ctx);
-	teamd_phys_port_check_fini(ctx);
-	teamd_state_basics_fini(ctx);
-	teamd_runner_fini(ctx);
-	teamd_link_watch_fini(ctx);
-	teamd_per_port_fini(ctx);
-	teamd_state_fini(ctx);
-	teamd_ifinfo_watch_fini(ctx);
-	teamd_option_watch_fini(ctx);
-	teamd_events_fini(ctx);
-	teamd_unregister_default_handlers(ctx);
-	teamd_workq_fini(ctx);
-	teamd_run_loop_fini(ctx);
-	if (!ctx->no_quit_destroy)
-		team_destroy(ctx->th);
-	team_free(ctx->th);
-}
-
 static int teamd_start(struct teamd_context *ctx, enum teamd_exit_code *p_ret)
 {
 	pid_t pid;
@@ -1508,12 +309,21 @@ static int teamd_start(struct teamd_context *ctx, enum teamd_exit_code *p_ret)
 		goto pid_file_remove;
 	}
 
-	err = teamd_init(ctx);
+	if (ctx->multi.enabled)
+		err = teamd_multi_init(ctx);
+	else
+		err = teamd_init(ctx);
 	if (err) {
 		teamd_log_err("teamd_init() failed.");
 		daemon_retval_send(-err);
 		goto signal_done;
 	}
+	err = teamd_realtime_init(ctx);
+	if (err) {
+		teamd_log_err("Failed to enable realtime mode.");
+		daemon_retval_send(-err);
+		goto fini;
+	}
 	*p_ret = TEAMD_EXIT_RUNTIME_FAILURE;
 
 	daemon_retval_send(0);
@@ -1524,7 +334,11 @@ static int teamd_start(struct teamd_context *ctx, enum teamd_exit_code *p_ret)
 
 	teamd_log_info("Exiting...");
 
-	teamd_fini(ctx);
+fini:
+	if (ctx->multi.enabled)
+		teamd_multi_fini(ctx);
+	else
+		teamd_fini(ctx);
 
 signal_done:
 	daemon_signal_done();
@@ -1535,68 +349,19 @@ pid_file_remove:
 	return err;
 }
 
-static int teamd_generate_devname(struct teamd_context *ctx)
-{
-	char buf[IFNAMSIZ];
-	int i = 0;
-	uint32_t ifindex = ifindex;
-	int ret;
-	int err;
-
-	do {
-		ret = snprintf(buf, sizeof(buf),
-			       TEAMD_DEFAULT_DEVNAME_PREFIX "%d", i++);
-		if (ret >= sizeof(buf))
-			return -EINVAL;
-		err = ifname2ifindex(&ifindex, buf);
-		if (err)
-			return err;
-	} while (ifindex);
-	teamd_log_dbg("Generated team device name \"%s\".", buf);
-
-	ctx->team_devname = strdup(buf);
-	if (!ctx->team_devname)
-		return -ENOMEM;
-	return 0;
-}
-
-static int teamd_get_devname(struct teamd_context *ctx, bool generate_enabled)
+static int teamd_multi_get_name(struct teamd_context *ctx)
 {
 	int err;
 
 	if (!ctx->team_devname) {
-		const char *team_name;
-
-		err = teamd_config_string_get(ctx, &team_name, "$.device");
-		if (!err) {
-			ctx->team_devname = strdup(team_name);
-			if (!ctx->team_devname) {
-				teamd_log_err("Failed allocate memory for device name.");
-				return -ENOMEM;
-			}
-			goto skip_set;
-		} else {
-			teamd_log_dbg("Failed to get team device name from config.");
-			if (generate_enabled) {
-				err = teamd_generate_devname(ctx);
-				if (err) {
-					teamd_log_err("Failed to generate team device name.");
-					return err;
-				}
-			} else {
-				teamd_log_err("Team device name not specified.");
-				return -EINVAL;
-			}
+		ctx->team_devname = strdup(TEAMD_MULTI_DEFAULT_NAME);
+		if (!ctx->team_devname) {
+			teamd_log_err("Failed allocate memory for instance name.");
+			return -ENOMEM;
 		}
 	}
-	err = teamd_config_string_set(ctx, ctx->team_devname, "$.device");
-	if (err) {
-		teamd_log_err("Failed to set team device name in config.");
-		return err;
-	}
-
-skip_set:
-	teamd_log_dbg("Using team device \"%s\".", ctx->team_devname);
+	teamd_log_dbg("Using multi-team instance name \"%s\".",
+		      ctx->team_devname);
 
 	err = asprintf(&ctx->ident, "%s_%s", ctx->argv0, ctx->team_devname);
 	if (err == -1) {
@@ -1653,16 +418,6 @@ static int teamd_context_init(struct teamd_context **pctx)
 	return 0;
 }
 
-static void teamd_context_fini(struct teamd_context *ctx)
-{
-	free(ctx->ident);
-	free(ctx->team_devname);
-	free(ctx->config_text);
-	free(ctx->config_file);
-	free(ctx->pid_file);
-	free(ctx);
-}
-
 int main(int argc, char **argv)
 {
 	enum teamd_exit_code ret = TEAMD_EXIT_FAILURE;
@@ -1709,7 +464,10 @@ int main(int argc, char **argv)
 
 	teamd_init_debug_level(ctx);
 
-	err = teamd_get_devname(ctx, ctx->cmd == DAEMON_CMD_RUN);
+	if (ctx->multi.enabled)
+		err = teamd_multi_get_name(ctx);
+	else
+		err = teamd_get_devname(ctx, ctx->cmd == DAEMON_CMD_RUN);
 	if (err)
 		goto config_free;
 
@@ -30,11 +30,13 @@
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <assert.h>
+#include <pthread.h>
 #include <jansson.h>
 #include <linux/filter.h>
 #include <linux/if_packet.h>
 #include <team.h>
 #include <private/list.h>
+#include <private/hash.h>
 
 #include "config.h"
 
@@ -92,6 +94,51 @@ enum teamd_command {
 
 struct teamd_runner;
 struct teamd_context;
+struct teamd_loop_fd;
+struct teamd_loop_callback;
+
+/*
+ * Loop callback priority classes. Ready callbacks of higher class are
+ * always dispatched first.
+ */
+enum teamd_loop_prio {
+	TEAMD_LOOP_PRIO_LINK, /* link state and failover decisions */
+	TEAMD_LOOP_PRIO_PROTOCOL, /* protocol packets and periodic work */
+	TEAMD_LOOP_PRIO_CONTROL, /* control interfaces (usock, D-Bus, ZMQ) */
+	TEAMD_LOOP_PRIO_COUNT,
+};
+
+/* Run loop, shared by all team contexts hosted in one process */
+struct teamd_run_loop {
+	struct list_item		callback_list;
+	struct list_item		ready_list[TEAMD_LOOP_PRIO_COUNT];
+	struct hash_table		lcb_table;
+	struct hash_table		name_table;
+	struct teamd_loop_fd **		fd_table;
+	unsigned int			fd_table_size;
+	int				epfd;
+	struct {
+		struct teamd_loop_callback **	heap;
+		unsigned int			heap_count;
+		unsigned int			heap_size;
+		unsigned int			count;
+		unsigned int			resolution_ns;
+		uint64_t			fd_deadline;
+		uint64_t			wakeups;
+		uint64_t			expirations;
+		int				fd;
+	} timers;
+	struct teamd_loop_callback *	current_lcb;
+	unsigned int			stall_budget_ms;
+	unsigned int			low_prio_budget_ms;
+	uint64_t			low_prio_deferrals;
+	uint64_t			stalls;
+	uint64_t			iterations;
+	int				ctrl_pipe_r;
+	int				ctrl_pipe_w;
+	int				err;
+	unsigned int			refcount;
+};
 
 struct teamd_context {
 	enum teamd_command		cmd;
@@ -102,6 +149,7 @@ struct teamd_context {
 	bool				no_quit_destroy;
 	bool				init_no_ports;
 	bool				pre_add_ports;
+	uint32_t			emul_port;
 	char *				config_file;
 	char *				config_text;
 	json_t *			config_json;
@@ -116,6 +164,12 @@ struct teamd_context {
 	unsigned int			port_obj_list_count;
 	struct list_item                option_watch_list;
 	struct list_item		event_watch_list;
+	struct {
+		struct hash_table	name_table; /* option name -> watches */
+		struct list_item	any_list; /* watches of all options */
+		struct list_item	pending_list; /* families changed */
+		unsigned int		seq; /* registration order */
+	} option_watch_index;
 	struct list_item		state_ops_list;
 	struct list_item		state_val_list;
 	uint32_t			ifindex;
@@ -123,12 +177,7 @@ struct teamd_context {
 	char *				hwaddr;
 	uint32_t			hwaddr_len;
 	bool				hwaddr_explicit;
-	struct {
-		struct list_item		callback_list;
-		int				ctrl_pipe_r;
-		int				ctrl_pipe_w;
-		int				err;
-	} run_loop;
+	struct teamd_run_loop *		run_loop;
 #ifdef ENABLE_DBUS
 	struct {
 		bool			enabled;
@@ -151,9 +200,37 @@ struct teamd_context {
 	} usock;
 	struct {
 		struct list_item	work_list;
-		int			pipe_r;
-		int			pipe_w;
+		struct list_item	delayed_list; /* sorted by deadline */
+		int			efd;
+		bool			pending; /* efd written, not read yet */
+		struct teamd_loop_callback *	delayed_lcb;
 	} workq;
+	struct {
+		pthread_t *		threads; /* started on first job */
+		unsigned int		thread_count;
+		pthread_mutex_t		lock;
+		pthread_cond_t		cond;
+		struct list_item	job_list; /* waiting for a thread */
+		struct list_item	done_list; /* waiting for done func */
+		bool			quit;
+		int			efd;
+	} worker;
+	struct {
+		bool			enabled; /* hosting many teams */
+		struct teamd_context *	master; /* set for hosted team */
+		struct team_evmux *	evmux;
+		struct list_item	team_list;
+		struct list_item	list;
+		bool			quitting;
+		bool			flushed;
+		int			reap_pipe_r;
+		int			reap_pipe_w;
+	} multi;
+	struct {
+		bool			enabled;
+		int			priority; /* SCHED_FIFO, 0 if not used */
+		int			cpu; /* -1 if not pinned */
+	} realtime;
 };
 
 struct teamd_port {
@@ -189,6 +266,14 @@ struct teamd_event_watch_ops {
 	int (*option_changed)(struct teamd_context *ctx,
 			      struct team_option *option, void *priv);
 	char *option_changed_match_name;
+	/*
+	 * Called once per refresh with all changed options named
+	 * option_family_match_name (array items and per-port instances).
+	 */
+	int (*option_family_changed)(struct teamd_context *ctx,
+				     struct team_option **options,
+				     unsigned int option_count, void *priv);
+	char *option_family_match_name;
 };
 
 int teamd_event_port_added(struct teamd_context *ctx,
@@ -201,6 +286,8 @@ int teamd_event_port_link_changed(struct teamd_context *ctx,
 				  struct teamd_port *tdport);
 int teamd_event_option_changed(struct teamd_context *ctx,
 			       struct team_option *option);
+int teamd_event_option_changes_done(struct teamd_context *ctx);
+void teamd_event_option_changes_drop(struct teamd_context *ctx);
 int teamd_event_ifinfo_hwaddr_changed(struct teamd_context *ctx,
 				      struct team_ifinfo *ifinfo);
 int teamd_event_ifinfo_ifname_changed(struct teamd_context *ctx,
@@ -215,6 +302,8 @@ void teamd_event_watch_unregister(struct teamd_context *ctx,
 				  void *priv);
 
 /* Main loop callbacks */
+#define TEAMD_LOOP_TIMER_RESOLUTION_NS	1000000 /* 1ms */
+
 #define TEAMD_LOOP_FD_EVENT_READ	(1 << 0)
 #define TEAMD_LOOP_FD_EVENT_WRITE	(1 << 1)
 #define TEAMD_LOOP_FD_EVENT_EXCEPTION	(1 << 2)
@@ -228,19 +317,23 @@ typedef int (*teamd_loop_callback_func_t)(struct teamd_context *ctx,
 int teamd_loop_callback_fd_add(struct teamd_context *ctx,
 			       const char *cb_name, void *priv,
 			       teamd_loop_callback_func_t func,
-			       int fd, int fd_event);
+			       int fd, int fd_event,
+			       enum teamd_loop_prio prio);
 int teamd_loop_callback_fd_add_tail(struct teamd_context *ctx,
 				    const char *cb_name, void *priv,
 				    teamd_loop_callback_func_t func,
-				    int fd, int fd_event);
+				    int fd, int fd_event,
+				    enum teamd_loop_prio prio);
 int teamd_loop_callback_timer_add_set(struct teamd_context *ctx,
 				      const char *cb_name, void *priv,
 				      teamd_loop_callback_func_t func,
 				      struct timespec *interval,
-				      struct timespec *initial);
+				      struct timespec *initial,
+				      enum teamd_loop_prio prio);
 int teamd_loop_callback_timer_add(struct teamd_context *ctx,
 				  const char *cb_name, void *priv,
-				  teamd_loop_callback_func_t func);
+				  teamd_loop_callback_func_t func,
+				  enum teamd_loop_prio prio);
 int teamd_loop_callback_timer_set(struct teamd_context *ctx,
 				  const char *cb_name, void *priv,
 				  struct timespec *interval,
@@ -251,10 +344,49 @@ int teamd_loop_callback_enable(struct teamd_context *ctx, const char *cb_name,
 			       void *priv);
 int teamd_loop_callback_disable(struct teamd_context *ctx, const char *cb_name,
 				void *priv);
+
+/*
+ * Handles returned by teamd_loop_lcb_get() stay valid until the callback
+ * is deleted and let hot paths skip the name lookup.
+ */
+struct teamd_loop_callback *teamd_loop_lcb_get(struct teamd_context *ctx,
+					       const char *cb_name,
+					       void *priv);
+int teamd_loop_lcb_timer_set(struct teamd_context *ctx,
+			     struct teamd_loop_callback *lcb,
+			     struct timespec *interval,
+			     struct timespec *initial);
+int teamd_loop_lcb_enable(struct teamd_context *ctx,
+			  struct teamd_loop_callback *lcb);
+int teamd_loop_lcb_disable(struct teamd_context *ctx,
+			   struct teamd_loop_callback *lcb);
+
+int teamd_loop_init(struct teamd_context *ctx);
+void teamd_loop_attach(struct teamd_context *ctx,
+		       struct teamd_context *master);
+void teamd_loop_fini(struct teamd_context *ctx);
+int teamd_run_loop_run(struct teamd_context *ctx);
 void teamd_run_loop_quit(struct teamd_context *ctx, int err);
 void teamd_run_loop_restart(struct teamd_context *ctx);
+int teamd_flush_ports(struct teamd_context *ctx);
 
+int teamd_init(struct teamd_context *ctx);
+void teamd_fini(struct teamd_context *ctx);
+int teamd_get_devname(struct teamd_context *ctx, bool generate_enabled);
+void teamd_context_fini(struct teamd_context *ctx);
 int teamd_change_debug_level(struct teamd_context *ctx, unsigned int new_debug);
+int teamd_realtime_init(struct teamd_context *ctx);
+
+int teamd_multi_init(struct teamd_context *ctx);
+void teamd_multi_fini(struct teamd_context *ctx);
+int teamd_multi_team_add(struct teamd_context *ctx, const char *config_text);
+int teamd_multi_team_remove(struct teamd_context *ctx,
+			    const char *team_devname);
+
+static inline bool teamd_multi_has_teams(struct teamd_context *ctx)
+{
+	return ctx->multi.enabled && !list_empty(&ctx->multi.team_list);
+}
 
 /* Runner structures */
 extern const struct teamd_runner teamd_runner_broadcast;
@@ -264,6 +396,9 @@ extern const struct teamd_runner teamd_runner_activebackup;
 extern const struct teamd_runner teamd_runner_loadbalance;
 extern const struct teamd_runner teamd_runner_lacp;
 
+extern const struct teamd_runner *teamd_runner_list[];
+extern const unsigned int teamd_runner_list_size;
+
 struct teamd_port_priv {
 	int (*init)(struct teamd_context *ctx, struct teamd_port *tdport,
 		    void *this_priv, void *creator_priv);
@@ -359,6 +494,15 @@ int teamd_sendto(int sockfd, const void *buf, size_t len, int flags,
 int teamd_recvfrom(int sockfd, void *buf, size_t len, int flags,
 		   struct sockaddr *src_addr, socklen_t addrlen);
 
+/* Frames received by one teamd_recvmmsg() call at most */
+#define TEAMD_MMSG_BATCH 16
+
+void teamd_mmsg_init(struct mmsghdr *msgvec, struct iovec *iov,
+		     unsigned int vlen, void *buf, size_t len,
+		     void *addrs, socklen_t addrlen);
+int teamd_recvmmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen,
+		   int flags);
+
 /* Various helpers */
 static inline void ms_to_timespec(struct timespec *ts, int ms)
 {
@@ -38,8 +38,11 @@ struct tb_hash_info {
 	uint8_t hash;
 	struct tb_stats stats;
 	struct teamd_port *tdport;
+	struct team_option_handle *mapping_oh;
 	struct {
 		bool processed;
+		int txn_index; /* -1 in case hash is not remapped */
+		struct teamd_port *tdport;
 	} rebalance;
 };
 
@@ -171,6 +174,7 @@ static void tb_clear_rebalance_data(struct teamd_balancer *tb)
 	}
 	for (i = 0; i < HASH_COUNT; i++) {
 		tb->hash_info[i].rebalance.processed = false;
+		tb->hash_info[i].rebalance.txn_index = -1;
 	}
 }
 
@@ -180,35 +184,56 @@ static int tb_hash_to_port_remap(struct team_handle *th,
 {
 	struct team_option *option;
 	struct teamd_port *new_tdport = tbpi->tdport;
-	uint8_t hash = tbhi->hash;
-	int err;
+	int ret;
 
 	if (tbhi->tdport == new_tdport)
 		return 0;
 
-	option = team_get_option(th, "na", "lb_tx_hash_to_port_mapping", hash);
+	option = team_option_handle_get_option(tbhi->mapping_oh);
 	if (!option)
 		return -ENOENT;
-	err = team_set_option_value_u32(th, option, new_tdport->ifindex);
-	if (err)
-		return err;
-	teamd_log_dbg("Remapped hash \"%u\" (delta %" PRIu64 ") to port %s.",
-		      hash, tb_stats_get_delta(&tbhi->stats),
-		      new_tdport->ifname);
+	ret = team_option_txn_set_value_u32(th, option, new_tdport->ifindex);
+	if (ret < 0)
+		return ret;
+	tbhi->rebalance.txn_index = ret;
+	tbhi->rebalance.tdport = new_tdport;
 	return 0;
 }
 
+static void tb_hash_to_port_remap_check(struct team_handle *th,
+					struct tb_hash_info *tbhi)
+{
+	int err;
+
+	if (tbhi->rebalance.txn_index < 0)
+		return;
+	err = team_option_txn_get_item_err(th, tbhi->rebalance.txn_index);
+	if (err) {
+		teamd_log_dbg("Failed to remap hash \"%u\" to port %s.",
+			      tbhi->hash, tbhi->rebalance.tdport->ifname);
+		return;
+	}
+	teamd_log_dbg("Remapped hash \"%u\" (delta %" PRIu64 ") to port %s.",
+		      tbhi->hash, tb_stats_get_delta(&tbhi->stats),
+		      tbhi->rebalance.tdport->ifname);
+}
+
 static int tb_rebalance(struct teamd_balancer *tb, struct team_handle *th)
 {
 	int err;
 	struct tb_hash_info *tbhi;
 	struct tb_port_info *tbpi;
+	int i;
 
 	if (!tb->tx_balancing_enabled)
 		return 0;
 
 	tb_clear_rebalance_data(tb);
 
+	/* All remaps of one round go to kernel in as few messages as fit */
+	err = team_option_txn_begin(th);
+	if (err)
+		return err;
 	while ((tbhi = tb_get_biggest_unprocessed_hash(tb)) &&
 	       (tbpi = tb_get_least_loaded_port(tb))) {
 		/* Do not remap zero delta hashes */
@@ -224,6 +249,10 @@ static int tb_rebalance(struct teamd_balancer *tb, struct team_handle *th)
 		tbpi->rebalance.bytes += tb_stats_get_delta(&tbhi->stats);
 		tbhi->rebalance.processed = true;
 	}
+	/* Result of each remap is checked separately */
+	team_option_txn_commit(th);
+	for (i = 0; i < HASH_COUNT; i++)
+		tb_hash_to_port_remap_check(th, &tb->hash_info[i]);
 
 	list_for_each_node_entry(tbpi, &tb->port_info_list, list) {
 		if (tbpi->rebalance.unusable)
@@ -246,7 +275,7 @@ static int tb_option_change_handler_func(struct team_handle *th, void *priv,
 	struct team_option *option;
 	bool rebalance_needed = false;
 
-	team_for_each_option(option, ctx->th) {
+	team_for_each_changed_option(option, ctx->th) {
 		char *name = team_get_option_name(option);
 		bool changed = team_is_option_changed(option);
 
@@ -283,7 +312,7 @@ static int tb_option_change_handler_func(struct team_handle *th, void *priv,
 
 	tb_stats_all_update_last(tb);
 
-	team_for_each_option(option, ctx->th) {
+	team_for_each_changed_option(option, ctx->th) {
 		char *name = team_get_option_name(option);
 		bool changed = team_is_option_changed(option);
 		struct lb_stats *lb_stats;
@@ -382,6 +411,18 @@ static const struct team_change_handler tb_option_change_handler = {
 	.type_mask = TEAM_OPTION_CHANGE,
 };
 
+static void tb_option_handles_free(struct team_handle *th,
+				   struct teamd_balancer *tb)
+{
+	int i;
+
+	for (i = 0; i < HASH_COUNT; i++) {
+		if (tb->hash_info[i].mapping_oh)
+			team_option_handle_free(th,
+						tb->hash_info[i].mapping_oh);
+	}
+}
+
 int teamd_balancer_init(struct teamd_context *ctx, struct teamd_balancer **ptb)
 {
 	struct teamd_balancer *tb;
@@ -393,8 +434,17 @@ int teamd_balancer_init(struct teamd_context *ctx, struct teamd_balancer **ptb)
 		return -ENOMEM;
 
 	list_init(&tb->port_info_list);
-	for (i = 0; i < HASH_COUNT; i++)
+	for (i = 0; i < HASH_COUNT; i++) {
 		tb->hash_info[i].hash = i;
+		tb->hash_info[i].mapping_oh =
+			team_option_handle_alloc(ctx->th, "na",
+						 "lb_tx_hash_to_port_mapping",
+						 i);
+		if (!tb->hash_info[i].mapping_oh) {
+			err = -ENOMEM;
+			goto err_option_handle_alloc;
+		}
+	}
 
 	tb->tx_balancing_enabled = tb_get_enable_tx_balancing(ctx);
 	tb->balancing_interval = tb_get_balancing_interval(ctx);
@@ -429,6 +479,8 @@ int teamd_balancer_init(struct teamd_context *ctx, struct teamd_balancer **ptb)
 err_set_lb_tx_method:
 err_set_lb_stats_refresh_interval:
 err_change_handler_register:
+err_option_handle_alloc:
+	tb_option_handles_free(ctx->th, tb);
 	free(tb);
 	return err;
 }
@@ -437,6 +489,7 @@ void teamd_balancer_fini(struct teamd_balancer *tb)
 {
 	team_change_handler_unregister(tb->ctx->th,
 				       &tb_option_change_handler, tb);
+	tb_option_handles_free(tb->ctx->th, tb);
 	free(tb);
 }
 
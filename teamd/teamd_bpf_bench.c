@@ -0,0 +1,150 @@
+/*
+ *   teamd_bpf_bench.c - BPF hash function compile micro-benchmark
+ *   Copyright (C) 2026 agent <agent@local>
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Compiles tx_hash fragment sets the same way teamd_hash_func does on
+ * runner init and reports time per compile and resulting program size.
+ * Output is one "key=value" record per line.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <linux/filter.h>
+#include <private/misc.h>
+#include <private/bench.h>
+
+#include "teamd_bpf_chef.h"
+
+#define BENCH_DEFAULT_ROUNDS 100000
+
+static const struct teamd_bpf_desc_frag bench_frags[] = {
+	{ .name = "eth", .hproto = PROTO_ETH },
+	{ .name = "vlan", .hproto = PROTO_VLAN },
+	{ .name = "ipv4", .hproto = PROTO_IPV4 },
+	{ .name = "ipv6", .hproto = PROTO_IPV6 },
+	{ .name = "ip", .hproto = PROTO_IP },
+	{ .name = "l3", .hproto = PROTO_L3 },
+	{ .name = "l4", .hproto = PROTO_L4 },
+	{ .name = "tcp", .hproto = PROTO_TCP },
+	{ .name = "udp", .hproto = PROTO_UDP },
+	{ .name = "sctp", .hproto = PROTO_SCTP },
+};
+
+#define BENCH_FRAGS_COUNT ARRAY_SIZE(bench_frags)
+
+struct bench_frag_set {
+	const char *	name;
+	const char *	frag_names[BENCH_FRAGS_COUNT + 1];
+};
+
+/* First one is what teamd uses when tx_hash is not configured */
+static const struct bench_frag_set bench_frag_sets[] = {
+	{ "default", { "eth", "ipv4", "ipv6" } },
+	{ "l3_l4", { "l3", "l4" } },
+	{ "all", { "eth", "vlan", "ipv4", "ipv6", "ip", "l3", "l4", "tcp",
+		   "udp", "sctp" } },
+};
+
+static const struct teamd_bpf_desc_frag *bench_frag_find(const char *name)
+{
+	int i;
+
+	for (i = 0; i < BENCH_FRAGS_COUNT; i++)
+		if (!strcmp(name, bench_frags[i].name))
+			return &bench_frags[i];
+	return NULL;
+}
+
+static int bench_compile(struct sock_fprog *fprog,
+			 const struct bench_frag_set *set)
+{
+	const struct teamd_bpf_desc_frag *frag;
+	int err;
+	int i;
+
+	teamd_bpf_desc_compile_start(fprog);
+	for (i = 0; set->frag_names[i]; i++) {
+		frag = bench_frag_find(set->frag_names[i]);
+		if (!frag) {
+			err = -ENOENT;
+			goto release;
+		}
+		err = teamd_bpf_desc_add_frag(fprog, frag);
+		if (err)
+			goto release;
+	}
+	err = teamd_bpf_desc_compile(fprog);
+	if (err)
+		goto release;
+	err = teamd_bpf_desc_compile_finish(fprog);
+	if (err)
+		goto release;
+	return 0;
+
+release:
+	teamd_bpf_desc_compile_release(fprog);
+	return err;
+}
+
+static int bench_frag_set(const struct bench_frag_set *set,
+			  unsigned int rounds)
+{
+	struct sock_fprog fprog;
+	unsigned int insns = 0;
+	uint64_t start;
+	unsigned int i;
+	int err;
+
+	start = bench_now();
+	for (i = 0; i < rounds; i++) {
+		err = bench_compile(&fprog, set);
+		if (err)
+			return err;
+		insns = fprog.len;
+		teamd_bpf_desc_compile_release(&fprog);
+	}
+	bench_record("bpf_compile", rounds, bench_now() - start,
+		     "frags=%s insns=%u", set->name, insns);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int rounds = BENCH_DEFAULT_ROUNDS;
+	int err = 0;
+	int i;
+
+	if (argc > 1)
+		rounds = strtoul(argv[1], NULL, 10);
+	if (!rounds) {
+		fprintf(stderr, "Usage: %s [ROUNDS]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	for (i = 0; !err && i < ARRAY_SIZE(bench_frag_sets); i++)
+		err = bench_frag_set(&bench_frag_sets[i], rounds);
+	if (err) {
+		fprintf(stderr, "Benchmark failed (%d)\n", err);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
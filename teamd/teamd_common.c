@@ -185,3 +185,51 @@ rerecv:
 	}
 	return ret;
 }
+
+void teamd_mmsg_init(struct mmsghdr *msgvec, struct iovec *iov,
+		     unsigned int vlen, void *buf, size_t len,
+		     void *addrs, socklen_t addrlen)
+{
+	unsigned int i;
+
+	memset(msgvec, 0, vlen * sizeof(*msgvec));
+	for (i = 0; i < vlen; i++) {
+		iov[i].iov_base = (char *) buf + i * len;
+		iov[i].iov_len = len;
+		msgvec[i].msg_hdr.msg_iov = &iov[i];
+		msgvec[i].msg_hdr.msg_iovlen = 1;
+		msgvec[i].msg_hdr.msg_name = (char *) addrs + i * addrlen;
+		msgvec[i].msg_hdr.msg_namelen = addrlen;
+	}
+}
+
+/*
+ * Receive up to vlen queued frames in one syscall. Never blocks, returns
+ * number of frames received, 0 in case nothing is queued.
+ */
+int teamd_recvmmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen,
+		   int flags)
+{
+	socklen_t addrlen = msgvec[0].msg_hdr.msg_namelen;
+	unsigned int i;
+	int ret;
+
+	/* Kernel rewrites name lengths, restore them for the next round */
+	for (i = 0; i < vlen; i++)
+		msgvec[i].msg_hdr.msg_namelen = addrlen;
+rerecv:
+	ret = recvmmsg(sockfd, msgvec, vlen, flags | MSG_DONTWAIT, NULL);
+	if (ret == -1) {
+		switch(errno) {
+		case EINTR:
+			goto rerecv;
+		case EAGAIN:
+		case ENETDOWN:
+			return 0;
+		default:
+			teamd_log_err("recvmmsg failed.");
+			return -errno;
+		}
+	}
+	return ret;
+}
@@ -0,0 +1,1223 @@
+/*
+ *   teamd_context.c - Team device context setup and teardown
+ *   Copyright (C) 2011-2013 Jiri Pirko <jiri@resnulli.us>
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <ctype.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <linux/netdevice.h>
+#include <sys/syslog.h>
+#include <libdaemon/dsignal.h>
+#include <libdaemon/dlog.h>
+#include <private/list.h>
+#include <private/misc.h>
+#include <team.h>
+
+#include "config.h"
+#include "teamd.h"
+#include "teamd_workq.h"
+#include "teamd_worker.h"
+#include "teamd_config.h"
+#include "teamd_state.h"
+#include "teamd_usock.h"
+#include "teamd_dbus.h"
+#include "teamd_zmq.h"
+#include "teamd_phys_port_check.h"
+
+const struct teamd_runner *teamd_runner_list[] = {
+	&teamd_runner_broadcast,
+	&teamd_runner_roundrobin,
+	&teamd_runner_random,
+	&teamd_runner_activebackup,
+	&teamd_runner_loadbalance,
+	&teamd_runner_lacp,
+};
+
+const unsigned int teamd_runner_list_size = ARRAY_SIZE(teamd_runner_list);
+
+static const struct teamd_runner *teamd_find_runner(const char *runner_name)
+{
+	int i;
+
+	for (i = 0; i < teamd_runner_list_size; i++) {
+		if (strcmp(teamd_runner_list[i]->name, runner_name) == 0)
+			return teamd_runner_list[i];
+	}
+	return NULL;
+}
+
+#define TEAMD_DEFAULT_RUNNER_NAME "roundrobin"
+#define TEAMD_DEFAULT_DEVNAME_PREFIX "team"
+static void libteam_log_daemon(struct team_handle *th, int priority,
+			       const char *file, int line, const char *fn,
+			       const char *format, va_list args)
+{
+	daemon_logv(priority, format, args);
+}
+
+static void teamd_multi_quit_teams(struct teamd_context *ctx)
+{
+	struct teamd_context *tctx;
+
+	if (!ctx->multi.enabled)
+		return;
+	list_for_each_node_entry(tctx, &ctx->multi.team_list, multi.list)
+		teamd_run_loop_quit(tctx, 0);
+}
+
+static void teamd_multi_reap(struct teamd_context *ctx);
+
+static int callback_daemon_signal(struct teamd_context *ctx, int events,
+				  void *priv)
+{
+	int sig;
+
+	/* Get signal */
+	if ((sig = daemon_signal_next()) <= 0) {
+		teamd_log_err("daemon_signal_next() failed.");
+		return -EINVAL;
+	}
+
+	/* Dispatch signal */
+	switch (sig) {
+	case SIGINT:
+	case SIGQUIT:
+	case SIGTERM:
+		teamd_log_warn("Got SIGINT, SIGQUIT or SIGTERM.");
+		teamd_multi_quit_teams(ctx);
+		teamd_run_loop_quit(ctx, 0);
+		break;
+	}
+	return 0;
+}
+
+static int callback_libteam_event(struct teamd_context *ctx, int events,
+				  void *priv)
+{
+	int err;
+
+	if (!ctx->multi.enabled)
+		return team_handle_events(ctx->th);
+	err = team_evmux_handle_events(ctx->multi.evmux);
+	/* Events might have finished port removal of quitting teams */
+	teamd_multi_reap(ctx);
+	return err;
+}
+
+#define DAEMON_CB_NAME "daemon"
+#define LIBTEAM_EVENTS_CB_NAME "libteam_events"
+
+static int teamd_run_loop_init(struct teamd_context *ctx)
+{
+	int event_fd;
+	int err;
+
+	/* Hosted team uses run loop and libteam events of its master */
+	if (ctx->multi.master) {
+		teamd_loop_attach(ctx, ctx->multi.master);
+		return 0;
+	}
+
+	err = teamd_loop_init(ctx);
+	if (err)
+		return err;
+
+	err = teamd_loop_callback_fd_add(ctx, DAEMON_CB_NAME, ctx,
+					 callback_daemon_signal,
+					 daemon_signal_fd(),
+					 TEAMD_LOOP_FD_EVENT_READ,
+					 TEAMD_LOOP_PRIO_CONTROL);
+	if (err) {
+		teamd_log_err("Failed to add daemon loop callback");
+		goto loop_fini;
+	}
+
+	if (ctx->multi.enabled)
+		event_fd = team_evmux_get_event_fd(ctx->multi.evmux);
+	else
+		event_fd = team_get_event_fd(ctx->th);
+	err = teamd_loop_callback_fd_add(ctx, LIBTEAM_EVENTS_CB_NAME, ctx,
+					 callback_libteam_event, event_fd,
+					 TEAMD_LOOP_FD_EVENT_READ,
+					 TEAMD_LOOP_PRIO_LINK);
+	if (err) {
+		teamd_log_err("Failed to add libteam event loop callback");
+		goto del_daemon_callback;
+	}
+
+	teamd_loop_callback_enable(ctx, DAEMON_CB_NAME, ctx);
+	teamd_loop_callback_enable(ctx, LIBTEAM_EVENTS_CB_NAME, ctx);
+
+	return 0;
+
+del_daemon_callback:
+	teamd_loop_callback_del(ctx, DAEMON_CB_NAME, ctx);
+loop_fini:
+	teamd_loop_fini(ctx);
+	return err;
+}
+
+static void teamd_run_loop_fini(struct teamd_context *ctx)
+{
+	if (!ctx->multi.master) {
+		teamd_loop_callback_del(ctx, LIBTEAM_EVENTS_CB_NAME, NULL);
+		teamd_loop_callback_del(ctx, DAEMON_CB_NAME, ctx);
+	}
+	teamd_loop_fini(ctx);
+}
+
+static int parse_hwaddr(const char *hwaddr_str, char **phwaddr,
+			unsigned int *plen)
+{
+	const char *pos = hwaddr_str;
+	unsigned int byte_count = 0;
+	unsigned int tmp;
+	int err;
+	char *hwaddr = NULL;
+	char *new_hwaddr;
+	char *endptr;
+
+	while (true) {
+		errno = 0;
+		tmp = strtoul(pos, &endptr, 16);
+		if (errno != 0 || tmp > 0xFF) {
+			err = -EINVAL;
+			goto err_out;
+		}
+		byte_count++;
+		new_hwaddr = realloc(hwaddr, sizeof(char) * byte_count);
+		if (!new_hwaddr) {
+			err = -ENOMEM;
+			goto err_out;
+		}
+		hwaddr = new_hwaddr;
+		hwaddr[byte_count - 1] = (char) tmp;
+		while (isspace(endptr[0]) && endptr[0] != '\0')
+			endptr++;
+		if (endptr[0] == ':') {
+			pos = endptr + 1;
+		} else if (endptr[0] == '\0') {
+			break;
+		} else {
+			err = -EINVAL;
+			goto err_out;
+		}
+	}
+	*phwaddr = hwaddr;
+	*plen = byte_count;
+	return 0;
+err_out:
+	free(hwaddr);
+	return err;
+}
+
+static int teamd_set_hwaddr(struct teamd_context *ctx)
+{
+	int err;
+	const char *hwaddr_str;
+	char *hwaddr;
+	unsigned int hwaddr_len;
+
+	err = teamd_config_string_get(ctx, &hwaddr_str, "$.hwaddr");
+	if (err)
+		return 0; /* addr is not defined in config, no change needed */
+
+	teamd_log_dbg("Hwaddr string: \"%s\".", hwaddr_str);
+	err = parse_hwaddr(hwaddr_str, &hwaddr, &hwaddr_len);
+	if (err) {
+		teamd_log_err("Failed to parse hardware address.");
+		return err;
+	}
+
+	if (hwaddr_len != ctx->hwaddr_len) {
+		teamd_log_err("Passed hardware address has different length (%d) than team device has (%d).",
+			      hwaddr_len, ctx->hwaddr_len);
+		err = -EINVAL;
+		goto free_hwaddr;
+	}
+	err = team_hwaddr_set(ctx->th, ctx->ifindex, hwaddr, hwaddr_len);
+	if (!err)
+		ctx->hwaddr_explicit = true;
+free_hwaddr:
+	free(hwaddr);
+	return err;
+}
+
+static int teamd_add_ports(struct teamd_context *ctx)
+{
+	int err;
+	const char *key;
+
+	ctx->pre_add_ports = false;
+	if (ctx->init_no_ports)
+		return 0;
+
+	teamd_config_for_each_key(key, ctx, "$.ports") {
+		err = teamd_port_add_ifname(ctx, key);
+		if (err)
+			return err;
+	}
+	return 0;
+}
+
+static int teamd_hwaddr_check_change(struct teamd_context *ctx,
+				     struct teamd_port *tdport)
+{
+	char *hwaddr;
+	unsigned char hwaddr_len;
+	int err;
+
+	if (ctx->port_obj_list_count != 1 || ctx->hwaddr_explicit)
+		return 0;
+	hwaddr = team_get_ifinfo_orig_hwaddr(tdport->team_ifinfo);
+	hwaddr_len = team_get_ifinfo_orig_hwaddr_len(tdport->team_ifinfo);
+	if (hwaddr_len != ctx->hwaddr_len) {
+		teamd_log_err("%s: Port original hardware address has different length (%d) than team device has (%d).",
+			      tdport->ifname, hwaddr_len, ctx->hwaddr_len);
+		return -EINVAL;
+	}
+	err = team_hwaddr_set(ctx->th, ctx->ifindex, hwaddr, hwaddr_len);
+	if (err) {
+		teamd_log_err("Failed to set team device hardware address.");
+		return err;
+	}
+	ctx->hwaddr = hwaddr;
+	return 0;
+}
+
+static int teamd_event_watch_port_added(struct teamd_context *ctx,
+					struct teamd_port *tdport, void *priv)
+{
+	int err;
+	int tmp;
+
+	if (!ctx->pre_add_ports) {
+		err = teamd_hwaddr_check_change(ctx, tdport);
+		if (err)
+			return err;
+	}
+
+	err = teamd_config_int_get(ctx, &tmp, "$.ports.%s.queue_id",
+				   tdport->ifname);
+	if (!err) {
+		uint32_t queue_id;
+
+		if (tmp < 0) {
+			teamd_log_err("%s: \"queue_id\" must not be negative number.",
+				      tdport->ifname);
+			return -EINVAL;
+		}
+		queue_id = tmp;
+		err = team_set_port_queue_id(ctx->th, tdport->ifindex,
+					     queue_id);
+		if (err) {
+			teamd_log_err("%s: Failed to set \"queue_id\".",
+				      tdport->ifname);
+			return err;
+		}
+	}
+	err = teamd_config_int_get(ctx, &tmp, "$.ports.%s.prio",
+				   tdport->ifname);
+	if (err)
+		tmp = 0;
+	err = team_set_port_priority(ctx->th, tdport->ifindex, tmp);
+	if (err) {
+		teamd_log_err("%s: Failed to set \"priority\".",
+			      tdport->ifname);
+		return err;
+	}
+	return 0;
+}
+
+static const struct teamd_event_watch_ops teamd_port_watch_ops = {
+	.port_added = teamd_event_watch_port_added,
+};
+
+static int teamd_port_watch_init(struct teamd_context *ctx)
+{
+	return teamd_event_watch_register(ctx, &teamd_port_watch_ops, NULL);
+}
+
+static void teamd_port_watch_fini(struct teamd_context *ctx)
+{
+	teamd_event_watch_unregister(ctx, &teamd_port_watch_ops, NULL);
+}
+
+static int teamd_runner_init(struct teamd_context *ctx)
+{
+	int err;
+	const char *runner_name;
+
+	err = teamd_config_string_get(ctx, &runner_name, "$.runner.name");
+	if (err) {
+		teamd_log_dbg("Failed to get team runner name from config.");
+		runner_name = TEAMD_DEFAULT_RUNNER_NAME;
+		err = teamd_config_string_set(ctx, runner_name, "$.runner.name");
+		if (err) {
+			teamd_log_err("Failed to set default team runner name in config.");
+			return err;
+		}
+		teamd_log_dbg("Using default team runner \"%s\".", runner_name);
+	} else {
+		teamd_log_dbg("Using team runner \"%s\".", runner_name);
+	}
+	ctx->runner = teamd_find_runner(runner_name);
+	if (!ctx->runner) {
+		teamd_log_err("No runner named \"%s\" available.", runner_name);
+		return -EINVAL;
+	}
+
+	if (ctx->runner->team_mode_name) {
+		char *cur_mode;
+		const char *new_mode = ctx->runner->team_mode_name;
+
+		err = team_get_mode_name(ctx->th, &cur_mode);
+		if (err) {
+			teamd_log_err("Failed to det team mode.");
+			return err;
+		}
+		if (strcmp(cur_mode, new_mode)) {
+			err = team_set_mode_name(ctx->th, new_mode);
+			if (err) {
+				teamd_log_err("Failed to set team mode \"%s\".",
+					      new_mode);
+				return err;
+			}
+		}
+	} else {
+		teamd_log_warn("Note \"%s\" runner does not select team mode resulting in no functionality!",
+			       runner_name);
+	}
+
+	if (ctx->runner->priv_size) {
+		ctx->runner_priv = myzalloc(ctx->runner->priv_size);
+		if (!ctx->runner_priv)
+			return -ENOMEM;
+	}
+
+	if (ctx->runner->init) {
+		err = ctx->runner->init(ctx, ctx->runner_priv);
+		if (err)
+			goto free_runner_priv;
+	}
+	return 0;
+
+free_runner_priv:
+	free(ctx->runner_priv);
+	return err;
+}
+
+static void teamd_runner_fini(struct teamd_context *ctx)
+{
+	if (ctx->runner->fini)
+		ctx->runner->fini(ctx, ctx->runner_priv);
+	free(ctx->runner_priv);
+	ctx->runner = NULL;
+}
+
+static int teamd_post_runner_init(struct teamd_context *ctx)
+{
+	int err;
+	int tmp;
+
+	err = teamd_config_int_get(ctx, &tmp, "$.notify_peers.count");
+	if (!err) {
+		uint32_t count;
+
+		if (tmp < 0) {
+			teamd_log_err("\"count\" must not be negative number.");
+			return -EINVAL;
+		}
+		count = tmp;
+		err = team_set_notify_peers_count(ctx->th, count);
+		if (err) {
+			if (err == -ENOENT) {
+				teamd_log_warn("Failed to set \"notify_peers_count\". Kernel probably does not support this option yet.");
+			} else {
+				teamd_log_err("Failed to set \"notify_peers_count\".");
+				return err;
+			}
+		}
+	}
+	err = teamd_config_int_get(ctx, &tmp, "$.notify_peers.interval");
+	if (!err) {
+		uint32_t interval;
+
+		if (tmp < 0) {
+			teamd_log_err("\"interval\" must not be negative number.");
+			return -EINVAL;
+		}
+		interval = tmp;
+		err = team_set_notify_peers_interval(ctx->th, interval);
+		if (err) {
+			if (err == -ENOENT) {
+				teamd_log_warn("Failed to set \"notify_peers_interval\". Kernel probably does not support this option yet.");
+			} else {
+				teamd_log_err("Failed to set \"notify_peers_interval\".");
+				return err;
+			}
+		}
+	}
+	err = teamd_config_int_get(ctx, &tmp, "$.mcast_rejoin.count");
+	if (!err) {
+		uint32_t count;
+
+		if (tmp < 0) {
+			teamd_log_err("\"count\" must not be negative number.");
+			return -EINVAL;
+		}
+		count = tmp;
+		err = team_set_mcast_rejoin_count(ctx->th, count);
+		if (err) {
+			if (err == -ENOENT) {
+				teamd_log_warn("Failed to set \"mcast_rejoin_count\". Kernel probably does not support this option yet.");
+			} else {
+				teamd_log_err("Failed to set \"mcast_rejoin_count\".");
+				return err;
+			}
+		}
+	}
+	err = teamd_config_int_get(ctx, &tmp, "$.mcast_rejoin.interval");
+	if (!err) {
+		uint32_t interval;
+
+		if (tmp < 0) {
+			teamd_log_err("\"interval\" must not be negative number.");
+			return -EINVAL;
+		}
+		interval = tmp;
+		err = team_set_mcast_rejoin_interval(ctx->th, interval);
+		if (err) {
+			if (err == -ENOENT) {
+				teamd_log_warn("Failed to set \"mcast_rejoin_interval\". Kernel probably does not support this option yet.");
+			} else {
+				teamd_log_err("Failed to set \"mcast_rejoin_interval\".");
+				return err;
+			}
+		}
+	}
+	return 0;
+}
+
+static void debug_log_port_list(struct teamd_context *ctx)
+{
+	struct team_port *port;
+	char buf[120];
+	bool trunc;
+
+	teamd_log_dbg("<port_list>");
+	team_for_each_port(port, ctx->th) {
+		trunc = team_port_str(port, buf, sizeof(buf));
+		teamd_log_dbg("%s %s", buf, trunc ? "<trunc>" : "");
+	}
+	teamd_log_dbg("</port_list>");
+}
+
+static void debug_log_option_list(struct teamd_context *ctx)
+{
+	struct team_option *option;
+	char buf[120];
+	bool trunc;
+
+	teamd_log_dbgx(ctx, 2, "<changed_option_list>");
+	team_for_each_option(option, ctx->th) {
+		if (!team_is_option_changed(option) ||
+		    team_is_option_changed_locally(option))
+			continue;
+		trunc = team_option_str(ctx->th, option, buf, sizeof(buf));
+		teamd_log_dbgx(ctx, 2, "%s %s", buf, trunc ? "<trunc>" : "");
+	}
+	teamd_log_dbgx(ctx, 2, "</changed_option_list>");
+}
+
+static void debug_log_ifinfo_list(struct teamd_context *ctx)
+{
+	struct team_ifinfo *ifinfo;
+	char buf[120];
+	bool trunc;
+
+	teamd_log_dbg("<ifinfo_list>");
+	team_for_each_ifinfo(ifinfo, ctx->th) {
+		trunc = team_ifinfo_str(ifinfo, buf, sizeof(buf));
+		teamd_log_dbg("%s %s", buf, trunc ? "<trunc>" : "");
+	}
+	teamd_log_dbg("</ifinfo_list>");
+}
+
+static int debug_change_handler_func(struct team_handle *th, void *priv,
+				     team_change_type_mask_t type_mask)
+{
+	struct teamd_context *ctx = priv;
+
+	if (type_mask & TEAM_PORT_CHANGE)
+		debug_log_port_list(ctx);
+	if (type_mask & TEAM_OPTION_CHANGE)
+		debug_log_option_list(ctx);
+	if (type_mask & TEAM_IFINFO_CHANGE)
+		debug_log_ifinfo_list(ctx);
+	return 0;
+}
+
+static const struct team_change_handler debug_change_handler = {
+	.func = debug_change_handler_func,
+	.type_mask = TEAM_PORT_CHANGE | TEAM_OPTION_CHANGE | TEAM_IFINFO_CHANGE,
+};
+
+static int teamd_register_debug_handler(struct teamd_context *ctx)
+{
+	return team_change_handler_register_head(ctx->th,
+						 &debug_change_handler, ctx);
+}
+
+static int teamd_register_default_handlers(struct teamd_context *ctx)
+{
+	if (!ctx->debug)
+		return 0;
+	return teamd_register_debug_handler(ctx);
+}
+
+static void teamd_unregister_debug_handler(struct teamd_context *ctx)
+{
+	team_change_handler_unregister(ctx->th, &debug_change_handler, ctx);
+}
+
+static void teamd_unregister_default_handlers(struct teamd_context *ctx)
+{
+	if (!ctx->debug)
+		return;
+	teamd_unregister_debug_handler(ctx);
+}
+
+int teamd_change_debug_level(struct teamd_context *ctx, unsigned int new_debug)
+{
+	int err = 0;
+
+	if (!ctx->debug && new_debug) {
+		daemon_set_verbosity(LOG_DEBUG);
+		err = teamd_register_debug_handler(ctx);
+	}
+	if (ctx->debug && !new_debug) {
+		daemon_set_verbosity(LOG_WARNING);
+		teamd_unregister_debug_handler(ctx);
+	}
+	if (err)
+		return err;
+	ctx->debug = new_debug;
+	return 0;
+}
+
+int teamd_init(struct teamd_context *ctx)
+{
+	int err;
+
+	ctx->th = team_alloc();
+	if (!ctx->th) {
+		teamd_log_err("Team alloc failed.");
+		return -ENOMEM;
+	}
+	if (ctx->debug)
+		team_set_log_priority(ctx->th, LOG_DEBUG);
+
+	team_set_log_fn(ctx->th, libteam_log_daemon);
+
+	if (ctx->emul_port) {
+		err = team_set_emul_port(ctx->th, ctx->emul_port);
+		if (err) {
+			teamd_log_err("Failed to set team emulator port.");
+			goto team_free;
+		}
+	}
+
+	if (ctx->multi.master) {
+		err = team_set_evmux(ctx->th, ctx->multi.master->multi.evmux);
+		if (err) {
+			teamd_log_err("Failed to set team event multiplexer.");
+			goto team_free;
+		}
+	}
+
+	ctx->ifindex = team_ifname2ifindex(ctx->th, ctx->team_devname);
+	if (ctx->ifindex && ctx->take_over)
+		goto skip_create;
+
+	if (ctx->force_recreate)
+		err = team_recreate(ctx->th, ctx->team_devname);
+	else
+		err = team_create(ctx->th, ctx->team_devname);
+	if (err) {
+		teamd_log_err("Failed to create team device.");
+		goto team_free;
+	}
+
+	ctx->ifindex = team_ifname2ifindex(ctx->th, ctx->team_devname);
+	if (!ctx->ifindex) {
+		teamd_log_err("Netdevice \"%s\" not found.", ctx->team_devname);
+		err = -ENODEV;
+		goto team_destroy;
+	}
+skip_create:
+
+	err = team_init(ctx->th, ctx->ifindex);
+	if (err) {
+		teamd_log_err("Team init failed.");
+		goto team_destroy;
+	}
+
+	ctx->ifinfo = team_get_ifinfo(ctx->th);
+	ctx->hwaddr = team_get_ifinfo_hwaddr(ctx->ifinfo);
+	ctx->hwaddr_len = team_get_ifinfo_hwaddr_len(ctx->ifinfo);
+
+	err = teamd_set_hwaddr(ctx);
+	if (err) {
+		teamd_log_err("Hardware address set failed.");
+		goto team_destroy;
+	}
+
+	err = teamd_state_init(ctx);
+	if (err) {
+		teamd_log_err("Failed to init state json infrastructure.");
+		goto team_destroy;
+	}
+
+	err = teamd_run_loop_init(ctx);
+	if (err) {
+		teamd_log_err("Failed to init run loop.");
+		goto state_fini;
+	}
+
+	err = teamd_workq_init(ctx);
+	if (err) {
+		teamd_log_err("Failed to init workq.");
+		goto run_loop_fini;
+	}
+
+	err = teamd_worker_init(ctx);
+	if (err) {
+		teamd_log_err("Failed to init worker.");
+		goto workq_fini;
+	}
+
+	err = teamd_register_default_handlers(ctx);
+	if (err) {
+		teamd_log_err("Failed to register debug event handlers.");
+		goto worker_fini;
+	}
+
+	err = teamd_events_init(ctx);
+	if (err) {
+		teamd_log_err("Failed to init events infrastructure.");
+		goto team_unreg_debug_handlers;
+	}
+
+	err = teamd_option_watch_init(ctx);
+	if (err) {
+		teamd_log_err("Failed to init option watches.");
+		goto events_fini;
+	}
+
+	err = teamd_ifinfo_watch_init(ctx);
+	if (err) {
+		teamd_log_err("Failed to init ifinfo watches.");
+		goto option_watch_fini;
+	}
+
+	err = teamd_port_watch_init(ctx);
+	if (err) {
+		teamd_log_err("Failed to init port watch.");
+		goto ifinfo_watch_fini;
+	}
+
+	err = teamd_per_port_init(ctx);
+	if (err) {
+		teamd_log_err("Failed to init per-port.");
+		goto port_watch_fini;
+	}
+
+	err = teamd_link_watch_init(ctx);
+	if (err) {
+		teamd_log_err("Failed to init link watch.");
+		goto per_port_fini;
+	}
+
+	err = teamd_runner_init(ctx);
+	if (err) {
+		teamd_log_err("Failed to init runner.");
+		goto link_watch_fini;
+	}
+
+	err = teamd_post_runner_init(ctx);
+	if (err) {
+		teamd_log_err("Failed to do post-runner initializations.");
+		goto runner_fini;
+	}
+
+	err = teamd_state_basics_init(ctx);
+	if (err) {
+		teamd_log_err("Failed to init state json basics.");
+		goto runner_fini;
+	}
+
+	err = teamd_phys_port_check_init(ctx);
+	if (err) {
+		teamd_log_err("Failed to init SR-IOV support.");
+		goto state_basics_fini;
+	}
+
+	err = teamd_usock_init(ctx);
+	if (err) {
+		teamd_log_err("Failed to init unix domain socket.");
+		goto phys_port_check_fini;
+	}
+
+	err = teamd_dbus_init(ctx);
+	if (err) {
+		teamd_log_err("Failed to init dbus.");
+		goto usock_fini;
+	}
+
+	err = teamd_zmq_init(ctx);
+	if (err) {
+		teamd_log_err("Failed to init zmq.");
+		goto dbus_fini;
+	}
+
+	ctx->pre_add_ports = true;
+	err = team_refresh(ctx->th);
+	if (err) {
+		teamd_log_err("Team refresh failed.");
+		goto zmq_fini;
+	}
+
+	err = teamd_add_ports(ctx);
+	if (err) {
+		teamd_log_err("Failed to add ports.");
+		goto zmq_fini;
+	}
+
+	/*
+	 * Expose name as the last thing so watchers like systemd
+	 * knows we are here and all ready.
+	 */
+	err = teamd_dbus_expose_name(ctx);
+	if (err) {
+		teamd_log_err("Failed to expose dbus name.");
+		goto zmq_fini;
+	}
+
+	return 0;
+zmq_fini:
+	teamd_zmq_fini(ctx);
+dbus_fini:
+	teamd_dbus_fini(ctx);
+usock_fini:
+	teamd_usock_fini(ctx);
+phys_port_check_fini:
+	teamd_phys_port_check_fini(ctx);
+state_basics_fini:
+	teamd_state_basics_fini(ctx);
+runner_fini:
+	teamd_runner_fini(ctx);
+link_watch_fini:
+	teamd_link_watch_fini(ctx);
+per_port_fini:
+	teamd_per_port_fini(ctx);
+port_watch_fini:
+	teamd_port_watch_fini(ctx);
+ifinfo_watch_fini:
+	teamd_ifinfo_watch_fini(ctx);
+option_watch_fini:
+	teamd_option_watch_fini(ctx);
+events_fini:
+	teamd_events_fini(ctx);
+team_unreg_debug_handlers:
+	teamd_unregister_default_handlers(ctx);
+worker_fini:
+	teamd_worker_fini(ctx);
+workq_fini:
+	teamd_workq_fini(ctx);
+run_loop_fini:
+	teamd_run_loop_fini(ctx);
+state_fini:
+	teamd_state_fini(ctx);
+team_destroy:
+	if (!ctx->take_over)
+		team_destroy(ctx->th);
+team_free:
+	team_free(ctx->th);
+	return err;
+}
+
+void teamd_fini(struct teamd_context *ctx)
+{
+	teamd_zmq_fini(ctx);
+	teamd_dbus_fini(ctx);
+	teamd_usock_fini(ctx);
+	teamd_phys_port_check_fini(ctx);
+	teamd_state_basics_fini(ctx);
+	teamd_runner_fini(ctx);
+	teamd_link_watch_fini(ctx);
+	teamd_per_port_fini(ctx);
+	teamd_ifinfo_watch_fini(ctx);
+	teamd_option_watch_fini(ctx);
+	teamd_events_fini(ctx);
+	teamd_unregister_default_handlers(ctx);
+	teamd_worker_fini(ctx);
+	teamd_workq_fini(ctx);
+	teamd_run_loop_fini(ctx);
+	teamd_state_fini(ctx);
+	if (!ctx->no_quit_destroy)
+		team_destroy(ctx->th);
+	team_free(ctx->th);
+}
+
+/*
+ * Multi-team mode. One process hosts many team devices on a single run
+ * loop. Hosted teams share libteam event sockets through an event
+ * multiplexer and they are added and removed over control socket.
+ */
+
+static struct teamd_context *teamd_multi_team_find(struct teamd_context *ctx,
+						   const char *team_devname)
+{
+	struct teamd_context *tctx;
+
+	list_for_each_node_entry(tctx, &ctx->multi.team_list, multi.list) {
+		if (!strcmp(tctx->team_devname, team_devname))
+			return tctx;
+	}
+	return NULL;
+}
+
+static void teamd_multi_team_destroy(struct teamd_context *tctx)
+{
+	teamd_log_info("%s: Team removed.", tctx->team_devname);
+	list_del(&tctx->multi.list);
+	teamd_fini(tctx);
+	teamd_config_free(tctx);
+	teamd_context_fini(tctx);
+}
+
+static void teamd_multi_reap(struct teamd_context *ctx)
+{
+	struct teamd_context *tctx;
+	struct teamd_context *tmp;
+	int err;
+
+	list_for_each_node_entry_safe(tctx, tmp, &ctx->multi.team_list,
+				      multi.list) {
+		if (!tctx->multi.quitting)
+			continue;
+		if (!tctx->multi.flushed) {
+			tctx->multi.flushed = true;
+			err = teamd_flush_ports(tctx);
+			if (err)
+				teamd_log_err("%s: Failed to flush ports.",
+					      tctx->team_devname);
+		}
+		if (!teamd_has_ports(tctx))
+			teamd_multi_team_destroy(tctx);
+	}
+}
+
+int teamd_multi_team_add(struct teamd_context *ctx, const char *config_text)
+{
+	struct teamd_context *tctx;
+	int err;
+
+	tctx = myzalloc(sizeof(*tctx));
+	if (!tctx)
+		return -ENOMEM;
+	tctx->multi.master = ctx;
+	tctx->argv0 = ctx->argv0;
+	tctx->emul_port = ctx->emul_port;
+	tctx->debug = ctx->debug;
+	tctx->force_recreate = ctx->force_recreate;
+	tctx->take_over = ctx->take_over;
+	tctx->no_quit_destroy = ctx->no_quit_destroy;
+	tctx->usock.enabled = ctx->usock.enabled;
+	tctx->config_text = strdup(config_text);
+	if (!tctx->config_text) {
+		err = -ENOMEM;
+		goto context_fini;
+	}
+
+	err = teamd_config_load(tctx);
+	if (err) {
+		teamd_log_err("Failed to load team config.");
+		goto context_fini;
+	}
+
+	err = teamd_get_devname(tctx, false);
+	if (err)
+		goto config_free;
+
+	if (teamd_multi_team_find(ctx, tctx->team_devname)) {
+		teamd_log_err("%s: Team is already hosted.",
+			      tctx->team_devname);
+		err = -EEXIST;
+		goto config_free;
+	}
+
+	err = teamd_init(tctx);
+	if (err) {
+		teamd_log_err("%s: teamd_init() failed.", tctx->team_devname);
+		goto config_free;
+	}
+	list_add_tail(&ctx->multi.team_list, &tctx->multi.list);
+	teamd_log_info("%s: Team added.", tctx->team_devname);
+	return 0;
+
+config_free:
+	teamd_config_free(tctx);
+context_fini:
+	teamd_context_fini(tctx);
+	return err;
+}
+
+int teamd_multi_team_remove(struct teamd_context *ctx,
+			    const char *team_devname)
+{
+	struct teamd_context *tctx;
+
+	tctx = teamd_multi_team_find(ctx, team_devname);
+	if (!tctx)
+		return -ENODEV;
+	/* Team is reaped once all its ports are gone */
+	teamd_run_loop_quit(tctx, 0);
+	return 0;
+}
+
+static int callback_multi_reap(struct teamd_context *ctx, int events,
+			       void *priv)
+{
+	char buf[32];
+	int ret;
+
+	ret = read(ctx->multi.reap_pipe_r, buf, sizeof(buf));
+	if (ret == -1 && errno != EINTR && errno != EAGAIN)
+		return -errno;
+	teamd_multi_reap(ctx);
+	return 0;
+}
+
+#define MULTI_REAP_CB_NAME "multi_reap"
+
+int teamd_multi_init(struct teamd_context *ctx)
+{
+	int fds[2];
+	int err;
+
+	if (!ctx->usock.enabled) {
+		teamd_log_err("Multi-team mode needs UNIX domain socket interface.");
+		return -EINVAL;
+	}
+
+	list_init(&ctx->multi.team_list);
+	list_init(&ctx->port_obj_list);
+
+	ctx->multi.evmux = team_evmux_alloc();
+	if (!ctx->multi.evmux) {
+		teamd_log_err("Team event multiplexer alloc failed.");
+		return -ENOMEM;
+	}
+
+	if (ctx->emul_port) {
+		err = team_evmux_set_emul_port(ctx->multi.evmux,
+					       ctx->emul_port);
+		if (err) {
+			teamd_log_err("Failed to set team emulator port.");
+			goto evmux_free;
+		}
+	}
+
+	err = team_evmux_init(ctx->multi.evmux);
+	if (err) {
+		teamd_log_err("Team event multiplexer init failed.");
+		goto evmux_free;
+	}
+
+	err = teamd_state_init(ctx);
+	if (err) {
+		teamd_log_err("Failed to init state json infrastructure.");
+		goto evmux_free;
+	}
+
+	err = teamd_run_loop_init(ctx);
+	if (err) {
+		teamd_log_err("Failed to init run loop.");
+		goto state_fini;
+	}
+
+	err = teamd_state_basics_init(ctx);
+	if (err) {
+		teamd_log_err("Failed to init state basics.");
+		goto run_loop_fini;
+	}
+
+	err = pipe(fds);
+	if (err) {
+		err = -errno;
+		teamd_log_err("Failed to create reap pipe.");
+		goto state_basics_fini;
+	}
+	ctx->multi.reap_pipe_r = fds[0];
+	ctx->multi.reap_pipe_w = fds[1];
+
+	err = teamd_loop_callback_fd_add(ctx, MULTI_REAP_CB_NAME, ctx,
+					 callback_multi_reap,
+					 ctx->multi.reap_pipe_r,
+					 TEAMD_LOOP_FD_EVENT_READ,
+					 TEAMD_LOOP_PRIO_CONTROL);
+	if (err) {
+		teamd_log_err("Failed to add reap loop callback");
+		goto close_pipe;
+	}
+	teamd_loop_callback_enable(ctx, MULTI_REAP_CB_NAME, ctx);
+
+	err = teamd_usock_init(ctx);
+	if (err) {
+		teamd_log_err("Failed to init unix domain socket.");
+		goto del_reap_callback;
+	}
+
+	return 0;
+
+del_reap_callback:
+	teamd_loop_callback_del(ctx, MULTI_REAP_CB_NAME, ctx);
+close_pipe:
+	close(ctx->multi.reap_pipe_r);
+	close(ctx->multi.reap_pipe_w);
+state_basics_fini:
+	teamd_state_basics_fini(ctx);
+run_loop_fini:
+	teamd_run_loop_fini(ctx);
+state_fini:
+	teamd_state_fini(ctx);
+evmux_free:
+	team_evmux_free(ctx->multi.evmux);
+	return err;
+}
+
+void teamd_multi_fini(struct teamd_context *ctx)
+{
+	struct teamd_context *tctx;
+	struct teamd_context *tmp;
+
+	/* Teams are left here only in case the run loop failed */
+	list_for_each_node_entry_safe(tctx, tmp, &ctx->multi.team_list,
+				      multi.list)
+		teamd_multi_team_destroy(tctx);
+	teamd_usock_fini(ctx);
+	teamd_loop_callback_del(ctx, MULTI_REAP_CB_NAME, ctx);
+	close(ctx->multi.reap_pipe_r);
+	close(ctx->multi.reap_pipe_w);
+	teamd_state_basics_fini(ctx);
+	teamd_run_loop_fini(ctx);
+	teamd_state_fini(ctx);
+	team_evmux_free(ctx->multi.evmux);
+}
+
+static int teamd_generate_devname(struct teamd_context *ctx)
+{
+	char buf[IFNAMSIZ];
+	int i = 0;
+	uint32_t ifindex = ifindex;
+	int ret;
+	int err;
+
+	do {
+		ret = snprintf(buf, sizeof(buf),
+			       TEAMD_DEFAULT_DEVNAME_PREFIX "%d", i++);
+		if (ret >= sizeof(buf))
+			return -EINVAL;
+		err = ifname2ifindex(&ifindex, buf);
+		if (err)
+			return err;
+	} while (ifindex);
+	teamd_log_dbg("Generated team device name \"%s\".", buf);
+
+	ctx->team_devname = strdup(buf);
+	if (!ctx->team_devname)
+		return -ENOMEM;
+	return 0;
+}
+
+int teamd_get_devname(struct teamd_context *ctx, bool generate_enabled)
+{
+	int err;
+
+	if (!ctx->team_devname) {
+		const char *team_name;
+
+		err = teamd_config_string_get(ctx, &team_name, "$.device");
+		if (!err) {
+			ctx->team_devname = strdup(team_name);
+			if (!ctx->team_devname) {
+				teamd_log_err("Failed allocate memory for device name.");
+				return -ENOMEM;
+			}
+			goto skip_set;
+		} else {
+			teamd_log_dbg("Failed to get team device name from config.");
+			if (generate_enabled) {
+				err = teamd_generate_devname(ctx);
+				if (err) {
+					teamd_log_err("Failed to generate team device name.");
+					return err;
+				}
+			} else {
+				teamd_log_err("Team device name not specified.");
+				return -EINVAL;
+			}
+		}
+	}
+	err = teamd_config_string_set(ctx, ctx->team_devname, "$.device");
+	if (err) {
+		teamd_log_err("Failed to set team device name in config.");
+		return err;
+	}
+
+skip_set:
+	teamd_log_dbg("Using team device \"%s\".", ctx->team_devname);
+
+	err = asprintf(&ctx->ident, "%s_%s", ctx->argv0, ctx->team_devname);
+	if (err == -1) {
+		teamd_log_err("Failed allocate memory for identification string.");
+		return -ENOMEM;
+	}
+	return 0;
+}
+
+void teamd_context_fini(struct teamd_context *ctx)
+{
+	free(ctx->ident);
+	free(ctx->team_devname);
+	free(ctx->config_text);
+	free(ctx->config_file);
+	free(ctx->pid_file);
+	free(ctx);
+}
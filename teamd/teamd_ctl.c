@@ -242,12 +242,67 @@ static int teamd_ctl_method_state_item_value_set(struct teamd_context *ctx,
 	return ops->reply_succ(ops_priv, NULL);
 }
 
+static int teamd_ctl_method_team_add(struct teamd_context *ctx,
+				     const struct teamd_ctl_method_ops *ops,
+				     void *ops_priv)
+{
+	const char *config_text;
+	int err;
+
+	err = ops->get_args(ops_priv, "s", &config_text);
+	if (err)
+		return ops->reply_err(ops_priv, "InvalidArgs", "Did not receive correct message arguments.");
+	teamd_log_dbgx(ctx, 2, "config_text \"%s\"", config_text);
+
+	err = teamd_multi_team_add(ctx, config_text);
+	switch (err) {
+	case -EEXIST:
+		return ops->reply_err(ops_priv, "TeamExists", "Team device is already hosted.");
+	case 0:
+		break;
+	default:
+		return ops->reply_err(ops_priv, "TeamAddFail", "Failed to add team.");
+	}
+	return ops->reply_succ(ops_priv, NULL);
+}
+
+static int teamd_ctl_method_team_remove(struct teamd_context *ctx,
+					const struct teamd_ctl_method_ops *ops,
+					void *ops_priv)
+{
+	const char *team_devname;
+	int err;
+
+	err = ops->get_args(ops_priv, "s", &team_devname);
+	if (err)
+		return ops->reply_err(ops_priv, "InvalidArgs", "Did not receive correct message arguments.");
+	teamd_log_dbgx(ctx, 2, "team_devname \"%s\"", team_devname);
+
+	err = teamd_multi_team_remove(ctx, team_devname);
+	switch (err) {
+	case -ENODEV:
+		return ops->reply_err(ops_priv, "NoSuchDev", "No such device.");
+	case 0:
+		break;
+	default:
+		return ops->reply_err(ops_priv, "TeamRemoveFail", "Failed to remove team.");
+	}
+	return ops->reply_succ(ops_priv, NULL);
+}
+
 typedef int (*teamd_ctl_method_func_t)(struct teamd_context *ctx,
 				       const struct teamd_ctl_method_ops *ops,
 				       void *ops_priv);
+enum teamd_ctl_method_scope {
+	TEAMD_CTL_METHOD_SCOPE_TEAM, /* served by teams only */
+	TEAMD_CTL_METHOD_SCOPE_MULTI, /* served by multi-team instance only */
+	TEAMD_CTL_METHOD_SCOPE_ANY,
+};
+
 struct teamd_ctl_method {
 	const char *name;
 	teamd_ctl_method_func_t func;
+	enum teamd_ctl_method_scope scope;
 };
 
 static const struct teamd_ctl_method teamd_ctl_method_list[] = {
@@ -274,7 +329,7 @@ static const struct teamd_ctl_method teamd_ctl_method_list[] = {
 	{
 		.name = "ConfigDump",
 		.func = teamd_ctl_method_config_dump,
-
+		.scope = TEAMD_CTL_METHOD_SCOPE_ANY,
 	},
 	{
 		.name = "ConfigDumpActual",
@@ -284,23 +339,33 @@ static const struct teamd_ctl_method teamd_ctl_method_list[] = {
 	{
 		.name = "StateDump",
 		.func = teamd_ctl_method_state_dump,
-
+		.scope = TEAMD_CTL_METHOD_SCOPE_ANY,
 	},
 	{
 		.name = "StateItemValueGet",
 		.func = teamd_ctl_method_state_item_value_get,
-
+		.scope = TEAMD_CTL_METHOD_SCOPE_ANY,
 	},
 	{
 		.name = "StateItemValueSet",
 		.func = teamd_ctl_method_state_item_value_set,
-
+		.scope = TEAMD_CTL_METHOD_SCOPE_ANY,
+	},
+	{
+		.name = "TeamAdd",
+		.func = teamd_ctl_method_team_add,
+		.scope = TEAMD_CTL_METHOD_SCOPE_MULTI,
+	},
+	{
+		.name = "TeamRemove",
+		.func = teamd_ctl_method_team_remove,
+		.scope = TEAMD_CTL_METHOD_SCOPE_MULTI,
 	},
 };
 
 #define TEAMD_CTL_METHOD_LIST_SIZE ARRAY_SIZE(teamd_ctl_method_list)
 
-static teamd_ctl_method_func_t get_func_by_name(const char *method_name)
+static const struct teamd_ctl_method *get_method_by_name(const char *method_name)
 {
 	int i;
 
@@ -309,27 +374,30 @@ static teamd_ctl_method_func_t get_func_by_name(const char *method_name)
 
 		method = &teamd_ctl_method_list[i];
 		if (!strcmp(method->name, method_name))
-			return method->func;
+			return method;
 	}
 	return NULL;
 }
 
 bool teamd_ctl_method_exists(const char *method_name)
 {
-	return get_func_by_name(method_name);
+	return get_method_by_name(method_name);
 }
 
 int teamd_ctl_method_call(struct teamd_context *ctx, const char *method_name,
 			  const struct teamd_ctl_method_ops *ops,
 			  void *ops_priv)
 {
-	teamd_ctl_method_func_t func;
+	const struct teamd_ctl_method *method;
 
-	func = get_func_by_name(method_name);
-	if (!func) {
+	method = get_method_by_name(method_name);
+	if (!method) {
 		teamd_log_err("Failed call non-existent method named \"%s\".",
 			      method_name);
 		return -EINVAL;
 	}
-	return func(ctx, ops, ops_priv);
+	if (method->scope != TEAMD_CTL_METHOD_SCOPE_ANY &&
+	    (method->scope == TEAMD_CTL_METHOD_SCOPE_MULTI) != ctx->multi.enabled)
+		return ops->reply_err(ops_priv, "MethodNotSupported", "Method is not supported by this instance.");
+	return method->func(ctx, ops, ops_priv);
 }
@@ -288,7 +288,8 @@ static dbus_bool_t add_watch(DBusWatch *watch, void *priv)
 		fd_events |= TEAMD_LOOP_FD_EVENT_WRITE;
 
 	err = teamd_loop_callback_fd_add(ctx, WATCH_CB_NAME, watch,
-					 callback_watch, fd, fd_events);
+					 callback_watch, fd, fd_events,
+					 TEAMD_LOOP_PRIO_CONTROL);
 	if (err)
 		return FALSE;
 	if (dbus_watch_get_enabled(watch))
@@ -331,7 +332,8 @@ static dbus_bool_t add_timeout(DBusTimeout *timeout, void *priv)
 
 	ms_to_timespec(&ts, dbus_timeout_get_interval(timeout));
 	err = teamd_loop_callback_timer_add_set(ctx, TIMEOUT_CB_NAME, timeout,
-						callback_timeout, NULL, &ts);
+						callback_timeout, NULL, &ts,
+						TEAMD_LOOP_PRIO_CONTROL);
 	if (err)
 		return FALSE;
 	if (dbus_timeout_get_enabled(timeout))
@@ -430,7 +432,8 @@ static int dispatch_init(struct dispatch_priv **pdp, struct teamd_context *ctx)
 
 	err = teamd_loop_callback_fd_add(ctx, DISPATCH_CB_NAME, dp,
 					 callback_dispatch,
-					 dp->fd_r, TEAMD_LOOP_FD_EVENT_READ);
+					 dp->fd_r, TEAMD_LOOP_FD_EVENT_READ,
+					 TEAMD_LOOP_PRIO_CONTROL);
 	teamd_loop_callback_enable(ctx, DISPATCH_CB_NAME, dp);
 	if (err)
 		goto close_pipe;
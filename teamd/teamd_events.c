@@ -28,10 +28,34 @@
 
 #include "teamd.h"
 
+struct option_watch_name;
+
 struct event_watch_item {
 	struct list_item list;
 	const struct teamd_event_watch_ops *ops;
 	void *priv;
+	unsigned int seq;
+	struct list_item option_list; /* in name watch_list or any_list */
+	struct option_watch_name *option_name;
+	struct list_item family_list; /* in name family_list */
+	struct option_watch_name *family_name;
+};
+
+/*
+ * Option watches are indexed by option name so changed option is matched
+ * by one lookup instead of comparing its name with every watch.
+ */
+struct option_watch_name {
+	struct hash_item hitem;
+	char *name;
+	unsigned int refcount;
+	struct list_item watch_list;
+	struct list_item family_list;
+	struct list_item pending_list;
+	bool pending;
+	struct team_option **options; /* changed ones, kept between refreshes */
+	unsigned int option_count;
+	unsigned int options_size;
 };
 
 int teamd_event_port_added(struct teamd_context *ctx,
@@ -94,19 +118,121 @@ int teamd_event_port_link_changed(struct teamd_context *ctx,
 	return 0;
 }
 
+static struct option_watch_name *
+option_watch_name_find(struct teamd_context *ctx, const char *name,
+		       uint32_t hash)
+{
+	struct option_watch_name *owname;
+
+	hash_table_for_each_match(owname, &ctx->option_watch_index.name_table,
+				  hash, hitem) {
+		if (!strcmp(owname->name, name))
+			return owname;
+	}
+	return NULL;
+}
+
+static struct option_watch_name *
+option_watch_name_get(struct teamd_context *ctx, const char *name)
+{
+	struct option_watch_name *owname;
+	uint32_t hash = hash_str(name);
+
+	owname = option_watch_name_find(ctx, name, hash);
+	if (owname) {
+		owname->refcount++;
+		return owname;
+	}
+	owname = myzalloc(sizeof(*owname));
+	if (!owname)
+		return NULL;
+	owname->name = strdup(name);
+	if (!owname->name) {
+		free(owname);
+		return NULL;
+	}
+	owname->refcount = 1;
+	list_init(&owname->watch_list);
+	list_init(&owname->family_list);
+	hash_table_add(&ctx->option_watch_index.name_table,
+		       &owname->hitem, hash);
+	return owname;
+}
+
+static void option_watch_name_put(struct teamd_context *ctx,
+				  struct option_watch_name *owname)
+{
+	if (--owname->refcount)
+		return;
+	if (owname->pending)
+		list_del(&owname->pending_list);
+	hash_table_del(&ctx->option_watch_index.name_table, &owname->hitem);
+	free(owname->options);
+	free(owname->name);
+	free(owname);
+}
+
+static int option_watch_name_batch(struct teamd_context *ctx,
+				   struct option_watch_name *owname,
+				   struct team_option *option)
+{
+	struct team_option **options;
+	unsigned int size;
+
+	if (owname->option_count == owname->options_size) {
+		size = owname->options_size ? owname->options_size * 2 : 16;
+		options = realloc(owname->options, sizeof(*options) * size);
+		if (!options)
+			return -ENOMEM;
+		owname->options = options;
+		owname->options_size = size;
+	}
+	owname->options[owname->option_count++] = option;
+	if (!owname->pending) {
+		owname->pending = true;
+		list_add_tail(&ctx->option_watch_index.pending_list,
+			      &owname->pending_list);
+	}
+	return 0;
+}
+
+static struct event_watch_item *
+option_watch_next(struct list_item *head, struct event_watch_item *watch)
+{
+	return list_get_next_node_entry(head, watch, option_list);
+}
+
 int teamd_event_option_changed(struct teamd_context *ctx,
 			       struct team_option *option)
 {
+	struct list_item *any_list = &ctx->option_watch_index.any_list;
+	const char *name = team_get_option_name(option);
+	struct option_watch_name *owname;
+	struct event_watch_item *named = NULL;
+	struct event_watch_item *any = NULL;
 	struct event_watch_item *watch;
 	int err;
 
-	list_for_each_node_entry(watch, &ctx->event_watch_list, list) {
-		if (!watch->ops->option_changed)
-			continue;
-		if (watch->ops->option_changed_match_name &&
-		    strcmp(team_get_option_name(option),
-			   watch->ops->option_changed_match_name))
-			continue;
+	owname = option_watch_name_find(ctx, name, hash_str(name));
+	if (owname) {
+		if (!list_empty(&owname->family_list)) {
+			err = option_watch_name_batch(ctx, owname, option);
+			if (err)
+				return err;
+		}
+		named = option_watch_next(&owname->watch_list, NULL);
+	}
+	any = option_watch_next(any_list, NULL);
+
+	/* Named and catch-all watches are called in registration order */
+	while (named || any) {
+		if (!any || (named && named->seq < any->seq)) {
+			watch = named;
+			named = option_watch_next(&owname->watch_list, named);
+		} else {
+			watch = any;
+			any = option_watch_next(any_list, any);
+		}
 		err = watch->ops->option_changed(ctx, option, watch->priv);
 		if (err)
 			return err;
@@ -114,6 +240,44 @@ int teamd_event_option_changed(struct teamd_context *ctx,
 	return 0;
 }
 
+void teamd_event_option_changes_drop(struct teamd_context *ctx)
+{
+	struct option_watch_name *owname;
+	struct option_watch_name *tmp;
+
+	list_for_each_node_entry_safe(owname, tmp,
+				      &ctx->option_watch_index.pending_list,
+				      pending_list) {
+		list_del(&owname->pending_list);
+		owname->pending = false;
+		owname->option_count = 0;
+	}
+}
+
+/* Calls family watches with options batched since previous call */
+int teamd_event_option_changes_done(struct teamd_context *ctx)
+{
+	struct list_item *pending_list = &ctx->option_watch_index.pending_list;
+	struct option_watch_name *owname;
+	struct event_watch_item *watch;
+	int err = 0;
+
+	list_for_each_node_entry(owname, pending_list, pending_list) {
+		list_for_each_node_entry(watch, &owname->family_list,
+					 family_list) {
+			err = watch->ops->option_family_changed(ctx,
+								owname->options,
+								owname->option_count,
+								watch->priv);
+			if (err)
+				goto out;
+		}
+	}
+out:
+	teamd_event_option_changes_drop(ctx);
+	return err;
+}
+
 int teamd_event_ifinfo_hwaddr_changed(struct teamd_context *ctx,
 				      struct team_ifinfo *ifinfo)
 {
@@ -163,11 +327,23 @@ int teamd_event_ifinfo_ifname_changed(struct teamd_context *ctx,
 int teamd_events_init(struct teamd_context *ctx)
 {
 	list_init(&ctx->event_watch_list);
-	return 0;
+	list_init(&ctx->option_watch_index.any_list);
+	list_init(&ctx->option_watch_index.pending_list);
+	ctx->option_watch_index.seq = 0;
+	return hash_table_init(&ctx->option_watch_index.name_table);
 }
 
+static void __event_watch_free(struct teamd_context *ctx,
+			       struct event_watch_item *watch);
+
 void teamd_events_fini(struct teamd_context *ctx)
 {
+	struct event_watch_item *watch;
+	struct event_watch_item *tmp;
+
+	list_for_each_node_entry_safe(watch, tmp, &ctx->event_watch_list, list)
+		__event_watch_free(ctx, watch);
+	hash_table_fini(&ctx->option_watch_index.name_table);
 }
 
 static struct event_watch_item *
@@ -184,21 +360,64 @@ __find_event_watch(struct teamd_context *ctx,
 	return NULL;
 }
 
+static void __event_watch_free(struct teamd_context *ctx,
+			       struct event_watch_item *watch)
+{
+	if (watch->ops->option_changed)
+		list_del(&watch->option_list);
+	if (watch->option_name)
+		option_watch_name_put(ctx, watch->option_name);
+	if (watch->family_name) {
+		list_del(&watch->family_list);
+		option_watch_name_put(ctx, watch->family_name);
+	}
+	list_del(&watch->list);
+	free(watch);
+}
+
 int teamd_event_watch_register(struct teamd_context *ctx,
 			       const struct teamd_event_watch_ops *ops,
 			       void *priv)
 {
 	struct event_watch_item *watch;
+	struct list_item *option_head;
 
 	if (__find_event_watch(ctx, ops, priv))
 		return -EEXIST;
-	watch = malloc(sizeof(*watch));
+	watch = myzalloc(sizeof(*watch));
 	if (!watch)
 		return -ENOMEM;
 	watch->ops = ops;
 	watch->priv = priv;
+	watch->seq = ctx->option_watch_index.seq++;
+	if (ops->option_changed && ops->option_changed_match_name) {
+		watch->option_name = option_watch_name_get(ctx,
+							   ops->option_changed_match_name);
+		if (!watch->option_name)
+			goto free_watch;
+		option_head = &watch->option_name->watch_list;
+	} else {
+		option_head = &ctx->option_watch_index.any_list;
+	}
+	if (ops->option_family_changed && ops->option_family_match_name) {
+		watch->family_name = option_watch_name_get(ctx,
+							   ops->option_family_match_name);
+		if (!watch->family_name)
+			goto put_option_name;
+		list_add_tail(&watch->family_name->family_list,
+			      &watch->family_list);
+	}
+	if (ops->option_changed)
+		list_add_tail(option_head, &watch->option_list);
 	list_add_tail(&ctx->event_watch_list, &watch->list);
 	return 0;
+
+put_option_name:
+	if (watch->option_name)
+		option_watch_name_put(ctx, watch->option_name);
+free_watch:
+	free(watch);
+	return -ENOMEM;
 }
 
 void teamd_event_watch_unregister(struct teamd_context *ctx,
@@ -210,6 +429,5 @@ void teamd_event_watch_unregister(struct teamd_context *ctx,
 	watch = __find_event_watch(ctx, ops, priv);
 	if (!watch)
 		return;
-	list_del(&watch->list);
-	free(watch);
+	__event_watch_free(ctx, watch);
 }
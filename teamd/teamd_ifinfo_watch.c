@@ -35,7 +35,7 @@ static int ifinfo_change_handler_func(struct team_handle *th, void *priv,
 	struct team_ifinfo *ifinfo;
 	int err;
 
-	team_for_each_ifinfo(ifinfo, th) {
+	team_for_each_changed_ifinfo(ifinfo, th) {
 		if (ctx->ifinfo == ifinfo &&
 		    team_is_ifinfo_removed(ifinfo)) {
 			teamd_log_warn("Team device removal detected.");
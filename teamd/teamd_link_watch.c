@@ -426,7 +426,8 @@ static int link_watch_refresh_forced_send(struct teamd_context *ctx)
 }
 
 static int link_watch_enabled_option_changed(struct teamd_context *ctx,
-					     struct team_option *option,
+					     struct team_option **options,
+					     unsigned int option_count,
 					     void *priv)
 {
 	return link_watch_refresh_forced_send(ctx);
@@ -436,8 +437,8 @@ static const struct teamd_event_watch_ops link_watch_port_watch_ops = {
 	.port_added = link_watch_event_watch_port_added,
 	.port_removed = link_watch_event_watch_port_removed,
 	.port_link_changed = link_watch_event_watch_port_link_changed,
-	.option_changed = link_watch_enabled_option_changed,
-	.option_changed_match_name = "enabled",
+	.option_family_changed = link_watch_enabled_option_changed,
+	.option_family_match_name = "enabled",
 };
 
 static int port_link_state_up_get(struct teamd_context *ctx,
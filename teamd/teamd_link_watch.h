@@ -29,6 +29,8 @@ struct lw_psr_ops {
 			    struct lw_psr_port_priv *psr_ppriv);
 	int (*send)(struct lw_psr_port_priv *psr_ppriv);
 	int (*receive)(struct lw_psr_port_priv *psr_ppriv);
+	/* optional, called once all host names got resolved */
+	void (*resolved)(struct lw_psr_port_priv *psr_ppriv);
 };
 
 struct lw_psr_port_priv {
@@ -40,6 +42,8 @@ struct lw_psr_port_priv {
 	int sock;
 	unsigned int missed;
 	bool reply_received;
+	struct list_item resolve_list; /* host names being resolved */
+	bool resolve_failed;
 };
 
 int __set_sockaddr(struct sockaddr *sa, socklen_t sa_len, sa_family_t family,
@@ -60,6 +64,10 @@ int teamd_link_watch_check_link_up(struct teamd_context *ctx,
 
 struct lw_psr_port_priv *
 lw_psr_ppriv_get(struct lw_common_port_priv *common_ppriv);
+int lw_psr_sockaddr_resolve(struct teamd_context *ctx,
+			    struct lw_psr_port_priv *psr_ppriv,
+			    struct sockaddr *sa, socklen_t sa_len,
+			    sa_family_t family, const char *hostname);
 int lw_psr_port_added(struct teamd_context *ctx, struct teamd_port *tdport,
 		      void *priv, void *creator_priv);
 void lw_psr_port_removed(struct teamd_context *ctx, struct teamd_port *tdport,
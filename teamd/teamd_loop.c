@@ -0,0 +1,1449 @@
+/*
+ *   teamd_loop.c - Main run loop
+ *   Copyright (C) 2011-2013 Jiri Pirko <jiri@resnulli.us>
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <private/list.h>
+#include <private/hash.h>
+#include <private/misc.h>
+
+#include "teamd.h"
+#include "teamd_config.h"
+#include "teamd_state.h"
+
+/*
+ * Every fd watched by the run loop is represented by one teamd_loop_fd.
+ * More callbacks can watch the same fd (D-Bus does that for example), so
+ * the fd is registered in epoll set with union of events of all enabled
+ * callbacks on it.
+ */
+struct teamd_loop_fd {
+	struct list_item lcb_list;
+	uint32_t epoll_events;
+	int fd;
+};
+
+/* Upper bounds of dispatch latency histogram buckets in microseconds */
+static const uint64_t teamd_loop_latency_hist_bounds[] = {
+	10, 100, 1000, 10000, 100000,
+};
+
+#define TEAMD_LOOP_LATENCY_HIST_SIZE \
+	(ARRAY_SIZE(teamd_loop_latency_hist_bounds) + 1)
+
+/* Longer names are truncated in stall warnings */
+#define TEAMD_LOOP_STALL_NAME_LEN 32
+
+/*
+ * Callback names are interned so that callbacks can be hashed and
+ * compared by name pointer. Each name also links all callbacks using it
+ * which serves lookups done without priv.
+ */
+struct teamd_loop_name {
+	struct hash_item hitem;
+	struct list_item lcb_list;
+	char name[];
+};
+
+struct teamd_loop_callback {
+	struct list_item list;
+	struct list_item fd_list;
+	struct list_item ready_list;
+	struct list_item name_list;
+	struct hash_item hitem;
+	struct teamd_context *ctx;
+	struct teamd_loop_fd *lfd;
+	struct teamd_loop_name *lname;
+	const char *name;
+	void *priv;
+	teamd_loop_callback_func_t func;
+	int fd;
+	int fd_event;
+	int ready_events;
+	enum teamd_loop_prio prio;
+	bool is_period;
+	bool is_tail;
+	bool enabled;
+	bool ready;
+	struct {
+		uint64_t deadline;
+		uint64_t interval;
+		uint64_t pending;
+		unsigned int heap_index;
+		bool armed;
+	} timer;
+	uint64_t ready_time;
+	struct {
+		uint64_t dispatches;
+		uint64_t runtime_total;
+		uint64_t runtime_max;
+		uint64_t latency_hist[TEAMD_LOOP_LATENCY_HIST_SIZE];
+	} stats;
+};
+
+static uint32_t teamd_loop_fd_event_to_epoll(int fd_event)
+{
+	uint32_t events = 0;
+
+	if (fd_event & TEAMD_LOOP_FD_EVENT_READ)
+		events |= EPOLLIN;
+	if (fd_event & TEAMD_LOOP_FD_EVENT_WRITE)
+		events |= EPOLLOUT;
+	if (fd_event & TEAMD_LOOP_FD_EVENT_EXCEPTION)
+		events |= EPOLLPRI;
+	return events;
+}
+
+static int teamd_loop_epoll_to_fd_event(uint32_t events)
+{
+	int fd_event = 0;
+
+	/* Be compatible with select(), error and hangup wake up readers */
+	if (events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+		fd_event |= TEAMD_LOOP_FD_EVENT_READ;
+	if (events & (EPOLLOUT | EPOLLERR))
+		fd_event |= TEAMD_LOOP_FD_EVENT_WRITE;
+	if (events & EPOLLPRI)
+		fd_event |= TEAMD_LOOP_FD_EVENT_EXCEPTION;
+	return fd_event;
+}
+
+static struct teamd_loop_fd *teamd_loop_fd_find(struct teamd_context *ctx,
+						int fd)
+{
+	if (fd < 0 || fd >= ctx->run_loop->fd_table_size)
+		return NULL;
+	return ctx->run_loop->fd_table[fd];
+}
+
+static int teamd_loop_fd_table_resize(struct teamd_context *ctx, int fd)
+{
+	struct teamd_loop_fd **fd_table;
+	unsigned int old_size = ctx->run_loop->fd_table_size;
+	unsigned int new_size;
+
+	if (fd < old_size)
+		return 0;
+	new_size = old_size ? old_size : 64;
+	while (new_size <= fd)
+		new_size <<= 1;
+	fd_table = realloc(ctx->run_loop->fd_table,
+			   sizeof(*fd_table) * new_size);
+	if (!fd_table)
+		return -ENOMEM;
+	memset(fd_table + old_size, 0,
+	       sizeof(*fd_table) * (new_size - old_size));
+	ctx->run_loop->fd_table = fd_table;
+	ctx->run_loop->fd_table_size = new_size;
+	return 0;
+}
+
+static struct teamd_loop_fd *teamd_loop_fd_get(struct teamd_context *ctx,
+					       int fd)
+{
+	struct teamd_loop_fd *lfd;
+	int err;
+
+	lfd = teamd_loop_fd_find(ctx, fd);
+	if (lfd)
+		return lfd;
+	err = teamd_loop_fd_table_resize(ctx, fd);
+	if (err)
+		return NULL;
+	lfd = myzalloc(sizeof(*lfd));
+	if (!lfd)
+		return NULL;
+	list_init(&lfd->lcb_list);
+	lfd->fd = fd;
+	ctx->run_loop->fd_table[fd] = lfd;
+	return lfd;
+}
+
+static void teamd_loop_fd_put(struct teamd_context *ctx,
+			      struct teamd_loop_fd *lfd)
+{
+	if (!list_empty(&lfd->lcb_list))
+		return;
+	ctx->run_loop->fd_table[lfd->fd] = NULL;
+	free(lfd);
+}
+
+static int teamd_loop_fd_update(struct teamd_context *ctx,
+				struct teamd_loop_fd *lfd)
+{
+	struct teamd_loop_callback *lcb;
+	struct epoll_event ev;
+	uint32_t events = 0;
+	int op;
+
+	list_for_each_node_entry(lcb, &lfd->lcb_list, fd_list) {
+		if (lcb->enabled)
+			events |= teamd_loop_fd_event_to_epoll(lcb->fd_event);
+	}
+	if (events == lfd->epoll_events)
+		return 0;
+	if (!lfd->epoll_events)
+		op = EPOLL_CTL_ADD;
+	else if (!events)
+		op = EPOLL_CTL_DEL;
+	else
+		op = EPOLL_CTL_MOD;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = events;
+	ev.data.fd = lfd->fd;
+	if (epoll_ctl(ctx->run_loop->epfd, op, lfd->fd, &ev) &&
+	    !(op == EPOLL_CTL_DEL && (errno == EBADF || errno == ENOENT))) {
+		teamd_log_err("Failed to update epoll set for fd %d.",
+			      lfd->fd);
+		return -errno;
+	}
+	lfd->epoll_events = events;
+	return 0;
+}
+
+static void teamd_run_loop_ready_del(struct teamd_loop_callback *lcb)
+{
+	if (!lcb->ready)
+		return;
+	list_del(&lcb->ready_list);
+	lcb->ready = false;
+	lcb->ready_events = 0;
+}
+
+static void teamd_run_loop_ready_add(struct teamd_context *ctx,
+				     struct teamd_loop_callback *lcb,
+				     int events, uint64_t ready_time)
+{
+	lcb->ready_events |= events;
+	if (lcb->ready)
+		return;
+	list_add_tail(&ctx->run_loop->ready_list[lcb->prio], &lcb->ready_list);
+	lcb->ready = true;
+	lcb->ready_time = ready_time;
+}
+
+/*
+ * All timer callbacks share one timerfd. Armed timers are kept in a binary
+ * min-heap ordered by deadline and the timerfd is always armed for the
+ * deadline of the heap top, rounded up to the timer resolution so timers
+ * expiring within the same tick are handled by a single wakeup.
+ */
+static uint64_t teamd_loop_timespec_to_ns(const struct timespec *ts)
+{
+	return (uint64_t) ts->tv_sec * 1000000000 + ts->tv_nsec;
+}
+
+static uint64_t teamd_loop_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return teamd_loop_timespec_to_ns(&ts);
+}
+
+static void teamd_loop_timer_heap_set(struct teamd_context *ctx,
+				      unsigned int index,
+				      struct teamd_loop_callback *lcb)
+{
+	ctx->run_loop->timers.heap[index] = lcb;
+	lcb->timer.heap_index = index;
+}
+
+static void teamd_loop_timer_sift_up(struct teamd_context *ctx,
+				     unsigned int index)
+{
+	struct teamd_loop_callback **heap = ctx->run_loop->timers.heap;
+	struct teamd_loop_callback *lcb = heap[index];
+	unsigned int parent;
+
+	while (index) {
+		parent = (index - 1) / 2;
+		if (heap[parent]->timer.deadline <= lcb->timer.deadline)
+			break;
+		teamd_loop_timer_heap_set(ctx, index, heap[parent]);
+		index = parent;
+	}
+	teamd_loop_timer_heap_set(ctx, index, lcb);
+}
+
+static void teamd_loop_timer_sift_down(struct teamd_context *ctx,
+				       unsigned int index)
+{
+	struct teamd_loop_callback **heap = ctx->run_loop->timers.heap;
+	unsigned int count = ctx->run_loop->timers.heap_count;
+	struct teamd_loop_callback *lcb = heap[index];
+	unsigned int child;
+
+	while ((child = index * 2 + 1) < count) {
+		if (child + 1 < count &&
+		    heap[child + 1]->timer.deadline < heap[child]->timer.deadline)
+			child++;
+		if (lcb->timer.deadline <= heap[child]->timer.deadline)
+			break;
+		teamd_loop_timer_heap_set(ctx, index, heap[child]);
+		index = child;
+	}
+	teamd_loop_timer_heap_set(ctx, index, lcb);
+}
+
+/* Heap has room for all registered timers, so insert can not fail */
+static void teamd_loop_timer_heap_insert(struct teamd_context *ctx,
+					 struct teamd_loop_callback *lcb)
+{
+	unsigned int index = ctx->run_loop->timers.heap_count++;
+
+	teamd_loop_timer_heap_set(ctx, index, lcb);
+	teamd_loop_timer_sift_up(ctx, index);
+	lcb->timer.armed = true;
+}
+
+static void teamd_loop_timer_heap_remove(struct teamd_context *ctx,
+					 struct teamd_loop_callback *lcb)
+{
+	struct teamd_loop_callback **heap = ctx->run_loop->timers.heap;
+	unsigned int index = lcb->timer.heap_index;
+	unsigned int last = --ctx->run_loop->timers.heap_count;
+
+	lcb->timer.armed = false;
+	if (index == last)
+		return;
+	teamd_loop_timer_heap_set(ctx, index, heap[last]);
+	if (index && heap[(index - 1) / 2]->timer.deadline >
+		     heap[index]->timer.deadline)
+		teamd_loop_timer_sift_up(ctx, index);
+	else
+		teamd_loop_timer_sift_down(ctx, index);
+}
+
+static int teamd_loop_timers_fd_set(struct teamd_context *ctx,
+				    uint64_t deadline)
+{
+	struct itimerspec its;
+
+	if (deadline == ctx->run_loop->timers.fd_deadline)
+		return 0;
+	memset(&its, 0, sizeof(its));
+	its.it_value.tv_sec = deadline / 1000000000;
+	its.it_value.tv_nsec = deadline % 1000000000;
+	if (timerfd_settime(ctx->run_loop->timers.fd, TFD_TIMER_ABSTIME,
+			    &its, NULL) < 0) {
+		teamd_log_err("Failed to set timerfd.");
+		return -errno;
+	}
+	ctx->run_loop->timers.fd_deadline = deadline;
+	return 0;
+}
+
+static int teamd_loop_timers_rearm(struct teamd_context *ctx)
+{
+	uint64_t resolution = ctx->run_loop->timers.resolution_ns;
+	uint64_t deadline;
+
+	if (!ctx->run_loop->timers.heap_count)
+		return teamd_loop_timers_fd_set(ctx, 0);
+	deadline = ctx->run_loop->timers.heap[0]->timer.deadline;
+	deadline = (deadline + resolution - 1) / resolution * resolution;
+	return teamd_loop_timers_fd_set(ctx, deadline);
+}
+
+static void teamd_loop_timers_expire(struct teamd_context *ctx)
+{
+	struct teamd_loop_callback *lcb;
+	uint64_t ticks;
+	uint64_t now;
+	uint64_t exp;
+	uint64_t last_deadline;
+	uint64_t fd_deadline = ctx->run_loop->timers.fd_deadline;
+
+	/* Timer is non-blocking, spurious wakeup only gives EAGAIN here */
+	if (read(ctx->run_loop->timers.fd, &ticks, sizeof(ticks)) < 0 &&
+	    errno != EAGAIN && errno != EINTR)
+		teamd_log_err("Failed to read timerfd.");
+	ctx->run_loop->timers.fd_deadline = 0;
+	ctx->run_loop->timers.wakeups++;
+
+	now = teamd_loop_now();
+	while (ctx->run_loop->timers.heap_count) {
+		lcb = ctx->run_loop->timers.heap[0];
+		if (lcb->timer.deadline > now)
+			break;
+		exp = 1;
+		last_deadline = lcb->timer.deadline;
+		if (lcb->timer.interval) {
+			exp += (now - lcb->timer.deadline) /
+			       lcb->timer.interval;
+			last_deadline += (exp - 1) * lcb->timer.interval;
+			lcb->timer.deadline += exp * lcb->timer.interval;
+			teamd_loop_timer_sift_down(ctx, 0);
+		} else {
+			teamd_loop_timer_heap_remove(ctx, lcb);
+		}
+		lcb->timer.pending += exp;
+		ctx->run_loop->timers.expirations += exp;
+		/*
+		 * Timerfd is armed at deadline rounded up to the timer
+		 * resolution, do not count the rounding into latency.
+		 */
+		if (last_deadline < fd_deadline)
+			last_deadline = fd_deadline;
+		if (lcb->enabled)
+			teamd_run_loop_ready_add(ctx, lcb,
+						 TEAMD_LOOP_FD_EVENT_READ,
+						 last_deadline);
+	}
+	teamd_loop_timers_rearm(ctx);
+}
+
+static void teamd_loop_timer_handle_pending(struct teamd_loop_callback *lcb)
+{
+	if (lcb->timer.pending > 1)
+		teamd_log_warn("some periodic function calls missed (%" PRIu64 ")",
+			       lcb->timer.pending - 1);
+	lcb->timer.pending = 0;
+}
+
+/* Behaves the same way timerfd_settime() with relative time would */
+static int teamd_loop_timer_reset(struct teamd_context *ctx,
+				  struct teamd_loop_callback *lcb,
+				  struct timespec *interval,
+				  struct timespec *initial)
+{
+	if (lcb->timer.armed)
+		teamd_loop_timer_heap_remove(ctx, lcb);
+	lcb->timer.pending = 0;
+	teamd_run_loop_ready_del(lcb);
+	lcb->timer.interval = interval ?
+			      teamd_loop_timespec_to_ns(interval) : 0;
+	if (initial && timespec_is_zero(initial))
+		return teamd_loop_timers_rearm(ctx);
+	lcb->timer.deadline = teamd_loop_now() +
+			      (initial ? teamd_loop_timespec_to_ns(initial) : 1);
+	teamd_loop_timer_heap_insert(ctx, lcb);
+	return teamd_loop_timers_rearm(ctx);
+}
+
+/*
+ * Put callbacks of all ready fds into ready list of their priority class.
+ * Callbacks added by teamd_loop_callback_fd_add_tail() go after all others
+ * of the same class. Callbacks deferred in previous iteration stay ready
+ * and keep their position.
+ */
+static void teamd_run_loop_collect_ready(struct teamd_context *ctx,
+					 struct epoll_event *events, int count)
+{
+	struct teamd_loop_callback *lcb;
+	struct teamd_loop_fd *lfd;
+	struct list_item tail_list[TEAMD_LOOP_PRIO_COUNT];
+	uint64_t now = teamd_loop_now();
+	int fd_event;
+	int i;
+
+	for (i = 0; i < TEAMD_LOOP_PRIO_COUNT; i++)
+		list_init(&tail_list[i]);
+	for (i = 0; i < count; i++) {
+		if (events[i].data.fd == ctx->run_loop->timers.fd) {
+			teamd_loop_timers_expire(ctx);
+			continue;
+		}
+		lfd = teamd_loop_fd_find(ctx, events[i].data.fd);
+		if (!lfd)
+			continue;
+		fd_event = teamd_loop_epoll_to_fd_event(events[i].events);
+		list_for_each_node_entry(lcb, &lfd->lcb_list, fd_list) {
+			if (!lcb->enabled || !(lcb->fd_event & fd_event))
+				continue;
+			lcb->ready_events |= lcb->fd_event & fd_event;
+			if (lcb->ready)
+				continue;
+			lcb->ready_time = now;
+			lcb->ready = true;
+			list_add_tail(lcb->is_tail ? &tail_list[lcb->prio] :
+				      &ctx->run_loop->ready_list[lcb->prio],
+				      &lcb->ready_list);
+		}
+	}
+	for (i = 0; i < TEAMD_LOOP_PRIO_COUNT; i++)
+		list_move_nodes(&ctx->run_loop->ready_list[i], &tail_list[i]);
+}
+
+static void teamd_loop_callback_account(struct teamd_loop_callback *lcb,
+					uint64_t start, uint64_t end)
+{
+	uint64_t runtime = end - start;
+	uint64_t latency_us;
+	int i;
+
+	lcb->stats.dispatches++;
+	lcb->stats.runtime_total += runtime;
+	if (runtime > lcb->stats.runtime_max)
+		lcb->stats.runtime_max = runtime;
+	latency_us = start > lcb->ready_time ?
+		     (start - lcb->ready_time) / 1000 : 0;
+	for (i = 0; i < ARRAY_SIZE(teamd_loop_latency_hist_bounds); i++)
+		if (latency_us < teamd_loop_latency_hist_bounds[i])
+			break;
+	lcb->stats.latency_hist[i]++;
+}
+
+static void teamd_loop_stall_check(struct teamd_context *ctx,
+				   const char *name, void *priv,
+				   uint64_t runtime)
+{
+	if (ctx->run_loop->stall_budget_ms &&
+	    runtime > (uint64_t) ctx->run_loop->stall_budget_ms * 1000000) {
+		ctx->run_loop->stalls++;
+		teamd_log_warn("Loop callback \"%s\" (%p) stalled the loop for %" PRIu64 "us (budget %ums).",
+			       name, priv, runtime / 1000,
+			       ctx->run_loop->stall_budget_ms);
+	}
+}
+
+static struct teamd_loop_callback *
+teamd_run_loop_ready_first(struct teamd_context *ctx)
+{
+	struct list_item *ready_list;
+	int i;
+
+	for (i = 0; i < TEAMD_LOOP_PRIO_COUNT; i++) {
+		ready_list = &ctx->run_loop->ready_list[i];
+		if (!list_empty(ready_list))
+			return list_get_node_entry(ready_list->next,
+						   struct teamd_loop_callback,
+						   ready_list);
+	}
+	return NULL;
+}
+
+/*
+ * Callbacks are taken one by one from the head of ready list of the
+ * highest non-empty priority class. That allows any callback to disable
+ * or remove any other callback, including those which are still waiting
+ * to be processed in this iteration, and lets link callbacks which got
+ * ready meanwhile to overtake lower classes.
+ *
+ * When low_prio_budget is set and control callbacks ran longer than that
+ * in this iteration, the rest of them is deferred to the next iteration
+ * so fresh link and protocol events are looked at first. Only control
+ * callbacks are charged, a busy control client must not starve protocol
+ * work.
+ */
+static int teamd_run_loop_do_callbacks(struct teamd_context *ctx)
+{
+	struct teamd_loop_callback *lcb;
+	uint64_t budget = (uint64_t) ctx->run_loop->low_prio_budget_ms * 1000000;
+	uint64_t control_runtime = 0;
+	enum teamd_loop_prio prio;
+	char name[TEAMD_LOOP_STALL_NAME_LEN];
+	void *priv;
+	uint64_t start;
+	uint64_t end;
+	int events;
+	int err;
+
+	while ((lcb = teamd_run_loop_ready_first(ctx))) {
+		prio = lcb->prio;
+		if (prio == TEAMD_LOOP_PRIO_CONTROL && budget &&
+		    control_runtime >= budget) {
+			ctx->run_loop->low_prio_deferrals++;
+			break;
+		}
+		events = lcb->ready_events;
+		teamd_run_loop_ready_del(lcb);
+		if (lcb->is_period)
+			teamd_loop_timer_handle_pending(lcb);
+		/*
+		 * Callback may remove itself, that resets current_lcb and
+		 * may free the name as well, so keep a copy for the stall
+		 * warning.
+		 */
+		ctx->run_loop->current_lcb = lcb;
+		strncpy(name, lcb->name, sizeof(name) - 1);
+		name[sizeof(name) - 1] = '\0';
+		priv = lcb->priv;
+		start = teamd_loop_now();
+		err = lcb->func(lcb->ctx, events, priv);
+		end = teamd_loop_now();
+		if (prio == TEAMD_LOOP_PRIO_CONTROL)
+			control_runtime += end - start;
+		if (err)
+			teamd_log_warn("Loop callback failed with: %s",
+				       strerror(-err));
+		teamd_loop_stall_check(ctx, name, priv, end - start);
+		if (!ctx->run_loop->current_lcb)
+			continue;
+		ctx->run_loop->current_lcb = NULL;
+		if (err)
+			teamd_log_dbg("Failed loop callback: %s, %p",
+				      lcb->name, lcb->priv);
+		teamd_loop_callback_account(lcb, start, end);
+	}
+	return 0;
+}
+
+static bool teamd_run_loop_has_ready(struct teamd_context *ctx)
+{
+	return teamd_run_loop_ready_first(ctx) != NULL;
+}
+
+int teamd_flush_ports(struct teamd_context *ctx)
+{
+	if (!ctx->no_quit_destroy)
+		return teamd_port_remove_all(ctx);
+	else
+		teamd_port_obj_remove_all(ctx);
+	return 0;
+}
+
+#define TEAMD_RUN_LOOP_EVENTS_MAX 64
+
+int teamd_run_loop_run(struct teamd_context *ctx)
+{
+	int err;
+	int ctrl_fd = ctx->run_loop->ctrl_pipe_r;
+	struct epoll_event events[TEAMD_RUN_LOOP_EVENTS_MAX];
+	int count;
+	char ctrl_byte;
+	bool ctrl_ready;
+	int i;
+	bool quit_in_progress = false;
+
+	/*
+	 * To process all things correctly during cleanup, on quit command
+	 * received via control pipe ('q') do flush all existing ports.
+	 * After that wait until all ports are gone and return.
+	 */
+
+	while (true) {
+		if (quit_in_progress && !teamd_has_ports(ctx) &&
+		    !teamd_multi_has_teams(ctx))
+			return ctx->run_loop->err;
+
+		/* Do not block when there are deferred callbacks */
+		count = epoll_wait(ctx->run_loop->epfd, events,
+				   TEAMD_RUN_LOOP_EVENTS_MAX,
+				   teamd_run_loop_has_ready(ctx) ? 0 : -1);
+		if (count < 0) {
+			if (errno == EINTR)
+				continue;
+
+			teamd_log_err("epoll_wait() failed.");
+			return -errno;
+		}
+
+		ctx->run_loop->iterations++;
+		ctrl_ready = false;
+		for (i = 0; i < count; i++) {
+			if (events[i].data.fd == ctrl_fd)
+				ctrl_ready = true;
+		}
+
+		if (ctrl_ready) {
+			err = read(ctrl_fd, &ctrl_byte, 1);
+			if (err != -1) {
+				switch(ctrl_byte) {
+				case 'q':
+					if (quit_in_progress)
+						return -EBUSY;
+					err = teamd_flush_ports(ctx);
+					if (err)
+						return err;
+					quit_in_progress = true;
+					continue;
+				case 'r':
+					continue;
+				}
+			} else if (errno == EINTR || errno == EAGAIN) {
+				continue;
+			} else {
+				teamd_log_err("read() failed.");
+				return -errno;
+			}
+		}
+
+		teamd_run_loop_collect_ready(ctx, events, count);
+		err = teamd_run_loop_do_callbacks(ctx);
+		if (err)
+			return err;
+	}
+	return 0;
+}
+
+static void teamd_run_loop_sent_ctrl_byte(struct teamd_context *ctx,
+					  const char ctrl_byte)
+{
+	int err;
+
+retry:
+	err = write(ctx->run_loop->ctrl_pipe_w, &ctrl_byte, 1);
+	if (err == -1 && errno == EINTR)
+		goto retry;
+}
+
+/*
+ * Hosted team does not stop the shared loop. It is only marked here
+ * since quit may be requested from inside libteam change handlers, the
+ * master flushes its ports and reaps it later from its own callback.
+ */
+static void teamd_run_loop_team_quit(struct teamd_context *ctx)
+{
+	struct teamd_context *master = ctx->multi.master;
+	const char reap_byte = 'q';
+	int err;
+
+	if (ctx->multi.quitting)
+		return;
+	ctx->multi.quitting = true;
+retry:
+	err = write(master->multi.reap_pipe_w, &reap_byte, 1);
+	if (err == -1 && errno == EINTR)
+		goto retry;
+}
+
+void teamd_run_loop_quit(struct teamd_context *ctx, int err)
+{
+	if (ctx->multi.master) {
+		teamd_run_loop_team_quit(ctx);
+		return;
+	}
+	ctx->run_loop->err = err;
+	teamd_run_loop_sent_ctrl_byte(ctx, 'q');
+}
+
+void teamd_run_loop_restart(struct teamd_context *ctx)
+{
+	teamd_run_loop_sent_ctrl_byte(ctx, 'r');
+}
+
+static struct teamd_loop_name *teamd_loop_name_find(struct teamd_context *ctx,
+						    const char *cb_name,
+						    uint32_t hash)
+{
+	struct teamd_loop_name *lname;
+
+	hash_table_for_each_match(lname, &ctx->run_loop->name_table,
+				  hash, hitem) {
+		if (!strcmp(lname->name, cb_name))
+			return lname;
+	}
+	return NULL;
+}
+
+static struct teamd_loop_name *teamd_loop_name_get(struct teamd_context *ctx,
+						   const char *cb_name)
+{
+	struct teamd_loop_name *lname;
+	uint32_t hash = hash_str(cb_name);
+	size_t len;
+
+	lname = teamd_loop_name_find(ctx, cb_name, hash);
+	if (lname)
+		return lname;
+	len = strlen(cb_name) + 1;
+	lname = myzalloc(sizeof(*lname) + len);
+	if (!lname)
+		return NULL;
+	memcpy(lname->name, cb_name, len);
+	list_init(&lname->lcb_list);
+	hash_table_add(&ctx->run_loop->name_table, &lname->hitem, hash);
+	return lname;
+}
+
+static void teamd_loop_name_put(struct teamd_context *ctx,
+				struct teamd_loop_name *lname)
+{
+	if (!list_empty(&lname->lcb_list))
+		return;
+	hash_table_del(&ctx->run_loop->name_table, &lname->hitem);
+	free(lname);
+}
+
+static uint32_t teamd_loop_lcb_hash(struct teamd_loop_name *lname, void *priv)
+{
+	return hash_combine(lname->hitem.hash, hash_ptr(priv));
+}
+
+/* Callbacks of all contexts sharing the loop are linked in one name list */
+static struct teamd_loop_callback *
+teamd_loop_name_next_lcb(struct teamd_context *ctx,
+			 struct teamd_loop_name *lname,
+			 struct teamd_loop_callback *lcb)
+{
+	do {
+		lcb = list_get_next_node_entry(&lname->lcb_list, lcb,
+					       name_list);
+	} while (lcb && lcb->ctx != ctx);
+	return lcb;
+}
+
+static struct teamd_loop_callback *get_lcb(struct teamd_context *ctx,
+					   const char *cb_name, void *priv)
+{
+	struct teamd_loop_callback *lcb;
+	struct teamd_loop_name *lname;
+	uint32_t hash;
+
+	if (!cb_name)
+		return NULL;
+	lname = teamd_loop_name_find(ctx, cb_name, hash_str(cb_name));
+	if (!lname)
+		return NULL;
+	if (!priv)
+		return teamd_loop_name_next_lcb(ctx, lname, NULL);
+	hash = teamd_loop_lcb_hash(lname, priv);
+	hash_table_for_each_match(lcb, &ctx->run_loop->lcb_table, hash, hitem) {
+		if (lcb->lname == lname && lcb->priv == priv &&
+		    lcb->ctx == ctx)
+			return lcb;
+	}
+	return NULL;
+}
+
+/*
+ * (name, priv) pairs are unique within context so with priv given there
+ * is at most one match. Without priv, all callbacks of the given name
+ * registered by the context match.
+ */
+#define for_each_lcb_multi_match_safe(lcb, tmp, ctx, cb_name, priv)		\
+	for (lcb = get_lcb(ctx, cb_name, priv),					\
+	     tmp = (lcb && !(priv)) ?						\
+		   teamd_loop_name_next_lcb(ctx, lcb->lname, lcb) : NULL;	\
+	     lcb;								\
+	     lcb = tmp,								\
+	     tmp = (lcb && !(priv)) ?						\
+		   teamd_loop_name_next_lcb(ctx, lcb->lname, lcb) : NULL)
+
+static int lcb_state_name_get(struct teamd_context *ctx,
+			      struct team_state_gsc *gsc, void *priv)
+{
+	struct teamd_loop_callback *lcb = priv;
+
+	gsc->data.str_val.ptr = lcb->name;
+	return 0;
+}
+
+static const char *teamd_loop_prio_names[] = {
+	[TEAMD_LOOP_PRIO_LINK] = "link",
+	[TEAMD_LOOP_PRIO_PROTOCOL] = "protocol",
+	[TEAMD_LOOP_PRIO_CONTROL] = "control",
+};
+
+static int lcb_state_priority_get(struct teamd_context *ctx,
+				  struct team_state_gsc *gsc, void *priv)
+{
+	struct teamd_loop_callback *lcb = priv;
+
+	gsc->data.str_val.ptr = teamd_loop_prio_names[lcb->prio];
+	return 0;
+}
+
+static int lcb_state_enabled_get(struct teamd_context *ctx,
+				 struct team_state_gsc *gsc, void *priv)
+{
+	struct teamd_loop_callback *lcb = priv;
+
+	gsc->data.bool_val = lcb->enabled;
+	return 0;
+}
+
+static int lcb_state_dispatches_get(struct teamd_context *ctx,
+				    struct team_state_gsc *gsc, void *priv)
+{
+	struct teamd_loop_callback *lcb = priv;
+
+	gsc->data.int_val = lcb->stats.dispatches;
+	return 0;
+}
+
+static int lcb_state_runtime_avg_get(struct teamd_context *ctx,
+				     struct team_state_gsc *gsc, void *priv)
+{
+	struct teamd_loop_callback *lcb = priv;
+
+	if (!lcb->stats.dispatches)
+		gsc->data.int_val = 0;
+	else
+		gsc->data.int_val = lcb->stats.runtime_total /
+				    lcb->stats.dispatches / 1000;
+	return 0;
+}
+
+static int lcb_state_runtime_max_get(struct teamd_context *ctx,
+				     struct team_state_gsc *gsc, void *priv)
+{
+	struct teamd_loop_callback *lcb = priv;
+
+	gsc->data.int_val = lcb->stats.runtime_max / 1000;
+	return 0;
+}
+
+#define LCB_STATE_LATENCY_GETTER(index)						\
+static int lcb_state_latency_##index##_get(struct teamd_context *ctx,		\
+					   struct team_state_gsc *gsc,		\
+					   void *priv)				\
+{										\
+	struct teamd_loop_callback *lcb = priv;					\
+										\
+	gsc->data.int_val = lcb->stats.latency_hist[index];			\
+	return 0;								\
+}
+
+LCB_STATE_LATENCY_GETTER(0)
+LCB_STATE_LATENCY_GETTER(1)
+LCB_STATE_LATENCY_GETTER(2)
+LCB_STATE_LATENCY_GETTER(3)
+LCB_STATE_LATENCY_GETTER(4)
+LCB_STATE_LATENCY_GETTER(5)
+
+/* Bucket names have to match teamd_loop_latency_hist_bounds */
+static const struct teamd_state_val lcb_state_latency_vals[] = {
+	{
+		.subpath = "lt_10us",
+		.type = TEAMD_STATE_ITEM_TYPE_INT,
+		.getter = lcb_state_latency_0_get,
+	},
+	{
+		.subpath = "lt_100us",
+		.type = TEAMD_STATE_ITEM_TYPE_INT,
+		.getter = lcb_state_latency_1_get,
+	},
+	{
+		.subpath = "lt_1ms",
+		.type = TEAMD_STATE_ITEM_TYPE_INT,
+		.getter = lcb_state_latency_2_get,
+	},
+	{
+		.subpath = "lt_10ms",
+		.type = TEAMD_STATE_ITEM_TYPE_INT,
+		.getter = lcb_state_latency_3_get,
+	},
+	{
+		.subpath = "lt_100ms",
+		.type = TEAMD_STATE_ITEM_TYPE_INT,
+		.getter = lcb_state_latency_4_get,
+	},
+	{
+		.subpath = "ge_100ms",
+		.type = TEAMD_STATE_ITEM_TYPE_INT,
+		.getter = lcb_state_latency_5_get,
+	},
+};
+
+static const struct teamd_state_val lcb_state_vals[] = {
+	{
+		.subpath = "name",
+		.type = TEAMD_STATE_ITEM_TYPE_STRING,
+		.getter = lcb_state_name_get,
+	},
+	{
+		.subpath = "priority",
+		.type = TEAMD_STATE_ITEM_TYPE_STRING,
+		.getter = lcb_state_priority_get,
+	},
+	{
+		.subpath = "enabled",
+		.type = TEAMD_STATE_ITEM_TYPE_BOOL,
+		.getter = lcb_state_enabled_get,
+	},
+	{
+		.subpath = "dispatches",
+		.type = TEAMD_STATE_ITEM_TYPE_INT,
+		.getter = lcb_state_dispatches_get,
+	},
+	{
+		.subpath = "runtime_avg_us",
+		.type = TEAMD_STATE_ITEM_TYPE_INT,
+		.getter = lcb_state_runtime_avg_get,
+	},
+	{
+		.subpath = "runtime_max_us",
+		.type = TEAMD_STATE_ITEM_TYPE_INT,
+		.getter = lcb_state_runtime_max_get,
+	},
+	{
+		.subpath = "latency",
+		.vals = lcb_state_latency_vals,
+		.vals_count = ARRAY_SIZE(lcb_state_latency_vals),
+	},
+};
+
+static const struct teamd_state_val lcb_state_vg = {
+	.vals = lcb_state_vals,
+	.vals_count = ARRAY_SIZE(lcb_state_vals),
+};
+
+#define LCB_STATE_SUBPATH "setup.loop.callbacks"
+
+static int teamd_loop_timer_heap_reserve(struct teamd_context *ctx)
+{
+	struct teamd_loop_callback **heap;
+	unsigned int new_size;
+
+	if (ctx->run_loop->timers.count < ctx->run_loop->timers.heap_size)
+		return 0;
+	new_size = ctx->run_loop->timers.heap_size ?
+		   ctx->run_loop->timers.heap_size * 2 : 64;
+	heap = realloc(ctx->run_loop->timers.heap, sizeof(*heap) * new_size);
+	if (!heap)
+		return -ENOMEM;
+	ctx->run_loop->timers.heap = heap;
+	ctx->run_loop->timers.heap_size = new_size;
+	return 0;
+}
+
+static int __teamd_loop_callback_add(struct teamd_context *ctx,
+				     const char *cb_name, void *priv,
+				     teamd_loop_callback_func_t func,
+				     int fd, int fd_event, bool tail,
+				     bool is_period, enum teamd_loop_prio prio,
+				     struct teamd_loop_callback **p_lcb)
+{
+	int err;
+	struct teamd_loop_callback *lcb;
+
+	if (!cb_name || !priv || (!is_period && fd < 0) ||
+	    prio >= TEAMD_LOOP_PRIO_COUNT)
+		return -EINVAL;
+	if (get_lcb(ctx, cb_name, priv)) {
+		teamd_log_err("Callback named \"%s\" is already registered.",
+			      cb_name);
+		return -EEXIST;
+	}
+	if (is_period) {
+		err = teamd_loop_timer_heap_reserve(ctx);
+		if (err)
+			return err;
+	}
+	lcb = myzalloc(sizeof(*lcb));
+	if (!lcb) {
+		teamd_log_err("Failed alloc memory for callback.");
+		return -ENOMEM;
+	}
+	lcb->lname = teamd_loop_name_get(ctx, cb_name);
+	if (!lcb->lname) {
+		err = -ENOMEM;
+		goto lcb_free;
+	}
+	lcb->name = lcb->lname->name;
+	list_add_tail(&lcb->lname->lcb_list, &lcb->name_list);
+	if (!is_period) {
+		lcb->lfd = teamd_loop_fd_get(ctx, fd);
+		if (!lcb->lfd) {
+			err = -ENOMEM;
+			goto name_put;
+		}
+		list_add_tail(&lcb->lfd->lcb_list, &lcb->fd_list);
+	} else {
+		ctx->run_loop->timers.count++;
+	}
+	lcb->ctx = ctx;
+	lcb->priv = priv;
+	lcb->func = func;
+	lcb->fd = fd;
+	lcb->fd_event = fd_event & TEAMD_LOOP_FD_EVENT_MASK;
+	lcb->is_tail = tail;
+	lcb->is_period = is_period;
+	lcb->prio = prio;
+	err = teamd_state_val_register_ex(ctx, &lcb_state_vg, lcb, NULL,
+					  LCB_STATE_SUBPATH ".%s.%p",
+					  cb_name, priv);
+	if (err)
+		goto fd_list_del;
+	if (tail)
+		list_add_tail(&ctx->run_loop->callback_list, &lcb->list);
+	else
+		list_add(&ctx->run_loop->callback_list, &lcb->list);
+	hash_table_add(&ctx->run_loop->lcb_table, &lcb->hitem,
+		       teamd_loop_lcb_hash(lcb->lname, priv));
+	teamd_log_dbg("Added loop callback: %s, %p", lcb->name, lcb->priv);
+	if (p_lcb)
+		*p_lcb = lcb;
+	return 0;
+
+fd_list_del:
+	if (!is_period) {
+		list_del(&lcb->fd_list);
+		teamd_loop_fd_put(ctx, lcb->lfd);
+	} else {
+		ctx->run_loop->timers.count--;
+	}
+name_put:
+	list_del(&lcb->name_list);
+	teamd_loop_name_put(ctx, lcb->lname);
+lcb_free:
+	free(lcb);
+	return err;
+}
+
+int teamd_loop_callback_fd_add(struct teamd_context *ctx,
+			       const char *cb_name, void *priv,
+			       teamd_loop_callback_func_t func,
+			       int fd, int fd_event,
+			       enum teamd_loop_prio prio)
+{
+	return __teamd_loop_callback_add(ctx, cb_name, priv, func,
+					 fd, fd_event, false, false, prio,
+					 NULL);
+}
+
+int teamd_loop_callback_fd_add_tail(struct teamd_context *ctx,
+				    const char *cb_name, void *priv,
+				    teamd_loop_callback_func_t func,
+				    int fd, int fd_event,
+				    enum teamd_loop_prio prio)
+{
+	return __teamd_loop_callback_add(ctx, cb_name, priv, func,
+					 fd, fd_event, true, false, prio,
+					 NULL);
+}
+
+static void teamd_loop_callback_free(struct teamd_context *ctx,
+				     struct teamd_loop_callback *lcb)
+{
+	teamd_run_loop_ready_del(lcb);
+	if (ctx->run_loop->current_lcb == lcb)
+		ctx->run_loop->current_lcb = NULL;
+	teamd_state_val_unregister(lcb->ctx, &lcb_state_vg, lcb);
+	hash_table_del(&ctx->run_loop->lcb_table, &lcb->hitem);
+	list_del(&lcb->list);
+	if (lcb->is_period) {
+		if (lcb->timer.armed)
+			teamd_loop_timer_heap_remove(ctx, lcb);
+		ctx->run_loop->timers.count--;
+	} else {
+		list_del(&lcb->fd_list);
+		teamd_loop_fd_update(ctx, lcb->lfd);
+		teamd_loop_fd_put(ctx, lcb->lfd);
+	}
+	teamd_log_dbg("Removed loop callback: %s, %p", lcb->name, lcb->priv);
+	list_del(&lcb->name_list);
+	teamd_loop_name_put(ctx, lcb->lname);
+	free(lcb);
+}
+
+int teamd_loop_callback_timer_add_set(struct teamd_context *ctx,
+				      const char *cb_name, void *priv,
+				      teamd_loop_callback_func_t func,
+				      struct timespec *interval,
+				      struct timespec *initial,
+				      enum teamd_loop_prio prio)
+{
+	struct teamd_loop_callback *lcb;
+	int err;
+
+	err = __teamd_loop_callback_add(ctx, cb_name, priv, func, -1,
+					TEAMD_LOOP_FD_EVENT_READ, false, true,
+					prio, &lcb);
+	if (err)
+		return err;
+	if (interval || initial) {
+		err = teamd_loop_timer_reset(ctx, lcb, interval, initial);
+		if (err) {
+			teamd_loop_callback_free(ctx, lcb);
+			return err;
+		}
+	}
+	return 0;
+}
+
+int teamd_loop_callback_timer_add(struct teamd_context *ctx,
+				  const char *cb_name, void *priv,
+				  teamd_loop_callback_func_t func,
+				  enum teamd_loop_prio prio)
+{
+	return teamd_loop_callback_timer_add_set(ctx, cb_name, priv, func,
+						 NULL, NULL, prio);
+}
+
+struct teamd_loop_callback *teamd_loop_lcb_get(struct teamd_context *ctx,
+					       const char *cb_name,
+					       void *priv)
+{
+	if (!cb_name || !priv)
+		return NULL;
+	return get_lcb(ctx, cb_name, priv);
+}
+
+int teamd_loop_lcb_timer_set(struct teamd_context *ctx,
+			     struct teamd_loop_callback *lcb,
+			     struct timespec *interval,
+			     struct timespec *initial)
+{
+	if (!lcb->is_period) {
+		teamd_log_err("Can't reset non-periodic callback.");
+		return -EINVAL;
+	}
+	return teamd_loop_timer_reset(ctx, lcb, interval, initial);
+}
+
+int teamd_loop_callback_timer_set(struct teamd_context *ctx,
+				  const char *cb_name,
+				  void *priv,
+				  struct timespec *interval,
+				  struct timespec *initial)
+{
+	struct teamd_loop_callback *lcb;
+
+	if (!cb_name || !priv)
+		return -EINVAL;
+	lcb = get_lcb(ctx, cb_name, priv);
+	if (!lcb) {
+		teamd_log_err("Callback named \"%s\" not found.", cb_name);
+		return -ENOENT;
+	}
+	return teamd_loop_lcb_timer_set(ctx, lcb, interval, initial);
+}
+
+void teamd_loop_callback_del(struct teamd_context *ctx, const char *cb_name,
+			     void *priv)
+{
+	struct teamd_loop_callback *lcb;
+	struct teamd_loop_callback *tmp;
+	bool found = false;
+
+	for_each_lcb_multi_match_safe(lcb, tmp, ctx, cb_name, priv) {
+		teamd_loop_callback_free(ctx, lcb);
+		found = true;
+	}
+	if (!found)
+		teamd_log_dbg("Callback named \"%s\" not found.", cb_name);
+}
+
+int teamd_loop_lcb_enable(struct teamd_context *ctx,
+			  struct teamd_loop_callback *lcb)
+{
+	lcb->enabled = true;
+	if (!lcb->is_period)
+		return teamd_loop_fd_update(ctx, lcb->lfd);
+	/*
+	 * Expired while disabled, run as soon as possible. Non-empty ready
+	 * list makes the next epoll_wait() not block.
+	 */
+	if (lcb->timer.pending)
+		teamd_run_loop_ready_add(ctx, lcb, TEAMD_LOOP_FD_EVENT_READ,
+					 teamd_loop_now());
+	return 0;
+}
+
+int teamd_loop_callback_enable(struct teamd_context *ctx, const char *cb_name,
+			       void *priv)
+{
+	struct teamd_loop_callback *lcb;
+	struct teamd_loop_callback *tmp;
+	bool found = false;
+	int err;
+
+	for_each_lcb_multi_match_safe(lcb, tmp, ctx, cb_name, priv) {
+		found = true;
+		err = teamd_loop_lcb_enable(ctx, lcb);
+		if (err)
+			return err;
+	}
+	if (!found)
+		return -ENOENT;
+	return 0;
+}
+
+int teamd_loop_lcb_disable(struct teamd_context *ctx,
+			   struct teamd_loop_callback *lcb)
+{
+	lcb->enabled = false;
+	teamd_run_loop_ready_del(lcb);
+	if (!lcb->is_period)
+		return teamd_loop_fd_update(ctx, lcb->lfd);
+	return 0;
+}
+
+int teamd_loop_callback_disable(struct teamd_context *ctx, const char *cb_name,
+				void *priv)
+{
+	struct teamd_loop_callback *lcb;
+	struct teamd_loop_callback *tmp;
+	bool found = false;
+	int err;
+
+	for_each_lcb_multi_match_safe(lcb, tmp, ctx, cb_name, priv) {
+		found = true;
+		err = teamd_loop_lcb_disable(ctx, lcb);
+		if (err)
+			return err;
+	}
+	if (!found)
+		return -ENOENT;
+	return 0;
+}
+
+int teamd_loop_init(struct teamd_context *ctx)
+{
+	struct epoll_event ev;
+	int fds[2];
+	int err;
+	int tmp;
+	int i;
+
+	ctx->run_loop = myzalloc(sizeof(*ctx->run_loop));
+	if (!ctx->run_loop)
+		return -ENOMEM;
+	ctx->run_loop->refcount = 1;
+	list_init(&ctx->run_loop->callback_list);
+	for (i = 0; i < TEAMD_LOOP_PRIO_COUNT; i++)
+		list_init(&ctx->run_loop->ready_list[i]);
+	err = hash_table_init(&ctx->run_loop->lcb_table);
+	if (err)
+		goto free_run_loop;
+	err = hash_table_init(&ctx->run_loop->name_table);
+	if (err)
+		goto lcb_table_fini;
+	ctx->run_loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (ctx->run_loop->epfd < 0) {
+		err = -errno;
+		goto name_table_fini;
+	}
+	err = pipe(fds);
+	if (err) {
+		err = -errno;
+		goto close_epfd;
+	}
+	ctx->run_loop->ctrl_pipe_r = fds[0];
+	ctx->run_loop->ctrl_pipe_w = fds[1];
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = ctx->run_loop->ctrl_pipe_r;
+	err = epoll_ctl(ctx->run_loop->epfd, EPOLL_CTL_ADD,
+			ctx->run_loop->ctrl_pipe_r, &ev);
+	if (err) {
+		err = -errno;
+		teamd_log_err("Failed to add control pipe to epoll set.");
+		goto close_pipe;
+	}
+
+	err = teamd_config_int_get(ctx, &tmp, "$.loop.stall_budget");
+	if (!err) {
+		if (tmp < 0) {
+			teamd_log_err("\"stall_budget\" must not be negative number.");
+			err = -EINVAL;
+			goto close_pipe;
+		}
+		ctx->run_loop->stall_budget_ms = tmp;
+	}
+
+	err = teamd_config_int_get(ctx, &tmp, "$.loop.low_prio_budget");
+	if (!err) {
+		if (tmp < 0) {
+			teamd_log_err("\"low_prio_budget\" must not be negative number.");
+			err = -EINVAL;
+			goto close_pipe;
+		}
+		ctx->run_loop->low_prio_budget_ms = tmp;
+	}
+
+	ctx->run_loop->timers.resolution_ns = TEAMD_LOOP_TIMER_RESOLUTION_NS;
+	ctx->run_loop->timers.fd = timerfd_create(CLOCK_MONOTONIC,
+						 TFD_NONBLOCK | TFD_CLOEXEC);
+	if (ctx->run_loop->timers.fd < 0) {
+		err = -errno;
+		teamd_log_err("Failed to create timerfd.");
+		goto close_pipe;
+	}
+	ev.data.fd = ctx->run_loop->timers.fd;
+	err = epoll_ctl(ctx->run_loop->epfd, EPOLL_CTL_ADD,
+			ctx->run_loop->timers.fd, &ev);
+	if (err) {
+		err = -errno;
+		teamd_log_err("Failed to add timerfd to epoll set.");
+		goto close_timerfd;
+	}
+
+	return 0;
+
+close_timerfd:
+	close(ctx->run_loop->timers.fd);
+close_pipe:
+	close(ctx->run_loop->ctrl_pipe_r);
+	close(ctx->run_loop->ctrl_pipe_w);
+close_epfd:
+	close(ctx->run_loop->epfd);
+name_table_fini:
+	hash_table_fini(&ctx->run_loop->name_table);
+lcb_table_fini:
+	hash_table_fini(&ctx->run_loop->lcb_table);
+free_run_loop:
+	free(ctx->run_loop);
+	ctx->run_loop = NULL;
+	return err;
+}
+
+/*
+ * Makes ctx use run loop of master, ctx has to be released by fini.
+ * Loop is configured by the master only.
+ */
+void teamd_loop_attach(struct teamd_context *ctx, struct teamd_context *master)
+{
+	if (teamd_config_path_exists(ctx, "$.loop"))
+		teamd_log_warn("%s: \"loop\" config is ignored for hosted team, set it in multi-team instance config.",
+			       ctx->team_devname);
+	ctx->run_loop = master->run_loop;
+	ctx->run_loop->refcount++;
+}
+
+/*
+ * Callbacks of a context attached to shared loop must not outlive it,
+ * they would be dispatched with freed ctx and priv.
+ */
+static void teamd_loop_callbacks_reap(struct teamd_context *ctx)
+{
+	struct teamd_loop_callback *lcb;
+	struct teamd_loop_callback *tmp;
+
+	list_for_each_node_entry_safe(lcb, tmp, &ctx->run_loop->callback_list,
+				      list) {
+		if (lcb->ctx != ctx)
+			continue;
+		teamd_log_warn("Loop callback \"%s\" (%p) left registered, removing it.",
+			       lcb->name, lcb->priv);
+		teamd_loop_callback_free(ctx, lcb);
+	}
+}
+
+void teamd_loop_fini(struct teamd_context *ctx)
+{
+	if (--ctx->run_loop->refcount) {
+		teamd_loop_callbacks_reap(ctx);
+		ctx->run_loop = NULL;
+		return;
+	}
+	close(ctx->run_loop->timers.fd);
+	close(ctx->run_loop->ctrl_pipe_r);
+	close(ctx->run_loop->ctrl_pipe_w);
+	close(ctx->run_loop->epfd);
+	free(ctx->run_loop->fd_table);
+	free(ctx->run_loop->timers.heap);
+	hash_table_fini(&ctx->run_loop->name_table);
+	hash_table_fini(&ctx->run_loop->lcb_table);
+	free(ctx->run_loop);
+	ctx->run_loop = NULL;
+}
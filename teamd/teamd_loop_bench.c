@@ -0,0 +1,315 @@
+/*
+ *   teamd_loop_bench.c - Run loop micro-benchmark
+ *   Copyright (C) 2026 agent <agent@local>
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Measures cost of re-arming and toggling loop callbacks while many of
+ * them are registered and cost of dispatching ready fd callbacks by the
+ * run loop. Output is one "key=value" record per line.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <libdaemon/dlog.h>
+#include <private/misc.h>
+#include <private/bench.h>
+
+#include "teamd.h"
+#include "teamd_state.h"
+
+#define BENCH_DEFAULT_CALLBACKS 1000
+#define BENCH_ROUNDS 100
+#define BENCH_DISPATCHES 1000000
+#define BENCH_DISPATCH_CB_NAME "bench_dispatch"
+
+/* Names used by per-port callbacks of runners and link watches */
+static const char *bench_cb_names[] = {
+	"lacp_socket",
+	"lacp_periodic",
+	"lacp_timeout",
+	"lw_periodic",
+};
+
+#define BENCH_CB_NAMES_COUNT ARRAY_SIZE(bench_cb_names)
+
+struct bench_cb {
+	const char *name;
+	struct teamd_loop_callback *lcb;
+};
+
+static int bench_callback(struct teamd_context *ctx, int events, void *priv)
+{
+	return 0;
+}
+
+static int bench_timer_set_by_name(struct teamd_context *ctx,
+				   struct bench_cb *cbs, unsigned int count)
+{
+	struct timespec ts = { .tv_sec = 3 };
+	uint64_t start;
+	unsigned int i, j;
+	int err;
+
+	start = bench_now();
+	for (j = 0; j < BENCH_ROUNDS; j++) {
+		for (i = 0; i < count; i++) {
+			err = teamd_loop_callback_timer_set(ctx, cbs[i].name,
+							    &cbs[i], NULL,
+							    &ts);
+			if (err)
+				return err;
+		}
+	}
+	bench_record("loop_timer_set_by_name",
+		     (uint64_t) count * BENCH_ROUNDS, bench_now() - start,
+		     "callbacks=%u", count);
+	return 0;
+}
+
+static int bench_timer_set_by_handle(struct teamd_context *ctx,
+				     struct bench_cb *cbs, unsigned int count)
+{
+	struct timespec ts = { .tv_sec = 3 };
+	uint64_t start;
+	unsigned int i, j;
+	int err;
+
+	start = bench_now();
+	for (j = 0; j < BENCH_ROUNDS; j++) {
+		for (i = 0; i < count; i++) {
+			err = teamd_loop_lcb_timer_set(ctx, cbs[i].lcb,
+						       NULL, &ts);
+			if (err)
+				return err;
+		}
+	}
+	bench_record("loop_timer_set_by_handle",
+		     (uint64_t) count * BENCH_ROUNDS, bench_now() - start,
+		     "callbacks=%u", count);
+	return 0;
+}
+
+static int bench_toggle_by_name(struct teamd_context *ctx,
+				struct bench_cb *cbs, unsigned int count)
+{
+	uint64_t start;
+	unsigned int i, j;
+	int err;
+
+	start = bench_now();
+	for (j = 0; j < BENCH_ROUNDS; j++) {
+		for (i = 0; i < count; i++) {
+			err = teamd_loop_callback_enable(ctx, cbs[i].name,
+							 &cbs[i]);
+			if (err)
+				return err;
+			err = teamd_loop_callback_disable(ctx, cbs[i].name,
+							  &cbs[i]);
+			if (err)
+				return err;
+		}
+	}
+	bench_record("loop_toggle_by_name",
+		     (uint64_t) count * BENCH_ROUNDS * 2, bench_now() - start,
+		     "callbacks=%u", count);
+	return 0;
+}
+
+static int bench_toggle_by_handle(struct teamd_context *ctx,
+				  struct bench_cb *cbs, unsigned int count)
+{
+	uint64_t start;
+	unsigned int i, j;
+	int err;
+
+	start = bench_now();
+	for (j = 0; j < BENCH_ROUNDS; j++) {
+		for (i = 0; i < count; i++) {
+			err = teamd_loop_lcb_enable(ctx, cbs[i].lcb);
+			if (err)
+				return err;
+			err = teamd_loop_lcb_disable(ctx, cbs[i].lcb);
+			if (err)
+				return err;
+		}
+	}
+	bench_record("loop_toggle_by_handle",
+		     (uint64_t) count * BENCH_ROUNDS * 2, bench_now() - start,
+		     "callbacks=%u", count);
+	return 0;
+}
+
+struct bench_dispatch {
+	uint64_t count;
+	uint64_t limit;
+};
+
+struct bench_dispatch_cb {
+	struct bench_dispatch *dispatch;
+	int fd;
+};
+
+static int bench_dispatch_callback(struct teamd_context *ctx, int events,
+				   void *priv)
+{
+	struct bench_dispatch_cb *dcb = priv;
+
+	if (++dcb->dispatch->count == dcb->dispatch->limit)
+		teamd_run_loop_quit(ctx, 0);
+	return 0;
+}
+
+/*
+ * Eventfds are never read so all their callbacks stay ready and each
+ * loop iteration dispatches all of them.
+ */
+static int bench_dispatch(struct teamd_context *ctx, unsigned int ready_count)
+{
+	struct bench_dispatch dispatch = {
+		.limit = BENCH_DISPATCHES,
+	};
+	struct bench_dispatch_cb *dcbs;
+	uint64_t iterations;
+	uint64_t start;
+	unsigned int i;
+	int err = 0;
+
+	dcbs = myzalloc(sizeof(*dcbs) * ready_count);
+	if (!dcbs)
+		return -ENOMEM;
+	for (i = 0; i < ready_count; i++) {
+		dcbs[i].dispatch = &dispatch;
+		dcbs[i].fd = eventfd(1, EFD_NONBLOCK);
+		if (dcbs[i].fd == -1) {
+			err = -errno;
+			goto close_fds;
+		}
+		err = teamd_loop_callback_fd_add(ctx, BENCH_DISPATCH_CB_NAME,
+						 &dcbs[i],
+						 bench_dispatch_callback,
+						 dcbs[i].fd,
+						 TEAMD_LOOP_FD_EVENT_READ,
+						 TEAMD_LOOP_PRIO_PROTOCOL);
+		if (err) {
+			close(dcbs[i].fd);
+			goto close_fds;
+		}
+	}
+	err = teamd_loop_callback_enable(ctx, BENCH_DISPATCH_CB_NAME, NULL);
+	if (err)
+		goto close_fds;
+
+	iterations = ctx->run_loop->iterations;
+	start = bench_now();
+	err = teamd_run_loop_run(ctx);
+	if (!err)
+		bench_record("loop_dispatch", dispatch.count,
+			     bench_now() - start,
+			     "callbacks=%u iterations=%" PRIu64, ready_count,
+			     ctx->run_loop->iterations - iterations);
+
+close_fds:
+	teamd_loop_callback_del(ctx, BENCH_DISPATCH_CB_NAME, NULL);
+	while (i--)
+		close(dcbs[i].fd);
+	free(dcbs);
+	return err;
+}
+
+int main(int argc, char **argv)
+{
+	struct teamd_context *ctx;
+	struct bench_cb *cbs;
+	unsigned int count = BENCH_DEFAULT_CALLBACKS;
+	unsigned int i;
+	int err;
+
+	if (argc > 1)
+		count = strtoul(argv[1], NULL, 10);
+	if (!count) {
+		fprintf(stderr, "Usage: %s [CALLBACK_COUNT]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	daemon_set_verbosity(LOG_WARNING);
+
+	ctx = myzalloc(sizeof(*ctx));
+	cbs = myzalloc(sizeof(*cbs) * count);
+	if (!ctx || !cbs)
+		return EXIT_FAILURE;
+	/* Run loop quit flushes ports, there are none */
+	list_init(&ctx->port_obj_list);
+	ctx->no_quit_destroy = true;
+	ctx->config_json = json_object();
+	if (!ctx->config_json)
+		return EXIT_FAILURE;
+
+	err = teamd_state_init(ctx);
+	if (err)
+		return EXIT_FAILURE;
+	err = teamd_loop_init(ctx);
+	if (err) {
+		fprintf(stderr, "Failed to init run loop (%d)\n", err);
+		return EXIT_FAILURE;
+	}
+
+	for (i = 0; i < count; i++) {
+		cbs[i].name = bench_cb_names[i % BENCH_CB_NAMES_COUNT];
+		err = teamd_loop_callback_timer_add(ctx, cbs[i].name, &cbs[i],
+						    bench_callback,
+						    TEAMD_LOOP_PRIO_PROTOCOL);
+		if (err) {
+			fprintf(stderr, "Failed to add callback (%d)\n", err);
+			return EXIT_FAILURE;
+		}
+		cbs[i].lcb = teamd_loop_lcb_get(ctx, cbs[i].name, &cbs[i]);
+	}
+
+	err = bench_timer_set_by_name(ctx, cbs, count);
+	if (!err)
+		err = bench_timer_set_by_handle(ctx, cbs, count);
+	if (!err)
+		err = bench_toggle_by_name(ctx, cbs, count);
+	if (!err)
+		err = bench_toggle_by_handle(ctx, cbs, count);
+	if (!err)
+		err = bench_dispatch(ctx, 1);
+	if (!err)
+		err = bench_dispatch(ctx, 16);
+	if (!err)
+		err = bench_dispatch(ctx, 256);
+	if (err) {
+		fprintf(stderr, "Benchmark failed (%d)\n", err);
+		return EXIT_FAILURE;
+	}
+
+	for (i = 0; i < BENCH_CB_NAMES_COUNT; i++)
+		teamd_loop_callback_del(ctx, bench_cb_names[i], NULL);
+	teamd_loop_fini(ctx);
+	teamd_state_fini(ctx);
+	json_decref(ctx->config_json);
+	free(cbs);
+	free(ctx);
+	return EXIT_SUCCESS;
+}
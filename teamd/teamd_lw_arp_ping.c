@@ -38,6 +38,8 @@ struct lw_ap_port_priv {
 	} start; /* must be first */
 	struct in_addr src;
 	struct in_addr dst;
+	struct sockaddr_in src_sin; /* resolved asynchronously */
+	struct sockaddr_in dst_sin;
 	bool validate_active;
 	bool validate_inactive;
 	bool send_always;
@@ -102,19 +104,6 @@ static const struct sock_fprog arp_vlan_rpl_fprog = {
 	.filter = arp_vlan_rpl_flt,
 };
 
-static int set_in_addr(struct in_addr *addr, const char *hostname)
-{
-	struct sockaddr_in sin;
-	int err;
-
-	err = __set_sockaddr((struct sockaddr *) &sin, sizeof(sin),
-			     AF_INET, hostname);
-	if (err)
-		return err;
-	memcpy(addr, &sin.sin_addr, sizeof(*addr));
-	return 0;
-}
-
 static char *str_in_addr(struct in_addr *addr)
 {
 	struct sockaddr_in sin;
@@ -160,28 +149,30 @@ static int lw_ap_load_options(struct teamd_context *ctx,
 	int tmp;
 	int err;
 
+	/*
+	 * If source_host is not provided, just use address 0.0.0.0 according
+	 * to RFC 5227 (IPv4 Address Conflict Detection).
+	 */
 	err = teamd_config_string_get(ctx, &host, "@.source_host", cpcookie);
 	if (!err) {
-		err = set_in_addr(&ap_ppriv->src, host);
+		err = lw_psr_sockaddr_resolve(ctx, psr_ppriv,
+					      (struct sockaddr *) &ap_ppriv->src_sin,
+					      sizeof(ap_ppriv->src_sin),
+					      AF_INET, host);
 		if (err)
 			return err;
 	}
-	/*
-	 * If source_host is not provided, just use address 0.0.0.0 according
-	 * to RFC 5227 (IPv4 Address Conflict Detection).
-	 */
-	teamd_log_dbg("source address \"%s\".",
-		      str_in_addr(&ap_ppriv->src));
 
 	err = teamd_config_string_get(ctx, &host, "@.target_host", cpcookie);
 	if (err) {
 		teamd_log_err("Failed to get \"target_host\" link-watch option.");
 		return -EINVAL;
 	}
-	err = set_in_addr(&ap_ppriv->dst, host);
+	err = lw_psr_sockaddr_resolve(ctx, psr_ppriv,
+				      (struct sockaddr *) &ap_ppriv->dst_sin,
+				      sizeof(ap_ppriv->dst_sin), AF_INET, host);
 	if (err)
 		return err;
-	teamd_log_dbg("target address \"%s\".", str_in_addr(&ap_ppriv->dst));
 
 	err = teamd_config_bool_get(ctx, &ap_ppriv->validate_active,
 				    "@.validate_active", cpcookie);
@@ -215,6 +206,16 @@ static int lw_ap_load_options(struct teamd_context *ctx,
 	return 0;
 }
 
+static void lw_ap_resolved(struct lw_psr_port_priv *psr_ppriv)
+{
+	struct lw_ap_port_priv *ap_ppriv = lw_ap_ppriv_get(psr_ppriv);
+
+	ap_ppriv->src = ap_ppriv->src_sin.sin_addr;
+	ap_ppriv->dst = ap_ppriv->dst_sin.sin_addr;
+	teamd_log_dbg("source address \"%s\".", str_in_addr(&ap_ppriv->src));
+	teamd_log_dbg("target address \"%s\".", str_in_addr(&ap_ppriv->dst));
+}
+
 static int __get_port_curr_hwaddr(struct lw_psr_port_priv *psr_ppriv,
 				  struct sockaddr_ll *addr, size_t expected_len)
 {
@@ -298,47 +299,70 @@ static int lw_ap_send(struct lw_psr_port_priv *psr_ppriv)
 	}
 }
 
+static bool lw_ap_reply_valid(struct lw_ap_port_priv *ap_ppriv,
+			      struct arp_packet *ap, struct sockaddr_ll *ll_my)
+{
+	if (ap->ah.ar_hrd != htons(ll_my->sll_hatype) ||
+	    ap->ah.ar_pro != htons(ETH_P_IP) ||
+	    ap->ah.ar_hln != ll_my->sll_halen ||
+	    ap->ah.ar_pln != 4)
+		return false;
+
+	if ((ap_ppriv->src.s_addr != ap->target_ip.s_addr ||
+	     ap_ppriv->dst.s_addr != ap->sender_ip.s_addr) &&
+	    (ap_ppriv->dst.s_addr != ap->target_ip.s_addr ||
+	     ap_ppriv->src.s_addr != ap->sender_ip.s_addr))
+		return false;
+	return true;
+}
+
 static int lw_ap_receive(struct lw_psr_port_priv *psr_ppriv)
 {
 	struct lw_common_port_priv *common_ppriv = &psr_ppriv->common;
 	struct lw_ap_port_priv *ap_ppriv = lw_ap_ppriv_get(psr_ppriv);
 	int err;
 	struct sockaddr_ll ll_my;
-	struct sockaddr_ll ll_from;
-	struct arp_packet ap;
+	struct sockaddr_ll ll_from[TEAMD_MMSG_BATCH];
+	struct arp_packet ap[TEAMD_MMSG_BATCH];
+	struct iovec iov[TEAMD_MMSG_BATCH];
+	struct mmsghdr msgvec[TEAMD_MMSG_BATCH];
 	bool port_enabled;
+	bool validate;
+	int count;
+	int i;
 
-	err = teamd_recvfrom(psr_ppriv->sock, &ap, sizeof(ap), 0,
-			     (struct sockaddr *) &ll_from, sizeof(ll_from));
-	if (err <= 0)
-		return err;
+	teamd_mmsg_init(msgvec, iov, TEAMD_MMSG_BATCH, ap, sizeof(ap[0]),
+			ll_from, sizeof(ll_from[0]));
+	count = teamd_recvmmsg(psr_ppriv->sock, msgvec, TEAMD_MMSG_BATCH, 0);
+	if (count <= 0)
+		return count;
 
 	err = teamd_port_enabled(common_ppriv->ctx, common_ppriv->tdport,
 				 &port_enabled);
 	if (err)
 		return err;
 
-	if ((port_enabled && ap_ppriv->validate_active) ||
-	    (!port_enabled && ap_ppriv->validate_inactive)) {
+	validate = (port_enabled && ap_ppriv->validate_active) ||
+		   (!port_enabled && ap_ppriv->validate_inactive);
+	if (validate) {
 		err = __get_port_curr_hwaddr(psr_ppriv, &ll_my, 0);
 		if (err)
 			return err;
-
-		if (ap.ah.ar_hrd != htons(ll_my.sll_hatype) ||
-		    ap.ah.ar_pro != htons(ETH_P_IP) ||
-		    ap.ah.ar_hln != ll_my.sll_halen ||
-		    ap.ah.ar_pln != 4) {
-			return 0;
-		}
-
-		if ((ap_ppriv->src.s_addr != ap.target_ip.s_addr ||
-		     ap_ppriv->dst.s_addr != ap.sender_ip.s_addr) &&
-		    (ap_ppriv->dst.s_addr != ap.target_ip.s_addr ||
-		     ap_ppriv->src.s_addr != ap.sender_ip.s_addr))
-			return 0;
 	}
 
-	psr_ppriv->reply_received = true;
+	/* Drain all queued frames, one valid reply is enough */
+	while (1) {
+		for (i = 0; i < count; i++)
+			if (!validate ||
+			    lw_ap_reply_valid(ap_ppriv, &ap[i], &ll_my))
+				psr_ppriv->reply_received = true;
+		if (count < TEAMD_MMSG_BATCH)
+			break;
+		count = teamd_recvmmsg(psr_ppriv->sock, msgvec,
+				       TEAMD_MMSG_BATCH, 0);
+		if (count < 0)
+			return count;
+	}
 	return 0;
 }
 
@@ -348,6 +372,7 @@ static const struct lw_psr_ops lw_psr_ops_ap = {
 	.load_options		= lw_ap_load_options,
 	.send			= lw_ap_send,
 	.receive		= lw_ap_receive,
+	.resolved		= lw_ap_resolved,
 };
 
 static int lw_ap_port_added(struct teamd_context *ctx,
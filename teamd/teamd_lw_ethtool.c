@@ -31,6 +31,7 @@ struct lw_ethtool_port_priv {
 	struct lw_common_port_priv common; /* must be first */
 	struct timespec delay_up;
 	struct timespec delay_down;
+	struct teamd_loop_callback *delay_lcb;
 };
 
 static struct lw_ethtool_port_priv *
@@ -59,7 +60,7 @@ static int lw_ethtool_event_watch_port_changed(struct teamd_context *ctx,
 	 * Link changed for sure, so if there is some delay in progress,
 	 * cancel it before proceeding.
 	 */
-	teamd_loop_callback_disable(ctx, LW_ETHTOOL_DELAY_CB_NAME, priv);
+	teamd_loop_lcb_disable(ctx, ethtool_ppriv->delay_lcb);
 	link_up = team_is_port_link_up(tdport->team_port);
 	if (!teamd_link_watch_link_up_differs(common_ppriv, link_up))
 		return 0;
@@ -74,13 +75,13 @@ static int lw_ethtool_event_watch_port_changed(struct teamd_context *ctx,
 		delay = &ethtool_ppriv->delay_down;
 	}
 
-	err = teamd_loop_callback_timer_set(ctx, LW_ETHTOOL_DELAY_CB_NAME,
-					    priv, NULL, delay);
+	err = teamd_loop_lcb_timer_set(ctx, ethtool_ppriv->delay_lcb,
+				       NULL, delay);
 	if (err) {
 		teamd_log_err("Failed to set delay timer.");
 		return err;
 	}
-	teamd_loop_callback_enable(ctx, LW_ETHTOOL_DELAY_CB_NAME, priv);
+	teamd_loop_lcb_enable(ctx, ethtool_ppriv->delay_lcb);
 	return 0;
 
 nodelay:
@@ -138,6 +139,7 @@ static int lw_ethtool_port_added(struct teamd_context *ctx,
 				 struct teamd_port *tdport,
 				 void *priv, void *creator_priv)
 {
+	struct lw_ethtool_port_priv *ethtool_ppriv = priv;
 	int err;
 
 	err = lw_ethtool_load_options(ctx, tdport, priv);
@@ -146,11 +148,15 @@ static int lw_ethtool_port_added(struct teamd_context *ctx,
 		return err;
 	}
 	err = teamd_loop_callback_timer_add(ctx, LW_ETHTOOL_DELAY_CB_NAME,
-					    priv, lw_ethtool_callback_delay);
+					    priv, lw_ethtool_callback_delay,
+					    TEAMD_LOOP_PRIO_LINK);
 	if (err) {
 		teamd_log_err("Failed add delay callback timer");
 		return err;
 	}
+	ethtool_ppriv->delay_lcb = teamd_loop_lcb_get(ctx,
+						      LW_ETHTOOL_DELAY_CB_NAME,
+						      priv);
 	err = teamd_event_watch_register(ctx, &lw_ethtool_port_watch_ops, priv);
 	if (err) {
 		teamd_log_err("Failed to register event watch.");
@@ -31,17 +31,6 @@
  * IPV6 NS/NA ping link watch
  */
 
-static int set_sockaddr_in6(struct sockaddr_in6 *sin6, const char *hostname)
-{
-	int err;
-
-	err = __set_sockaddr((struct sockaddr *) sin6, sizeof(*sin6),
-			     AF_INET6, hostname);
-	if (err)
-		return err;
-	return 0;
-}
-
 static char *str_sockaddr_in6(struct sockaddr_in6 *sin6)
 {
 	static char buf[NI_MAXHOST];
@@ -169,13 +158,17 @@ static int lw_nsnap_load_options(struct teamd_context *ctx,
 		teamd_log_err("Failed to get \"target_host\" link-watch option.");
 		return -EINVAL;
 	}
-	err = set_sockaddr_in6(&nsnap_ppriv->dst, host);
-	if (err)
-		return err;
+	return lw_psr_sockaddr_resolve(ctx, psr_ppriv,
+				       (struct sockaddr *) &nsnap_ppriv->dst,
+				       sizeof(nsnap_ppriv->dst), AF_INET6, host);
+}
+
+static void lw_nsnap_resolved(struct lw_psr_port_priv *psr_ppriv)
+{
+	struct lw_nsnap_port_priv *nsnap_ppriv = lw_nsnap_ppriv_get(psr_ppriv);
+
 	teamd_log_dbg("target address \"%s\".",
 		      str_sockaddr_in6(&nsnap_ppriv->dst));
-
-	return 0;
 }
 
 static void compute_multi_in6_addr(struct in6_addr *addr)
@@ -231,34 +224,48 @@ struct na_packet {
 	unsigned char			hwaddr[ETH_ALEN];
 };
 
-static int lw_nsnap_receive(struct lw_psr_port_priv *psr_ppriv)
+static bool lw_nsnap_reply_valid(struct lw_nsnap_port_priv *nsnap_ppriv,
+				 struct na_packet *nap)
 {
-	struct lw_nsnap_port_priv *nsnap_ppriv = lw_nsnap_ppriv_get(psr_ppriv);
-	struct na_packet nap;
-	struct sockaddr_ll ll_from;
-	int err;
-
-	err = teamd_recvfrom(psr_ppriv->sock, &nap, sizeof(nap), 0,
-			     (struct sockaddr *) &ll_from, sizeof(ll_from));
-	if (err <= 0)
-		return err;
-
 	/* check IPV6 header */
-	if (nap.ip6h.ip6_vfc != 0x60 /* IPV6 */ ||
-	    nap.ip6h.ip6_plen != htons(sizeof(nap) - sizeof(nap.ip6h)) ||
-	    nap.ip6h.ip6_nxt != IPPROTO_ICMPV6 ||
-	    nap.ip6h.ip6_hlim != 255 /* Do not route */ ||
-	    memcmp(&nap.ip6h.ip6_src, &nsnap_ppriv->dst.sin6_addr,
+	if (nap->ip6h.ip6_vfc != 0x60 /* IPV6 */ ||
+	    nap->ip6h.ip6_plen != htons(sizeof(*nap) - sizeof(nap->ip6h)) ||
+	    nap->ip6h.ip6_nxt != IPPROTO_ICMPV6 ||
+	    nap->ip6h.ip6_hlim != 255 /* Do not route */ ||
+	    memcmp(&nap->ip6h.ip6_src, &nsnap_ppriv->dst.sin6_addr,
 		   sizeof(struct in6_addr)))
-		return 0;
+		return false;
 
 	/* check ICMP6 header */
-	if (nap.nah.nd_na_type != ND_NEIGHBOR_ADVERT ||
-	    nap.opt.nd_opt_type != ND_OPT_TARGET_LINKADDR ||
-	    nap.opt.nd_opt_len != 1 /* 8 bytes */)
-		return 0;
+	if (nap->nah.nd_na_type != ND_NEIGHBOR_ADVERT ||
+	    nap->opt.nd_opt_type != ND_OPT_TARGET_LINKADDR ||
+	    nap->opt.nd_opt_len != 1 /* 8 bytes */)
+		return false;
+	return true;
+}
 
-	psr_ppriv->reply_received = true;
+static int lw_nsnap_receive(struct lw_psr_port_priv *psr_ppriv)
+{
+	struct lw_nsnap_port_priv *nsnap_ppriv = lw_nsnap_ppriv_get(psr_ppriv);
+	struct na_packet nap[TEAMD_MMSG_BATCH];
+	struct sockaddr_ll ll_from[TEAMD_MMSG_BATCH];
+	struct iovec iov[TEAMD_MMSG_BATCH];
+	struct mmsghdr msgvec[TEAMD_MMSG_BATCH];
+	int count;
+	int i;
+
+	teamd_mmsg_init(msgvec, iov, TEAMD_MMSG_BATCH, nap, sizeof(nap[0]),
+			ll_from, sizeof(ll_from[0]));
+	/* Drain all queued frames, one valid reply is enough */
+	do {
+		count = teamd_recvmmsg(psr_ppriv->sock, msgvec,
+				       TEAMD_MMSG_BATCH, 0);
+		if (count < 0)
+			return count;
+		for (i = 0; i < count; i++)
+			if (lw_nsnap_reply_valid(nsnap_ppriv, &nap[i]))
+				psr_ppriv->reply_received = true;
+	} while (count == TEAMD_MMSG_BATCH);
 	return 0;
 }
 
@@ -268,6 +275,7 @@ static const struct lw_psr_ops lw_psr_ops_nsnap = {
 	.load_options		= lw_nsnap_load_options,
 	.send			= lw_nsnap_send,
 	.receive		= lw_nsnap_receive,
+	.resolved		= lw_nsnap_resolved,
 };
 
 static int lw_nsnap_port_added(struct teamd_context *ctx,
@@ -18,10 +18,13 @@
  *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
  */
 
+#include <stdlib.h>
+#include <string.h>
 #include <private/misc.h>
 #include "teamd.h"
 #include "teamd_link_watch.h"
 #include "teamd_config.h"
+#include "teamd_worker.h"
 
 /*
  * Generic periodic send/receive link watch "template"
@@ -57,9 +60,106 @@ static int lw_psr_callback_periodic(struct teamd_context *ctx, int events, void
 		return err;
 	psr_ppriv->reply_received = false;
 
+	/* Nowhere to send to until host names are resolved */
+	if (!list_empty(&psr_ppriv->resolve_list) || psr_ppriv->resolve_failed)
+		return 0;
 	return psr_ppriv->ops->send(psr_ppriv);
 }
 
+/*
+ * Host names are resolved by worker threads since getaddrinfo() may block
+ * for seconds when name servers are slow or unreachable.
+ */
+struct lw_psr_resolve_job {
+	struct teamd_worker_job job;
+	struct list_item list;
+	struct lw_psr_port_priv *psr_ppriv;
+	struct sockaddr *sa;
+	socklen_t sa_len;
+	sa_family_t family;
+	struct sockaddr_storage result;
+	char hostname[];
+};
+
+static int lw_psr_resolve_job_func(struct teamd_worker_job *job)
+{
+	struct lw_psr_resolve_job *rjob;
+
+	rjob = get_container(job, struct lw_psr_resolve_job, job);
+	return __set_sockaddr((struct sockaddr *) &rjob->result, rjob->sa_len,
+			      rjob->family, rjob->hostname);
+}
+
+static void lw_psr_resolve_job_done(struct teamd_context *ctx,
+				    struct teamd_worker_job *job, int err)
+{
+	struct lw_psr_resolve_job *rjob;
+	struct lw_psr_port_priv *psr_ppriv;
+
+	rjob = get_container(job, struct lw_psr_resolve_job, job);
+	if (err == -ECANCELED)
+		goto free_job;
+	psr_ppriv = rjob->psr_ppriv;
+	list_del(&rjob->list);
+	if (err) {
+		teamd_log_err("%s: Failed to resolve \"%s\".",
+			      psr_ppriv->common.tdport->ifname, rjob->hostname);
+		psr_ppriv->resolve_failed = true;
+		goto free_job;
+	}
+	memcpy(rjob->sa, &rjob->result, rjob->sa_len);
+	teamd_log_dbg("%s: Resolved \"%s\".", psr_ppriv->common.tdport->ifname,
+		      rjob->hostname);
+	if (list_empty(&psr_ppriv->resolve_list) &&
+	    !psr_ppriv->resolve_failed && psr_ppriv->ops->resolved)
+		psr_ppriv->ops->resolved(psr_ppriv);
+free_job:
+	free(rjob);
+}
+
+int lw_psr_sockaddr_resolve(struct teamd_context *ctx,
+			    struct lw_psr_port_priv *psr_ppriv,
+			    struct sockaddr *sa, socklen_t sa_len,
+			    sa_family_t family, const char *hostname)
+{
+	struct lw_psr_resolve_job *rjob;
+	size_t hostname_len = strlen(hostname) + 1;
+	int err;
+
+	if (sa_len > sizeof(rjob->result))
+		return -EINVAL;
+	rjob = myzalloc(sizeof(*rjob) + hostname_len);
+	if (!rjob)
+		return -ENOMEM;
+	teamd_worker_job_init(&rjob->job, lw_psr_resolve_job_func,
+			      lw_psr_resolve_job_done);
+	rjob->psr_ppriv = psr_ppriv;
+	rjob->sa = sa;
+	rjob->sa_len = sa_len;
+	rjob->family = family;
+	memcpy(rjob->hostname, hostname, hostname_len);
+	err = teamd_worker_job_submit(ctx, &rjob->job);
+	if (err) {
+		free(rjob);
+		return err;
+	}
+	list_add_tail(&psr_ppriv->resolve_list, &rjob->list);
+	return 0;
+}
+
+static void lw_psr_resolve_cancel(struct teamd_context *ctx,
+				  struct lw_psr_port_priv *psr_ppriv)
+{
+	struct lw_psr_resolve_job *rjob;
+	struct lw_psr_resolve_job *tmp;
+
+	list_for_each_node_entry_safe(rjob, tmp, &psr_ppriv->resolve_list,
+				      list) {
+		list_del(&rjob->list);
+		teamd_worker_job_cancel(ctx, &rjob->job);
+	}
+}
+
 #define LW_SOCKET_CB_NAME "lw_socket"
 static int lw_psr_callback_socket(struct teamd_context *ctx, int events, void *priv)
 {
@@ -120,6 +220,7 @@ int lw_psr_port_added(struct teamd_context *ctx, struct teamd_port *tdport,
 	struct lw_psr_port_priv *psr_ppriv = priv;
 	int err;
 
+	list_init(&psr_ppriv->resolve_list);
 	err = lw_psr_load_options(ctx, tdport, psr_ppriv);
 	if (err) {
 		teamd_log_err("Failed to load options.");
@@ -129,19 +230,20 @@ int lw_psr_port_added(struct teamd_context *ctx, struct teamd_port *tdport,
 	err = psr_ppriv->ops->load_options(ctx, tdport, psr_ppriv);
 	if (err) {
 		teamd_log_err("Failed to load options.");
-		return err;
+		goto resolve_cancel;
 	}
 
 	err = psr_ppriv->ops->sock_open(psr_ppriv);
 	if (err) {
 		teamd_log_err("Failed to create socket.");
-		return err;
+		goto resolve_cancel;
 	}
 
 	err = teamd_loop_callback_fd_add(ctx, LW_SOCKET_CB_NAME, psr_ppriv,
 					 lw_psr_callback_socket,
 					 psr_ppriv->sock,
-					 TEAMD_LOOP_FD_EVENT_READ);
+					 TEAMD_LOOP_FD_EVENT_READ,
+					 TEAMD_LOOP_PRIO_LINK);
 	if (err) {
 		teamd_log_err("Failed add socket callback.");
 		goto close_sock;
@@ -151,7 +253,8 @@ int lw_psr_port_added(struct teamd_context *ctx, struct teamd_port *tdport,
 						psr_ppriv,
 						lw_psr_callback_periodic,
 						&psr_ppriv->interval,
-						&psr_ppriv->init_wait);
+						&psr_ppriv->init_wait,
+						TEAMD_LOOP_PRIO_LINK);
 	if (err) {
 		teamd_log_err("Failed add callback timer");
 		goto socket_callback_del;
@@ -174,6 +277,8 @@ socket_callback_del:
 	teamd_loop_callback_del(ctx, LW_SOCKET_CB_NAME, psr_ppriv);
 close_sock:
 	psr_ppriv->ops->sock_close(psr_ppriv);
+resolve_cancel:
+	lw_psr_resolve_cancel(ctx, psr_ppriv);
 	return err;
 }
 
@@ -182,6 +287,7 @@ void lw_psr_port_removed(struct teamd_context *ctx, struct teamd_port *tdport,
 {
 	struct lw_psr_port_priv *psr_ppriv = priv;
 
+	lw_psr_resolve_cancel(ctx, psr_ppriv);
 	teamd_loop_callback_del(ctx, LW_PERIODIC_CB_NAME, psr_ppriv);
 	teamd_loop_callback_del(ctx, LW_SOCKET_CB_NAME, psr_ppriv);
 	psr_ppriv->ops->sock_close(psr_ppriv);
@@ -169,7 +169,7 @@ static int lw_tipc_topsrv_subscribe(struct teamd_context *ctx, struct lw_tipc_po
 	err = teamd_loop_callback_fd_add(ctx, LW_TIPC_TOPSRV_SOCKET, priv,
 				 lw_tipc_callback_socket,
 				 priv->topsrv_sock,
-				 POLLIN);
+				 POLLIN, TEAMD_LOOP_PRIO_LINK);
 	if (err) {
 		teamd_log_err("Failed to add socket callback");
 		err = -errno;
@@ -222,6 +222,7 @@ static void lw_tipc_port_removed(struct teamd_context *ctx,
 	struct lw_tipc_port_priv *tipc_ppriv = priv;
 
 	teamd_log_dbg("tipc port removed\n");
+	teamd_loop_callback_del(ctx, LW_TIPC_TOPSRV_SOCKET, priv);
 	close(tipc_ppriv->topsrv_sock);
 	while (tipc_ppriv->links.lh_first != NULL)
 		LIST_REMOVE(tipc_ppriv->links.lh_first, next);
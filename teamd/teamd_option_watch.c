@@ -35,14 +35,16 @@ static int tow_option_change_handler_func(struct team_handle *th, void *priv,
 	struct team_option *option;
 	int err;
 
-	team_for_each_option(option, th) {
+	team_for_each_changed_option(option, th) {
 		if (!team_is_option_changed(option))
 			continue;
 		err = teamd_event_option_changed(ctx, option);
-		if (err)
+		if (err) {
+			teamd_event_option_changes_drop(ctx);
 			return err;
+		}
 	}
-	return 0;
+	return teamd_event_option_changes_done(ctx);
 }
 
 static struct team_change_handler tow_option_change_handler = {
@@ -39,6 +39,8 @@ struct port_obj {
 	struct teamd_port port; /* must be first */
 	struct list_item list;
 	struct list_item priv_list;
+	struct team_option_handle *enabled_oh;
+	struct team_option_handle *prio_oh;
 };
 
 #define _port(port_obj) (&(port_obj)->port)
@@ -159,11 +161,29 @@ static struct port_obj *port_obj_alloc(struct teamd_context *ctx,
 	tdport->ifname = team_get_ifinfo_ifname(team_ifinfo);
 	tdport->team_port = team_port;
 	tdport->team_ifinfo = team_ifinfo;
+	port_obj->enabled_oh = team_option_handle_alloc(ctx->th, "np",
+							"enabled", ifindex);
+	if (!port_obj->enabled_oh)
+		goto err_enabled_oh_alloc;
+	port_obj->prio_oh = team_option_handle_alloc(ctx->th, "np",
+						     "priority", ifindex);
+	if (!port_obj->prio_oh)
+		goto err_prio_oh_alloc;
 	return port_obj;
+
+err_prio_oh_alloc:
+	team_option_handle_free(ctx->th, port_obj->enabled_oh);
+err_enabled_oh_alloc:
+	teamd_log_err("Failed to alloc port option handles.");
+	free(port_obj);
+	return NULL;
 }
 
-static void port_obj_free(struct port_obj *port_obj)
+static void port_obj_free(struct teamd_context *ctx,
+			  struct port_obj *port_obj)
 {
+	team_option_handle_free(ctx->th, port_obj->prio_oh);
+	team_option_handle_free(ctx->th, port_obj->enabled_oh);
 	port_priv_free_all(port_obj);
 	free(port_obj);
 }
@@ -204,7 +224,7 @@ teamd_event_port_removed:
 	teamd_event_port_removed(ctx, tdport);
 list_del:
 	port_obj_destroy(ctx, port_obj);
-	port_obj_free(port_obj);
+	port_obj_free(ctx, port_obj);
 	return err;
 }
 
@@ -215,7 +235,7 @@ static void port_obj_remove(struct teamd_context *ctx,
 
 	teamd_event_port_removed(ctx, tdport);
 	port_obj_destroy(ctx, port_obj);
-	port_obj_free(port_obj);
+	port_obj_free(ctx, port_obj);
 }
 
 static struct port_obj *get_port_obj(struct teamd_context *ctx,
@@ -250,7 +270,7 @@ static int port_priv_change_handler_func(struct team_handle *th, void *priv,
 	struct port_obj *port_obj;
 	int err;
 
-	team_for_each_port(port, th) {
+	team_for_each_changed_port(port, th) {
 		uint32_t ifindex = team_get_port_ifindex(port);
 
 		port_obj = get_port_obj(ctx, ifindex);
@@ -392,9 +412,10 @@ int teamd_port_remove_ifname(struct teamd_context *ctx, const char *port_name)
 int teamd_port_enabled(struct teamd_context *ctx, struct teamd_port *tdport,
 		       bool *enabled)
 {
+	struct port_obj *port_obj = get_container(tdport, struct port_obj, port);
 	struct team_option *option;
 
-	option = team_get_option(ctx->th, "np", "enabled", tdport->ifindex);
+	option = team_option_handle_get_option(port_obj->enabled_oh);
 	if (!option) {
 		teamd_log_err("%s: Failed to find \"enabled\" option.",
 			      tdport->ifname);
@@ -411,10 +432,11 @@ int teamd_port_enabled(struct teamd_context *ctx, struct teamd_port *tdport,
 
 int teamd_port_prio(struct teamd_context *ctx, struct teamd_port *tdport)
 {
-	int prio;
+	struct port_obj *port_obj = get_container(tdport, struct port_obj, port);
+	int32_t prio;
 	int err;
 
-	err = team_get_port_priority(ctx->th, tdport->ifindex, &prio);
+	err = team_option_handle_get_value_s32(port_obj->prio_oh, &prio);
 	if (err) {
 		teamd_log_warn("%s: Can't get port priority. Using default.",
 			       tdport->ifname);
@@ -427,6 +449,7 @@ int teamd_port_check_enable(struct teamd_context *ctx,
 			    struct teamd_port *tdport,
 			    bool should_enable, bool should_disable)
 {
+	struct port_obj *port_obj;
 	bool new_enabled_state;
 	bool curr_enabled_state;
 	int err;
@@ -446,8 +469,9 @@ int teamd_port_check_enable(struct teamd_context *ctx,
 
 	teamd_log_dbg("%s: %s port", tdport->ifname,
 		      new_enabled_state ? "Enabling": "Disabling");
-	err = team_set_port_enabled(ctx->th, tdport->ifindex,
-				    new_enabled_state);
+	port_obj = get_container(tdport, struct port_obj, port);
+	err = team_option_handle_set_value_bool(ctx->th, port_obj->enabled_oh,
+						new_enabled_state);
 	if (err) {
 		teamd_log_err("%s: Failed to %s port.", tdport->ifname,
 			      new_enabled_state ? "enable": "disable");
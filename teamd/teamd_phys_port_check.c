@@ -22,8 +22,18 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#include <linux/netdevice.h>
+#include <private/list.h>
+#include <private/misc.h>
 
 #include "teamd.h"
+#include "teamd_worker.h"
+
+static void teamd_phys_port_warn(const char *ifname1, const char *ifname2)
+{
+	teamd_log_warn("%s: device is using the same physical port as device %s. Note that teaming multiple devices which use the same physical port makes no sense.",
+		       ifname1, ifname2);
+}
 
 struct pcie_addr {
 	uint16_t domain;
@@ -63,23 +73,85 @@ static int teamd_sriov_physfn_addr(struct pcie_addr *addr, const char *ifname)
 	return 0;
 }
 
-static bool teamd_phys_port_sriovsysfs_cmp(struct teamd_port *tdport1,
-					   struct teamd_port *tdport2)
+/*
+ * Sysfs is read by worker thread, job carries copies of port names so it
+ * does not care about ports going away meanwhile.
+ */
+struct teamd_phys_port_job {
+	struct teamd_worker_job job;
+	char ifname[IFNAMSIZ];
+	unsigned int port_count;
+	struct {
+		char ifname[IFNAMSIZ];
+		bool same;
+	} ports[];
+};
+
+static int teamd_phys_port_sriovsysfs_job_func(struct teamd_worker_job *job)
 {
+	struct teamd_phys_port_job *ppjob;
 	struct pcie_addr physfnaddr1;
 	struct pcie_addr physfnaddr2;
+	unsigned int i;
 	int err;
 
-	err = teamd_sriov_physfn_addr(&physfnaddr1, tdport1->ifname);
+	ppjob = get_container(job, struct teamd_phys_port_job, job);
+	err = teamd_sriov_physfn_addr(&physfnaddr1, ppjob->ifname);
 	if (err)
-		return false;
+		return err;
+	for (i = 0; i < ppjob->port_count; i++) {
+		err = teamd_sriov_physfn_addr(&physfnaddr2,
+					      ppjob->ports[i].ifname);
+		if (err)
+			continue;
+		if (!memcmp(&physfnaddr1, &physfnaddr2, sizeof(physfnaddr1)))
+			ppjob->ports[i].same = true;
+	}
+	return 0;
+}
 
-	err = teamd_sriov_physfn_addr(&physfnaddr2, tdport2->ifname);
+static void teamd_phys_port_sriovsysfs_job_done(struct teamd_context *ctx,
+						struct teamd_worker_job *job,
+						int err)
+{
+	struct teamd_phys_port_job *ppjob;
+	unsigned int i;
+
+	ppjob = get_container(job, struct teamd_phys_port_job, job);
+	for (i = 0; !err && i < ppjob->port_count; i++) {
+		if (ppjob->ports[i].same)
+			teamd_phys_port_warn(ppjob->ifname,
+					     ppjob->ports[i].ifname);
+	}
+	free(ppjob);
+}
+
+static int teamd_phys_port_sriovsysfs_check(struct teamd_context *ctx,
+					    struct teamd_port *tdport,
+					    unsigned int port_count)
+{
+	struct teamd_phys_port_job *ppjob;
+	struct teamd_port *cur_tdport;
+	unsigned int i = 0;
+	int err;
+
+	ppjob = myzalloc(sizeof(*ppjob) +
+			 port_count * sizeof(ppjob->ports[0]));
+	if (!ppjob)
+		return -ENOMEM;
+	teamd_worker_job_init(&ppjob->job, teamd_phys_port_sriovsysfs_job_func,
+			      teamd_phys_port_sriovsysfs_job_done);
+	strcpy(ppjob->ifname, tdport->ifname);
+	teamd_for_each_tdport(cur_tdport, ctx) {
+		if (cur_tdport == tdport || i == port_count)
+			continue;
+		strcpy(ppjob->ports[i++].ifname, cur_tdport->ifname);
+	}
+	ppjob->port_count = i;
+	err = teamd_worker_job_submit(ctx, &ppjob->job);
 	if (err)
-		return false;
-	if (!memcmp(&physfnaddr1, &physfnaddr2, sizeof(physfnaddr1)))
-		return true;
-	return false;
+		free(ppjob);
+	return err;
 }
 
 static bool teamd_phys_port_ifinfo_cmp(struct teamd_port *tdport1,
@@ -103,20 +175,22 @@ static int teamd_phys_port_check_event_watch_port_added(struct teamd_context *ct
 							void *priv)
 {
 	struct teamd_port *cur_tdport;
+	unsigned int port_count = 0;
 
 	teamd_for_each_tdport(cur_tdport, ctx) {
 		if (cur_tdport == tdport)
 			continue;
-		/* Once all drivers implement ndo_get_phys_port_id() function,
-		 * teamd_phys_port_sriovsysfs_cmp() would not be needed to be
-		 * called here.
-		 */
-		if (teamd_phys_port_ifinfo_cmp(tdport, cur_tdport) ||
-		    teamd_phys_port_sriovsysfs_cmp(tdport, cur_tdport))
-			teamd_log_warn("%s: device is using the same physical port as device %s. Note that teaming multiple devices which use the same physical port makes no sense.",
-				       tdport->ifname, cur_tdport->ifname);
+		port_count++;
+		if (teamd_phys_port_ifinfo_cmp(tdport, cur_tdport))
+			teamd_phys_port_warn(tdport->ifname,
+					     cur_tdport->ifname);
 	}
-	return 0;
+	if (!port_count)
+		return 0;
+	/* Once all drivers implement ndo_get_phys_port_id() function,
+	 * sysfs check would not be needed to be done here.
+	 */
+	return teamd_phys_port_sriovsysfs_check(ctx, tdport, port_count);
 }
 
 static const struct teamd_event_watch_ops teamd_phys_port_check_event_watch_ops = {
@@ -0,0 +1,202 @@
+/*
+ *   teamd_reaction_bench.c - Teamd failover latency against team emulator
+ *   Copyright (C) 2026 agent <agent@local>
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Runs team emulator and teamd pointed to it by --emul-port. Teamd
+ * creates team device with two ports in activebackup mode. Then carrier
+ * of the active port is repeatedly taken down and the time until teamd
+ * sets the other port active is measured. Output is one "key=value"
+ * record per line. Needs no privileges nor team kernel module.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <team.h>
+#include <private/bench.h>
+
+#define BENCH_DEFAULT_TEAMD "./teamd"
+#define BENCH_DEFAULT_ROUNDS 200
+#define BENCH_TIMEOUT 5000 /* ms */
+#define BENCH_SETTLE_TIME 10000 /* us, lets teamd see carrier back */
+#define BENCH_TEAM_NAME "bench_team0"
+#define BENCH_PORT0_NAME "bench_p0"
+#define BENCH_PORT1_NAME "bench_p1"
+#define BENCH_CONFIG							\
+	"{\"device\": \"" BENCH_TEAM_NAME "\", "			\
+	"\"runner\": {\"name\": \"activebackup\"}, "			\
+	"\"link_watch\": {\"name\": \"ethtool\"}, "			\
+	"\"ports\": {\"" BENCH_PORT0_NAME "\": {}, "			\
+	"\"" BENCH_PORT1_NAME "\": {}}}"
+
+static pid_t bench_teamd_spawn(const char *teamd_path, uint32_t emul_port,
+			       const char *pid_file)
+{
+	char port_str[16];
+	pid_t pid;
+
+	pid = fork();
+	if (pid)
+		return pid;
+	snprintf(port_str, sizeof(port_str), "%u", emul_port);
+	execl(teamd_path, teamd_path, "-c", BENCH_CONFIG, "-p", pid_file,
+	      "-u", "-E", port_str, NULL);
+	perror("Failed to run teamd");
+	_exit(EXIT_FAILURE);
+}
+
+/* Waits until teamd created the device and picked an active port */
+static int bench_wait_ready(struct team_emul *emul, uint32_t *p_ifindex,
+			    uint32_t *p_active)
+{
+	uint64_t deadline = bench_now() + BENCH_TIMEOUT * 1000000ULL;
+	uint32_t ifindex = 0;
+	uint32_t active = 0;
+
+	while (bench_now() < deadline) {
+		if (!ifindex)
+			ifindex = team_emul_ifname2ifindex(emul,
+							   BENCH_TEAM_NAME);
+		if (ifindex &&
+		    !team_emul_option_get_u32(emul, ifindex, "activeport",
+					      &active) && active) {
+			*p_ifindex = ifindex;
+			*p_active = active;
+			return 0;
+		}
+		usleep(1000);
+	}
+	return -ETIMEDOUT;
+}
+
+/* Intermediate sets, like clearing active port, are not counted */
+static int bench_failover(struct team_emul *emul, uint32_t ifindex,
+			  uint32_t active, uint32_t *p_active,
+			  uint64_t *p_elapsed)
+{
+	uint64_t set_count;
+	uint64_t start;
+	uint32_t value;
+	int err;
+
+	set_count = team_emul_get_option_set_count(emul, ifindex,
+						   "activeport");
+	start = bench_now();
+	err = team_emul_link_set_carrier(emul, active, false);
+	if (err)
+		return err;
+	while (1) {
+		err = team_emul_wait_option_set(emul, ifindex, "activeport",
+						set_count, BENCH_TIMEOUT);
+		if (err)
+			return err;
+		err = team_emul_option_get_u32(emul, ifindex, "activeport",
+					       &value);
+		if (err)
+			return err;
+		if (value && value != active)
+			break;
+		set_count = team_emul_get_option_set_count(emul, ifindex,
+							   "activeport");
+	}
+	*p_elapsed = bench_now() - start;
+	*p_active = value;
+	err = team_emul_link_set_carrier(emul, active, true);
+	usleep(BENCH_SETTLE_TIME);
+	return err;
+}
+
+int main(int argc, char **argv)
+{
+	const char *teamd_path = BENCH_DEFAULT_TEAMD;
+	unsigned int rounds = BENCH_DEFAULT_ROUNDS;
+	uint64_t min = UINT64_MAX;
+	uint64_t max = 0;
+	uint64_t sum = 0;
+	uint64_t elapsed;
+	struct team_emul *emul;
+	char pid_file[64];
+	uint32_t ifindex;
+	uint32_t active;
+	unsigned int i;
+	pid_t pid;
+	int status;
+	int err;
+
+	if (argc > 1)
+		teamd_path = argv[1];
+	if (argc > 2)
+		rounds = strtoul(argv[2], NULL, 10);
+	if (!rounds) {
+		fprintf(stderr, "Usage: %s [TEAMD_PATH [ROUNDS]]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	emul = team_emul_alloc();
+	if (!emul)
+		return EXIT_FAILURE;
+	err = team_emul_link_add(emul, BENCH_PORT0_NAME, "dummy", NULL);
+	if (!err)
+		err = team_emul_link_add(emul, BENCH_PORT1_NAME, "dummy", NULL);
+	if (!err)
+		err = team_emul_start(emul);
+	if (err) {
+		fprintf(stderr, "Failed to set up emulator (%d)\n", err);
+		return EXIT_FAILURE;
+	}
+
+	snprintf(pid_file, sizeof(pid_file), "/tmp/teamd_reaction_bench.%d.pid",
+		 getpid());
+	pid = bench_teamd_spawn(teamd_path, team_emul_get_port(emul),
+				pid_file);
+	if (pid == -1) {
+		perror("Failed to fork");
+		return EXIT_FAILURE;
+	}
+
+	err = bench_wait_ready(emul, &ifindex, &active);
+	for (i = 0; !err && i < rounds; i++) {
+		err = bench_failover(emul, ifindex, active, &active, &elapsed);
+		if (err)
+			break;
+		sum += elapsed;
+		if (elapsed < min)
+			min = elapsed;
+		if (elapsed > max)
+			max = elapsed;
+	}
+
+	kill(pid, SIGTERM);
+	waitpid(pid, &status, 0);
+	unlink(pid_file);
+	team_emul_free(emul);
+	if (err) {
+		fprintf(stderr, "Benchmark failed (%d)\n", err);
+		return EXIT_FAILURE;
+	}
+	bench_record("teamd_failover", rounds, sum,
+		     "ns_min=%" PRIu64 " ns_max=%" PRIu64, min, max);
+	return EXIT_SUCCESS;
+}
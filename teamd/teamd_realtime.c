@@ -0,0 +1,130 @@
+/*
+ *   teamd_realtime.c - Teamd latency-critical runtime mode
+ *   Copyright (C) 2026 agent <agent@local>
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <string.h>
+#include <errno.h>
+#include <malloc.h>
+#include <sched.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "teamd.h"
+#include "teamd_config.h"
+
+/*
+ * In realtime mode all memory is locked and freed memory is kept in the
+ * heap, so failover paths do not take page faults nor hit the system
+ * allocator. Run loop thread optionally gets SCHED_FIFO and is pinned to
+ * a CPU. Worker threads are always started with default policy.
+ */
+
+#define TEAMD_REALTIME_STACK_PREFAULT (256 * 1024)
+
+static void teamd_realtime_stack_prefault(void)
+{
+	volatile char stack[TEAMD_REALTIME_STACK_PREFAULT];
+	long page_size = sysconf(_SC_PAGESIZE);
+	size_t i;
+
+	if (page_size <= 0)
+		page_size = 4096;
+	/* Stores have to go through volatile, memset would be optimized out */
+	for (i = 0; i < sizeof(stack); i += page_size)
+		stack[i] = 0;
+}
+
+static int teamd_realtime_load_config(struct teamd_context *ctx)
+{
+	bool enabled;
+	int tmp;
+	int err;
+
+	err = teamd_config_bool_get(ctx, &enabled, "$.realtime.enabled");
+	if (!err && enabled)
+		ctx->realtime.enabled = true;
+
+	ctx->realtime.priority = 0;
+	err = teamd_config_int_get(ctx, &tmp, "$.realtime.priority");
+	if (!err) {
+		if (tmp < sched_get_priority_min(SCHED_FIFO) ||
+		    tmp > sched_get_priority_max(SCHED_FIFO)) {
+			teamd_log_err("\"realtime.priority\" is out of range.");
+			return -EINVAL;
+		}
+		ctx->realtime.priority = tmp;
+	}
+
+	ctx->realtime.cpu = -1;
+	err = teamd_config_int_get(ctx, &tmp, "$.realtime.cpu");
+	if (!err) {
+		if (tmp < -1 || tmp >= CPU_SETSIZE) {
+			teamd_log_err("\"realtime.cpu\" is out of range.");
+			return -EINVAL;
+		}
+		ctx->realtime.cpu = tmp;
+	}
+	return 0;
+}
+
+int teamd_realtime_init(struct teamd_context *ctx)
+{
+	struct sched_param param;
+	cpu_set_t cpuset;
+	int err;
+
+	err = teamd_realtime_load_config(ctx);
+	if (err)
+		return err;
+	if (!ctx->realtime.enabled)
+		return 0;
+
+	mallopt(M_TRIM_THRESHOLD, -1);
+	mallopt(M_MMAP_MAX, 0);
+	if (mlockall(MCL_CURRENT | MCL_FUTURE)) {
+		teamd_log_err("Failed to lock memory.");
+		return -errno;
+	}
+	teamd_realtime_stack_prefault();
+
+	if (ctx->realtime.cpu != -1) {
+		CPU_ZERO(&cpuset);
+		CPU_SET(ctx->realtime.cpu, &cpuset);
+		err = pthread_setaffinity_np(pthread_self(), sizeof(cpuset),
+					     &cpuset);
+		if (err) {
+			teamd_log_err("Failed to pin run loop to CPU %d.",
+				      ctx->realtime.cpu);
+			return -err;
+		}
+	}
+	if (ctx->realtime.priority) {
+		memset(&param, 0, sizeof(param));
+		param.sched_priority = ctx->realtime.priority;
+		err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+		if (err) {
+			teamd_log_err("Failed to set SCHED_FIFO priority %d.",
+				      ctx->realtime.priority);
+			return -err;
+		}
+	}
+	teamd_log_info("Realtime mode enabled (priority %d, cpu %d).",
+		       ctx->realtime.priority, ctx->realtime.cpu);
+	return 0;
+}
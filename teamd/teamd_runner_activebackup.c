@@ -52,6 +52,8 @@ struct ab {
 	char active_orig_hwaddr[MAX_ADDR_LEN];
 	const struct ab_hwaddr_policy *hwaddr_policy;
 	struct teamd_workq link_watch_handler_workq;
+	struct teamd_workq active_port_set_workq;
+	uint32_t active_port_set_ifindex; /* last one requested wins */
 };
 
 struct ab_port {
@@ -458,7 +460,7 @@ static void ab_port_removed(struct teamd_context *ctx,
 {
 	struct ab *ab = creator_priv;
 
-	ab_link_watch_handler(ctx, ab);
+	teamd_workq_schedule_work(ctx, &ab->link_watch_handler_workq);
 }
 
 static const struct teamd_port_priv ab_port_priv = {
@@ -479,14 +481,21 @@ static int ab_event_watch_port_link_changed(struct teamd_context *ctx,
 					    struct teamd_port *tdport,
 					    void *priv)
 {
-	return ab_link_watch_handler(ctx, priv);
+	struct ab *ab = priv;
+
+	/* Burst of changes results in a single best port selection */
+	teamd_workq_schedule_work(ctx, &ab->link_watch_handler_workq);
+	return 0;
 }
 
 static int ab_event_watch_prio_option_changed(struct teamd_context *ctx,
 					      struct team_option *option,
 					      void *priv)
 {
-	return ab_link_watch_handler(ctx, priv);
+	struct ab *ab = priv;
+
+	teamd_workq_schedule_work(ctx, &ab->link_watch_handler_workq);
+	return 0;
 }
 
 static const struct teamd_event_watch_ops ab_event_watch_ops = {
@@ -527,26 +536,15 @@ static int ab_state_active_port_get(struct teamd_context *ctx,
 	return 0;
 }
 
-struct ab_active_port_set_info {
-	struct teamd_workq workq;
-	struct ab *ab;
-	uint32_t ifindex;
-};
-
 static int ab_active_port_set_work(struct teamd_context *ctx,
 				   struct teamd_workq *workq)
 {
-	struct ab_active_port_set_info *info;
 	struct ab *ab;
-	uint32_t ifindex;
 	struct teamd_port *tdport;
 	struct teamd_port *active_tdport;
 
-	info = get_container(workq, struct ab_active_port_set_info, workq);
-	ab = info->ab;
-	ifindex = info->ifindex;
-	free(info);
-	tdport = teamd_get_port(ctx, ifindex);
+	ab = get_container(workq, struct ab, active_port_set_workq);
+	tdport = teamd_get_port(ctx, ab->active_port_set_ifindex);
 	if (!tdport)
 		/* Port disapeared in between, ignore */
 		return 0;
@@ -558,20 +556,14 @@ static int ab_state_active_port_set(struct teamd_context *ctx,
 				    struct team_state_gsc *gsc,
 				    void *priv)
 {
-	struct ab_active_port_set_info *info;
 	struct ab *ab = priv;
 	struct teamd_port *tdport;
 
 	tdport = teamd_get_port_by_ifname(ctx, (const char *) gsc->data.str_val.ptr);
 	if (!tdport)
 		return -ENODEV;
-	info = malloc(sizeof(*info));
-	if (!info)
-		return -ENOMEM;
-	teamd_workq_init_work(&info->workq, ab_active_port_set_work);
-	info->ab = ab;
-	info->ifindex = tdport->ifindex;
-	teamd_workq_schedule_work(ctx, &info->workq);
+	ab->active_port_set_ifindex = tdport->ifindex;
+	teamd_workq_schedule_work(ctx, &ab->active_port_set_workq);
 	return 0;
 }
 
@@ -614,6 +606,10 @@ static int ab_init(struct teamd_context *ctx, void *priv)
 		teamd_log_err("Failed to load config values.");
 		return err;
 	}
+	teamd_workq_init_work(&ab->link_watch_handler_workq,
+			      ab_link_watch_handler_work);
+	teamd_workq_init_work(&ab->active_port_set_workq,
+			      ab_active_port_set_work);
 	err = teamd_event_watch_register(ctx, &ab_event_watch_ops, ab);
 	if (err) {
 		teamd_log_err("Failed to register event watch.");
@@ -624,12 +620,11 @@ static int ab_init(struct teamd_context *ctx, void *priv)
 		teamd_log_err("Failed to register state value group.");
 		goto event_watch_unregister;
 	}
-	teamd_workq_init_work(&ab->link_watch_handler_workq,
-			      ab_link_watch_handler_work);
 	return 0;
 
 event_watch_unregister:
 	teamd_event_watch_unregister(ctx, &ab_event_watch_ops, ab);
+	teamd_workq_cancel_work(ctx, &ab->link_watch_handler_workq);
 	return err;
 }
 
@@ -639,6 +634,8 @@ static void ab_fini(struct teamd_context *ctx, void *priv)
 
 	teamd_state_val_unregister(ctx, &ab_state_vg, ab);
 	teamd_event_watch_unregister(ctx, &ab_event_watch_ops, ab);
+	teamd_workq_cancel_work(ctx, &ab->active_port_set_workq);
+	teamd_workq_cancel_work(ctx, &ab->link_watch_handler_workq);
 }
 
 const struct teamd_runner teamd_runner_activebackup = {
@@ -142,6 +142,7 @@ struct lacp {
 #define		LACP_CFG_DFLT_AGG_SELECT_POLICY LACP_AGG_SELECT_LACP_PRIO
 	} cfg;
 	struct teamd_balancer *tb;
+	struct teamd_workq agg_update_workq;
 };
 
 enum lacp_port_state {
@@ -167,6 +168,8 @@ struct lacp_port {
 	struct lacpdu_info partner;
 	struct lacpdu_info __partner_last; /* last state before update */
 	bool periodic_on;
+	struct teamd_loop_callback *periodic_lcb;
+	struct teamd_loop_callback *timeout_lcb;
 	struct lacp_port *agg_lead; /* leading port of aggregator.
 				     * NULL in case this port is not selected */
 	enum lacp_port_state state;
@@ -183,6 +186,7 @@ struct lacp_port {
 		bool sticky;
 #define		LACP_PORT_CFG_DFLT_STICKY false
 	} cfg;
+	struct teamd_workq agg_select_workq;
 };
 
 static struct lacp_port *lacp_port_get(struct lacp *lacp,
@@ -711,6 +715,15 @@ static int lacp_selected_agg_update(struct lacp *lacp,
 	return 0;
 }
 
+static int lacp_agg_update_work(struct teamd_context *ctx,
+				struct teamd_workq *workq)
+{
+	struct lacp *lacp;
+
+	lacp = get_container(workq, struct lacp, agg_update_workq);
+	return lacp_selected_agg_update(lacp, NULL);
+}
+
 static bool lacp_port_mergeable(struct lacp_port *lacp_port)
 {
 	/* Port can be merged with other aggregator only in case it is
@@ -733,7 +746,14 @@ static int lacp_port_agg_update(struct lacp_port *lacp_port)
 	    lacp_port_selectable(lacp_port))
 		lacp_port_agg_select(lacp_port);
 
-	return lacp_selected_agg_update(lacp_port->lacp, NULL);
+	/*
+	 * Port membership is updated right away as actor state depends on
+	 * it. Aggregator selection is left to workq so changes of many ports
+	 * in a row result in a single one.
+	 */
+	teamd_workq_schedule_work(lacp_port->ctx,
+				  &lacp_port->lacp->agg_update_workq);
+	return 0;
 }
 
 static const char slow_addr[ETH_ALEN] = { 0x01, 0x80, 0xC2, 0x00, 0x00, 0x02 };
@@ -790,9 +810,8 @@ static int lacp_port_timeout_set(struct lacp_port *lacp_port, bool fast_forced)
 					LACP_PERIODIC_SHORT: LACP_PERIODIC_LONG;
 	ms *= LACP_PERIODIC_MUL;
 	ms_to_timespec(&ts, ms);
-	err = teamd_loop_callback_timer_set(lacp_port->ctx,
-					    LACP_TIMEOUT_CB_NAME,
-					    lacp_port, NULL, &ts);
+	err = teamd_loop_lcb_timer_set(lacp_port->ctx, lacp_port->timeout_lcb,
+				       NULL, &ts);
 	if (err) {
 		teamd_log_err("Failed to set timeout timer.");
 		return err;
@@ -812,9 +831,8 @@ static int lacp_port_periodic_set(struct lacp_port *lacp_port)
 		      lacp_port->tdport->ifname, fast_on ? "fast": "slow");
 	ms = fast_on ? LACP_PERIODIC_SHORT: LACP_PERIODIC_LONG;
 	ms_to_timespec(&ts, ms);
-	err = teamd_loop_callback_timer_set(lacp_port->ctx,
-					    LACP_PERIODIC_CB_NAME,
-					    lacp_port, &ts, NULL);
+	err = teamd_loop_lcb_timer_set(lacp_port->ctx,
+				       lacp_port->periodic_lcb, &ts, NULL);
 	if (err) {
 		teamd_log_err("Failed to set periodic timer.");
 		return err;
@@ -831,11 +849,9 @@ static bool lacp_port_should_be_active(struct lacp_port *lacp_port)
 static void lacp_port_periodic_cb_change_enabled(struct lacp_port *lacp_port)
 {
 	if (lacp_port_should_be_active(lacp_port) && lacp_port->periodic_on)
-		teamd_loop_callback_enable(lacp_port->ctx,
-					   LACP_PERIODIC_CB_NAME, lacp_port);
+		teamd_loop_lcb_enable(lacp_port->ctx, lacp_port->periodic_lcb);
 	else
-		teamd_loop_callback_disable(lacp_port->ctx,
-					    LACP_PERIODIC_CB_NAME, lacp_port);
+		teamd_loop_lcb_disable(lacp_port->ctx, lacp_port->periodic_lcb);
 }
 
 static void lacp_port_periodic_on(struct lacp_port *lacp_port)
@@ -922,8 +938,7 @@ static int lacp_port_set_state(struct lacp_port *lacp_port,
 	case PORT_STATE_CURRENT:
 		break;
 	case PORT_STATE_EXPIRED:
-		teamd_loop_callback_enable(lacp_port->ctx,
-					   LACP_PERIODIC_CB_NAME, lacp_port);
+		teamd_loop_lcb_enable(lacp_port->ctx, lacp_port->periodic_lcb);
 		/*
 		 * This is a transient state; the LACP_Timeout settings allow
 		 * the Actor to transmit LACPDUs rapidly in an attempt to
@@ -935,12 +950,10 @@ static int lacp_port_set_state(struct lacp_port *lacp_port,
 		if (err)
 			return err;
 		lacp_port_timeout_set(lacp_port, true);
-		teamd_loop_callback_enable(lacp_port->ctx,
-					   LACP_TIMEOUT_CB_NAME, lacp_port);
+		teamd_loop_lcb_enable(lacp_port->ctx, lacp_port->timeout_lcb);
 		break;
 	case PORT_STATE_DEFAULTED:
-		teamd_loop_callback_disable(lacp_port->ctx,
-					    LACP_TIMEOUT_CB_NAME, lacp_port);
+		teamd_loop_lcb_disable(lacp_port->ctx, lacp_port->timeout_lcb);
 		/* fall through */
 	case PORT_STATE_DISABLED:
 		memset(&lacp_port->partner, 0, sizeof(lacp_port->partner));
@@ -1023,26 +1036,14 @@ static int lacpdu_send(struct lacp_port *lacp_port)
 	return err;
 }
 
-static int lacpdu_recv(struct lacp_port *lacp_port)
+static int lacpdu_process(struct lacp_port *lacp_port, struct lacpdu *lacpdu)
 {
-	struct lacpdu lacpdu;
-	struct sockaddr_ll ll_from;
 	int err;
 
-	err = teamd_recvfrom(lacp_port->sock, &lacpdu, sizeof(lacpdu), 0,
-			     (struct sockaddr *) &ll_from, sizeof(ll_from));
-	if (err <= 0)
-		return err;
-
-	if (!lacpdu_check(&lacpdu)) {
-		teamd_log_warn("malformed LACP PDU came.");
-		return 0;
-	}
-
 	/* Check if we have correct info about the other side */
-	if (memcmp(&lacpdu.actor, &lacp_port->partner,
+	if (memcmp(&lacpdu->actor, &lacp_port->partner,
 		   sizeof(struct lacpdu_info))) {
-		lacp_port->partner = lacpdu.actor;
+		lacp_port->partner = lacpdu->actor;
 		err = lacp_port_partner_update(lacp_port);
 		if (err)
 			return err;
@@ -1051,12 +1052,48 @@ static int lacpdu_recv(struct lacp_port *lacp_port)
 			return err;
 	}
 
-	err = lacp_port_set_state(lacp_port, PORT_STATE_CURRENT);
-	if (err)
-		return err;
+	return lacp_port_set_state(lacp_port, PORT_STATE_CURRENT);
+}
 
-	/* Check if the other side has correct info about us */
-	if (memcmp(&lacpdu.partner, &lacp_port->actor,
+static int lacpdu_recv(struct lacp_port *lacp_port)
+{
+	struct lacpdu lacpdu[TEAMD_MMSG_BATCH];
+	struct sockaddr_ll ll_from[TEAMD_MMSG_BATCH];
+	struct iovec iov[TEAMD_MMSG_BATCH];
+	struct mmsghdr msgvec[TEAMD_MMSG_BATCH];
+	struct lacpdu last;
+	bool received = false;
+	int count;
+	int err;
+	int i;
+
+	teamd_mmsg_init(msgvec, iov, TEAMD_MMSG_BATCH, lacpdu,
+			sizeof(lacpdu[0]), ll_from, sizeof(ll_from[0]));
+	do {
+		count = teamd_recvmmsg(lacp_port->sock, msgvec,
+				       TEAMD_MMSG_BATCH, 0);
+		if (count < 0)
+			return count;
+		for (i = 0; i < count; i++) {
+			if (!lacpdu_check(&lacpdu[i])) {
+				teamd_log_warn("malformed LACP PDU came.");
+				continue;
+			}
+			err = lacpdu_process(lacp_port, &lacpdu[i]);
+			if (err)
+				return err;
+			last = lacpdu[i];
+			received = true;
+		}
+	} while (count == TEAMD_MMSG_BATCH);
+	if (!received)
+		return 0;
+
+	/*
+	 * Check if the other side has correct info about us. Only the most
+	 * recent PDU matters, so a burst results in a single reply.
+	 */
+	if (memcmp(&last.partner, &lacp_port->actor,
 		   sizeof(struct lacpdu_info))) {
 		err = lacpdu_send(lacp_port);
 		if (err)
@@ -1066,8 +1103,7 @@ static int lacpdu_recv(struct lacp_port *lacp_port)
 	if (err) {
 		return err;
 	}
-	teamd_loop_callback_enable(lacp_port->ctx,
-				   LACP_TIMEOUT_CB_NAME, lacp_port);
+	teamd_loop_lcb_enable(lacp_port->ctx, lacp_port->timeout_lcb);
 	return 0;
 }
 
@@ -1167,6 +1203,9 @@ static int lacp_port_load_config(struct teamd_context *ctx,
 	return 0;
 }
 
+static int lacp_port_aggregator_select_work(struct teamd_context *ctx,
+					    struct teamd_workq *workq);
+
 static int lacp_port_added(struct teamd_context *ctx,
 			   struct teamd_port *tdport,
 			   void *priv, void *creator_priv)
@@ -1178,6 +1217,8 @@ static int lacp_port_added(struct teamd_context *ctx,
 	lacp_port->ctx = ctx;
 	lacp_port->tdport = tdport;
 	lacp_port->lacp = lacp;
+	teamd_workq_init_work(&lacp_port->agg_select_workq,
+			      lacp_port_aggregator_select_work);
 
 	err = lacp_port_load_config(ctx, lacp_port);
 	if (err) {
@@ -1198,28 +1239,35 @@ static int lacp_port_added(struct teamd_context *ctx,
 	err = teamd_loop_callback_fd_add(ctx, LACP_SOCKET_CB_NAME, lacp_port,
 					 lacp_callback_socket,
 					 lacp_port->sock,
-					 TEAMD_LOOP_FD_EVENT_READ);
+					 TEAMD_LOOP_FD_EVENT_READ,
+					 TEAMD_LOOP_PRIO_LINK);
 	if (err) {
 		teamd_log_err("Failed add socket callback.");
 		goto slow_addr_del;
 	}
 
 	err = teamd_loop_callback_timer_add(ctx, LACP_PERIODIC_CB_NAME,
-					    lacp_port, lacp_callback_periodic);
+					    lacp_port, lacp_callback_periodic,
+					    TEAMD_LOOP_PRIO_PROTOCOL);
 	if (err) {
 		teamd_log_err("Failed add periodic callback timer");
 		goto socket_callback_del;
 	}
+	lacp_port->periodic_lcb = teamd_loop_lcb_get(ctx, LACP_PERIODIC_CB_NAME,
+						     lacp_port);
 	err = lacp_port_periodic_set(lacp_port);
 	if (err)
 		goto periodic_callback_del;
 
 	err = teamd_loop_callback_timer_add(ctx, LACP_TIMEOUT_CB_NAME,
-					    lacp_port, lacp_callback_timeout);
+					    lacp_port, lacp_callback_timeout,
+					    TEAMD_LOOP_PRIO_LINK);
 	if (err) {
 		teamd_log_err("Failed add timeout callback timer");
 		goto periodic_callback_del;
 	}
+	lacp_port->timeout_lcb = teamd_loop_lcb_get(ctx, LACP_TIMEOUT_CB_NAME,
+						    lacp_port);
 
 	/* Newly added ports are disabled */
 	err = team_set_port_enabled(ctx->th, tdport->ifindex, false);
@@ -1259,6 +1307,7 @@ static void lacp_port_removed(struct teamd_context *ctx,
 	struct lacp_port *lacp_port = priv;
 
 	lacp_port_set_state(lacp_port, PORT_STATE_DISABLED);
+	teamd_workq_cancel_work(ctx, &lacp_port->agg_select_workq);
 	teamd_loop_callback_del(ctx, LACP_TIMEOUT_CB_NAME, lacp_port);
 	teamd_loop_callback_del(ctx, LACP_PERIODIC_CB_NAME, lacp_port);
 	teamd_loop_callback_del(ctx, LACP_SOCKET_CB_NAME, lacp_port);
@@ -1625,28 +1674,12 @@ static int lacp_port_state_aggregator_selected_get(struct teamd_context *ctx,
 	return 0;
 }
 
-struct lacp_port_selected_set_info {
-	struct teamd_workq workq;
-	struct lacp *lacp;
-	uint32_t ifindex;
-};
-
 static int lacp_port_aggregator_select_work(struct teamd_context *ctx,
 					    struct teamd_workq *workq)
 {
-	struct lacp_port_selected_set_info *info;
-	struct teamd_port *tdport;
-	struct lacp *lacp;
 	struct lacp_port *lacp_port;
 
-	info = get_container(workq, struct lacp_port_selected_set_info, workq);
-	lacp = info->lacp;
-	tdport = teamd_get_port(ctx, info->ifindex);
-	free(info);
-	if (!tdport)
-		/* Port disapeared in between, ignore */
-		return 0;
-	lacp_port = lacp_port_get(lacp, tdport);
+	lacp_port = get_container(workq, struct lacp_port, agg_select_workq);
 	if (!lacp_port_selected(lacp_port))
 		return 0;
 	return lacp_selected_agg_update(lacp_port->lacp, lacp_port->agg_lead);
@@ -1656,20 +1689,13 @@ static int lacp_port_state_aggregator_selected_set(struct teamd_context *ctx,
 						   struct team_state_gsc *gsc,
 						   void *priv)
 {
-	struct lacp_port_selected_set_info *info;
-	struct lacp *lacp = priv;
+	struct lacp_port *lacp_port = lacp_port_gsc(gsc, priv);
 
 	if (!gsc->data.bool_val)
 		return -EOPNOTSUPP;
-	if (!lacp_port_selected(lacp_port_gsc(gsc, priv)))
+	if (!lacp_port_selected(lacp_port))
 		return -EINVAL;
-	info = malloc(sizeof(*info));
-	if (!info)
-		return -ENOMEM;
-	teamd_workq_init_work(&info->workq, lacp_port_aggregator_select_work);
-	info->lacp = lacp;
-	info->ifindex = gsc->info.tdport->ifindex;
-	teamd_workq_schedule_work(ctx, &info->workq);
+	teamd_workq_schedule_work(ctx, &lacp_port->agg_select_workq);
 	return 0;
 }
 
@@ -1772,6 +1798,7 @@ static int lacp_init(struct teamd_context *ctx, void *priv)
 	}
 
 	lacp->ctx = ctx;
+	teamd_workq_init_work(&lacp->agg_update_workq, lacp_agg_update_work);
 	err = teamd_hash_func_set(ctx);
 	if (err)
 		return err;
@@ -1806,6 +1833,7 @@ balancer_fini:
 	teamd_balancer_fini(lacp->tb);
 event_watch_unregister:
 	teamd_event_watch_unregister(ctx, &lacp_port_watch_ops, lacp);
+	teamd_workq_cancel_work(ctx, &lacp->agg_update_workq);
 	return err;
 }
 
@@ -1816,6 +1844,7 @@ static void lacp_fini(struct teamd_context *ctx, void *priv)
 	teamd_state_val_unregister(ctx, &lacp_state_vg, lacp);
 	teamd_balancer_fini(lacp->tb);
 	teamd_event_watch_unregister(ctx, &lacp_port_watch_ops, lacp);
+	teamd_workq_cancel_work(ctx, &lacp->agg_update_workq);
 	lacp_carrier_fini(ctx, lacp);
 }
 
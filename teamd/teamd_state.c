@@ -672,7 +672,41 @@ static int setup_state_pid_file_get(struct teamd_context *ctx,
 	return 0;
 }
 
-static const struct teamd_state_val setup_state_vals[] = {
+static int setup_state_alloc_count_get(struct teamd_context *ctx,
+				       struct team_state_gsc *gsc,
+				       void *priv)
+{
+	gsc->data.int_val = team_get_alloc_count(ctx->th);
+	return 0;
+}
+
+static int setup_state_overrun_count_get(struct teamd_context *ctx,
+					 struct team_state_gsc *gsc,
+					 void *priv)
+{
+	gsc->data.int_val = team_get_overrun_count(ctx->th);
+	return 0;
+}
+
+static int setup_state_resync_count_get(struct teamd_context *ctx,
+					struct team_state_gsc *gsc,
+					void *priv)
+{
+	gsc->data.int_val = team_get_resync_count(ctx->th);
+	return 0;
+}
+
+static int setup_state_realtime_get(struct teamd_context *ctx,
+				    struct team_state_gsc *gsc,
+				    void *priv)
+{
+	struct teamd_context *root = ctx->multi.master ? : ctx;
+
+	gsc->data.bool_val = root->realtime.enabled;
+	return 0;
+}
+
+static const struct teamd_state_val setup_team_state_vals[] = {
 	{
 		.subpath = "runner_name",
 		.type = TEAMD_STATE_ITEM_TYPE_STRING,
@@ -683,6 +717,24 @@ static const struct teamd_state_val setup_state_vals[] = {
 		.type = TEAMD_STATE_ITEM_TYPE_STRING,
 		.getter = setup_state_kernel_team_mode_name_get,
 	},
+	{
+		.subpath = "alloc_count",
+		.type = TEAMD_STATE_ITEM_TYPE_INT,
+		.getter = setup_state_alloc_count_get,
+	},
+	{
+		.subpath = "overrun_count",
+		.type = TEAMD_STATE_ITEM_TYPE_INT,
+		.getter = setup_state_overrun_count_get,
+	},
+	{
+		.subpath = "resync_count",
+		.type = TEAMD_STATE_ITEM_TYPE_INT,
+		.getter = setup_state_resync_count_get,
+	},
+};
+
+static const struct teamd_state_val setup_state_vals[] = {
 	{
 		.subpath = "dbus_enabled",
 		.type = TEAMD_STATE_ITEM_TYPE_BOOL,
@@ -714,9 +766,172 @@ static const struct teamd_state_val setup_state_vals[] = {
 		.type = TEAMD_STATE_ITEM_TYPE_STRING,
 		.getter = setup_state_pid_file_get,
 	},
+	{
+		.subpath = "realtime",
+		.type = TEAMD_STATE_ITEM_TYPE_BOOL,
+		.getter = setup_state_realtime_get,
+	},
 };
 
-static const struct teamd_state_val state_vgs[] = {
+static int setup_timers_state_resolution_us_get(struct teamd_context *ctx,
+						struct team_state_gsc *gsc,
+						void *priv)
+{
+	gsc->data.int_val = ctx->run_loop->timers.resolution_ns / 1000;
+	return 0;
+}
+
+static int setup_timers_state_count_get(struct teamd_context *ctx,
+					struct team_state_gsc *gsc,
+					void *priv)
+{
+	gsc->data.int_val = ctx->run_loop->timers.count;
+	return 0;
+}
+
+static int setup_timers_state_armed_get(struct teamd_context *ctx,
+					struct team_state_gsc *gsc,
+					void *priv)
+{
+	gsc->data.int_val = ctx->run_loop->timers.heap_count;
+	return 0;
+}
+
+static int setup_timers_state_wakeups_get(struct teamd_context *ctx,
+					  struct team_state_gsc *gsc,
+					  void *priv)
+{
+	gsc->data.int_val = ctx->run_loop->timers.wakeups;
+	return 0;
+}
+
+static int setup_timers_state_expirations_get(struct teamd_context *ctx,
+					      struct team_state_gsc *gsc,
+					      void *priv)
+{
+	gsc->data.int_val = ctx->run_loop->timers.expirations;
+	return 0;
+}
+
+static const struct teamd_state_val setup_timers_state_vals[] = {
+	{
+		.subpath = "resolution_us",
+		.type = TEAMD_STATE_ITEM_TYPE_INT,
+		.getter = setup_timers_state_resolution_us_get,
+	},
+	{
+		.subpath = "count",
+		.type = TEAMD_STATE_ITEM_TYPE_INT,
+		.getter = setup_timers_state_count_get,
+	},
+	{
+		.subpath = "armed",
+		.type = TEAMD_STATE_ITEM_TYPE_INT,
+		.getter = setup_timers_state_armed_get,
+	},
+	{
+		.subpath = "wakeups",
+		.type = TEAMD_STATE_ITEM_TYPE_INT,
+		.getter = setup_timers_state_wakeups_get,
+	},
+	{
+		.subpath = "expirations",
+		.type = TEAMD_STATE_ITEM_TYPE_INT,
+		.getter = setup_timers_state_expirations_get,
+	},
+};
+
+static int setup_loop_state_iterations_get(struct teamd_context *ctx,
+					   struct team_state_gsc *gsc,
+					   void *priv)
+{
+	gsc->data.int_val = ctx->run_loop->iterations;
+	return 0;
+}
+
+static int setup_loop_state_stalls_get(struct teamd_context *ctx,
+				       struct team_state_gsc *gsc,
+				       void *priv)
+{
+	gsc->data.int_val = ctx->run_loop->stalls;
+	return 0;
+}
+
+static int setup_loop_state_stall_budget_get(struct teamd_context *ctx,
+					     struct team_state_gsc *gsc,
+					     void *priv)
+{
+	gsc->data.int_val = ctx->run_loop->stall_budget_ms;
+	return 0;
+}
+
+static int setup_loop_state_stall_budget_set(struct teamd_context *ctx,
+					     struct team_state_gsc *gsc,
+					     void *priv)
+{
+	if (gsc->data.int_val < 0)
+		return -EINVAL;
+	ctx->run_loop->stall_budget_ms = gsc->data.int_val;
+	return 0;
+}
+
+static int setup_loop_state_low_prio_budget_get(struct teamd_context *ctx,
+						struct team_state_gsc *gsc,
+						void *priv)
+{
+	gsc->data.int_val = ctx->run_loop->low_prio_budget_ms;
+	return 0;
+}
+
+static int setup_loop_state_low_prio_budget_set(struct teamd_context *ctx,
+						struct team_state_gsc *gsc,
+						void *priv)
+{
+	if (gsc->data.int_val < 0)
+		return -EINVAL;
+	ctx->run_loop->low_prio_budget_ms = gsc->data.int_val;
+	return 0;
+}
+
+static int setup_loop_state_low_prio_deferrals_get(struct teamd_context *ctx,
+						   struct team_state_gsc *gsc,
+						   void *priv)
+{
+	gsc->data.int_val = ctx->run_loop->low_prio_deferrals;
+	return 0;
+}
+
+static const struct teamd_state_val setup_loop_state_vals[] = {
+	{
+		.subpath = "iterations",
+		.type = TEAMD_STATE_ITEM_TYPE_INT,
+		.getter = setup_loop_state_iterations_get,
+	},
+	{
+		.subpath = "stalls",
+		.type = TEAMD_STATE_ITEM_TYPE_INT,
+		.getter = setup_loop_state_stalls_get,
+	},
+	{
+		.subpath = "stall_budget",
+		.type = TEAMD_STATE_ITEM_TYPE_INT,
+		.getter = setup_loop_state_stall_budget_get,
+		.setter = setup_loop_state_stall_budget_set,
+	},
+	{
+		.subpath = "low_prio_budget",
+		.type = TEAMD_STATE_ITEM_TYPE_INT,
+		.getter = setup_loop_state_low_prio_budget_get,
+		.setter = setup_loop_state_low_prio_budget_set,
+	},
+	{
+		.subpath = "low_prio_deferrals",
+		.type = TEAMD_STATE_ITEM_TYPE_INT,
+		.getter = setup_loop_state_low_prio_deferrals_get,
+	},
+};
+
+static const struct teamd_state_val team_state_vgs[] = {
 	{
 		.subpath = "team_device.ifinfo",
 		.vals = ifinfo_state_vals,
@@ -736,27 +951,76 @@ static const struct teamd_state_val state_vgs[] = {
 	},
 	{
 		.subpath = "setup",
-		.vals = setup_state_vals,
-		.vals_count = ARRAY_SIZE(setup_state_vals),
+		.vals = setup_team_state_vals,
+		.vals_count = ARRAY_SIZE(setup_team_state_vals),
+	},
+};
+
+static const struct teamd_state_val team_state_vg = {
+	.vals = team_state_vgs,
+	.vals_count = ARRAY_SIZE(team_state_vgs),
+};
+
+static const struct teamd_state_val setup_state_vg = {
+	.subpath = "setup",
+	.vals = setup_state_vals,
+	.vals_count = ARRAY_SIZE(setup_state_vals),
+};
+
+static const struct teamd_state_val loop_state_vgs[] = {
+	{
+		.subpath = "setup.loop",
+		.vals = setup_loop_state_vals,
+		.vals_count = ARRAY_SIZE(setup_loop_state_vals),
+	},
+	{
+		.subpath = "setup.timers",
+		.vals = setup_timers_state_vals,
+		.vals_count = ARRAY_SIZE(setup_timers_state_vals),
 	},
 };
 
-static const struct teamd_state_val root_state_vg = {
-	.vals = state_vgs,
-	.vals_count = ARRAY_SIZE(state_vgs),
+static const struct teamd_state_val loop_state_vg = {
+	.vals = loop_state_vgs,
+	.vals_count = ARRAY_SIZE(loop_state_vgs),
 };
 
+/*
+ * Multi-team instance has no team device and no runner. Run loop is
+ * shared by all hosted teams so only the instance exposes it.
+ */
 int teamd_state_basics_init(struct teamd_context *ctx)
 {
 	int err;
 
-	err = teamd_state_val_register(ctx, &root_state_vg, ctx);
+	if (!ctx->multi.enabled) {
+		err = teamd_state_val_register(ctx, &team_state_vg, ctx);
+		if (err)
+			return err;
+	}
+	err = teamd_state_val_register(ctx, &setup_state_vg, ctx);
 	if (err)
-		return err;
+		goto team_unregister;
+	if (!ctx->multi.master) {
+		err = teamd_state_val_register(ctx, &loop_state_vg, ctx);
+		if (err)
+			goto setup_unregister;
+	}
 	return 0;
+
+setup_unregister:
+	teamd_state_val_unregister(ctx, &setup_state_vg, ctx);
+team_unregister:
+	if (!ctx->multi.enabled)
+		teamd_state_val_unregister(ctx, &team_state_vg, ctx);
+	return err;
 }
 
 void teamd_state_basics_fini(struct teamd_context *ctx)
 {
-	teamd_state_val_unregister(ctx, &root_state_vg, ctx);
+	if (!ctx->multi.master)
+		teamd_state_val_unregister(ctx, &loop_state_vg, ctx);
+	teamd_state_val_unregister(ctx, &setup_state_vg, ctx);
+	if (!ctx->multi.enabled)
+		teamd_state_val_unregister(ctx, &team_state_vg, ctx);
 }
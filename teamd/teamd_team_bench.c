@@ -0,0 +1,361 @@
+/*
+ *   teamd_team_bench.c - Teamd state dump and tx balancer micro-benchmarks
+ *   Copyright (C) 2026 agent <agent@local>
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ * Runs team emulator and teamd context in-process. For each port count
+ * loadbalance team with basic tx balancer is set up and its run loop is
+ * driven by periodic bench callback. Once all ports are enabled, state
+ * dump is measured. Then emulator sends stats refreshes with traffic
+ * spread over given number of hashes and the time teamd spends in option
+ * change handlers, which is where tb_rebalance() runs, is measured. Output
+ * is one "key=value" record per line. Needs no privileges nor team kernel
+ * module.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <net/if.h>
+#include <libdaemon/dlog.h>
+#include <libdaemon/dsignal.h>
+#include <private/misc.h>
+#include <private/bench.h>
+#include <team.h>
+
+#include "teamd.h"
+#include "teamd_config.h"
+#include "teamd_state.h"
+
+#define BENCH_DUMP_ROUNDS 100
+#define BENCH_REBALANCE_ROUNDS 100
+#define BENCH_HASH_COUNT 256
+#define BENCH_TICK_NS 1000000
+#define BENCH_TIMEOUT_TICKS 10000
+#define BENCH_TICK_CB_NAME "bench_tick"
+#define BENCH_TEAM_NAME "bench_team%u"
+#define BENCH_PORT_NAME "bench_p%u"
+
+static const unsigned int bench_port_counts[] = { 1, 32, 256 };
+static const unsigned int bench_bucket_counts[] = { 16, 64, BENCH_HASH_COUNT };
+
+#define BENCH_PORTS_MAX 256
+
+enum bench_phase {
+	BENCH_PHASE_WAIT_PORTS,
+	BENCH_PHASE_REBALANCE,
+};
+
+struct bench {
+	struct team_emul *	emul;
+	struct teamd_context *	ctx;
+	unsigned int		port_count;
+	enum bench_phase	phase;
+	unsigned int		ticks;
+	unsigned int		bucket_index;
+	unsigned int		round;
+	bool			in_flight;
+	uint64_t		handler_start;
+	uint64_t		handler_elapsed;
+	uint64_t		tx_bytes[BENCH_HASH_COUNT];
+	int			err;
+};
+
+static void bench_quit(struct bench *bench, int err)
+{
+	bench->err = err;
+	teamd_loop_callback_disable(bench->ctx, BENCH_TICK_CB_NAME, bench);
+	teamd_run_loop_quit(bench->ctx, err);
+}
+
+/* Stats option change is wrapped by head and tail handlers */
+static int bench_head_handler_func(struct team_handle *th, void *priv,
+				   team_change_type_mask_t type_mask)
+{
+	struct bench *bench = priv;
+	struct team_option *option;
+
+	team_for_each_changed_option(option, th) {
+		if (team_is_option_changed(option) &&
+		    !strcmp(team_get_option_name(option), "lb_hash_stats")) {
+			bench->handler_start = bench_now();
+			break;
+		}
+	}
+	return 0;
+}
+
+static int bench_tail_handler_func(struct team_handle *th, void *priv,
+				   team_change_type_mask_t type_mask)
+{
+	struct bench *bench = priv;
+
+	if (!bench->handler_start)
+		return 0;
+	bench->handler_elapsed += bench_now() - bench->handler_start;
+	bench->handler_start = 0;
+	bench->in_flight = false;
+	return 0;
+}
+
+static const struct team_change_handler bench_head_handler = {
+	.func = bench_head_handler_func,
+	.type_mask = TEAM_OPTION_CHANGE,
+};
+
+static const struct team_change_handler bench_tail_handler = {
+	.func = bench_tail_handler_func,
+	.type_mask = TEAM_OPTION_CHANGE,
+};
+
+static unsigned int bench_enabled_port_count(struct teamd_context *ctx)
+{
+	struct teamd_port *tdport;
+	unsigned int count = 0;
+	bool enabled;
+
+	teamd_for_each_tdport(tdport, ctx)
+		if (!teamd_port_enabled(ctx, tdport, &enabled) && enabled)
+			count++;
+	return count;
+}
+
+static int bench_state_dump(struct bench *bench)
+{
+	size_t dump_len = 0;
+	uint64_t start;
+	char *dump;
+	unsigned int i;
+	int err;
+
+	start = bench_now();
+	for (i = 0; i < BENCH_DUMP_ROUNDS; i++) {
+		err = teamd_state_dump(bench->ctx, &dump);
+		if (err)
+			return err;
+		dump_len = strlen(dump);
+		free(dump);
+	}
+	bench_record("teamd_state_dump", BENCH_DUMP_ROUNDS, bench_now() - start,
+		     "ports=%u bytes=%zu", bench->port_count, dump_len);
+	return 0;
+}
+
+/*
+ * Traffic goes over first bucket_count hashes only and its amount shifts
+ * every round, so each refresh makes balancer move some hashes.
+ */
+static int bench_stats_refresh(struct bench *bench)
+{
+	unsigned int bucket_count = bench_bucket_counts[bench->bucket_index];
+	unsigned int i;
+
+	for (i = 0; i < BENCH_HASH_COUNT; i++)
+		bench->tx_bytes[i] = i < bucket_count ?
+				     (uint64_t) ((i + bench->round) % 7 + 1) *
+				     1000 * (i + 1) : 0;
+	bench->in_flight = true;
+	bench->ticks = 0;
+	return team_emul_lb_stats_refresh(bench->emul, bench->ctx->ifindex,
+					  bench->tx_bytes);
+}
+
+static int bench_rebalance_next(struct bench *bench)
+{
+	if (++bench->round < BENCH_REBALANCE_ROUNDS)
+		return bench_stats_refresh(bench);
+	bench_record("tb_rebalance", BENCH_REBALANCE_ROUNDS,
+		     bench->handler_elapsed, "ports=%u buckets=%u",
+		     bench->port_count,
+		     bench_bucket_counts[bench->bucket_index]);
+	if (++bench->bucket_index == ARRAY_SIZE(bench_bucket_counts)) {
+		bench_quit(bench, 0);
+		return 0;
+	}
+	bench->round = 0;
+	bench->handler_elapsed = 0;
+	return bench_stats_refresh(bench);
+}
+
+static int bench_tick(struct teamd_context *ctx, int events, void *priv)
+{
+	struct bench *bench = priv;
+	int err = 0;
+
+	if (bench->err)
+		return 0;
+	if (++bench->ticks > BENCH_TIMEOUT_TICKS) {
+		fprintf(stderr, "Benchmark timed out\n");
+		bench_quit(bench, -ETIMEDOUT);
+		return 0;
+	}
+	switch (bench->phase) {
+	case BENCH_PHASE_WAIT_PORTS:
+		if (bench_enabled_port_count(ctx) != bench->port_count)
+			return 0;
+		err = bench_state_dump(bench);
+		if (err)
+			break;
+		err = team_change_handler_register_head(ctx->th,
+							&bench_head_handler,
+							bench);
+		if (err)
+			break;
+		err = team_change_handler_register(ctx->th, &bench_tail_handler,
+						   bench);
+		if (err)
+			break;
+		bench->phase = BENCH_PHASE_REBALANCE;
+		err = bench_stats_refresh(bench);
+		break;
+	case BENCH_PHASE_REBALANCE:
+		if (bench->in_flight)
+			return 0;
+		err = bench_rebalance_next(bench);
+		break;
+	}
+	if (err)
+		bench_quit(bench, err);
+	return 0;
+}
+
+static char *bench_config_text(unsigned int team_index,
+			       unsigned int port_count)
+{
+	char *text;
+	size_t size;
+	int len;
+	unsigned int i;
+
+	size = 256 + port_count * 32;
+	text = myzalloc(size);
+	if (!text)
+		return NULL;
+	len = snprintf(text, size, "{\"device\": \"" BENCH_TEAM_NAME "\", "
+		       "\"runner\": {\"name\": \"loadbalance\", "
+		       "\"tx_balancer\": {\"name\": \"basic\"}}, "
+		       "\"link_watch\": {\"name\": \"ethtool\"}, "
+		       "\"ports\": {", team_index);
+	for (i = 0; i < port_count; i++)
+		len += snprintf(text + len, size - len,
+				"%s\"" BENCH_PORT_NAME "\": {}",
+				i ? ", " : "", i);
+	snprintf(text + len, size - len, "}}");
+	return text;
+}
+
+static int bench_team(struct team_emul *emul, unsigned int team_index,
+		      unsigned int port_count)
+{
+	struct timespec tick = { .tv_nsec = BENCH_TICK_NS };
+	struct bench bench = {
+		.emul = emul,
+		.port_count = port_count,
+	};
+	struct teamd_context *ctx;
+	int err;
+
+	ctx = myzalloc(sizeof(*ctx));
+	if (!ctx)
+		return -ENOMEM;
+	bench.ctx = ctx;
+	ctx->argv0 = "teamd_team_bench";
+	ctx->emul_port = team_emul_get_port(emul);
+	ctx->config_text = bench_config_text(team_index, port_count);
+	if (!ctx->config_text) {
+		err = -ENOMEM;
+		goto context_fini;
+	}
+	err = teamd_config_load(ctx);
+	if (err)
+		goto context_fini;
+	err = teamd_get_devname(ctx, false);
+	if (err)
+		goto config_free;
+	err = teamd_init(ctx);
+	if (err)
+		goto config_free;
+
+	err = teamd_loop_callback_timer_add_set(ctx, BENCH_TICK_CB_NAME, &bench,
+						bench_tick, &tick, &tick,
+						TEAMD_LOOP_PRIO_CONTROL);
+	if (err)
+		goto fini;
+	err = teamd_loop_callback_enable(ctx, BENCH_TICK_CB_NAME, &bench);
+	if (err)
+		goto tick_del;
+	err = teamd_run_loop_run(ctx);
+	if (!err)
+		err = bench.err;
+
+	team_change_handler_unregister(ctx->th, &bench_tail_handler, &bench);
+	team_change_handler_unregister(ctx->th, &bench_head_handler, &bench);
+tick_del:
+	teamd_loop_callback_del(ctx, BENCH_TICK_CB_NAME, &bench);
+fini:
+	teamd_fini(ctx);
+config_free:
+	teamd_config_free(ctx);
+context_fini:
+	teamd_context_fini(ctx);
+	return err;
+}
+
+int main(int argc, char **argv)
+{
+	struct team_emul *emul;
+	char ifname[IFNAMSIZ];
+	unsigned int i;
+	int err = 0;
+
+	daemon_set_verbosity(LOG_WARNING);
+	daemon_log_ident = daemon_ident_from_argv0(argv[0]);
+
+	emul = team_emul_alloc();
+	if (!emul)
+		return EXIT_FAILURE;
+	for (i = 0; !err && i < BENCH_PORTS_MAX; i++) {
+		snprintf(ifname, sizeof(ifname), BENCH_PORT_NAME, i);
+		err = team_emul_link_add(emul, ifname, "dummy", NULL);
+	}
+	if (!err)
+		err = team_emul_start(emul);
+	if (err) {
+		fprintf(stderr, "Failed to set up emulator (%d)\n", err);
+		return EXIT_FAILURE;
+	}
+
+	if (daemon_signal_init(SIGINT, SIGTERM, SIGQUIT, SIGHUP, 0) < 0) {
+		fprintf(stderr, "Failed to register signal handlers\n");
+		return EXIT_FAILURE;
+	}
+	for (i = 0; !err && i < ARRAY_SIZE(bench_port_counts); i++)
+		err = bench_team(emul, i, bench_port_counts[i]);
+	daemon_signal_done();
+	team_emul_free(emul);
+	if (err) {
+		fprintf(stderr, "Benchmark failed (%d)\n", err);
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
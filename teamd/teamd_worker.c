@@ -0,0 +1,258 @@
+/*
+ *   teamd_worker.c - Teamd worker threads for blocking jobs
+ *   Copyright (C) 2026 agent <agent@local>
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <private/list.h>
+#include <private/misc.h>
+
+#include "teamd.h"
+#include "teamd_worker.h"
+
+/*
+ * Jobs which may block (name resolution, sysfs reads) are run by a small
+ * pool of threads so they do not hold up the run loop. Finished jobs are
+ * put on done list and the loop is woken up by eventfd to call their done
+ * funcs. Threads are started on the first submitted job.
+ */
+
+#define TEAMD_WORKER_THREAD_COUNT 2
+#define WORKER_CB_NAME "worker"
+
+static void *teamd_worker_thread(void *arg)
+{
+	struct teamd_context *ctx = arg;
+	struct teamd_worker_job *job;
+	const uint64_t one = 1;
+	int ret;
+
+	pthread_mutex_lock(&ctx->worker.lock);
+	while (1) {
+		while (!ctx->worker.quit && list_empty(&ctx->worker.job_list))
+			pthread_cond_wait(&ctx->worker.cond, &ctx->worker.lock);
+		if (ctx->worker.quit)
+			break;
+		job = list_get_node_entry(ctx->worker.job_list.next,
+					  struct teamd_worker_job, list);
+		list_del(&job->list);
+		if (!job->canceled) {
+			pthread_mutex_unlock(&ctx->worker.lock);
+			job->err = job->func(job);
+			pthread_mutex_lock(&ctx->worker.lock);
+		}
+		list_add_tail(&ctx->worker.done_list, &job->list);
+retry:
+		ret = write(ctx->worker.efd, &one, sizeof(one));
+		if (ret == -1 && errno == EINTR)
+			goto retry;
+	}
+	pthread_mutex_unlock(&ctx->worker.lock);
+	return NULL;
+}
+
+static int teamd_worker_threads_start(struct teamd_context *ctx)
+{
+	struct sched_param param;
+	pthread_attr_t attr;
+	sigset_t sigset;
+	sigset_t oldset;
+	unsigned int i;
+	int err = 0;
+
+	ctx->worker.threads = myzalloc(TEAMD_WORKER_THREAD_COUNT *
+				       sizeof(pthread_t));
+	if (!ctx->worker.threads)
+		return -ENOMEM;
+
+	/*
+	 * Jobs block, so they must not inherit SCHED_FIFO of the loop
+	 * thread in realtime mode.
+	 */
+	memset(&param, 0, sizeof(param));
+	pthread_attr_init(&attr);
+	pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+	pthread_attr_setschedpolicy(&attr, SCHED_OTHER);
+	pthread_attr_setschedparam(&attr, &param);
+
+	/* Signals are handled by the loop thread only */
+	sigfillset(&sigset);
+	pthread_sigmask(SIG_BLOCK, &sigset, &oldset);
+	for (i = 0; i < TEAMD_WORKER_THREAD_COUNT; i++) {
+		err = pthread_create(&ctx->worker.threads[i], &attr,
+				     teamd_worker_thread, ctx);
+		if (err) {
+			teamd_log_err("Failed to start worker thread.");
+			err = -err;
+			break;
+		}
+		ctx->worker.thread_count++;
+	}
+	pthread_sigmask(SIG_SETMASK, &oldset, NULL);
+	pthread_attr_destroy(&attr);
+	if (!ctx->worker.thread_count) {
+		free(ctx->worker.threads);
+		ctx->worker.threads = NULL;
+		return err;
+	}
+	return 0;
+}
+
+static void teamd_worker_threads_stop(struct teamd_context *ctx)
+{
+	unsigned int i;
+
+	pthread_mutex_lock(&ctx->worker.lock);
+	ctx->worker.quit = true;
+	pthread_cond_broadcast(&ctx->worker.cond);
+	pthread_mutex_unlock(&ctx->worker.lock);
+	for (i = 0; i < ctx->worker.thread_count; i++)
+		pthread_join(ctx->worker.threads[i], NULL);
+	free(ctx->worker.threads);
+	ctx->worker.threads = NULL;
+	ctx->worker.thread_count = 0;
+}
+
+static void teamd_worker_jobs_done(struct teamd_context *ctx,
+				   struct list_item *list)
+{
+	struct teamd_worker_job *job;
+	struct teamd_worker_job *tmp;
+
+	list_for_each_node_entry_safe(job, tmp, list, list) {
+		list_del(&job->list);
+		job->done(ctx, job, job->canceled ? -ECANCELED : job->err);
+	}
+}
+
+static int teamd_worker_callback_efd(struct teamd_context *ctx, int events,
+				     void *priv)
+{
+	struct list_item done_list;
+	uint64_t count;
+	int ret;
+
+	ret = read(ctx->worker.efd, &count, sizeof(count));
+	if (ret == -1 && errno != EAGAIN && errno != EINTR)
+		return -errno;
+
+	list_init(&done_list);
+	pthread_mutex_lock(&ctx->worker.lock);
+	list_move_nodes(&done_list, &ctx->worker.done_list);
+	pthread_mutex_unlock(&ctx->worker.lock);
+	teamd_worker_jobs_done(ctx, &done_list);
+	return 0;
+}
+
+int teamd_worker_init(struct teamd_context *ctx)
+{
+	int err;
+
+	list_init(&ctx->worker.job_list);
+	list_init(&ctx->worker.done_list);
+	ctx->worker.efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (ctx->worker.efd == -1) {
+		teamd_log_err("Failed to create worker eventfd.");
+		return -errno;
+	}
+	pthread_mutex_init(&ctx->worker.lock, NULL);
+	pthread_cond_init(&ctx->worker.cond, NULL);
+
+	err = teamd_loop_callback_fd_add(ctx, WORKER_CB_NAME, ctx,
+					 teamd_worker_callback_efd,
+					 ctx->worker.efd,
+					 TEAMD_LOOP_FD_EVENT_READ,
+					 TEAMD_LOOP_PRIO_PROTOCOL);
+	if (err) {
+		teamd_log_err("Failed add worker callback.");
+		goto close_efd;
+	}
+	teamd_loop_callback_enable(ctx, WORKER_CB_NAME, ctx);
+	return 0;
+
+close_efd:
+	pthread_cond_destroy(&ctx->worker.cond);
+	pthread_mutex_destroy(&ctx->worker.lock);
+	close(ctx->worker.efd);
+	return err;
+}
+
+void teamd_worker_fini(struct teamd_context *ctx)
+{
+	struct teamd_worker_job *job;
+
+	/* Running jobs are waited for, pending ones are not run at all */
+	if (ctx->worker.threads)
+		teamd_worker_threads_stop(ctx);
+	list_for_each_node_entry(job, &ctx->worker.job_list, list)
+		job->canceled = true;
+	list_move_nodes(&ctx->worker.done_list, &ctx->worker.job_list);
+	teamd_worker_jobs_done(ctx, &ctx->worker.done_list);
+
+	teamd_loop_callback_del(ctx, WORKER_CB_NAME, ctx);
+	pthread_cond_destroy(&ctx->worker.cond);
+	pthread_mutex_destroy(&ctx->worker.lock);
+	close(ctx->worker.efd);
+}
+
+void teamd_worker_job_init(struct teamd_worker_job *job,
+			   teamd_worker_job_func_t func,
+			   teamd_worker_job_done_func_t done)
+{
+	job->func = func;
+	job->done = done;
+	job->err = 0;
+	job->canceled = false;
+	list_init(&job->list);
+}
+
+int teamd_worker_job_submit(struct teamd_context *ctx,
+			    struct teamd_worker_job *job)
+{
+	int err;
+
+	if (!ctx->worker.threads) {
+		err = teamd_worker_threads_start(ctx);
+		if (err)
+			return err;
+	}
+	pthread_mutex_lock(&ctx->worker.lock);
+	list_add_tail(&ctx->worker.job_list, &job->list);
+	pthread_cond_signal(&ctx->worker.cond);
+	pthread_mutex_unlock(&ctx->worker.lock);
+	return 0;
+}
+
+/*
+ * Job which has not started yet is not run at all, running one is let
+ * finish. Either way the done func gets called later.
+ */
+void teamd_worker_job_cancel(struct teamd_context *ctx,
+			     struct teamd_worker_job *job)
+{
+	pthread_mutex_lock(&ctx->worker.lock);
+	job->canceled = true;
+	pthread_mutex_unlock(&ctx->worker.lock);
+}
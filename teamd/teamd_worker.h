@@ -0,0 +1,56 @@
+/*
+ *   teamd_worker.h - Teamd worker threads for blocking jobs
+ *   Copyright (C) 2026 agent <agent@local>
+ *
+ *   This library is free software; you can redistribute it and/or
+ *   modify it under the terms of the GNU Lesser General Public
+ *   License as published by the Free Software Foundation; either
+ *   version 2.1 of the License, or (at your option) any later version.
+ *
+ *   This library is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ *   Lesser General Public License for more details.
+ *
+ *   You should have received a copy of the GNU Lesser General Public
+ *   License along with this library; if not, write to the Free Software
+ *   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _TEAMD_WORKER_H_
+#define _TEAMD_WORKER_H_
+
+#include <stdbool.h>
+#include "teamd.h"
+
+/*
+ * Job func runs in worker thread. It must only touch data owned by the
+ * job, never ctx nor anything reachable from it. Job done func runs in
+ * run loop afterwards, exactly once for each submitted job, and it is
+ * the place to free the job. Canceled job is done with -ECANCELED and
+ * its done func must not touch the job submitter anymore.
+ */
+struct teamd_worker_job;
+typedef int (*teamd_worker_job_func_t)(struct teamd_worker_job *job);
+typedef void (*teamd_worker_job_done_func_t)(struct teamd_context *ctx,
+					     struct teamd_worker_job *job,
+					     int err);
+struct teamd_worker_job {
+	struct list_item list;
+	teamd_worker_job_func_t func;
+	teamd_worker_job_done_func_t done;
+	int err;
+	bool canceled;
+};
+
+int teamd_worker_init(struct teamd_context *ctx);
+void teamd_worker_fini(struct teamd_context *ctx);
+void teamd_worker_job_init(struct teamd_worker_job *job,
+			   teamd_worker_job_func_t func,
+			   teamd_worker_job_done_func_t done);
+int teamd_worker_job_submit(struct teamd_context *ctx,
+			    struct teamd_worker_job *job);
+void teamd_worker_job_cancel(struct teamd_context *ctx,
+			     struct teamd_worker_job *job);
+
+#endif /* _TEAMD_WORKER_H_ */
@@ -18,71 +18,177 @@
  */
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <unistd.h>
-#include <fcntl.h>
+#include <time.h>
 #include <errno.h>
+#include <sys/eventfd.h>
 #include <private/misc.h>
 
 #include "teamd_workq.h"
 
+/*
+ * Work item is its own coalescing key. Scheduling an item which is already
+ * queued does nothing, so a burst of events scheduling the same item makes
+ * its func run only once. Eventfd is written only when the queue goes from
+ * idle to pending, the loop callback stays enabled all the time.
+ *
+ * Delayed items sit on a list sorted by deadline. One loop timer is armed
+ * for the earliest of them.
+ */
+
 #define WORKQ_CB_NAME "workq"
+#define WORKQ_DELAYED_CB_NAME "workq_delayed"
 
-static int teamd_workq_callback_socket(struct teamd_context *ctx, int events,
-				       void *priv)
+static uint64_t teamd_workq_now(void)
 {
-	struct teamd_workq *workq;
-	struct teamd_workq *tmp;
-	char bytes[16];
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void teamd_workq_kick(struct teamd_context *ctx)
+{
+	const uint64_t one = 1;
 	int ret;
+
+	if (ctx->workq.pending)
+		return;
+retry:
+	ret = write(ctx->workq.efd, &one, sizeof(one));
+	if (ret == -1 && errno == EINTR)
+		goto retry;
+	ctx->workq.pending = true;
+}
+
+static int teamd_workq_run(struct teamd_context *ctx)
+{
+	struct list_item run_list;
+	struct teamd_workq *workq;
 	int err;
 
+	/* Items scheduled by funcs run next time */
+	list_init(&run_list);
+	list_move_nodes(&run_list, &ctx->workq.work_list);
+	while (!list_empty(&run_list)) {
+		workq = list_get_node_entry(run_list.next,
+					    struct teamd_workq, list);
+		list_del(&workq->list);
+		list_init(&workq->list);
+		err = workq->func(ctx, workq);
+		if (err) {
+			/* Keep the rest queued in front of newly scheduled */
+			list_move_nodes(&run_list, &ctx->workq.work_list);
+			list_move_nodes(&ctx->workq.work_list, &run_list);
+			if (!list_empty(&ctx->workq.work_list))
+				teamd_workq_kick(ctx);
+			return err;
+		}
+	}
+	return 0;
+}
+
+static int teamd_workq_callback_efd(struct teamd_context *ctx, int events,
+				    void *priv)
+{
+	uint64_t count;
+	int ret;
+
 again:
-	ret = read(ctx->workq.pipe_r, bytes, sizeof(bytes));
+	ret = read(ctx->workq.efd, &count, sizeof(count));
 	if (ret == -1) {
 		if (errno == EINTR)
 			goto again;
 		else if (errno != EAGAIN)
 			return -errno;
 	}
+	ctx->workq.pending = false;
+	return teamd_workq_run(ctx);
+}
 
-	teamd_loop_callback_disable(ctx, WORKQ_CB_NAME, ctx);
+static int teamd_workq_delayed_rearm(struct teamd_context *ctx)
+{
+	struct teamd_workq *workq;
+	struct timespec ts = {0, 0};
+	uint64_t now;
 
-	list_for_each_node_entry_safe(workq, tmp, &ctx->workq.work_list, list) {
+	if (!list_empty(&ctx->workq.delayed_list)) {
+		workq = list_get_node_entry(ctx->workq.delayed_list.next,
+					    struct teamd_workq, list);
+		now = teamd_workq_now();
+		if (workq->deadline > now) {
+			ts.tv_sec = (workq->deadline - now) / 1000000000;
+			ts.tv_nsec = (workq->deadline - now) % 1000000000;
+		} else {
+			ts.tv_nsec = 1;
+		}
+	}
+	/* Zero initial disarms the timer */
+	return teamd_loop_lcb_timer_set(ctx, ctx->workq.delayed_lcb,
+					NULL, &ts);
+}
+
+static int teamd_workq_callback_delayed(struct teamd_context *ctx, int events,
+					void *priv)
+{
+	struct teamd_workq *workq;
+	struct teamd_workq *tmp;
+	uint64_t now = teamd_workq_now();
+	int err;
+
+	list_for_each_node_entry_safe(workq, tmp, &ctx->workq.delayed_list,
+				      list) {
+		if (workq->deadline > now)
+			break;
 		list_del(&workq->list);
-		list_init(&workq->list);
-		err = workq->func(ctx, workq);
-		if (err)
-			return err;
+		workq->delayed = false;
+		list_add_tail(&ctx->workq.work_list, &workq->list);
 	}
-	return 0;
+	err = teamd_workq_delayed_rearm(ctx);
+	if (err)
+		return err;
+	return teamd_workq_run(ctx);
 }
 
 int teamd_workq_init(struct teamd_context *ctx)
 {
-	int fds[2];
 	int err;
 
 	list_init(&ctx->workq.work_list);
-	err = pipe2(fds, O_NONBLOCK);
-	if (err)
+	list_init(&ctx->workq.delayed_list);
+	ctx->workq.pending = false;
+	ctx->workq.efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (ctx->workq.efd == -1)
 		return -errno;
-	ctx->workq.pipe_r = fds[0];
-	ctx->workq.pipe_w = fds[1];
 
 	err = teamd_loop_callback_fd_add_tail(ctx, WORKQ_CB_NAME, ctx,
-					      teamd_workq_callback_socket,
-					      ctx->workq.pipe_r,
-					      TEAMD_LOOP_FD_EVENT_READ);
+					      teamd_workq_callback_efd,
+					      ctx->workq.efd,
+					      TEAMD_LOOP_FD_EVENT_READ,
+					      TEAMD_LOOP_PRIO_LINK);
 	if (err) {
 		teamd_log_err("Failed add workq callback.");
-		goto close_pipe;
+		goto close_efd;
 	}
+	err = teamd_loop_callback_timer_add(ctx, WORKQ_DELAYED_CB_NAME, ctx,
+					    teamd_workq_callback_delayed,
+					    TEAMD_LOOP_PRIO_LINK);
+	if (err) {
+		teamd_log_err("Failed add workq delayed callback.");
+		goto callback_del;
+	}
+	ctx->workq.delayed_lcb = teamd_loop_lcb_get(ctx, WORKQ_DELAYED_CB_NAME,
+						    ctx);
+	teamd_loop_callback_enable(ctx, WORKQ_CB_NAME, ctx);
+	teamd_loop_callback_enable(ctx, WORKQ_DELAYED_CB_NAME, ctx);
 	return 0;
 
-close_pipe:
-	close(ctx->workq.pipe_r);
-	close(ctx->workq.pipe_w);
-	return 0;
+callback_del:
+	teamd_loop_callback_del(ctx, WORKQ_CB_NAME, ctx);
+close_efd:
+	close(ctx->workq.efd);
+	return err;
 }
 
 void teamd_workq_fini(struct teamd_context *ctx)
@@ -90,38 +196,82 @@ void teamd_workq_fini(struct teamd_context *ctx)
 	struct teamd_workq *workq;
 	struct teamd_workq *tmp;
 
+	teamd_loop_callback_del(ctx, WORKQ_DELAYED_CB_NAME, ctx);
 	teamd_loop_callback_del(ctx, WORKQ_CB_NAME, ctx);
-	close(ctx->workq.pipe_r);
-	close(ctx->workq.pipe_w);
+	close(ctx->workq.efd);
+	list_move_nodes(&ctx->workq.work_list, &ctx->workq.delayed_list);
 	list_for_each_node_entry_safe(workq, tmp, &ctx->workq.work_list, list) {
 		list_del(&workq->list);
 		list_init(&workq->list);
+		workq->delayed = false;
 	}
 }
 
-static void teamd_workq_set_for_process(struct teamd_context *ctx)
+void teamd_workq_schedule_work(struct teamd_context *ctx,
+			       struct teamd_workq *workq)
 {
-	int err;
-	const char byte = 0;
+	if (!list_empty(&workq->list)) {
+		if (!workq->delayed)
+			return;
+		/* Run delayed item right away */
+		teamd_workq_cancel_work(ctx, workq);
+	}
+	list_add_tail(&ctx->workq.work_list, &workq->list);
+	teamd_workq_kick(ctx);
+}
 
-retry:
-	err = write(ctx->workq.pipe_w, &byte, 1);
-	if (err == -1 && errno == EINTR)
-		goto retry;
-	teamd_loop_callback_enable(ctx, WORKQ_CB_NAME, ctx);
+/*
+ * Item is run at or after given delay. If it is already queued, it is run
+ * at the earlier of both times.
+ */
+int teamd_workq_schedule_delayed_work(struct teamd_context *ctx,
+				      struct teamd_workq *workq,
+				      const struct timespec *delay)
+{
+	struct teamd_workq *cur;
+	uint64_t deadline;
+
+	deadline = teamd_workq_now() + (uint64_t) delay->tv_sec * 1000000000 +
+		   delay->tv_nsec;
+	if (!list_empty(&workq->list)) {
+		if (!workq->delayed || workq->deadline <= deadline)
+			return 0;
+		list_del(&workq->list);
+	}
+	workq->deadline = deadline;
+	workq->delayed = true;
+	list_for_each_node_entry(cur, &ctx->workq.delayed_list, list)
+		if (cur->deadline > deadline)
+			break;
+	/* Either before first later item or at the tail */
+	list_add_tail(&cur->list, &workq->list);
+	return teamd_workq_delayed_rearm(ctx);
 }
 
-void teamd_workq_schedule_work(struct teamd_context *ctx,
-			       struct teamd_workq *workq)
+void teamd_workq_cancel_work(struct teamd_context *ctx,
+			     struct teamd_workq *workq)
 {
-	if (!list_empty(&workq->list))
+	bool was_first;
+
+	if (list_empty(&workq->list))
 		return;
-	list_add_tail(&ctx->workq.work_list, &workq->list);
-	teamd_workq_set_for_process(ctx);
+	was_first = workq->delayed &&
+		    ctx->workq.delayed_list.next == &workq->list;
+	list_del(&workq->list);
+	list_init(&workq->list);
+	workq->delayed = false;
+	if (was_first)
+		teamd_workq_delayed_rearm(ctx);
+}
+
+bool teamd_workq_work_pending(struct teamd_workq *workq)
+{
+	return !list_empty(&workq->list);
 }
 
 void teamd_workq_init_work(struct teamd_workq *workq, teamd_workq_func_t func)
 {
 	workq->func = func;
+	workq->delayed = false;
 	list_init(&workq->list);
 }
@@ -20,6 +20,9 @@
 #ifndef _TEAMD_WORKQ_H_
 #define _TEAMD_WORKQ_H_
 
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
 #include "teamd.h"
 
 struct teamd_workq;
@@ -28,12 +31,20 @@ typedef int (*teamd_workq_func_t)(struct teamd_context *ctx,
 struct teamd_workq {
 	struct list_item list;
 	teamd_workq_func_t func;
+	bool delayed;
+	uint64_t deadline; /* CLOCK_MONOTONIC ns, valid when delayed */
 };
 
 int teamd_workq_init(struct teamd_context *ctx);
 void teamd_workq_fini(struct teamd_context *ctx);
 void teamd_workq_schedule_work(struct teamd_context *ctx,
 			       struct teamd_workq *workq);
+int teamd_workq_schedule_delayed_work(struct teamd_context *ctx,
+				      struct teamd_workq *workq,
+				      const struct timespec *delay);
+void teamd_workq_cancel_work(struct teamd_context *ctx,
+			     struct teamd_workq *workq);
+bool teamd_workq_work_pending(struct teamd_workq *workq);
 void teamd_workq_init_work(struct teamd_workq *workq, teamd_workq_func_t func);
 
 #endif /* _TEAMD_WORKQ_H_ */